@@ -0,0 +1,277 @@
+#include "AfxCapture.h"
+
+#include <string.h>
+
+#include <thread>
+
+namespace advancedfx {
+namespace interop {
+
+static const unsigned char g_CaptureMagic[8] = {'A', 'F', 'X', 'C',
+                                                'A', 'P', 0,   1};
+
+// CCaptureWriter //////////////////////////////////////////////////////////////
+
+bool CCaptureWriter::Open(const char* path) {
+  Close();
+
+  m_File = fopen(path, "wb");
+  if (nullptr == m_File)
+    return false;
+
+  m_Buffer.reserve(64 * 1024);
+  m_Buffer.assign(g_CaptureMagic, g_CaptureMagic + sizeof(g_CaptureMagic));
+  m_Last = std::chrono::steady_clock::now();
+  m_Failed = false;
+  return true;
+}
+
+void CCaptureWriter::Close() {
+  if (nullptr == m_File)
+    return;
+
+  Flush();
+  fclose(m_File);
+  m_File = nullptr;
+  m_Buffer.clear();
+}
+
+void CCaptureWriter::Write(CaptureRecord kind,
+                           const void* bytes,
+                           uint32_t length) {
+  if (nullptr == m_File)
+    return;
+
+  auto now = std::chrono::steady_clock::now();
+  uint64_t deltaUs = (uint64_t)std::chrono::duration_cast<
+                         std::chrono::microseconds>(now - m_Last)
+                         .count();
+  // Only advance by whole microseconds, so rounding errors don't add up:
+  m_Last += std::chrono::microseconds(deltaUs);
+
+  m_Buffer.push_back((unsigned char)kind);
+  AppendVarUInt(deltaUs);
+  AppendVarUInt(length);
+  m_Buffer.insert(m_Buffer.end(), (const unsigned char*)bytes,
+                  (const unsigned char*)bytes + length);
+
+  if (64 * 1024 <= m_Buffer.size())
+    Flush();
+}
+
+void CCaptureWriter::Flush() {
+  if (nullptr == m_File || m_Buffer.empty())
+    return;
+
+  // A damaged capture is useless for replay, so stop at the first error
+  // instead of leaving a gap.
+  if (!m_Failed &&
+      m_Buffer.size() != fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File))
+    m_Failed = true;
+
+  m_Buffer.clear();
+  fflush(m_File);
+}
+
+void CCaptureWriter::AppendVarUInt(uint64_t value) {
+  while (0x80 <= value) {
+    m_Buffer.push_back((unsigned char)(value | 0x80));
+    value >>= 7;
+  }
+  m_Buffer.push_back((unsigned char)value);
+}
+
+// CReplayTransport ////////////////////////////////////////////////////////////
+
+bool CReplayTransport::Open(const char* path) {
+  Close();
+
+  FILE* file = fopen(path, "rb");
+  if (nullptr == file)
+    return false;
+
+  std::vector<unsigned char> bytes;
+  unsigned char buffer[64 * 1024];
+  size_t bytesRead;
+  while (0 < (bytesRead = fread(buffer, 1, sizeof(buffer), file)))
+    bytes.insert(bytes.end(), buffer, buffer + bytesRead);
+
+  bool failed = 0 != ferror(file);
+  fclose(file);
+
+  return !failed && Open(std::move(bytes));
+}
+
+bool CReplayTransport::Open(std::vector<unsigned char>&& bytes) {
+  Close();
+
+  if (bytes.size() < sizeof(g_CaptureMagic) ||
+      0 != memcmp(bytes.data(), g_CaptureMagic, sizeof(g_CaptureMagic)))
+    return false;
+
+  m_Bytes = std::move(bytes);
+  Rewind();
+  return true;
+}
+
+void CReplayTransport::Close() {
+  m_Bytes.clear();
+  m_Bytes.shrink_to_fit();
+  Rewind();
+}
+
+void CReplayTransport::Rewind() {
+  m_ConnectionStart = sizeof(g_CaptureMagic);
+  m_In = Cursor_s();
+  m_In.Position = m_Bytes.size();
+  m_Out = m_In;
+  m_Diverged = false;
+}
+
+bool CReplayTransport::NextConnection() {
+  // Skip the rest of the current connection, up to and including the next
+  // Connect record:
+  size_t position = m_ConnectionStart;
+  while (position < m_Bytes.size()) {
+    CaptureRecord kind;
+    uint64_t deltaUs;
+    size_t data;
+    uint32_t length;
+    if (!ReadRecord(position, kind, deltaUs, data, length))
+      break;
+
+    if (CaptureRecord::Connect == kind) {
+      m_ConnectionStart = position;
+      m_In = Cursor_s();
+      m_In.Position = position;
+      m_Out = m_In;
+      m_Cancelled = false;
+      m_Start = std::chrono::steady_clock::now();
+      return true;
+    }
+  }
+
+  m_ConnectionStart = m_Bytes.size();
+  m_In.Position = m_Bytes.size();
+  m_In.Left = 0;
+  m_Out = m_In;
+  return false;
+}
+
+bool CReplayTransport::ReadSome(void* bytes,
+                                uint32_t length,
+                                uint32_t& outRead) {
+  if (m_Cancelled)
+    return false;
+
+  if (0 == m_In.Left && !Next(m_In, CaptureRecord::In))
+    return false;
+
+  if (m_Paced) {
+    auto due = m_Start + std::chrono::microseconds(m_In.TimeUs);
+    while (!m_Cancelled && std::chrono::steady_clock::now() < due) {
+      auto left = due - std::chrono::steady_clock::now();
+      std::this_thread::sleep_for(
+          left < std::chrono::milliseconds(10) ? left
+                                               : std::chrono::milliseconds(10));
+    }
+    if (m_Cancelled)
+      return false;
+  }
+
+  uint32_t chunk = length < m_In.Left ? length : m_In.Left;
+  memcpy(bytes, &m_Bytes[m_In.Data], chunk);
+  m_In.Data += chunk;
+  m_In.Left -= chunk;
+
+  outRead = chunk;
+  return true;
+}
+
+bool CReplayTransport::WriteSome(const void* bytes,
+                                 uint32_t length,
+                                 uint32_t& outWritten) {
+  if (m_Cancelled || m_Bytes.empty())
+    return false;
+
+  outWritten = length;
+
+  const unsigned char* p = static_cast<const unsigned char*>(bytes);
+  while (!m_Diverged && 0 < length) {
+    if (0 == m_Out.Left && !Next(m_Out, CaptureRecord::Out)) {
+      m_Diverged = true;
+      break;
+    }
+
+    uint32_t chunk = length < m_Out.Left ? length : m_Out.Left;
+    if (0 != memcmp(p, &m_Bytes[m_Out.Data], chunk))
+      m_Diverged = true;
+    m_Out.Data += chunk;
+    m_Out.Left -= chunk;
+    p += chunk;
+    length -= chunk;
+  }
+
+  return true;
+}
+
+bool CReplayTransport::Next(Cursor_s& cursor, CaptureRecord kind) {
+  while (cursor.Position < m_Bytes.size()) {
+    size_t position = cursor.Position;
+    CaptureRecord recordKind;
+    uint64_t deltaUs;
+    size_t data;
+    uint32_t length;
+    if (!ReadRecord(position, recordKind, deltaUs, data, length) ||
+        CaptureRecord::Connect == recordKind)
+      return false;
+
+    cursor.Position = position;
+    cursor.TimeUs += deltaUs;
+
+    if (kind == recordKind && 0 < length) {
+      cursor.Data = data;
+      cursor.Left = length;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool CReplayTransport::ReadRecord(size_t& position,
+                                  CaptureRecord& outKind,
+                                  uint64_t& outDeltaUs,
+                                  size_t& outData,
+                                  uint32_t& outLength) const {
+  auto readVarUInt = [this, &position](uint64_t& outValue) {
+    outValue = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+      if (m_Bytes.size() <= position)
+        return false;
+      unsigned char value = m_Bytes[position++];
+      outValue |= (uint64_t)(value & 0x7f) << shift;
+      if (0 == (value & 0x80))
+        return true;
+    }
+    return false;
+  };
+
+  if (m_Bytes.size() <= position)
+    return false;
+
+  outKind = (CaptureRecord)m_Bytes[position++];
+
+  uint64_t length;
+  if (!readVarUInt(outDeltaUs) || !readVarUInt(length) ||
+      m_Bytes.size() - position < length)
+    return false;
+
+  outData = position;
+  outLength = (uint32_t)length;
+  position += (size_t)length;
+  return true;
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "AfxTransport.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace advancedfx {
+namespace interop {
+
+// Traffic capture file:
+//
+//   "AFXCAP" 0 1                     magic and version
+//   { kind delta length bytes }*     records
+//
+// kind is a CaptureRecord byte, delta the microseconds since the previous
+// record and length the number of bytes that follow, both as unsigned LEB128.
+// Connect records carry no bytes, they separate the connections of a capture.
+
+enum class CaptureRecord : uint8_t {
+  Connect = 1,
+  // Bytes the interop read from the peer.
+  In = 2,
+  // Bytes the interop wrote to the peer.
+  Out = 3
+};
+
+class CCaptureWriter {
+ public:
+  CCaptureWriter() {}
+
+  ~CCaptureWriter() { Close(); }
+
+  CCaptureWriter(const CCaptureWriter& rhs) = delete;
+  CCaptureWriter& operator=(const CCaptureWriter& rhs) = delete;
+
+  /**
+   * Creates (or truncates) the file at path.
+   * @returns false on error.
+   */
+  bool Open(const char* path);
+
+  void Close();
+
+  bool IsOpen() const { return nullptr != m_File; }
+
+  /**
+   * Marks the start of a new connection.
+   */
+  void WriteConnect() { Write(CaptureRecord::Connect, nullptr, 0); }
+
+  void Write(CaptureRecord kind, const void* bytes, uint32_t length);
+
+  /**
+   * Hands the buffered records to the OS.
+   */
+  void Flush();
+
+ private:
+  FILE* m_File = nullptr;
+  std::vector<unsigned char> m_Buffer;
+  std::chrono::steady_clock::time_point m_Last;
+  bool m_Failed = false;
+
+  void AppendVarUInt(uint64_t value);
+};
+
+// Records everything that goes through the wrapped transport.
+class CTapTransport : public CTransport {
+ public:
+  CTapTransport(CTransport* transport = nullptr,
+                CCaptureWriter* capture = nullptr)
+      : m_Transport(transport), m_Capture(capture) {}
+
+  void SetTransport(CTransport* transport) { m_Transport = transport; }
+
+  void SetCapture(CCaptureWriter* capture) { m_Capture = capture; }
+
+  virtual bool ReadSome(void* bytes,
+                        uint32_t length,
+                        uint32_t& outRead) override {
+    if (!m_Transport->ReadSome(bytes, length, outRead))
+      return false;
+    if (m_Capture)
+      m_Capture->Write(CaptureRecord::In, bytes, outRead);
+    return true;
+  }
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override {
+    if (!m_Transport->WriteSome(bytes, length, outWritten))
+      return false;
+    if (m_Capture)
+      m_Capture->Write(CaptureRecord::Out, bytes, outWritten);
+    return true;
+  }
+
+  virtual bool FlushTransport() override {
+    return m_Transport->FlushTransport();
+  }
+
+  virtual void BeginRead() override { m_Transport->BeginRead(); }
+
+  virtual void EndRead() override { m_Transport->EndRead(); }
+
+  virtual void BeginWrite() override { m_Transport->BeginWrite(); }
+
+  virtual void EndWrite() override { m_Transport->EndWrite(); }
+
+ private:
+  CTransport* m_Transport;
+  CCaptureWriter* m_Capture;
+};
+
+// Plays the In records of a capture back as if the peer sent them, one
+// connection at a time. What the interop writes is compared against the Out
+// records, but not sent anywhere.
+class CReplayTransport : public CTransport {
+ public:
+  CReplayTransport() {}
+
+  CReplayTransport(const CReplayTransport& rhs) = delete;
+  CReplayTransport& operator=(const CReplayTransport& rhs) = delete;
+
+  /**
+   * Loads the whole capture into memory.
+   * @returns false on error.
+   */
+  bool Open(const char* path);
+
+  /**
+   * Uses bytes as the capture.
+   * @returns false if they are not a capture.
+   */
+  bool Open(std::vector<unsigned char>&& bytes);
+
+  void Close();
+
+  bool IsOpen() const { return !m_Bytes.empty(); }
+
+  /**
+   * Moves to the next connection of the capture, reads fail at its end.
+   * @returns false if there is none left.
+   */
+  bool NextConnection();
+
+  /**
+   * Rewinds to the start of the capture.
+   */
+  void Rewind();
+
+  /**
+   * If paced, In records are not delivered before the time they were
+   * recorded at (relative to the start of the connection), otherwise as fast
+   * as they are read.
+   */
+  void SetPaced(bool value) { m_Paced = value; }
+
+  /**
+   * Makes the pending and all further reads fail until the next
+   * NextConnection(). Can be called from any thread.
+   */
+  void Cancel() { m_Cancelled = true; }
+
+  /**
+   * @returns true if the interop wrote something different from what it
+   * wrote when the capture was taken.
+   */
+  bool GetDiverged() const { return m_Diverged; }
+
+  virtual bool ReadSome(void* bytes,
+                        uint32_t length,
+                        uint32_t& outRead) override;
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  virtual bool FlushTransport() override { return IsOpen(); }
+
+ private:
+  struct Cursor_s {
+    size_t Position = 0;
+    uint64_t TimeUs = 0;
+    // Of the current record:
+    size_t Data = 0;
+    uint32_t Left = 0;
+  };
+
+  std::vector<unsigned char> m_Bytes;
+  size_t m_ConnectionStart = 0;
+  Cursor_s m_In;
+  Cursor_s m_Out;
+  bool m_Paced = false;
+  bool m_Diverged = false;
+  std::atomic<bool> m_Cancelled{false};
+  std::chrono::steady_clock::time_point m_Start;
+
+  /**
+   * Advances cursor to the next record of kind in the current connection.
+   * @returns false at the end of the connection.
+   */
+  bool Next(Cursor_s& cursor, CaptureRecord kind);
+
+  /**
+   * @returns false on a damaged record.
+   */
+  bool ReadRecord(size_t& position,
+                  CaptureRecord& outKind,
+                  uint64_t& outDeltaUs,
+                  size_t& outData,
+                  uint32_t& outLength) const;
+};
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,298 @@
+#include "AfxGameEventBuffer.h"
+
+#include <string.h>
+
+namespace advancedfx {
+namespace interop {
+
+static size_t AlignTo8(size_t value) {
+  return (value + 7) & ~(size_t)7;
+}
+
+uint32_t GetGameEventColumnWidth(GameEventColumnType type) {
+  switch (type) {
+    case GameEventColumnType::String:
+      return 4;
+    case GameEventColumnType::Float32:
+      return 4;
+    case GameEventColumnType::Int32:
+      return 4;
+    case GameEventColumnType::Int16:
+      return 2;
+    case GameEventColumnType::UInt8:
+      return 1;
+    case GameEventColumnType::Bool:
+      return 1;
+    case GameEventColumnType::UInt64:
+      return 8;
+    case GameEventColumnType::Float32x3:
+      return 12;
+  }
+  return 0;
+}
+
+const char* GetGameEventColumnTypeName(GameEventColumnType type) {
+  switch (type) {
+    case GameEventColumnType::String:
+      return "string";
+    case GameEventColumnType::Float32:
+      return "float32";
+    case GameEventColumnType::Int32:
+      return "int32";
+    case GameEventColumnType::Int16:
+      return "int16";
+    case GameEventColumnType::UInt8:
+      return "uint8";
+    case GameEventColumnType::Bool:
+      return "bool";
+    case GameEventColumnType::UInt64:
+      return "uint64";
+    case GameEventColumnType::Float32x3:
+      return "float32x3";
+  }
+  return nullptr;
+}
+
+GameEventSchemaPtr CreateGameEventSchema(
+    uint32_t id,
+    const KnownGameEvent_s& known,
+    bool clientTime,
+    bool tick,
+    bool systemTime,
+    const std::vector<unsigned int>& enrichments) {
+  GameEventSchemaPtr result = std::make_shared<GameEventSchema_s>();
+  result->Id = id;
+  result->Name = known.Name;
+
+  auto& columns = result->Columns;
+
+  if (clientTime)
+    columns.push_back({"clientTime", nullptr, GameEventColumnType::Float32});
+  if (tick)
+    columns.push_back({"tick", nullptr, GameEventColumnType::Int32});
+  if (systemTime)
+    columns.push_back({"systemTime", nullptr, GameEventColumnType::UInt64});
+
+  size_t index = 0;
+  for (auto itKey = known.Keys.begin(); itKey != known.Keys.end();
+       ++itKey, ++index) {
+    switch (itKey->Type) {
+      case GameEventFieldType::CString:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::String});
+        break;
+      case GameEventFieldType::Float:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::Float32});
+        break;
+      case GameEventFieldType::Long:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::Int32});
+        break;
+      case GameEventFieldType::Short:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::Int16});
+        break;
+      case GameEventFieldType::Byte:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::UInt8});
+        break;
+      case GameEventFieldType::Bool:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::Bool});
+        break;
+      case GameEventFieldType::Uint64:
+        columns.push_back({itKey->Key, nullptr, GameEventColumnType::UInt64});
+        break;
+      default:
+        // HLAE sends no value.
+        break;
+    }
+
+    unsigned int enrichment =
+        index < enrichments.size() ? enrichments[index] : 0;
+
+    if (enrichment & GameEventEnrichment_UserIdWithSteamId)
+      columns.push_back(
+          {itKey->Key, "userIdWithSteamId", GameEventColumnType::UInt64});
+    if (enrichment & GameEventEnrichment_EntnumWithOrigin)
+      columns.push_back(
+          {itKey->Key, "entnumWithOrigin", GameEventColumnType::Float32x3});
+    if (enrichment & GameEventEnrichment_EntnumWithAngles)
+      columns.push_back(
+          {itKey->Key, "entnumWithAngles", GameEventColumnType::Float32x3});
+    if (enrichment & GameEventEnrichment_UseridWithEyePosition)
+      columns.push_back({itKey->Key, "useridWithEyePosition",
+                         GameEventColumnType::Float32x3});
+    // Spelled like the value tree has it.
+    if (enrichment & GameEventEnrichment_UseridWithEyeAngles)
+      columns.push_back({itKey->Key, "useridWithEyeAngels",
+                         GameEventColumnType::Float32x3});
+  }
+
+  return result;
+}
+
+// CGameEventBuffer ////////////////////////////////////////////////////////////
+
+bool CGameEventBuffer::ReadEvent(CTransportStream& stream,
+                                 const GameEventSchemaPtr& schema) {
+  uint32_t blockIndex = GetBlock(schema);
+  Block_s& block = m_Blocks[blockIndex];
+
+  for (size_t i = 0; i < block.Columns.size(); ++i) {
+    if (!ReadColumn(stream, schema->Columns[i].Type, block.Columns[i])) {
+      for (size_t j = 0; j <= i; ++j) {
+        block.Columns[j].resize(
+            block.Rows * GetGameEventColumnWidth(schema->Columns[j].Type));
+      }
+      return false;
+    }
+  }
+
+  ++block.Rows;
+  m_Order.push_back(blockIndex);
+  return true;
+}
+
+void CGameEventBuffer::TakeNewSchemas(
+    std::vector<GameEventSchemaPtr>& outSchemas) {
+  for (uint32_t i = 0; i < m_BlockCount; ++i) {
+    GameEventSchema_s& schema = *m_Blocks[i].Schema;
+    if (!schema.Delivered) {
+      schema.Delivered = true;
+      outSchemas.push_back(m_Blocks[i].Schema);
+    }
+  }
+}
+
+size_t CGameEventBuffer::GetSize() const {
+  size_t size = AlignTo8(GetOrderEnd());
+
+  for (uint32_t i = 0; i < m_BlockCount; ++i) {
+    for (const auto& column : m_Blocks[i].Columns)
+      size += AlignTo8(column.size());
+  }
+
+  size += 4 * (m_StringList.size() + 1);
+  for (const auto& string : m_StringList)
+    size += string.Length;
+
+  return size;
+}
+
+void CGameEventBuffer::Write(unsigned char* bytes) const {
+  uint32_t* header = (uint32_t*)bytes;
+  header[0] = (uint32_t)m_Order.size();
+  header[1] = m_BlockCount;
+  header[2] = (uint32_t)m_StringList.size();
+
+  uint32_t* blocks = header + 4;
+  uint32_t* order = blocks + 4 * m_BlockCount;
+  memcpy(order, m_Order.data(), 4 * m_Order.size());
+
+  size_t offset = AlignTo8(GetOrderEnd());
+  memset(bytes + GetOrderEnd(), 0, offset - GetOrderEnd());
+
+  for (uint32_t i = 0; i < m_BlockCount; ++i) {
+    const Block_s& block = m_Blocks[i];
+    blocks[4 * i + 0] = block.Schema->Id;
+    blocks[4 * i + 1] = block.Rows;
+    blocks[4 * i + 2] = (uint32_t)offset;
+    blocks[4 * i + 3] = 0;
+
+    for (const auto& column : block.Columns) {
+      size_t padded = AlignTo8(column.size());
+      memcpy(bytes + offset, column.data(), column.size());
+      memset(bytes + offset + column.size(), 0, padded - column.size());
+      offset += padded;
+    }
+  }
+
+  header[3] = (uint32_t)offset;
+
+  uint32_t* offsets = (uint32_t*)(bytes + offset);
+  offset += 4 * (m_StringList.size() + 1);
+
+  for (size_t i = 0; i < m_StringList.size(); ++i) {
+    offsets[i] = (uint32_t)offset;
+    memcpy(bytes + offset, m_StringList[i].Data, m_StringList[i].Length);
+    offset += m_StringList[i].Length;
+  }
+  offsets[m_StringList.size()] = (uint32_t)offset;
+}
+
+void CGameEventBuffer::Clear() {
+  for (uint32_t i = 0; i < m_BlockCount; ++i) {
+    Block_s& block = m_Blocks[i];
+    block.Schema.reset();
+    block.Rows = 0;
+    for (auto& column : block.Columns)
+      column.clear();
+  }
+  m_BlockCount = 0;
+  m_Order.clear();
+
+  m_Strings.Clear();
+  m_StringList.clear();
+  m_StringIndices.clear();
+}
+
+uint32_t CGameEventBuffer::GetBlock(const GameEventSchemaPtr& schema) {
+  // Runs of the same event are common, so look from the back:
+  for (uint32_t i = m_BlockCount; 0 < i; --i) {
+    if (m_Blocks[i - 1].Schema == schema)
+      return i - 1;
+  }
+
+  if (m_Blocks.size() <= m_BlockCount)
+    m_Blocks.emplace_back();
+
+  Block_s& block = m_Blocks[m_BlockCount];
+  block.Schema = schema;
+  block.Columns.resize(schema->Columns.size());
+  return m_BlockCount++;
+}
+
+bool CGameEventBuffer::ReadColumn(CTransportStream& stream,
+                                  GameEventColumnType type,
+                                  std::vector<unsigned char>& column) {
+  size_t at = column.size();
+
+  switch (type) {
+    case GameEventColumnType::String: {
+      if (!stream.ReadStringUTF8(m_ReadString))
+        return false;
+
+      StringView_s key;
+      key.Data = m_ReadString.c_str();
+      key.Length = (uint32_t)m_ReadString.length();
+
+      uint32_t index;
+      auto it = m_StringIndices.find(key);
+      if (it != m_StringIndices.end()) {
+        index = it->second;
+      } else {
+        index = (uint32_t)m_StringList.size();
+        StringView_s stored = m_Strings.Store(m_ReadString);
+        m_StringList.push_back(stored);
+        m_StringIndices.emplace(stored, index);
+      }
+
+      column.resize(at + sizeof(index));
+      memcpy(&column[at], &index, sizeof(index));
+      return true;
+    }
+    case GameEventColumnType::Bool: {
+      bool value;
+      if (!stream.ReadBoolean(value))
+        return false;
+      column.push_back(value ? 1 : 0);
+      return true;
+    }
+    default:
+      break;
+  }
+
+  // The others are on the wire as they are in the column:
+  uint32_t width = GetGameEventColumnWidth(type);
+  column.resize(at + width);
+  return stream.ReadBytes(&column[at], 0, width);
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "AfxInteropProtocol.h"
+#include "AfxTransport.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace advancedfx {
+namespace interop {
+
+// Column types of a CGameEventBuffer, each has a fixed width per row.
+enum class GameEventColumnType : uint8_t {
+  // UInt32 index into the string table.
+  String,
+  Float32,
+  Int32,
+  Int16,
+  UInt8,
+  // UInt8, 0 or 1.
+  Bool,
+  UInt64,
+  // x, y, z or pitch, yaw, roll.
+  Float32x3
+};
+
+/**
+ * @returns the bytes a row of type takes.
+ */
+uint32_t GetGameEventColumnWidth(GameEventColumnType type);
+
+/**
+ * @returns the name of type as the page sees it.
+ */
+const char* GetGameEventColumnTypeName(GameEventColumnType type);
+
+struct GameEventColumn_s {
+  // The key, or clientTime, tick and systemTime for the transmitted ones.
+  std::string Name;
+  // Name of the enrichment of key Name, nullptr for the value itself.
+  const char* Enrichment;
+  GameEventColumnType Type;
+};
+
+// How the values of a known game event are laid out, for the transmit and
+// enrichment settings at the time it was made. The columns are in wire
+// order, so reading them in turn reads the event.
+struct GameEventSchema_s {
+  uint32_t Id = 0;
+  std::string Name;
+  std::vector<GameEventColumn_s> Columns;
+  // If it went to the page already.
+  bool Delivered = false;
+};
+
+typedef std::shared_ptr<GameEventSchema_s> GameEventSchemaPtr;
+
+/**
+ * @param enrichments GameEventEnrichment_e of each key of known, in order.
+ */
+GameEventSchemaPtr CreateGameEventSchema(
+    uint32_t id,
+    const KnownGameEvent_s& known,
+    bool clientTime,
+    bool tick,
+    bool systemTime,
+    const std::vector<unsigned int>& enrichments);
+
+// Collects game events column by column, so they can be handed to the page
+// as a single ArrayBuffer without building an object per key. Little endian,
+// like the typed arrays on the machines HLAE runs on:
+//
+//   UInt32 eventCount, blockCount, stringCount, stringsOffset
+//   blockCount times: UInt32 schemaId, rowCount, offset, 0
+//   eventCount times: UInt32 index of the block the event is in, the rows of
+//     a block are in the order the events arrived
+//   for each block, at its offset: the columns of its schema in order, each
+//     rowCount times the width of its type, padded to 8 bytes
+//   at stringsOffset: UInt32 offsets[stringCount + 1] of the UTF-8 strings
+//     in the buffer, string i ends where string i + 1 starts
+//
+// Equal strings of a batch share their index.
+class CGameEventBuffer {
+ public:
+  CGameEventBuffer() {}
+
+  CGameEventBuffer(const CGameEventBuffer& rhs) = delete;
+  CGameEventBuffer& operator=(const CGameEventBuffer& rhs) = delete;
+
+  /**
+   * Reads the values of an event of schema, following its header. On error
+   * the event is dropped, the ones before are kept.
+   */
+  bool ReadEvent(CTransportStream& stream, const GameEventSchemaPtr& schema);
+
+  uint32_t GetEventCount() const { return (uint32_t)m_Order.size(); }
+
+  /**
+   * Appends the schemas of the events collected that were not delivered yet
+   * to outSchemas and marks them delivered.
+   */
+  void TakeNewSchemas(std::vector<GameEventSchemaPtr>& outSchemas);
+
+  /**
+   * @returns the bytes Write() needs.
+   */
+  size_t GetSize() const;
+
+  /**
+   * @param bytes GetSize() bytes, aligned to 8.
+   */
+  void Write(unsigned char* bytes) const;
+
+  void Clear();
+
+ private:
+  struct Block_s {
+    GameEventSchemaPtr Schema;
+    uint32_t Rows = 0;
+    std::vector<std::vector<unsigned char>> Columns;
+  };
+
+  // Blocks beyond m_BlockCount are kept for their memory.
+  std::vector<Block_s> m_Blocks;
+  uint32_t m_BlockCount = 0;
+  std::vector<uint32_t> m_Order;
+
+  CStringArena m_Strings;
+  std::vector<StringView_s> m_StringList;
+  std::unordered_map<StringView_s, uint32_t, StringViewHash_s,
+                     StringViewEqual_s>
+      m_StringIndices;
+  std::string m_ReadString;
+
+  // Where the block index of the last event ends.
+  size_t GetOrderEnd() const {
+    return 16 + 16 * (size_t)m_BlockCount + 4 * m_Order.size();
+  }
+
+  uint32_t GetBlock(const GameEventSchemaPtr& schema);
+
+  bool ReadColumn(CTransportStream& stream,
+                  GameEventColumnType type,
+                  std::vector<unsigned char>& column);
+};
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -1,4 +1,9 @@
 #include "AfxInterop.h"
+#include "AfxCapture.h"
+#include "AfxGameEventBuffer.h"
+#include "AfxInteropProtocol.h"
+#include "AfxSharedMemory.h"
+#include "AfxValue.h"
 
 #include <include/base/cef_bind.h>
 #include <include/wrapper/cef_closure_task.h>
@@ -15,6 +20,7 @@
 #include <unordered_map>
 #include <mutex>
 #include <queue>
+#include <random>
 #include <set>
 #include <vector>
 #include <functional>
@@ -114,123 +120,6 @@ class CVersion {
   unsigned int m_Build;
 };
 
-
-enum class GameEventFieldType : int {
-  Local = 0,
-  CString = 1,
-  Float = 2,
-  Long = 3,
-  Short = 4,
-  Byte = 5,
-  Bool = 6,
-  Uint64 = 7
-};
-
-enum class EngineMessage : unsigned int {
-  Invalid = 0,
-  LevelInitPreEntity = 1,
-  LevelShutDown = 2,
-  BeforeFrameStart = 3,
-  OnRenderView = 4,
-  OnRenderViewEnd = 5,
-  BeforeFrameRenderStart = 6,
-  AfterFrameRenderStart = 7,
-  OnViewOverride = 8,
-  BeforeTranslucentShadow = 9,
-  AfterTranslucentShadow = 10,
-  BeforeTranslucent = 11,
-  AfterTranslucent = 12,
-  BeforeHud = 13,
-  AfterHud = 14,
-  GameEvent = 15,
-  ForceEndQueue = 16
-};
-
-enum class DrawingMessage : unsigned int {
-  Invalid = 0,
-  PreapareDraw = 1,
-  BeforeTranslucentShadow = 2,
-  AfterTranslucentShadow = 3,
-  BeforeTranslucent = 4,
-  AfterTranslucent = 5,
-  BeforeHud = 6,
-  AfterHud = 7,
-  OnRenderViewEnd = 8,
-
-  DeviceLost = 9,
-  DeviceRestored = 10,
-};
-
-enum class PrepareDrawReply : unsigned int {
-  Skip = 1,
-  Retry = 2,
-  Continue = 3
-};
-
-enum class DrawingReply : unsigned int {
-  Skip = 1,
-  Retry = 2,
-  Continue = 3,
-  Finished = 4,
-
-  D3d9CreateVertexDeclaration = 5,
-  ReleaseD3d9VertexDeclaration = 6,
-
-  D3d9CreateIndexBuffer = 7,
-  ReleaseD3d9IndexBuffer = 8,
-  UpdateD3d9IndexBuffer = 9,
-
-  D3d9CreateVertexBuffer = 10,
-  ReleaseD3d9VertexBuffer = 11,
-  UpdateD3d9VertexBuffer = 12,
-
-  D3d9CreateTexture = 13,
-  ReleaseD3d9Texture = 14,
-  UpdateD3d9Texture = 15,
-
-  D3d9CreateVertexShader = 16,
-  ReleaseD3d9VertexShader = 17,
-
-  D3d9CreatePixelShader = 18,
-  ReleaseD3d9PixelShader = 19,
-
-  D3d9SetViewport = 20,
-  D3d9SetRenderState = 21,
-  D3d9SetSamplerState = 22,
-  D3d9SetTexture = 23,
-  D3d9SetTextureStageState = 24,
-  D3d9SetTransform = 25,
-  D3d9SetIndices = 26,
-  D3d9SetStreamSource = 27,
-  D3d9SetStreamSourceFreq = 28,
-  D3d9SetVertexDeclaration = 29,
-  D3d9SetVertexShader = 30,
-  D3d9SetVertexShaderConstantF = 31,
-  D3d9SetVertexShaderConstantI = 32,
-  D3d9SetVertexShaderConstantB = 33,
-  D3d9SetPixelShader = 34,
-  D3d9SetPixelShaderConstantB = 35,
-  D3d9SetPixelShaderConstantF = 36,
-  D3d9SetPixelShaderConstantI = 37,
-  D3d9DrawPrimitive = 38,
-  D3d9DrawIndexedPrimitive = 39,
-
-  WaitForGpu = 40,
-  BeginCleanState = 41,
-  EndCleanState = 42,
-
-  D3d9UpdateTexture = 43,
-  DrawPrimitiveUP = 44,
-
-  GetRenderTarget = 45,
-  SetRenderTarget = 46,
-
-  ReleaseD3d9Surface = 47,
-  D3d9TextureGetSurfaceLevel = 48,
-
-  D3d9StretchRect = 49
-};
-
 enum class AfxObjectType : int {
   AfxObject,
   AfxHandle,
@@ -248,146 +137,12 @@ enum class AfxObjectType : int {
   AfxD3d9Surface
 };
 
-struct Matrix4x4_s {
-  float M00;
-  float M01;
-  float M02;
-  float M03;
-  float M10;
-  float M11;
-  float M12;
-  float M13;
-  float M20;
-  float M21;
-  float M22;
-  float M23;
-  float M30;
-  float M31;
-  float M32;
-  float M33;
-
-    float operator[](size_t index) const {
-    switch (index) {
-      case 0:
-        return M00;
-      case 1:
-        return M01;
-      case 2:
-        return M02;
-      case 3:
-        return M03;
-      case 4:
-        return M10;
-      case 5:
-        return M11;
-      case 6:
-        return M12;
-      case 7:
-        return M13;
-      case 8:
-        return M20;
-      case 9:
-        return M21;
-      case 10:
-        return M22;
-      case 11:
-        return M23;
-      case 12:
-        return M30;
-      case 13:
-        return M31;
-      case 14:
-        return M32;
-      case 15:
-        return M33;
-      default:
-        return M00;
-
-    }
-  }
-
-  float& operator[](size_t index){
-      switch (index) {
-        case 0:
-            return M00;
-        case 1:
-          return M01;
-        case 2:
-          return M02;
-        case 3:
-          return M03;
-        case 4:
-          return M10;
-        case 5:
-          return M11;
-        case 6:
-          return M12;
-        case 7:
-          return M13;
-        case 8:
-          return M20;
-        case 9:
-          return M21;
-        case 10:
-          return M22;
-        case 11:
-          return M23;
-        case 12:
-          return M30;
-        case 13:
-          return M31;
-        case 14:
-          return M32;
-        case 15:
-          return M33;
-        default:
-          return M00;
-    }
-  }
-};
-
-enum RenderPassType_e {
-  RenderPassType_BeforeTranslucentShadow = 2,
-  RenderPassType_AfterTranslucentShadow = 3,
-  RenderPassType_BeforeTranslucent = 4,
-  RenderPassType_AfterTranslucent = 5
-};
-
-struct View_s {
-  int X;
-  int Y;
-  int Width;
-  int Height;
-  struct Matrix4x4_s ViewMatrix;
-  struct Matrix4x4_s ProjectionMatrix;
-};
-
-struct RenderInfo_s {
-  struct View_s View;
-  int FrameCount;
-  float AbsoluteFrameTime;
-  float CurTime;
-  float FrameTime;
-};
-
 struct HandleCalcResult_s : public CefBaseRefCounted {
   int IntHandle = -1;
 
   IMPLEMENT_REFCOUNTING(HandleCalcResult_s);
 };
 
-struct Vector_s {
-  float X = 0;
-  float Y = 0;
-  float Z = 0;
-};
-
-struct QAngle_s {
-  float Pitch = 0;
-  float Yaw = 0;
-  float Roll = 0;
-};
-
 struct VecAngCalcResult_s : public CefBaseRefCounted {
   struct Vector_s Vector;
   struct QAngle_s QAngle;
@@ -421,86 +176,33 @@ struct IntCalcResult_s : public CefBaseRefCounted  {
   IMPLEMENT_REFCOUNTING(IntCalcResult_s);
 };
 
-CThreadedQueue::CThreadedQueue() {
-  m_Thread = std::thread(&CThreadedQueue::QueueThreadHandler, this);
-}
+// CPipeHandle /////////////////////////////////////////////////////////////////
 
-CThreadedQueue::~CThreadedQueue() {
-  Abort();
+bool CPipeHandle::ReadSome(void* bytes, uint32_t length, uint32_t& outRead) {
+  return CNamedPipeTransport::ReadSome(m_Handle, m_LastError, bytes, length,
+                                       outRead);
 }
 
-void CThreadedQueue::Abort() {
-  if (!m_Quit) {
-    std::unique_lock<std::mutex> lock(m_Lock);
-    m_Quit = true;
-    m_Cv.notify_all();
-    lock.unlock();
-
-    if (m_Thread.joinable()) {
-      m_Thread.join();
-    }  
-  }
+bool CPipeHandle::WriteSome(const void* bytes,
+                            uint32_t length,
+                            uint32_t& outWritten) {
+  return CNamedPipeTransport::WriteSome(m_Handle, m_LastError, bytes, length,
+                                        outWritten);
 }
 
-
-void CThreadedQueue::Queue(const fp_t& op) {
-
-  std::unique_lock<std::mutex> lock(m_Lock);
-  m_Queue.push(op);
-
-  m_Cv.notify_one();
+bool CPipeHandle::FlushTransport() {
+  return CNamedPipeTransport::FlushTransport(m_Handle, m_LastError);
 }
 
-void CThreadedQueue::Queue(fp_t&& op) {
-
-  std::unique_lock<std::mutex> lock(m_Lock);
-  m_Queue.push(std::move(op));
-
-  m_Cv.notify_one();
-}
-
-void CThreadedQueue::QueueThreadHandler(void) {
-  std::unique_lock<std::mutex> lock(m_Lock);
-
-  do {
-    m_Cv.wait(lock, [this] { return (m_Queue.size() || m_Quit); });
-
-    if (!m_Quit && m_Queue.size()) {
-      auto op = std::move(m_Queue.front());
-      m_Queue.pop();
-
-      lock.unlock();
-
-      op();
-
-      lock.lock();
-    }
-  } while (!m_Quit);
-}
-
-
+// CPipeReader /////////////////////////////////////////////////////////////////
 
 void CPipeReader::ReadBytes(LPVOID bytes, DWORD offset, DWORD length) {
-  while (0 < length) {
-    DWORD bytesRead = 0;
-
-    if (!(ReadFile(m_Handle, (unsigned char*)bytes + offset, length,
-                   &bytesRead, nullptr))) {
-      DWORD lastError = GetLastError();
-      switch (lastError) {
-        case ERROR_MORE_DATA:
-          break;
-        case ERROR_INVALID_HANDLE:
-          m_Handle = INVALID_HANDLE_VALUE;
-        default:
-          throw CPipeException(lastError);
-      }
-    }
-    
+  // The peer won't answer before it got the whole request:
+  if (!m_WriteBuffer.WriteTo(*this))
+    throw CPipeException(m_LastError);
 
-    offset += bytesRead;
-    length -= bytesRead;
-  }
+  if (!m_ReadBuffer.Read(*this, (unsigned char*)bytes + offset, length))
+    throw CPipeException(m_LastError);
 }
 
 bool CPipeReader::ReadBoolean() {
@@ -582,39 +284,18 @@ FLOAT CPipeReader::ReadSingle() {
   return tmp;
 }
 
-void CPipeWriter::WriteBytes(const LPVOID bytes, DWORD offset, DWORD length) {
-  while (0 < length) {
-    DWORD bytesWritten = 0;
-
-    if (!(WriteFile(m_Handle, (unsigned char*)bytes + offset, length,
-                    &bytesWritten, nullptr))) {
-      DWORD lastError = GetLastError();
-      switch (lastError) {
-        case ERROR_MORE_DATA:
-          break;
-        case ERROR_INVALID_HANDLE:
-          m_Handle = INVALID_HANDLE_VALUE;
-        default:
-          throw CPipeException(lastError);
-      }
-    }
+// CPipeWriter /////////////////////////////////////////////////////////////////
 
-    offset += bytesWritten;
-    length -= bytesWritten;
-  }
+void CPipeWriter::WriteBytes(const LPVOID bytes, DWORD offset, DWORD length) {
+  m_WriteBuffer.Append((unsigned char*)bytes + offset, length);
 }
 
 void CPipeWriter::Flush() {
+  if (!m_WriteBuffer.WriteTo(*this))
+    throw CPipeException(m_LastError);
 
-  if (!FlushFileBuffers(m_Handle)) {
-    DWORD lastError = GetLastError();
-    switch (lastError) {
-      case ERROR_INVALID_HANDLE:
-        m_Handle = INVALID_HANDLE_VALUE;
-      default:
-        throw CPipeException(lastError);
-    }
-  }
+  if (!FlushTransport())
+    throw CPipeException(m_LastError);
 }
 
 void CPipeWriter::WriteBoolean(bool value) {
@@ -678,30 +359,50 @@ void CPipeWriter::WriteStringUTF8(const std::string& value) {
 
 void CPipeClient::OpenPipe(const char* pipeName, int timeOut) {
   ClosePipe();
+  m_WriteBuffer.Clear();
+  m_ReadBuffer.Clear();
+
+  // Set by the server whenever it created the pipe, so we don't have to poll
+  // for it to appear:
+  HANDLE readyEvent = CNamedPipeTransport::CreateReadyEvent(pipeName);
 
-  for(int i = 0; i < 2; ++i)
+  while (true)
   {
+    if (NULL != readyEvent) ResetEvent(readyEvent);
+
     m_Handle = CreateFileA(pipeName, GENERIC_WRITE | GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
     if (m_Handle != INVALID_HANDLE_VALUE)
-      return;
+      break;
 
     DWORD lastError = GetLastError();
 
-    if (lastError != ERROR_PIPE_BUSY)
+    if (lastError == ERROR_FILE_NOT_FOUND && NULL != readyEvent)
+    {
+      if (WAIT_OBJECT_0 != WaitForSingleObject(readyEvent, timeOut))
+      {
+        CloseHandle(readyEvent);
+        throw CWinApiException("CPipeClient::OpenPipe: Waiting for pipe failed.", ERROR_TIMEOUT);
+      }
+    }
+    else if (lastError != ERROR_PIPE_BUSY)
     {
+      if (NULL != readyEvent) CloseHandle(readyEvent);
       throw CWinApiException("CPipeClient::OpenPipe: CreateFileA failed.", lastError);
     }
     else if (FALSE == WaitNamedPipeA(pipeName, timeOut))
     {
-      throw CWinApiException("CPipeClient::OpenPipe: WaitNamedPipe failed", GetLastError());
+      lastError = GetLastError();
+      if (NULL != readyEvent) CloseHandle(readyEvent);
+      throw CWinApiException("CPipeClient::OpenPipe: WaitNamedPipe failed", lastError);
     }
   }
 
-  throw "CPipeClient::OpenPipe failed.";
+  if (NULL != readyEvent) CloseHandle(readyEvent);
 }
 
 void CPipeClient::ClosePipe() {
   if(INVALID_HANDLE_VALUE != m_Handle) {
+    m_WriteBuffer.WriteTo(*this);
     if(!CloseHandle(m_Handle)) {
       m_Handle = INVALID_HANDLE_VALUE;
       throw CWinApiException("CPipeClient::ClosePipe: CloseHandle failed.",
@@ -711,669 +412,641 @@ void CPipeClient::ClosePipe() {
   }
 }
 
+// CPipeChannel ////////////////////////////////////////////////////////////////
 
-// CPipeServer /////////////////////////////////////////////////////////////////
+namespace {
 
-CPipeServerConnectionThread* CPipeServer::WaitForConnection(
-    const char* pipeName,
-    DWORD pipeTimeOut) {
+// The render process' end of the connection to the handler.
+class CHandlerConnection : public CMuxConnection {
+ public:
+  CHandlerConnection() : CMuxConnection(&m_Transport, true) {}
 
+  /**
+   * Connects if there is no working connection to handlerId yet.
+   * @returns nullptr on error.
+   */
+  static std::shared_ptr<CMuxConnection> Get(DWORD handlerId,
+                                             DWORD& outLastError) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
 
-  CPipeServerConnectionThread* result = nullptr;
+    if (nullptr != m_Connection && m_HandlerId == handlerId &&
+        !m_Connection->IsShutdown())
+      return m_Connection;
 
-  // https://docs.microsoft.com/en-us/windows/win32/ipc/multithreaded-pipe-server
+    std::string strPipeName("afx-cefhud-interop_handler_");
+    strPipeName.append(std::to_string(handlerId));
 
-  BOOL fConnected = FALSE;
-  HANDLE hPipe = INVALID_HANDLE_VALUE;
+    auto connection = std::make_shared<CHandlerConnection>();
 
- hPipe = CreateNamedPipeA(pipeName, PIPE_ACCESS_DUPLEX,
-                           PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
-                               PIPE_REJECT_REMOTE_CLIENTS,
-                           PIPE_UNLIMITED_INSTANCES, 0,0,
-                           pipeTimeOut,
-                           nullptr);
-
-    if (hPipe == INVALID_HANDLE_VALUE) {
-      throw CWinApiException("CreateNamedPipeA failed", GetLastError());
+    // The handler might not be listening (again) yet:
+    if (!connection->m_Transport.OpenWhenReady(strPipeName.c_str(),
+                                               AFX_INFINITE_TIMEOUT)) {
+      outLastError = connection->m_Transport.GetErrorCode();
+      return nullptr;
     }
 
-    fConnected = ConnectNamedPipe(hPipe, nullptr)
-                     ? TRUE
-                     : (GetLastError() == ERROR_PIPE_CONNECTED);
+    // Keeps the connection alive until the handler goes away:
+    CPooledThread([connection]() { connection->Run(); }).detach();
 
-    if (fConnected) {
-      result = OnNewConnection(hPipe);
-      if (nullptr == result) {
-        CloseHandle(hPipe);
-        throw "CPipeServer::WaitForConnection: OnNewConnection returned no thread";
-      }
-    } else {
-      // The client could not connect, so close the pipe.
-      CloseHandle(hPipe);
-    }
+    m_Connection = connection;
+    m_HandlerId = handlerId;
+    return connection;
+  }
 
-    return result;
-}
- 
-class CNamedPipeServer {
  private:
-  HANDLE m_PipeHandle = INVALID_HANDLE_VALUE;
-
-  DWORD m_ReadTimeoutMs;
-  DWORD m_WriteTimeoutMs;
+  static std::mutex m_Mutex;
+  static std::shared_ptr<CHandlerConnection> m_Connection;
+  static DWORD m_HandlerId;
 
-  std::mutex m_PipeMutex;
+  CPlatformEndpointTransport m_Transport;
+};
 
- public:
-  CNamedPipeServer(DWORD readTimeOutMs = TEN_MINUTES_IN_MILLISECONDS,
-                   DWORD writeTimeOutMs = TEN_MINUTES_IN_MILLISECONDS)
-      : m_ReadTimeoutMs(readTimeOutMs), m_WriteTimeoutMs(writeTimeOutMs) {
+std::mutex CHandlerConnection::m_Mutex;
+std::shared_ptr<CHandlerConnection> CHandlerConnection::m_Connection;
+DWORD CHandlerConnection::m_HandlerId = 0;
 
+}  // namespace
 
-  }
+void CPipeChannel::OpenChannel(DWORD handlerId) {
+  CloseChannel();
+  m_WriteBuffer.Clear();
+  m_ReadBuffer.Clear();
 
-  ~CNamedPipeServer() {
-    Close();
-  }
+  DWORD lastError = ERROR_SUCCESS;
+  auto connection = CHandlerConnection::Get(handlerId, lastError);
+  if (nullptr == connection)
+    throw CWinApiException("CPipeChannel::OpenChannel: Connecting failed.",
+                           lastError);
 
-  bool OpenPipe(const char* pipeName) {
-
-    std::unique_lock<std::mutex> lock(m_PipeMutex);
+  m_Channel = connection->OpenChannel();
+  if (nullptr == m_Channel)
+    throw CWinApiException("CPipeChannel::OpenChannel: OpenChannel failed.",
+                           ERROR_BROKEN_PIPE);
+}
 
-    if (m_PipeHandle != INVALID_HANDLE_VALUE)
-        return false;
+void CPipeChannel::CloseChannel() {
+  if (nullptr == m_Channel)
+    return;
 
-    std::string strPipeName("\\\\.\\pipe\\");
-    strPipeName.append(pipeName);
+  m_WriteBuffer.WriteTo(*this);
+  m_Channel->Close();
+}
 
-    m_PipeHandle = CreateNamedPipeA(strPipeName.c_str(), PIPE_ACCESS_DUPLEX,
-                                    PIPE_READMODE_BYTE | PIPE_TYPE_BYTE |
-                                        PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
-                         1, 0, 0, TEN_MINUTES_IN_MILLISECONDS, nullptr);
+void CPipeChannel::CancelChannel() {
+  if (nullptr != m_Channel)
+    m_Channel->Cancel();
+}
 
-    return m_PipeHandle != INVALID_HANDLE_VALUE;
+bool CPipeChannel::ReadSome(void* bytes, uint32_t length, uint32_t& outRead) {
+  if (nullptr == m_Channel || !m_Channel->ReadSome(bytes, length, outRead)) {
+    m_LastError = ERROR_BROKEN_PIPE;
+    return false;
   }
 
-  bool Connect() {
-    std::unique_lock<std::mutex> lock(m_PipeMutex);
-
-    if (m_PipeHandle != INVALID_HANDLE_VALUE) {
-      BOOL fConnected = ConnectNamedPipe(m_PipeHandle, nullptr)
-                            ? TRUE
-                            : (GetLastError() == ERROR_PIPE_CONNECTED);
-
-      if (fConnected)
-        return true;
-
-    }
+  return true;
+}
 
+bool CPipeChannel::WriteSome(const void* bytes,
+                             uint32_t length,
+                             uint32_t& outWritten) {
+  if (nullptr == m_Channel ||
+      !m_Channel->WriteSome(bytes, length, outWritten)) {
+    m_LastError = ERROR_BROKEN_PIPE;
     return false;
   }
 
-  bool ReadBytes(LPVOID bytes, DWORD offset, DWORD length) {
-    while (0 < length) {
-      DWORD bytesRead = 0;
-
-      if (!(ReadFile(m_PipeHandle, (unsigned char*)bytes + offset, length,
-                     &bytesRead, nullptr))) {
-        DWORD lastError = GetLastError();
-        switch (lastError) {
-          case ERROR_MORE_DATA:
-            break;
-          case ERROR_INVALID_HANDLE:
-            m_PipeHandle = INVALID_HANDLE_VALUE;
-          default:
-            return false;
-        }
-      }
-
-      offset += bytesRead;
-      length -= bytesRead;
-    }
+  return true;
+}
 
-    return true;
+bool CPipeChannel::FlushTransport() {
+  if (nullptr == m_Channel || !m_Channel->FlushTransport()) {
+    m_LastError = ERROR_BROKEN_PIPE;
+    return false;
   }
 
-  bool ReadBoolean(bool& outValue) {
-    BYTE tmp;
+  return true;
+}
 
-    if (ReadBytes(&tmp, 0, sizeof(tmp))) {
-      outValue = 0 != tmp;
-      return true;
-    }
+// Stats ///////////////////////////////////////////////////////////////////////
 
-    return false;
-  }
+static void SetStat(CefRefPtr<CefV8Value> obj, const char* key, double value) {
+  obj->SetValue(key, CefV8Value::CreateDouble(value),
+                V8_PROPERTY_ATTRIBUTE_NONE);
+}
 
-  bool ReadByte(BYTE& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+/**
+ * Times are in milliseconds, buckets[i] counts the ones below 2^i
+ * microseconds (except the last one, which has the longer ones too).
+ */
+static CefRefPtr<CefV8Value> CreateLatencyStats(
+    const CLatencyHistogram& histogram) {
+  auto result = CefV8Value::CreateObject(nullptr, nullptr);
+
+  SetStat(result, "count", (double)histogram.GetCount());
+  SetStat(result, "totalMs", histogram.GetTotalNs() / 1000000.0);
+  SetStat(result, "maxMs", histogram.GetMaxNs() / 1000000.0);
+
+  auto buckets = CefV8Value::CreateArray(g_LatencyBuckets);
+  for (int i = 0; i < g_LatencyBuckets; ++i)
+    buckets->SetValue(i, CefV8Value::CreateDouble(
+                             (double)histogram.GetBucket(i)));
+  result->SetValue("buckets", buckets, V8_PROPERTY_ATTRIBUTE_NONE);
+
+  return result;
+}
 
-  bool ReadSByte(signed char& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+static CefRefPtr<CefV8Value> CreateQueueStats(const CThreadedQueue& queue) {
+  auto result = CefV8Value::CreateObject(nullptr, nullptr);
 
-  bool ReadInt16(INT16& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+  // Started first, so depth doesn't go negative:
+  uint64_t started = queue.GetWaitStats().GetCount();
+  uint64_t queued = queue.GetQueued();
 
-  bool ReadUInt32(UINT32& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+  SetStat(result, "depth", (double)(queued - started));
+  SetStat(result, "queued", (double)queued);
+  result->SetValue("wait", CreateLatencyStats(queue.GetWaitStats()),
+                   V8_PROPERTY_ATTRIBUTE_NONE);
+  result->SetValue("run", CreateLatencyStats(queue.GetRunStats()),
+                   V8_PROPERTY_ATTRIBUTE_NONE);
 
-  bool ReadCompressedUInt32(UINT32& outValue) {
-    BYTE value;
+  return result;
+}
 
-    if (!ReadByte(value))
-      return false;
+// CPropertyNames //////////////////////////////////////////////////////////////
 
-    if (value < 255) {
-      outValue = value;
-      return true;
-    }
+const CefString& CPropertyNames::Get(const char* name, uint32_t length) {
+  StringView_s key;
+  key.Data = name;
+  key.Length = length;
 
-    return ReadUInt32(outValue);
-  }
+  auto it = m_Names.find(key);
+  if (it != m_Names.end())
+    return it->second;
 
-  bool ReadInt32(INT32& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+  return m_Names
+      .emplace(m_Keys.Store(name, length), CefString(std::string(name, length)))
+      .first->second;
+}
 
-  bool ReadCompressedInt32(INT32& outValue) {
-    signed char value;
+// CInterop ////////////////////////////////////////////////////////////////////
 
-    if (!ReadSByte(value))
-      return false;
+void CInterop::PostCompletion(std::function<void(void)>&& fn) {
+  m_CompletionsQueued.fetch_add(1, std::memory_order_relaxed);
 
-    if (value < 127) {
-      outValue = value;
-      return value;
-    }
+  std::unique_lock<std::mutex> lock(m_CompletionsMutex);
 
-    return ReadInt32(outValue);
-  }
+  m_Completions.emplace_back(std::move(fn));
 
-  bool ReadStringUTF8(std::string& outValue) {
-    UINT32 length;
+  // The task posted already will run this one too:
+  if (m_CompletionsPosted)
+    return;
+  m_CompletionsPosted = true;
+  m_CompletionsPostedAt = GetStatsTimeNs();
 
-    if (!ReadCompressedUInt32(length))
-      return false;
+  lock.unlock();
 
-    outValue.resize(length);
+  CefRefPtr<CInterop> self(this);
+  CefPostTask(TID_RENDERER,
+              new CAfxTask([self]() { self->RunCompletions(); }));
+}
 
-    if (!ReadBytes(&outValue[0], 0, length))
-      return false;
+void CInterop::RunCompletions() {
+  uint64_t startedAt = GetStatsTimeNs();
 
-    return true;
+  std::vector<std::function<void(void)>> completions;
+  {
+    std::unique_lock<std::mutex> lock(m_CompletionsMutex);
+    completions.swap(m_Completions);
+    m_CompletionsPosted = false;
+    m_CompletionWaitStats.Add(startedAt - m_CompletionsPostedAt);
   }
 
-  bool ReadHandle(HANDLE& outValue) {
-    DWORD value32;
-
-    if (ReadBytes(&value32, 0, (DWORD)sizeof(value32))) {
-      outValue = ULongToHandle(value32);
-      return true;
-    }
+  if (nullptr == m_Context)
+    return;
 
-    return false;
-  }
+  m_Context->Enter();
+  for (auto& fn : completions)
+    fn();
+  m_Context->Exit();
 
-  bool ReadUInt64(uint64_t& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+  m_CompletionRunStats.Add(GetStatsTimeNs() - startedAt);
+}
 
-  bool ReadSingle(float& outValue) {
-    return ReadBytes(&outValue, 0, (DWORD)sizeof(outValue));
-  }
+CefRefPtr<CefV8Value> CInterop::GetStats() {
+  auto result = CefV8Value::CreateObject(nullptr, nullptr);
 
-  bool WriteBytes(const LPVOID bytes, DWORD offset, DWORD length) {
-    while (0 < length) {
-      DWORD bytesWritten = 0;
+  result->SetValue("interopQueue", CreateQueueStats(m_InteropQueue),
+                   V8_PROPERTY_ATTRIBUTE_NONE);
 
-      if (!(WriteFile(m_PipeHandle, (unsigned char*)bytes + offset, length,
-                      &bytesWritten, nullptr))) {
-        DWORD lastError = GetLastError();
-        switch (lastError) {
-          case ERROR_MORE_DATA:
-            break;
-          case ERROR_INVALID_HANDLE:
-            m_PipeHandle = INVALID_HANDLE_VALUE;
-          default:
-            return false;
-        }
-      }
+  auto completions = CefV8Value::CreateObject(nullptr, nullptr);
+  SetStat(completions, "queued",
+          (double)m_CompletionsQueued.load(std::memory_order_relaxed));
+  completions->SetValue("wait", CreateLatencyStats(m_CompletionWaitStats),
+                        V8_PROPERTY_ATTRIBUTE_NONE);
+  completions->SetValue("run", CreateLatencyStats(m_CompletionRunStats),
+                        V8_PROPERTY_ATTRIBUTE_NONE);
+  result->SetValue("completions", completions, V8_PROPERTY_ATTRIBUTE_NONE);
 
-      offset += bytesWritten;
-      length -= bytesWritten;
-    }
-    return true;
-  }
+  return result;
+}
 
-  bool Flush() {
+CefRefPtr<CefV8Value> CInterop::CreateErrorResult(int hr,
+                                                  unsigned int lastError) {
+  auto result = CefV8Value::CreateObject(nullptr, nullptr);
+  result->SetValue(m_PropertyNames.Get("hr"), CefV8Value::CreateInt(hr),
+                   V8_PROPERTY_ATTRIBUTE_NONE);
+  result->SetValue(m_PropertyNames.Get("lastError"),
+                   CefV8Value::CreateUInt(lastError),
+                   V8_PROPERTY_ATTRIBUTE_NONE);
+  return result;
+}
 
-  if (!FlushFileBuffers(m_PipeHandle)) {
-      DWORD lastError = GetLastError();
-      switch (lastError) {
-        case ERROR_INVALID_HANDLE:
-          m_PipeHandle = INVALID_HANDLE_VALUE;
-        default:
-          return false;
-      }
-    }
+// CPipeServer /////////////////////////////////////////////////////////////////
 
-    return true;
-  }
+CPipeServerConnectionThread* CPipeServer::WaitForConnection(
+    const char* pipeName,
+    DWORD pipeTimeOut) {
 
-  bool WriteBoolean(bool value) {
-    BYTE tmp = value ? 1 : 0;
 
-    return WriteBytes(&tmp, 0, sizeof(tmp));
-  }
+  CPipeServerConnectionThread* result = nullptr;
 
-  bool WriteByte(BYTE value) { return WriteBytes(&value, 0, sizeof(value)); }
+  // https://docs.microsoft.com/en-us/windows/win32/ipc/multithreaded-pipe-server
 
-  bool WriteSByte(signed char value) {
-    return WriteBytes(&value, 0, sizeof(value));
-  }
+  BOOL fConnected = FALSE;
+  HANDLE hPipe = INVALID_HANDLE_VALUE;
 
-  bool WriteUInt32(UINT32 value) {
-    return WriteBytes(&value, 0, sizeof(value));
-  }
+ hPipe = CreateNamedPipeA(pipeName, PIPE_ACCESS_DUPLEX,
+                           PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+                               PIPE_REJECT_REMOTE_CLIENTS,
+                           PIPE_UNLIMITED_INSTANCES, 0,0,
+                           pipeTimeOut,
+                           nullptr);
 
-  bool WriteCompressedUInt32(UINT32 value) {
-    if (0 <= value && value <= 255 - 1) {
-      return WriteByte((BYTE)value);
-    } else {
-      return WriteByte(255) && WriteUInt32(value);
+    if (hPipe == INVALID_HANDLE_VALUE) {
+      throw CWinApiException("CreateNamedPipeA failed", GetLastError());
     }
-  }
 
-  bool WriteInt32(INT32 value) { return WriteBytes(&value, 0, sizeof(value)); }
-
-  bool WriteCompressedInt32(INT32 value) {
-    if (-128 <= value && value <= 127 - 1) {
-      WriteSByte((signed char)value);
-    } else {
-      return WriteSByte(127) && WriteInt32(value);
+    {
+      std::unique_lock<std::mutex> lock(m_WaitMutex);
+      if (m_WaitCancelled) {
+        CloseHandle(hPipe);
+        return nullptr;
+      }
+      m_WaitHandle = hPipe;
+      m_WaitPipeName = pipeName;
     }
-  }
 
-  bool WriteUInt64(UINT64 value) {
-    return WriteBytes(&value, 0, sizeof(value));
-  }
+    // Wake up clients waiting in CPipeClient::OpenPipe, the event stays
+    // alive as long as one of them holds it:
+    HANDLE readyEvent = CNamedPipeTransport::CreateReadyEvent(pipeName);
+    if (NULL != readyEvent) {
+      SetEvent(readyEvent);
+      CloseHandle(readyEvent);
+    }
 
-  bool WriteHandle(HANDLE value) {
-    DWORD value32 = HandleToULong(value);
+    fConnected = ConnectNamedPipe(hPipe, nullptr)
+                     ? TRUE
+                     : (GetLastError() == ERROR_PIPE_CONNECTED);
 
-    return WriteBytes(&value32, 0, sizeof(value32));
-  }
+    {
+      std::unique_lock<std::mutex> lock(m_WaitMutex);
+      m_WaitHandle = INVALID_HANDLE_VALUE;
+      if (m_WaitCancelled)
+        fConnected = FALSE;
+    }
 
-  bool WriteSingle(FLOAT value) {
-      return WriteBytes(&value, 0, sizeof(value));
-  }
+    if (fConnected) {
+      result = OnNewConnection(hPipe);
+      if (nullptr == result) {
+        CloseHandle(hPipe);
+        throw "CPipeServer::WaitForConnection: OnNewConnection returned no thread";
+      }
+    } else {
+      // The client could not connect, so close the pipe.
+      CloseHandle(hPipe);
+    }
 
-  bool WriteStringUTF8(const std::string &value) {
-    UINT32 length = (UINT32)value.length();
+    return result;
+}
 
-    return WriteCompressedUInt32(length) &&
-           WriteBytes((LPVOID)value.c_str(), 0, length);
-  }
+void CPipeServer::CancelWaitForConnection() {
+  std::unique_lock<std::mutex> lock(m_WaitMutex);
 
-  void Close()
-  {
-    std::unique_lock<std::mutex> lock(m_PipeMutex);
+  m_WaitCancelled = true;
 
-    if (INVALID_HANDLE_VALUE != m_PipeHandle)
-    {
-      CloseHandle(m_PipeHandle);
-      m_PipeHandle = INVALID_HANDLE_VALUE;
-    }
+  if (INVALID_HANDLE_VALUE != m_WaitHandle &&
+      !CancelIoEx(m_WaitHandle, nullptr) && ERROR_NOT_FOUND == GetLastError()) {
+    // Not in ConnectNamedPipe yet, connecting makes it return right away:
+    HANDLE hClient = CreateFileA(m_WaitPipeName.c_str(), GENERIC_READ, 0,
+                                 nullptr, OPEN_EXISTING, 0, nullptr);
+    if (INVALID_HANDLE_VALUE != hClient)
+      CloseHandle(hClient);
   }
-};
+}
+ 
+class CNamedPipeServer : public CTransportStream {
+ private:
+  CPlatformEndpointTransport m_Endpoint;
+  CTapTransport m_Tap;
+  std::atomic<CReplayTransport*> m_Replay{nullptr};
 
+  std::mutex m_PipeMutex;
 
-class CAfxCommand {
  public:
-  size_t GetArgs() const { return m_Args.size(); }
-
-  const char* GetArg(size_t index) const {
-    if (index >= m_Args.size())
-      return "";
-
-    return m_Args[index].c_str();
+  CNamedPipeServer(DWORD readTimeOutMs = TEN_MINUTES_IN_MILLISECONDS,
+                   DWORD writeTimeOutMs = TEN_MINUTES_IN_MILLISECONDS)
+      : CTransportStream(&m_Endpoint) {
+    m_Endpoint.SetTimeouts(readTimeOutMs, writeTimeOutMs);
   }
 
-  void SetArgs(size_t numArgs) { m_Args.resize(numArgs); }
-
-  std::string& GetArgString(size_t index) { return m_Args[index]; }
-
- private:
-  std::vector<std::string> m_Args;
-};
-
-typedef std::function<bool(const CefString& name,
-                        CefRefPtr<CefV8Value> object,
-                        const CefV8ValueList& arguments,
-                        CefRefPtr<CefV8Value>& retval,
-                        CefString& exception)>
-AfxExecute_t;
-
-typedef std::unordered_map<std::string, AfxExecute_t> AfxExecuteMap_t;
+  ~CNamedPipeServer() {
+    Close();
+  }
 
-typedef std::function<bool(const CefString& name,
-                           const CefRefPtr<CefV8Value> object,
-                           CefRefPtr<CefV8Value>& retval,
-                           CefString& exception)>
-    AfxGet_t;
+  bool OpenPipe(const char* pipeName) {
+    std::unique_lock<std::mutex> lock(m_PipeMutex);
 
-typedef std::unordered_map<std::string, AfxGet_t> AfxGetMap_t;
+    if (m_Endpoint.IsOpen())
+      return false;
 
+    return m_Endpoint.Listen(pipeName);
+  }
 
-typedef std::function<bool(const CefString& name,
-                           const CefRefPtr<CefV8Value> object,
-                           const CefRefPtr<CefV8Value> value,
-                           CefString& exception)>
-    AfxSet_t;
+  /**
+   * @param capture If not nullptr, all traffic of the connection is
+   * recorded to it.
+   */
+  bool Connect(CCaptureWriter* capture = nullptr) {
+    std::unique_lock<std::mutex> lock(m_PipeMutex);
 
-typedef std::unordered_map<std::string, AfxSet_t> AfxSetMap_t;
+    if (!m_Endpoint.Accept())
+      return false;
 
+    if (capture) {
+      capture->WriteConnect();
+      m_Tap.SetTransport(&m_Endpoint);
+      m_Tap.SetCapture(capture);
+      SetTransport(&m_Tap);
+    }
 
-template<class...>struct types{using type=types;};
-template<class T>struct tag{using type=T;};
-template<class Tag>using type_t=typename Tag::type;
+    return true;
+  }
 
-class CAfxValue : public CefBaseRefCounted {
- public:
-  enum class ValueType { Invalid, Array, Object, Bool, Int, UInt, Double, V8Function, String, Time };
+  /**
+   * Plays back the next connection of replay instead of talking to a peer.
+   */
+  bool OpenReplay(CReplayTransport* replay) {
+    std::unique_lock<std::mutex> lock(m_PipeMutex);
 
-  static CefRefPtr<CAfxValue> FromV8Value(CefRefPtr<CefV8Value> value) {
-    return new CAfxValue(value);
-  }
+    if (m_Endpoint.IsOpen() || nullptr != m_Replay ||
+        !replay->NextConnection())
+      return false;
 
-  static CefRefPtr<CAfxValue> CreateArray(int size) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_ValueType = ValueType::Array;
-    result->m_Elements.resize(size);
-    return result;
+    m_Replay = replay;
+    SetTransport(replay);
+    return true;
   }
 
-  static CefRefPtr<CAfxValue> CreateObject() {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_ValueType = ValueType::Object;
-    return result;
+  /**
+   * Deadlines for each read / write on the pipe.
+   */
+  void SetTimeouts(DWORD readTimeOutMs, DWORD writeTimeOutMs) {
+    m_Endpoint.SetTimeouts(readTimeOutMs, writeTimeOutMs);
   }
 
-  static CefRefPtr<CAfxValue> CreateBool(bool value) {
-   CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Value.Bool = value;
-    result->m_ValueType = ValueType::Bool;
-    return result;
-  }
+  /**
+   * Aborts the pending and further I/O until the pipe is re-opened, can be
+   * called from any thread.
+   */
+  void Cancel() {
+    m_Endpoint.Cancel();
 
-  static CefRefPtr<CAfxValue> CreateInt(int value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Value.Int = value;
-    result->m_ValueType = ValueType::Int;
-    return result;
+    if (CReplayTransport* replay = m_Replay)
+      replay->Cancel();
   }
 
-  static CefRefPtr<CAfxValue> CreateUInt(unsigned int value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Value.UInt = value;
-    result->m_ValueType = ValueType::UInt;
-    return result;
-  }
+  bool GetTimedOut() const { return m_Endpoint.GetTimedOut(); }
 
-  static CefRefPtr<CAfxValue> CreateDouble(double value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Value.Double = value;
-    result->m_ValueType = ValueType::Double;
-    return result;
-  }
+  bool ReadHandle(HANDLE& outValue) {
+    DWORD value32;
 
-  static CefRefPtr<CAfxValue> CreateV8Function(CefRefPtr<CefV8Value> value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Function = value;
-    result->m_ValueType = ValueType::V8Function;
-    return result;
-  }
+    if (ReadBytes(&value32, 0, (DWORD)sizeof(value32))) {
+      outValue = ULongToHandle(value32);
+      return true;
+    }
 
-  static CefRefPtr<CAfxValue> CreateString(const std::string & value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_String = value;
-    result->m_ValueType = ValueType::String;
-    return result;
+    return false;
   }
 
-  
-  static CefRefPtr<CAfxValue> CreateTime(time_t value) {
-    CefRefPtr<CAfxValue> result = new CAfxValue();
-    result->m_Value.Time = value;
-    result->m_ValueType = ValueType::Time;
-    return result;
-  }
+  bool WriteHandle(HANDLE value) {
+    DWORD value32 = HandleToULong(value);
 
-  CAfxValue() : m_ValueType(ValueType::Invalid), m_Value({false}) {
-  }
-
-  CAfxValue(CefRefPtr<CefV8Value> value)
-      : m_ValueType(ValueType::Invalid), m_Value({false}) {
-    if (value) {
-      if (value->IsBool()) {
-        m_ValueType = ValueType::Int;
-        m_Value.Double = value->GetBoolValue();
-      } else if (value->IsInt()) {
-        m_ValueType = ValueType::Int;
-        m_Value.Double = value->GetIntValue();
-      } else if (value->IsUInt()) {
-        m_ValueType = ValueType::UInt;
-        m_Value.UInt = value->GetUIntValue();
-      } else if (value->IsString()) {
-        m_ValueType = ValueType::String;
-        m_String = value->GetStringValue().ToString();
-      } else if (value->IsDouble()) {
-        m_ValueType = ValueType::Double;
-        m_Value.Double = value->GetDoubleValue();
-      } else if (value->IsFunction()) {
-        m_ValueType = ValueType::V8Function;
-        m_Function = value;
-      } else if (value->IsArray()) {
-        m_ValueType = ValueType::Array;
-        for (int i = 0; i < value->GetArrayLength(); ++i) {
-          m_Elements.emplace_back(FromV8Value(value->GetValue(i)));
-        }
-      } else if (value->IsObject()) {
-        m_ValueType = ValueType::Object;
-        std::vector<CefString> keys;
-        if (value->GetKeys(keys)) {
-          int i = 0;
-          for (auto it = keys.begin(); it != keys.end(); ++it) {
-
-            m_Children.emplace(it->ToString(),
-                               FromV8Value(value->GetValue(*it)));
-            ++i;
-          }
-        }
-      }
-    }
+    return WriteBytes(&value32, 0, sizeof(value32));
   }
 
-  void AddChild(const char* name, CefRefPtr<CAfxValue> value){
-      m_Children[name] = value;
-  }
+  /**
+   * @param sendPending If to send what was written but not flushed yet, only
+   *   for an orderly close: after an error or Cancel() it may be half a frame
+   *   and the peer might not be reading anymore.
+   */
+  void Close(bool sendPending = false)
+  {
+    std::unique_lock<std::mutex> lock(m_PipeMutex);
 
-  CefRefPtr<CAfxValue> GetChild(const char* name) {
-    if (m_ValueType == ValueType::Object) {
-      auto it = m_Children.find(name);
-      if (it != m_Children.end())
-        return it->second;
+    if (m_Endpoint.IsOpen())
+    {
+      if (sendPending && !GetFailed())
+        Send();
+      m_Endpoint.Close();
     }
-    return nullptr;
-  }
-
-  void SetChild(const char* name, CefRefPtr<CAfxValue> value) {      
-      m_Children[name] = value;
-  }
 
-  int GetArraySize() {
-    if (m_ValueType == ValueType::Array)
-      return (int)m_Elements.size();
+    if (GetTransport() != &m_Endpoint) {
+      m_Tap.SetCapture(nullptr);
+      m_Replay = nullptr;
+      SetTransport(&m_Endpoint);
+    }
 
-      return 0;
+    ResetBuffers();
   }
+};
 
-  CefRefPtr<CAfxValue> GetArrayElement(int index) {
 
-    if (m_ValueType == ValueType::Array && 0 <= index && index < m_Elements.size())
-        return m_Elements[index];
+class CAfxCommand {
+ public:
+  size_t GetArgs() const { return m_Args.size(); }
 
-    return nullptr;
-  }
+  const char* GetArg(size_t index) const {
+    if (index >= m_Args.size())
+      return "";
 
-  void SetArrayElement(int index, CefRefPtr<CAfxValue> value) {m_Elements[index] = value;
+    return m_Args[index].c_str();
   }
 
-  CefRefPtr<CefV8Value> GetFunction() {
-      return m_Function;
-  }
+  void SetArgs(size_t numArgs) { m_Args.resize(numArgs); }
 
-  bool IsTime() { return m_ValueType == ValueType::Time; }
+  std::string& GetArgString(size_t index) { return m_Args[index]; }
 
-    bool IsString() { return m_ValueType == ValueType::String; }
+ private:
+  std::vector<std::string> m_Args;
+};
 
+typedef std::function<bool(const CefString& name,
+                        CefRefPtr<CefV8Value> object,
+                        const CefV8ValueList& arguments,
+                        CefRefPtr<CefV8Value>& retval,
+                        CefString& exception)>
+AfxExecute_t;
 
-  bool IsArray() { return m_ValueType == ValueType::Array; }
+typedef std::unordered_map<std::string, AfxExecute_t> AfxExecuteMap_t;
 
-  bool IsObject() { return m_ValueType == ValueType::Object; }
+typedef std::function<bool(const CefString& name,
+                           const CefRefPtr<CefV8Value> object,
+                           CefRefPtr<CefV8Value>& retval,
+                           CefString& exception)>
+    AfxGet_t;
 
-  bool IsV8Function() { return m_ValueType == ValueType::V8Function; }
+typedef std::unordered_map<std::string, AfxGet_t> AfxGetMap_t;
 
-  bool IsBool() {
-    return m_ValueType == ValueType::Bool;
-  }
 
-  bool IsUInt() {
-    return m_ValueType == ValueType::Int || m_ValueType == ValueType::UInt;
-  }
+typedef std::function<bool(const CefString& name,
+                           const CefRefPtr<CefV8Value> object,
+                           const CefRefPtr<CefV8Value> value,
+                           CefString& exception)>
+    AfxSet_t;
 
-  bool IsInt() {
-      return m_ValueType == ValueType::Int || m_ValueType == ValueType::UInt;
-  }
+typedef std::unordered_map<std::string, AfxSet_t> AfxSetMap_t;
 
-  bool IsDouble() {
-    return m_ValueType == ValueType::Int || m_ValueType == ValueType::UInt || m_ValueType == ValueType::Double;
-  }
 
-  CefRefPtr<CefV8Value> GetV8Function() {
-    if (m_ValueType == ValueType::V8Function)
-      return m_Function;
+template<class...>struct types{using type=types;};
+template<class T>struct tag{using type=T;};
+template<class Tag>using type_t=typename Tag::type;
 
-    return nullptr;
+// Value trees of the pump. V8 functions can't live in the portable CValue, so
+// the arena keeps them, CValue::GetFunction() indexes into m_Functions.
+class CAfxValueArena : public CValueArena {
+ public:
+  /**
+   * @returns value converted into a tree of its own arena, nullptr for
+   * undefined or null.
+   */
+  static CefRefPtr<CValue> FromV8Value(CefRefPtr<CefV8Value> value) {
+    CefRefPtr<CAfxValueArena> arena = new CAfxValueArena();
+    return arena->Convert(value);
+  }
+
+  /**
+   * @param value from a CAfxValueArena, nullptr is undefined.
+   * @param names of the context the result is for.
+   * @param newFloat32Array from CreateNewFloat32Array(), without it
+   *   Float32Array values become arrays of numbers.
+   */
+  static CefRefPtr<CefV8Value> ToV8Value(
+      const CValue* value,
+      CPropertyNames& names,
+      CefRefPtr<CefV8Value> newFloat32Array = nullptr) {
+    ToV8Value_s state(names);
+    state.NewFloat32Array = newFloat32Array;
+    return ToV8Value(value, state);
+  }
+
+  /**
+   * CEF can't construct typed arrays, so this compiles a function
+   * (buffer, byteOffset, length) doing it in context.
+   * @returns nullptr on error.
+   */
+  static CefRefPtr<CefV8Value> CreateNewFloat32Array(
+      CefRefPtr<CefV8Context> context) {
+    CefRefPtr<CefV8Value> result;
+    CefRefPtr<CefV8Exception> exception;
+    if (!context->Eval("(function(buffer, byteOffset, length) {"
+                       " return new Float32Array(buffer, byteOffset, length);"
+                       " })",
+                       CefString(), 0, result, exception))
+      return nullptr;
+    return result;
   }
 
-    time_t GetTime() {
-    if (m_ValueType == ValueType::Time)
-      return m_Value.Time;
+  /**
+   * @returns nullptr if value is no function.
+   */
+  static CefRefPtr<CefV8Value> GetV8Function(const CValue* value) {
+    if (nullptr == value || !value->IsFunction())
+      return nullptr;
 
-    return false;
+    return static_cast<CAfxValueArena*>(value->GetArena())
+        ->m_Functions[value->GetFunction()];
   }
 
-  int GetBool() {
-    if (m_ValueType == ValueType::Bool)
-      return m_Value.Bool;
-
-    return false;
+  CValue* CreateV8Function(CefRefPtr<CefV8Value> value) {
+    m_Functions.emplace_back(value);
+    return CreateFunction((uint32_t)(m_Functions.size() - 1));
   }
 
-  unsigned int GetUInt() {
-    if (m_ValueType == ValueType::Int)
-      return (unsigned int)m_Value.Int;
-    if (m_ValueType == ValueType::UInt)
-      return m_Value.UInt;
-    return 0;
+  virtual void Clear() override {
+    CValueArena::Clear();
+    m_Functions.clear();
   }
 
-  int GetInt() {
-    if (m_ValueType == ValueType::Int)
-      return m_Value.Int;
-    if (m_ValueType == ValueType::UInt)
-      return (int)m_Value.UInt;
-    return 0;
-  }
+ private:
+  struct ToV8Value_s {
+    explicit ToV8Value_s(CPropertyNames& names) : Names(names) {}
 
-  double GetDouble() {
-    if (m_ValueType == ValueType::Int)
-      return (double)m_Value.Int;
-    if (m_ValueType == ValueType::UInt)
-      return (double)m_Value.UInt;
-    if (m_ValueType == ValueType::Double)
-      return m_Value.Double;
+    CPropertyNames& Names;
+    CefRefPtr<CefV8Value> NewFloat32Array;
+    // The Float32Buffers converted so far, so their views share them.
+    std::vector<std::pair<const CValue*, CefRefPtr<CefV8Value>>> Buffers;
+  };
 
-    return 0;
-  }
+  std::vector<CefRefPtr<CefV8Value>> m_Functions;
 
-  const std::string & GetString() {
-    if (m_ValueType == ValueType::String)
-      return m_String;
-    return m_String;
-  }
-
-  CefRefPtr<CefV8Value> ToV8Value() {
-      switch (m_ValueType) {
-        case ValueType::Bool:
-          return CefV8Value::CreateBool(m_Value.Bool);
-        case ValueType::Int:
-          return CefV8Value::CreateInt(m_Value.Int);
-        case ValueType::UInt:
-          return CefV8Value::CreateUInt(m_Value.UInt);
-        case ValueType::Double:
-          return CefV8Value::CreateDouble(m_Value.Double);
-        case ValueType::V8Function:
-          return m_Function;
-        case ValueType::Array: {
-          CefRefPtr<CefV8Value> arr = CefV8Value::CreateArray((int)m_Elements.size());
-          for(int i = 0; i < (int)m_Elements.size(); ++i) {
-            arr->SetValue(i, m_Elements[i]->ToV8Value());
-          }
-          return arr;
-        }
-        case ValueType::Object: {
+  // Defined after CAfxData:
+  static CefRefPtr<CefV8Value> ToV8Value(const CValue* value,
+                                         ToV8Value_s& state);
+  static CefRefPtr<CefV8Value> GetArrayBuffer(const CValue* buffer,
+                                              ToV8Value_s& state);
+  static CefRefPtr<CefV8Value> CopyArrayBuffer(const void* bytes,
+                                               uint32_t size);
 
-          CefRefPtr<CefV8Value> obj =
-              CefV8Value::CreateObject(nullptr, nullptr);
+  CValue* Convert(CefRefPtr<CefV8Value> value) {
+    if (!value)
+      return nullptr;
 
-          for (auto it = m_Children.begin(); it != m_Children.end(); ++it) {
-            obj->SetValue(CefString(it->first), it->second->ToV8Value(),
-                          V8_PROPERTY_ATTRIBUTE_NONE);
-          }
+    if (value->IsBool())
+      return CreateInt(value->GetBoolValue() ? 1 : 0);
+    if (value->IsInt())
+      return CreateInt(value->GetIntValue());
+    if (value->IsUInt())
+      return CreateUInt(value->GetUIntValue());
+    if (value->IsString())
+      return CreateString(value->GetStringValue().ToString());
+    if (value->IsDouble())
+      return CreateDouble(value->GetDoubleValue());
+    if (value->IsFunction())
+      return CreateV8Function(value);
+
+    if (value->IsArray()) {
+      int length = value->GetArrayLength();
+      CValue* result = CreateArray((uint32_t)length);
+      for (int i = 0; i < length; ++i) {
+        result->SetArrayElement((uint32_t)i, Convert(value->GetValue(i)));
+      }
+      return result;
+    }
 
-          return obj;
-        }
-        case ValueType::String:
-          return CefV8Value::CreateString(m_String);
-        case ValueType::Time:
-          return CefV8Value::CreateDate(CefTime(m_Value.Time));
+    if (value->IsObject()) {
+      std::vector<CefString> keys;
+      if (!value->GetKeys(keys))
+        return CreateObject(0);
+      CValue* result = CreateObject((uint32_t)keys.size());
+      for (auto it = keys.begin(); it != keys.end(); ++it) {
+        result->SetChild(it->ToString().c_str(),
+                         Convert(value->GetValue(*it)));
       }
+      return result;
+    }
 
-      return nullptr;
+    return nullptr;
   }
-
-      private :
-  ValueType m_ValueType;
-  std::map<std::string, CefRefPtr<CAfxValue>> m_Children;
-  std::vector<CefRefPtr<CAfxValue>> m_Elements;
-  union Value_u {
-    bool Bool;
-    int Int;
-    unsigned int UInt;
-    double Double;
-    time_t Time;
-  } m_Value;
-  CefRefPtr<CefV8Value> m_Function;
-  std::string m_String;
-
-  IMPLEMENT_REFCOUNTING(CAfxValue);
-  DISALLOW_COPY_AND_ASSIGN(CAfxValue);
 };
 
 class CAfxCallback : public CefBaseRefCounted {
@@ -1763,6 +1436,99 @@ class CAfxHandle : public CAfxObject {
   IMPLEMENT_REFCOUNTING(CAfxData);
 };
 
+// CAfxValueArena //////////////////////////////////////////////////////////////
+
+CefRefPtr<CefV8Value> CAfxValueArena::ToV8Value(const CValue* value,
+                                                ToV8Value_s& state) {
+  if (nullptr == value)
+    return CefV8Value::CreateUndefined();
+
+  switch (value->GetType()) {
+    case CValue::Type::Bool:
+      return CefV8Value::CreateBool(value->GetBool());
+    case CValue::Type::Int:
+      return CefV8Value::CreateInt(value->GetInt());
+    case CValue::Type::UInt:
+      return CefV8Value::CreateUInt(value->GetUInt());
+    case CValue::Type::Double:
+      return CefV8Value::CreateDouble(value->GetDouble());
+    case CValue::Type::Function:
+      return GetV8Function(value);
+    case CValue::Type::Array: {
+      uint32_t size = value->GetArraySize();
+      CefRefPtr<CefV8Value> arr = CefV8Value::CreateArray((int)size);
+      for (uint32_t i = 0; i < size; ++i) {
+        arr->SetValue((int)i, ToV8Value(value->GetArrayElement(i), state));
+      }
+      return arr;
+    }
+    case CValue::Type::Object: {
+      CefRefPtr<CefV8Value> obj = CefV8Value::CreateObject(nullptr, nullptr);
+      for (uint32_t i = 0; i < value->GetChildCount(); ++i) {
+        obj->SetValue(state.Names.Get(value->GetChildName(i)),
+                      ToV8Value(value->GetChildAt(i), state),
+                      V8_PROPERTY_ATTRIBUTE_NONE);
+      }
+      return obj;
+    }
+    case CValue::Type::String:
+      return CefV8Value::CreateString(value->GetString().ToString());
+    case CValue::Type::Time:
+      return CefV8Value::CreateDate(CefTime((time_t)value->GetTime()));
+    case CValue::Type::Float32Buffer:
+      return GetArrayBuffer(value, state);
+    case CValue::Type::Float32Array: {
+      if (nullptr != state.NewFloat32Array) {
+        CefV8ValueList args;
+        args.push_back(GetArrayBuffer(value->GetFloat32Buffer(), state));
+        args.push_back(CefV8Value::CreateUInt(
+            (uint32_t)(value->GetFloat32Offset() * sizeof(float))));
+        args.push_back(CefV8Value::CreateUInt(value->GetFloat32Length()));
+        auto result = state.NewFloat32Array->ExecuteFunction(nullptr, args);
+        if (result)
+          return result;
+      }
+      const float* data = value->GetFloat32Data();
+      uint32_t length = value->GetFloat32Length();
+      CefRefPtr<CefV8Value> arr = CefV8Value::CreateArray((int)length);
+      for (uint32_t i = 0; i < length; ++i) {
+        arr->SetValue((int)i, CefV8Value::CreateDouble(data[i]));
+      }
+      return arr;
+    }
+    case CValue::Type::Bytes:
+      return CopyArrayBuffer(value->GetBytesData(), value->GetBytesLength());
+    default:
+      break;
+  }
+
+  return CefV8Value::CreateUndefined();
+}
+
+CefRefPtr<CefV8Value> CAfxValueArena::GetArrayBuffer(const CValue* buffer,
+                                                     ToV8Value_s& state) {
+  for (auto& it : state.Buffers) {
+    if (it.first == buffer)
+      return it.second;
+  }
+
+  auto result =
+      CopyArrayBuffer(buffer->GetFloat32Data(),
+                      (uint32_t)(buffer->GetFloat32Length() * sizeof(float)));
+  state.Buffers.emplace_back(buffer, result);
+  return result;
+}
+
+CefRefPtr<CefV8Value> CAfxValueArena::CopyArrayBuffer(const void* bytes,
+                                                      uint32_t size) {
+  // V8 owns the copy, the arena is reused:
+  void* data = malloc(0 < size ? size : 1);
+  if (0 < size)
+    memcpy(data, bytes, size);
+
+  return CAfxData::Create(size, data);
+}
+
 class CCalcCallbacksGuts {
 public:
   ~CCalcCallbacksGuts() {
@@ -1803,7 +1569,7 @@ public:
 template <typename R>
 class CCalcCallbacks abstract : public CCalcCallbacksGuts {
  public:
-  bool BatchUpdateRequest(CNamedPipeServer & pipeServer) {
+  bool BatchUpdateRequest(CTransportStream & pipeServer) {
     if (!pipeServer.WriteCompressedUInt32((UINT32)m_Map.size()))
       return false;
     for (typename std::map<std::string, std::set<CefRefPtr<CAfxCallback>>>::iterator it =
@@ -1816,7 +1582,7 @@ class CCalcCallbacks abstract : public CCalcCallbacksGuts {
     return true;
   }
 
-  bool BatchUpdateResult(CefRefPtr<CInterop> interop, CNamedPipeServer & pipeServer) {
+  bool BatchUpdateResult(CefRefPtr<CInterop> interop, CTransportStream & pipeServer) {
     CefRefPtr<R> result;
 
     for (typename std::map<std::string, std::set<CefRefPtr<CAfxCallback>>>::iterator it =
@@ -1834,15 +1600,10 @@ class CCalcCallbacks abstract : public CCalcCallbacksGuts {
       }
 
       for (typename std::set<CefRefPtr<CAfxCallback>>::iterator setIt = (*it).second.begin(); setIt != (*it).second.end(); ++setIt) {
-        CefPostTask(TID_RENDERER,
-                    new CAfxTask([this, interop, callback = *setIt, result]() {
-                      if (nullptr == interop->m_Context)
-                        return;
-
-          interop->m_Context->Enter();
-                      CallResult(callback, interop->m_Context, result);
-            interop->m_Context->Exit();
-        }));
+        interop->PostCompletion([this, interop, callback = *setIt, result]() {
+          CallResult(callback, interop->m_Context, interop->m_PropertyNames,
+                     result);
+        });
       }
     }
 
@@ -1850,16 +1611,17 @@ class CCalcCallbacks abstract : public CCalcCallbacksGuts {
   }
 
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer, CefRefPtr<R> outResult) = 0;
+  virtual bool ReadResult(CTransportStream & pipeServer, CefRefPtr<R> outResult) = 0;
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
                           CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<R> result) = 0;
 };
 
 class CHandleCalcCallbacks
     : public CCalcCallbacks<struct HandleCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                           CefRefPtr<struct HandleCalcResult_s> outResult) override {
     if (!pipeServer.ReadInt32(outResult->IntHandle))
       return false;
@@ -1869,6 +1631,7 @@ class CHandleCalcCallbacks
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
       CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct HandleCalcResult_s> result) override {
 
     CefV8ValueList args;
@@ -1876,7 +1639,8 @@ class CHandleCalcCallbacks
     if (result) {
       CefRefPtr<CefV8Value> v8Obj = CefV8Value::CreateObject(nullptr, nullptr);
 
-      v8Obj->SetValue("intHandle", CefV8Value::CreateInt(result->IntHandle),
+      v8Obj->SetValue(names.Get("intHandle"),
+                      CefV8Value::CreateInt(result->IntHandle),
                       V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
@@ -1891,20 +1655,12 @@ class CHandleCalcCallbacks
 class CVecAngCalcCallbacks
     : public CCalcCallbacks<struct VecAngCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                          CefRefPtr<struct VecAngCalcResult_s> outResult) override {
-    if (!pipeServer.ReadSingle(outResult->Vector.X))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->Vector.Y))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->Vector.Z))
+    if (!ReadVector(pipeServer, outResult->Vector))
       return false;
 
-    if (!pipeServer.ReadSingle(outResult->QAngle.Pitch))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->QAngle.Yaw))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->QAngle.Roll))
+    if (!ReadQAngle(pipeServer, outResult->QAngle))
       return false;
 
     return true;
@@ -1912,6 +1668,7 @@ class CVecAngCalcCallbacks
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
       CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct VecAngCalcResult_s> result) override {
 
     CefV8ValueList args;
@@ -1921,24 +1678,31 @@ class CVecAngCalcCallbacks
 
       CefRefPtr<CefV8Value> v8Vector =
           CefV8Value::CreateObject(nullptr, nullptr);
-      v8Vector->SetValue("x", CefV8Value::CreateDouble(result->Vector.X),
+      v8Vector->SetValue(names.Get("x"),
+                         CefV8Value::CreateDouble(result->Vector.X),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("y", CefV8Value::CreateDouble(result->Vector.Y),
+      v8Vector->SetValue(names.Get("y"),
+                         CefV8Value::CreateDouble(result->Vector.Y),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("z", CefV8Value::CreateDouble(result->Vector.Z),
+      v8Vector->SetValue(names.Get("z"),
+                         CefV8Value::CreateDouble(result->Vector.Z),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Obj->SetValue("vector", v8Vector, V8_PROPERTY_ATTRIBUTE_NONE);
+      v8Obj->SetValue(names.Get("vector"),
+                      v8Vector, V8_PROPERTY_ATTRIBUTE_NONE);
 
       CefRefPtr<CefV8Value> v8QAngle =
           CefV8Value::CreateObject(nullptr, nullptr);
-      v8Vector->SetValue("pitch",
+      v8QAngle->SetValue(names.Get("pitch"),
                          CefV8Value::CreateDouble(result->QAngle.Pitch),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("yaw", CefV8Value::CreateDouble(result->QAngle.Yaw),
+      v8QAngle->SetValue(names.Get("yaw"),
+                         CefV8Value::CreateDouble(result->QAngle.Yaw),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("roll", CefV8Value::CreateDouble(result->QAngle.Roll),
+      v8QAngle->SetValue(names.Get("roll"),
+                         CefV8Value::CreateDouble(result->QAngle.Roll),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Obj->SetValue("qAngle", v8QAngle, V8_PROPERTY_ATTRIBUTE_NONE);
+      v8Obj->SetValue(names.Get("qAngle"),
+                      v8QAngle, V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
     } else {
@@ -1951,20 +1715,12 @@ class CVecAngCalcCallbacks
 
 class CCamCalcCallbacks : public CCalcCallbacks<struct CamCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                           CefRefPtr<struct CamCalcResult_s> outResult) override {
-    if (!pipeServer.ReadSingle(outResult->Vector.X))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->Vector.Y))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->Vector.Z))
+    if (!ReadVector(pipeServer, outResult->Vector))
       return false;
 
-    if (!pipeServer.ReadSingle(outResult->QAngle.Pitch))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->QAngle.Yaw))
-      return false;
-    if (!pipeServer.ReadSingle(outResult->QAngle.Roll))
+    if (!ReadQAngle(pipeServer, outResult->QAngle))
       return false;
 
     if (!pipeServer.ReadSingle(outResult->Fov))
@@ -1975,6 +1731,7 @@ class CCamCalcCallbacks : public CCalcCallbacks<struct CamCalcResult_s> {
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
                           CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct CamCalcResult_s> result) override {
     CefV8ValueList args;
 
@@ -1983,26 +1740,33 @@ class CCamCalcCallbacks : public CCalcCallbacks<struct CamCalcResult_s> {
 
       CefRefPtr<CefV8Value> v8Vector =
           CefV8Value::CreateObject(nullptr, nullptr);
-      v8Vector->SetValue("x", CefV8Value::CreateDouble(result->Vector.X),
+      v8Vector->SetValue(names.Get("x"),
+                         CefV8Value::CreateDouble(result->Vector.X),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("y", CefV8Value::CreateDouble(result->Vector.Y),
+      v8Vector->SetValue(names.Get("y"),
+                         CefV8Value::CreateDouble(result->Vector.Y),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("z", CefV8Value::CreateDouble(result->Vector.Z),
+      v8Vector->SetValue(names.Get("z"),
+                         CefV8Value::CreateDouble(result->Vector.Z),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Obj->SetValue("vector", v8Vector, V8_PROPERTY_ATTRIBUTE_NONE);
+      v8Obj->SetValue(names.Get("vector"),
+                      v8Vector, V8_PROPERTY_ATTRIBUTE_NONE);
 
       CefRefPtr<CefV8Value> v8QAngle =
           CefV8Value::CreateObject(nullptr, nullptr);
-      v8Vector->SetValue("pitch",
+      v8QAngle->SetValue(names.Get("pitch"),
                          CefV8Value::CreateDouble(result->QAngle.Pitch),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("yaw", CefV8Value::CreateDouble(result->QAngle.Yaw),
+      v8QAngle->SetValue(names.Get("yaw"),
+                         CefV8Value::CreateDouble(result->QAngle.Yaw),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Vector->SetValue("roll", CefV8Value::CreateDouble(result->QAngle.Roll),
+      v8QAngle->SetValue(names.Get("roll"),
+                         CefV8Value::CreateDouble(result->QAngle.Roll),
                          V8_PROPERTY_ATTRIBUTE_NONE);
-      v8Obj->SetValue("qAngle", v8QAngle, V8_PROPERTY_ATTRIBUTE_NONE);
+      v8Obj->SetValue(names.Get("qAngle"),
+                      v8QAngle, V8_PROPERTY_ATTRIBUTE_NONE);
 
-      v8Obj->SetValue("fov", CefV8Value::CreateDouble(result->Fov),
+      v8Obj->SetValue(names.Get("fov"), CefV8Value::CreateDouble(result->Fov),
                       V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
@@ -2017,7 +1781,7 @@ class CCamCalcCallbacks : public CCalcCallbacks<struct CamCalcResult_s> {
 class CFovCalcCallbacks
     : public CCalcCallbacks<struct FovCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                           CefRefPtr<struct FovCalcResult_s> outResult) override {
     if (!pipeServer.ReadSingle(outResult->Fov))
       return false;
@@ -2027,13 +1791,14 @@ class CFovCalcCallbacks
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
                           CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct FovCalcResult_s> result) override {
     CefV8ValueList args;
 
     if (result) {
       CefRefPtr<CefV8Value> v8Obj = CefV8Value::CreateObject(nullptr, nullptr);
 
-      v8Obj->SetValue("fov", CefV8Value::CreateDouble(result->Fov),
+      v8Obj->SetValue(names.Get("fov"), CefV8Value::CreateDouble(result->Fov),
                       V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
@@ -2048,7 +1813,7 @@ class CFovCalcCallbacks
 class CBoolCalcCallbacks
     : public CCalcCallbacks<struct BoolCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                           CefRefPtr<struct BoolCalcResult_s> outResult) override {
     bool result;
     if (!pipeServer.ReadBoolean(result))
@@ -2061,13 +1826,15 @@ class CBoolCalcCallbacks
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
                           CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct BoolCalcResult_s> result) override {
     CefV8ValueList args;
 
     if (result) {
       CefRefPtr<CefV8Value> v8Obj = CefV8Value::CreateObject(nullptr, nullptr);
 
-      v8Obj->SetValue("result", CefV8Value::CreateBool(result->Result),
+      v8Obj->SetValue(names.Get("result"),
+                      CefV8Value::CreateBool(result->Result),
                       V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
@@ -2082,7 +1849,7 @@ class CBoolCalcCallbacks
 class CIntCalcCallbacks
     : public CCalcCallbacks<struct IntCalcResult_s> {
  protected:
-  virtual bool ReadResult(CNamedPipeServer & pipeServer,
+  virtual bool ReadResult(CTransportStream & pipeServer,
                           CefRefPtr<struct IntCalcResult_s> outResult) override {
     INT32 result;
     if (!pipeServer.ReadInt32(result))
@@ -2095,13 +1862,15 @@ class CIntCalcCallbacks
 
   virtual void CallResult(CefRefPtr<CAfxCallback> callback,
                           CefRefPtr<CefV8Context> context,
+                          CPropertyNames& names,
                           CefRefPtr<struct IntCalcResult_s> result) override {
     CefV8ValueList args;
 
     if (result) {
       CefRefPtr<CefV8Value> v8Obj = CefV8Value::CreateObject(nullptr, nullptr);
 
-      v8Obj->SetValue("result", CefV8Value::CreateInt(result->Result),
+      v8Obj->SetValue(names.Get("result"),
+                      CefV8Value::CreateInt(result->Result),
                       V8_PROPERTY_ATTRIBUTE_NONE);
 
       args.push_back(v8Obj);
@@ -2113,19 +1882,40 @@ class CIntCalcCallbacks
   }
 };
 
-class CAfxInterop {
+class CAfxInterop : public CTaskObserver {
  public:
   CAfxInterop(const char* pipeName)
       : m_PipeName(pipeName),
         m_PipeServer(TEN_MINUTES_IN_MILLISECONDS, TEN_MINUTES_IN_MILLISECONDS) {
+    m_PipeQueue.SetObserver(this);
   }
 
   virtual bool Connection(DWORD readTimeOutMs = TEN_MINUTES_IN_MILLISECONDS, DWORD writeTimeOutMs = TEN_MINUTES_IN_MILLISECONDS) {
 
+    // Would wait for a peer again:
+    if (m_PipeQueue.IsCancelled())
+      return false;
+
     Close();
 
+    m_ClientVersion = CVersion();
+    m_Negotiated = false;
+    m_Capabilities = 0;
+
+    if (m_Replay.IsOpen()) {
+      if (m_PipeServer.OpenReplay(&m_Replay)) {
+        m_Connected = true;
+        OnConnect();
+        return true;
+      }
+
+      return false;
+    }
+
+    m_PipeServer.SetTimeouts(readTimeOutMs, writeTimeOutMs);
+
     if (m_PipeServer.OpenPipe(m_PipeName.c_str())) {
-      if (m_PipeServer.Connect()) {
+      if (m_PipeServer.Connect(m_Capture.IsOpen() ? &m_Capture : nullptr)) {
         m_Connected = true;
         OnConnect();
         return true;
@@ -2135,31 +1925,148 @@ class CAfxInterop {
     return false;
   }
 
+  /**
+   * Cancels the tasks queued on m_PipeQueue so far and the I/O of the
+   * running one. Can be called from any thread.
+   */
   virtual void Cancel() {
-    CancelSynchronousIo(m_PipeQueue.GetNativeThreadHandle());
+    m_PipeQueue.Cancel();
+    m_PipeServer.Cancel();
   }
 
 
-  virtual void Close() {
+  /**
+   * @param orderly If the connection is closed on request, rather than on an
+   *   error or cancel. Only then what is pending is still sent.
+   */
+  virtual void Close(bool orderly = false) {
     if(m_Connected) {
       OnClose();
       m_Connected = false;   
     }
 
-    m_PipeServer.Close();
+    m_PipeServer.Close(orderly && !m_PipeQueue.IsCancelled());
+    m_Capture.Flush();
   }
 
   virtual void SetPipeName(const char* value) { m_PipeName = value; }
 
+  /**
+   * Records the traffic of all further connections to the file at path, an
+   * empty path stops recording.
+   */
+  bool SetCapture(const char* path) {
+    m_Capture.Close();
+
+    return '\0' == path[0] || m_Capture.Open(path);
+  }
+
+  /**
+   * Further connections play back the capture at path instead of waiting
+   * for HLAE, an empty path goes back to HLAE.
+   */
+  bool SetReplay(const char* path, bool paced) {
+    Close();
+
+    m_Replay.Close();
+    m_Replay.SetPaced(paced);
+
+    return '\0' == path[0] || m_Replay.Open(path);
+  }
+
+  virtual void SetPipeTimeouts(DWORD readTimeOutMs, DWORD writeTimeOutMs) {
+    m_ReadTimeOutMs = readTimeOutMs;
+    m_WriteTimeOutMs = writeTimeOutMs;
+  }
+
   bool GetConnected() {
     return m_Connected;
   }
 
+  /**
+   * @returns false if the client negotiated the capabilities of the current
+   * connection and capability is not among them. Legacy clients don't
+   * negotiate, so this is true for them.
+   */
+  bool MayUse(InteropCapability_e capability) const {
+    return !m_Negotiated || 0 != (m_Capabilities & capability);
+  }
+
+  /**
+   * Adds the counters of the pipe to stats, getOpcodeName names the opcodes
+   * in m_OpcodeStats.
+   */
+  void AddPipeStats(CefRefPtr<CefV8Value> stats,
+                    const char* (*getOpcodeName)(uint32_t opcode)) {
+    stats->SetValue("pipeQueue", CreateQueueStats(m_PipeQueue),
+                    V8_PROPERTY_ATTRIBUTE_NONE);
+
+    uint64_t frames = m_Frames.load(std::memory_order_relaxed);
+    uint64_t roundTrips = m_PipeServer.GetRoundTrips();
+
+    auto pipe = CefV8Value::CreateObject(nullptr, nullptr);
+    SetStat(pipe, "bytesIn", (double)m_PipeServer.GetBytesRead());
+    SetStat(pipe, "bytesOut", (double)m_PipeServer.GetBytesWritten());
+    SetStat(pipe, "roundTrips", (double)roundTrips);
+    SetStat(pipe, "frames", (double)frames);
+    SetStat(pipe, "roundTripsPerFrame",
+            0 < frames ? (double)roundTrips / frames : 0.0);
+    stats->SetValue("pipe", pipe, V8_PROPERTY_ATTRIBUTE_NONE);
+
+    auto opcodes = CefV8Value::CreateObject(nullptr, nullptr);
+    for (uint32_t i = 0; i < g_StatsOpcodes; ++i) {
+      const CLatencyHistogram& histogram = m_OpcodeStats.Get(i);
+      if (0 == histogram.GetCount())
+        continue;
+
+      const char* opcodeName = getOpcodeName(i);
+      opcodes->SetValue(nullptr != opcodeName ? opcodeName : std::to_string(i),
+                        CreateLatencyStats(histogram),
+                        V8_PROPERTY_ATTRIBUTE_NONE);
+    }
+    stats->SetValue("opcodes", opcodes, V8_PROPERTY_ATTRIBUTE_NONE);
+  }
+
+  // Observes m_PipeQueue.
+
+  virtual void OnTaskBegin() override {
+    // Cancelled tasks fail on their first I/O and reject what waits for
+    // them, the rejections go out together with PostCompletion:
+    if (m_PipeQueue.IsCancelled())
+      m_PipeServer.Cancel();
+
+    if (m_RequestOpcodes)
+      m_PipeServer.BeginRequest();
+  }
+
+  virtual void OnTaskEnd(uint64_t runNs) override {
+    uint32_t opcode = m_PipeServer.GetRequestOpcode();
+    if (g_NoOpcode != opcode)
+      m_OpcodeStats.Add(opcode, runNs);
+  }
+
  protected:
   std::string m_PipeName;
+  // Seen by 7.0 clients too (engine), they only check the major though:
+  CVersion m_ServerVersion{7, 1, 0, 0};
+  CVersion m_ClientVersion;
+  bool m_Negotiated = false;
+  uint32_t m_Capabilities = 0;
+  DWORD m_ReadTimeOutMs = TEN_MINUTES_IN_MILLISECONDS;
+  DWORD m_WriteTimeOutMs = TEN_MINUTES_IN_MILLISECONDS;
   CNamedPipeServer m_PipeServer;
   CThreadedQueue m_PipeQueue;
   bool m_Connected = false;
+  CCaptureWriter m_Capture;
+  CReplayTransport m_Replay;
+
+  std::atomic<uint64_t> m_Frames{0};
+  // Attribute each task of m_PipeQueue to the first UInt32 it writes, that is
+  // the opcode of the tasks that send a request.
+  bool m_RequestOpcodes = false;
+  COpcodeStats m_OpcodeStats;
+  uint32_t m_MessageOpcode = g_NoOpcode;
+  uint64_t m_MessageAt = 0;
 
   virtual ~CAfxInterop() {
     Close();
@@ -2172,13 +2079,40 @@ class CAfxInterop {
   virtual void OnClose() {
 
   }
+
+  /**
+   * Agrees on what both the client (offered) and this side (supported)
+   * support.
+   */
+  void NegotiateCapabilities(uint32_t offered, uint32_t supported) {
+    m_Negotiated = true;
+    m_Capabilities = offered & supported;
+  }
+
+  void CountFrame() { m_Frames.fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * Times handling the message with opcode from the client, until
+   * EndMessage().
+   */
+  void BeginMessage(uint32_t opcode) {
+    m_MessageOpcode = opcode;
+    m_MessageAt = GetStatsTimeNs();
+  }
+
+  void EndMessage() {
+    if (g_NoOpcode == m_MessageOpcode)
+      return;
+
+    m_OpcodeStats.Add(m_MessageOpcode, GetStatsTimeNs() - m_MessageAt);
+    m_MessageOpcode = g_NoOpcode;
+  }
 };
 
 class CDrawingInteropImpl : public CAfxObject,
                             public CInterop,
                             public CAfxInterop,
-                            public CPipeServer,
-                            public CPipeClient {
+                            public CPipeChannel {
   IMPLEMENT_REFCOUNTING(CDrawingInteropImpl);
 
  public:
@@ -2204,14 +2138,9 @@ class CDrawingInteropImpl : public CAfxObject,
       if (0 < m_OnFrame.size()) {
         auto fn_resolve = m_OnFrame.front();
         m_OnFrame.pop();
-        CefPostTask(TID_RENDERER, new CAfxTask([this, fn_resolve]() {
-                      if (nullptr == m_Context)
-                        return;
-
-                      m_Context->Enter();
-                      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                      m_Context->Exit();
-                    }));
+        PostCompletion([this, fn_resolve]() {
+          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+        });
       }
 
       return true;
@@ -2219,14 +2148,9 @@ class CDrawingInteropImpl : public CAfxObject,
       if (nullptr != m_OnAck) {
         auto fn_resolve = m_OnAck;
         m_OnAck = nullptr;
-        CefPostTask(TID_RENDERER, new CAfxTask([this, fn_resolve]() {
-                      if (nullptr == m_Context)
-                        return;
-
-                      m_Context->Enter();
-                      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                      m_Context->Exit();
-                    }));
+        PostCompletion([this, fn_resolve]() {
+          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+        });
       }
 
       return true;
@@ -2245,27 +2169,12 @@ class CDrawingInteropImpl : public CAfxObject,
     CefRefPtr<CDrawingInteropImpl> self =
         new CDrawingInteropImpl(browser->GetIdentifier());
 
-    std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_handler_");
-    strPipeName.append(std::to_string(handlerId));
-
     try {
-      while(true)
-      {
-      bool bError = false;
-      try {
-        self->OpenPipe(strPipeName.c_str(), INFINITE);
-        Sleep(100);
-      }
-      catch(const std::exception&)
-      {
-        bError = true;
-      }
-
-      if(!bError) break;
-      }
-      self->WriteUInt32(GetCurrentProcessId());
+      self->OpenChannel(handlerId);
       self->WriteInt32(browser->GetIdentifier());
       self->Flush();
+      self->m_ChannelThread =
+          CPooledThread(&CDrawingInteropImpl::ChannelThreadHandler, self.get());
     } catch (const std::exception& e) {
       DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                   << e.what();
@@ -2343,8 +2252,128 @@ CAfxObject::AddFunction(
         obj,
         "sendMessage",
         [](const CefString& name, CefRefPtr<CefV8Value> object,
-               const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
-               CefString& exceptionoverride) {
+               const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+               CefString& exceptionoverride) {
+          auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
+                                   CDrawingInteropImpl>(object);
+          if (self == nullptr) {
+            exceptionoverride = g_szInvalidThis;
+            return true;
+          }
+
+          if (4 <= arguments.size() && arguments[0]->IsFunction() &&
+              arguments[1]->IsFunction() && arguments[2]->IsInt() &&
+              arguments[3]->IsString()) {
+            self->m_InteropQueue.Queue([self, fn_resolve = arguments[0],
+                                      fn_reject = arguments[1],
+                                      id = arguments[2]->GetIntValue(),
+                                      str = arguments[3]->GetStringValue()]() {
+                  try {
+                    self->WriteInt32((int)HostMessage::Message);
+                    self->WriteInt32(id);
+                    self->WriteStringUTF8(str.ToString());
+                    self->Flush();
+
+                    self->PostCompletion([self, fn_resolve]() {
+                      fn_resolve->ExecuteFunction(nullptr,
+                                                  CefV8ValueList());
+                    });
+                  } catch (const std::exception& e) {
+                    self->PostCompletion([self, fn_reject,
+                                          error_msg = std::string(e.what())]() {
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateString(error_msg));
+                      fn_reject->ExecuteFunction(nullptr, args);
+                    });
+
+                  }
+                });
+
+            return true;
+          }
+
+          exceptionoverride = g_szInvalidArguments;
+          return true;
+        });
+
+    CAfxObject::AddFunction(
+        obj, "getStats",
+        [](const CefString& name, CefRefPtr<CefV8Value> object,
+           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+           CefString& exceptionoverride) {
+          auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
+                                     CDrawingInteropImpl>(object);
+          if (self == nullptr) {
+            exceptionoverride = g_szInvalidThis;
+            return true;
+          }
+
+          retval = self->GetStats();
+          return true;
+        });
+
+    self->m_OnMessage = CAfxObject::AddCallback(obj, "onMessage");
+
+    self->m_OnError = CAfxObject::AddCallback(obj, "onError");
+ 
+    CAfxObject::AddFunction(
+        obj, "setPipeName",
+        [](const CefString& name,
+                                              CefRefPtr<CefV8Value> object,
+                                              const CefV8ValueList& arguments,
+                                              CefRefPtr<CefV8Value>& retval,
+                                              CefString& exceptionoverride) {
+          auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
+                                   CDrawingInteropImpl>(object);
+          if (self == nullptr) {
+            exceptionoverride = g_szInvalidThis;
+            return true;
+          }
+
+        if (1 <= arguments.size() && arguments[0]->IsString()) {
+            self->m_PipeQueue.Queue(
+            [self, pipeName = arguments[0]->GetStringValue().ToString()]() {
+              self->SetPipeName(pipeName.c_str());
+            });
+
+        return true;
+      }
+
+      exceptionoverride = g_szInvalidArguments;
+      return true;
+    });
+
+    CAfxObject::AddFunction(
+        obj, "setPipeTimeouts",
+        [](const CefString& name, CefRefPtr<CefV8Value> object,
+           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+           CefString& exceptionoverride) {
+          auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
+                                   CDrawingInteropImpl>(object);
+          if (self == nullptr) {
+            exceptionoverride = g_szInvalidThis;
+            return true;
+          }
+
+          if (2 <= arguments.size() && arguments[0]->IsUInt() &&
+              arguments[1]->IsUInt()) {
+            self->m_PipeQueue.Queue(
+                [self, readTimeOutMs = arguments[0]->GetUIntValue(),
+                 writeTimeOutMs = arguments[1]->GetUIntValue()]() {
+                  self->SetPipeTimeouts(readTimeOutMs, writeTimeOutMs);
+                });
+            return true;
+          }
+
+          exceptionoverride = g_szInvalidArguments;
+          return true;
+        });
+
+    CAfxObject::AddFunction(
+        obj, "setCapture",
+        [](const CefString& name, CefRefPtr<CefV8Value> object,
+           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+           CefString& exceptionoverride) {
           auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
                                    CDrawingInteropImpl>(object);
           if (self == nullptr) {
@@ -2352,47 +2381,17 @@ CAfxObject::AddFunction(
             return true;
           }
 
-          if (4 <= arguments.size() && arguments[0]->IsFunction() &&
-              arguments[1]->IsFunction() && arguments[2]->IsInt() &&
-              arguments[3]->IsString()) {
-            self->m_InteropQueue.Queue([self, fn_resolve = arguments[0],
-                                      fn_reject = arguments[1],
-                                      id = arguments[2]->GetIntValue(),
-                                      str = arguments[3]->GetStringValue()]() {
-                  try {
-                    self->WriteInt32((int)HostMessage::Message);
-                    self->WriteInt32(id);
-                    self->WriteStringUTF8(str.ToString());
-                    self->Flush();
-
-                    CefPostTask(
-                        TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          fn_resolve->ExecuteFunction(nullptr,
-                                                      CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
-                  } catch (const std::exception& e) {
-                    CefPostTask(
-                        TID_RENDERER,
-                        new CAfxTask([self, fn_reject,
-                                      error_msg = std::string(e.what())]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          CefV8ValueList args;
-                          args.push_back(CefV8Value::CreateString(error_msg));
-                          fn_reject->ExecuteFunction(nullptr, args);
-                          self->m_Context->Exit();
-                        }));
-
-                  }
+          if (3 <= arguments.size() && arguments[0]->IsFunction() &&
+              arguments[1]->IsFunction() && arguments[2]->IsString()) {
+            self->m_PipeQueue.Queue(
+                [self, fn_resolve = arguments[0], fn_reject = arguments[1],
+                 path = arguments[2]->GetStringValue().ToString()]() {
+                  bool bOk = self->SetCapture(path.c_str());
+                  self->PostCompletion([self, fn_resolve, fn_reject, bOk]() {
+                    (bOk ? fn_resolve : fn_reject)
+                        ->ExecuteFunction(nullptr, CefV8ValueList());
+                  });
                 });
-
             return true;
           }
 
@@ -2400,17 +2399,11 @@ CAfxObject::AddFunction(
           return true;
         });
 
-    self->m_OnMessage = CAfxObject::AddCallback(obj, "onMessage");
-
-    self->m_OnError = CAfxObject::AddCallback(obj, "onError");
- 
     CAfxObject::AddFunction(
-        obj, "setPipeName",
-        [](const CefString& name,
-                                              CefRefPtr<CefV8Value> object,
-                                              const CefV8ValueList& arguments,
-                                              CefRefPtr<CefV8Value>& retval,
-                                              CefString& exceptionoverride) {
+        obj, "setReplay",
+        [](const CefString& name, CefRefPtr<CefV8Value> object,
+           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+           CefString& exceptionoverride) {
           auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
                                    CDrawingInteropImpl>(object);
           if (self == nullptr) {
@@ -2418,17 +2411,26 @@ CAfxObject::AddFunction(
             return true;
           }
 
-        if (1 <= arguments.size() && arguments[0]->IsString()) {
-            self->m_PipeQueue.Queue(
-            [self, pipeName = arguments[0]->GetStringValue().ToString()]() {
-              self->SetPipeName(pipeName.c_str());
-            });
-        return true;
-      }
+          if (3 <= arguments.size() && arguments[0]->IsFunction() &&
+              arguments[1]->IsFunction() && arguments[2]->IsString()) {
+            bool paced = 4 <= arguments.size() && arguments[3]->IsBool() &&
+                         arguments[3]->GetBoolValue();
+            // Releases for the current connection go out before it's closed:
+            self->m_PipeQueue.QueueBarrier(
+                [self, fn_resolve = arguments[0], fn_reject = arguments[1],
+                 path = arguments[2]->GetStringValue().ToString(), paced]() {
+                  bool bOk = self->SetReplay(path.c_str(), paced);
+                  self->PostCompletion([self, fn_resolve, fn_reject, bOk]() {
+                    (bOk ? fn_resolve : fn_reject)
+                        ->ExecuteFunction(nullptr, CefV8ValueList());
+                  });
+                });
+            return true;
+          }
 
-      exceptionoverride = g_szInvalidArguments;
-      return true;
-    });
+          exceptionoverride = g_szInvalidArguments;
+          return true;
+        });
 
     CAfxObject::AddFunction(
         obj, "setFrameRate",
@@ -2568,27 +2570,18 @@ CAfxObject::AddFunction(
 
       if (2 <= arguments.size() && arguments[0]->IsFunction() &&
           arguments[1]->IsFunction()) {
-        self->m_PipeQueue.Queue([self, fn_resolve = arguments[0],
-                                 fn_reject = arguments[1]]() {
-          if (self->Connection()) {
-
-            CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Context)
-                            return;
+        // Releases for the previous connection go out before it's closed:
+        self->m_PipeQueue.QueueBarrier([self, fn_resolve = arguments[0],
+                                        fn_reject = arguments[1]]() {
+          if (self->Connection(self->m_ReadTimeOutMs, self->m_WriteTimeOutMs)) {
 
-                          self->m_Context->Enter();
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
+            self->PostCompletion([self, fn_resolve]() {
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           } else {
-            CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
+            self->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           }
         });
         return true;
@@ -2629,16 +2622,11 @@ CAfxObject::AddFunction(
           if (2 <= arguments.size() && arguments[0]->IsFunction() &&
               arguments[1]->IsFunction()) {
 
-            self->m_PipeQueue.Queue([self, fn_resolve = arguments[0]]() {
-              self->Close();
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+            self->m_PipeQueue.QueueBarrier([self, fn_resolve = arguments[0]]() {
+              self->Close(true);
+              self->PostCompletion([self, fn_resolve]() {
+                fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -2671,40 +2659,29 @@ CAfxObject::AddFunction(
           unsigned int pass = 0;
 
           if (self->GetConnected() && 0 == (errorLine = self->DoPumpBegin(queuedThreaded, frameCount, pass))) {
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_resolve,
-                                      queuedThreaded, frameCount, pass]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          CefV8ValueList args;
-                          auto dict = CefV8Value::CreateObject(nullptr,nullptr);
-                          dict->SetValue("queuedThreaded",
-                                         CefV8Value::CreateBool(queuedThreaded),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                          dict->SetValue("frameCount",
-                                         CefV8Value::CreateInt(frameCount),
-                                           V8_PROPERTY_ATTRIBUTE_NONE);
-                          dict->SetValue("pass",
-                                           CefV8Value::CreateUInt(pass),
-                                           V8_PROPERTY_ATTRIBUTE_NONE);
-                          args.push_back(dict);
-                          fn_resolve->ExecuteFunction(nullptr, args);
-                          self->m_Context->Exit();
-                        }));
+            self->PostCompletion([self, fn_resolve, queuedThreaded, frameCount,
+                                  pass]() {
+              CefV8ValueList args;
+              auto dict = CefV8Value::CreateObject(nullptr,nullptr);
+              dict->SetValue(self->m_PropertyNames.Get("queuedThreaded"),
+                             CefV8Value::CreateBool(queuedThreaded),
+                             V8_PROPERTY_ATTRIBUTE_NONE);
+              dict->SetValue(self->m_PropertyNames.Get("frameCount"),
+                             CefV8Value::CreateInt(frameCount),
+                             V8_PROPERTY_ATTRIBUTE_NONE);
+              dict->SetValue(self->m_PropertyNames.Get("pass"),
+                             CefV8Value::CreateUInt(pass),
+                             V8_PROPERTY_ATTRIBUTE_NONE);
+              args.push_back(dict);
+              fn_resolve->ExecuteFunction(nullptr, args);
+            });
           } else {
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_reject, errorLine]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          CefV8ValueList args;
-                          args.push_back(CefV8Value::CreateString("AfxInterop.cpp:"+std::to_string(errorLine)));
-                          fn_reject->ExecuteFunction(nullptr, args);
-                          self->m_Context->Exit();
-                        }));
+            self->PostCompletion([self, fn_reject, errorLine,
+                                  timedOut = self->m_PipeServer.GetTimedOut()]() {
+              CefV8ValueList args;
+              args.push_back(CefV8Value::CreateString("AfxInterop.cpp:"+std::to_string(errorLine) + (timedOut ? ": timed out" : "")));
+              fn_reject->ExecuteFunction(nullptr, args);
+            });
           }
         });
 
@@ -2739,24 +2716,17 @@ CAfxObject::AddFunction(
               if (!self->m_PipeServer.Flush())
                 goto error;
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            self->m_Context->Enter();
-                            fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve]() {
+                fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+              });
               return;
 
             error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
             return true;
@@ -2789,24 +2759,17 @@ CAfxObject::AddFunction(
               if (!self->m_PipeServer.Flush())
                 goto error;
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            self->m_Context->Enter();
-                            fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve]() {
+                fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+              });
               return;
 
             error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
             return true;
@@ -2833,7 +2796,11 @@ CAfxObject::AddFunction(
 
      if (2 <= arguments.size() && arguments[0]->IsFunction() &&
           arguments[1]->IsFunction()) {
-            self->m_PipeQueue.Queue([self, fn_resolve = arguments[0],
+            // Releases queued in this pass go out before Finished. HLAE
+            // doesn't read between passes and the pipes are unbuffered, so a
+            // release written after Finished would hold up the next
+            // pumpBegin until the write times out.
+            self->m_PipeQueue.QueueBarrier([self, fn_resolve = arguments[0],
                                  fn_reject = arguments[1]]() {
 
             if (!self->m_PipeServer.WriteUInt32(
@@ -2844,24 +2811,17 @@ CAfxObject::AddFunction(
               goto error;
 
 
-            CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                          self->m_Context->Enter();
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
+            self->PostCompletion([self, fn_resolve]() {
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
             return;
 
           error:
           self->Close();
 
-            CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
-                       fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                        self->m_Context->Exit();
-                     }));
+            self->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
         });
 
         return true;
@@ -2905,8 +2865,8 @@ CAfxObject::AddFunction(
                   goto __error;
                 if (!self->m_PipeServer.WriteUInt32((UINT32)data->GetSize()))
                   goto __error;
-                if (!self->m_PipeServer.WriteBytes(data->GetData(), 0,
-                                                    (DWORD)data->GetSize()))
+                if (!self->WriteBulkBytes(data->GetData(),
+                                          (UINT32)data->GetSize()))
                   goto __error;
 
                 if (!self->m_PipeServer.Flush())
@@ -2916,62 +2876,42 @@ CAfxObject::AddFunction(
                 if (!self->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->ReleaseBulk();
+
                if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve,
-                                          refVertexDeclaration, retobj, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                                self->m_Context->Enter();
-                              refVertexDeclaration->SetValue(0, retobj);
-
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Context->Exit();
-                              }));
+                  self->PostCompletion([self, fn_resolve, refVertexDeclaration,
+                                        retobj, hr]() {
+                    refVertexDeclaration->SetValue(0, retobj);
+
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateInt(hr));
+                      fn_resolve->ExecuteFunction(
+                          nullptr, args);
+                  });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -3056,27 +2996,15 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
-
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
@@ -3087,39 +3015,28 @@ CAfxObject::AddFunction(
                   goto __error;
               }
 
-              CefPostTask(TID_RENDERER,
-                          new CAfxTask([self, fn_resolve, hr,
-                                        tmpHandle, refIndexBuffer, refHandle, retobj,
-                                        drawingHandle]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-
-                            refIndexBuffer->SetValue(0, retobj);
-                            if (nullptr != drawingHandle) {
-                              refHandle->SetValue(
-                                  0, CAfxHandle::Create(tmpHandle, nullptr));
-                            }
-
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr, tmpHandle,
+                                    refIndexBuffer, refHandle, retobj,
+                                    drawingHandle]() {
+
+                refIndexBuffer->SetValue(0, retobj);
+                if (nullptr != drawingHandle) {
+                  refHandle->SetValue(
+                      0, CAfxHandle::Create(tmpHandle, nullptr));
+                }
+
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
         return true;
@@ -3202,27 +3119,15 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
@@ -3233,39 +3138,28 @@ CAfxObject::AddFunction(
                   goto __error;
               }
 
-              CefPostTask(TID_RENDERER,
-                          new CAfxTask([self, fn_resolve, hr,
-                                        tmpHandle, refVertexBuffer, refHandle, retobj,
-                                        drawingHandle]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-
-                            refVertexBuffer->SetValue(0, retobj);
-                            if (nullptr != drawingHandle) {
-                              refHandle->SetValue(
-                                  0, CAfxHandle::Create(tmpHandle, nullptr));
-                            }
-
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr, tmpHandle,
+                                    refVertexBuffer, refHandle, retobj,
+                                    drawingHandle]() {
+
+                refVertexBuffer->SetValue(0, retobj);
+                if (nullptr != drawingHandle) {
+                  refHandle->SetValue(
+                      0, CAfxHandle::Create(tmpHandle, nullptr));
+                }
+
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
         return true;
@@ -3359,27 +3253,15 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      self->m_Context->Enter();
-
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
@@ -3390,40 +3272,28 @@ CAfxObject::AddFunction(
                   goto __error;
               }
 
-              CefPostTask(TID_RENDERER,
-                          new CAfxTask([self, fn_resolve, hr,
-                                        tmpHandle, refTexture, refHandle, retobj,
-                                        drawingHandle]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-
-                            refTexture->SetValue(0, retobj);
-                            if (nullptr != drawingHandle &&
-                                nullptr != refHandle) {
-                              refHandle->SetValue(
-                                  0, CAfxHandle::Create(tmpHandle, nullptr));
-                            }
-
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr, tmpHandle, refTexture,
+                                    refHandle, retobj, drawingHandle]() {
+
+                refTexture->SetValue(0, retobj);
+                if (nullptr != drawingHandle &&
+                    nullptr != refHandle) {
+                  refHandle->SetValue(
+                      0, CAfxHandle::Create(tmpHandle, nullptr));
+                }
+
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
         return true;
@@ -3485,62 +3355,40 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, refVertexShader,
-                                          retobj, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
+                  self->PostCompletion([self, fn_resolve, refVertexShader,
+                                        retobj, hr]() {
 
-                              self->m_Context->Enter();
+                    refVertexShader->SetValue(0, retobj);
 
-                              refVertexShader->SetValue(0, retobj);
-
-                              CefV8ValueList args;
+                    CefV8ValueList args;
 
-                              args.push_back(CefV8Value::CreateInt(hr));
+                    args.push_back(CefV8Value::CreateInt(hr));
 
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                 
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -3602,60 +3450,38 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
 
 
-                  CefPostTask(TID_RENDERER,
-                              new CAfxTask([self, fn_resolve, refPixelShader,
-                                          retobj, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
+                  self->PostCompletion([self, fn_resolve, refPixelShader,
+                                        retobj, hr]() {
+                    refPixelShader->SetValue(0, retobj);
 
-                                self->m_Context->Enter();
-                              refPixelShader->SetValue(0, retobj);
-
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Context->Exit();
-                              }));
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateInt(hr));
+                      fn_resolve->ExecuteFunction(
+                          nullptr, args);
+                  });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -3711,55 +3537,32 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        self->m_Context->Enter();
-
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
+                self->PostCompletion([self, fn_resolve, hr]() {
 
-                              self->m_Context->Enter();
-
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
 
 
               });
@@ -3810,52 +3613,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -3898,52 +3680,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4001,54 +3762,32 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
               return true;
             }
@@ -4101,52 +3840,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4203,52 +3921,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4302,52 +3999,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4403,52 +4079,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4516,52 +4171,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4613,52 +4247,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4716,52 +4329,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4810,52 +4402,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4904,52 +4475,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -4997,52 +4547,31 @@ CAfxObject::AddFunction(
                 unsigned int lastError;
                 if (!self->m_PipeServer.ReadUInt32(lastError))
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                       CefV8Value::CreateUInt(lastError),
-                                       V8_PROPERTY_ATTRIBUTE_NONE);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(hr, lastError);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(hr));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve, hr]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(hr));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -5109,53 +4638,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5222,53 +4729,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5335,53 +4820,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5448,53 +4911,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5561,53 +5002,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5674,53 +5093,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5774,53 +5171,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
                  });
 
            return true;
@@ -5884,53 +5259,31 @@ CAfxObject::AddFunction(
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
-
-                        self->m_Context->Enter();
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(lastError),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
               return true;
             }
@@ -5967,27 +5320,17 @@ CAfxObject::AddFunction(
         )
           goto __error;
 
-        CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
-                      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                      self->m_Context->Exit();
-                    }));
+        self->PostCompletion([self, fn_resolve]() {
+          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+        });
         return;
 
       __error:
         self->Close();
 
-        CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
-                      fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                      self->m_Context->Exit();
-                    }));
+        self->PostCompletion([self, fn_reject]() {
+          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+        });
     });
               return true;
           }
@@ -6046,9 +5389,9 @@ CAfxObject::AddFunction(
                       if (!self->m_PipeServer.WriteUInt32(
                               (UINT32)vertexStreamZeroData->GetSize()))
                         goto __error;
-                      if (!self->m_PipeServer.WriteBytes(
-                              vertexStreamZeroData->GetData(), 0,
-                              (DWORD)vertexStreamZeroData->GetSize()))
+                      if (!self->WriteBulkBytes(
+                              vertexStreamZeroData->GetData(),
+                              (UINT32)vertexStreamZeroData->GetSize()))
                         goto __error;
                 }
 
@@ -6059,58 +5402,38 @@ CAfxObject::AddFunction(
                 if (!self->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->ReleaseBulk();
+
                 if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Context)
-                          return;
+                  self->PostCompletion([self, fn_resolve, hr, lastError]() {
 
-                        self->m_Context->Enter();
+                    CefRefPtr<CefV8Value> result =
+                        self->CreateErrorResult(hr, lastError);
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              CefV8ValueList args;
-                              args.push_back(CefV8Value::CreateInt(hr));
-                              fn_resolve->ExecuteFunction(nullptr, args);
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve, hr]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateInt(hr));
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
 
               __error:
                 self->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -6142,27 +5465,20 @@ CAfxObject::AddFunction(
                       (UINT32)DrawingReply::BeginCleanState))
                 goto __error;
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            if (nullptr == self->m_Context)
-                              return;
+              if (!self->m_PipeServer.Send())
+                goto __error;
 
-                            self->m_Context->Enter();
-                            fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve]() {
+                fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
             return true;
@@ -6194,27 +5510,20 @@ CAfxObject::AddFunction(
                       (UINT32)DrawingReply::EndCleanState))
                 goto __error;
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            if (nullptr == self->m_Context)
-                              return;
+              if (!self->m_PipeServer.Send())
+                goto __error;
 
-                            self->m_Context->Enter();
-                            fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve]() {
+                fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
             return true;
@@ -6281,27 +5590,15 @@ CAfxObject::AddFunction(
                 goto __error;
 
               if (!br) {
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
-
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(-1),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(0),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);                      
+                self->PostCompletion([self, fn_resolve]() {
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(-1, 0);
 
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
@@ -6310,36 +5607,25 @@ CAfxObject::AddFunction(
               if (!self->m_PipeServer.ReadBoolean(bHasTarget))
                 goto __error;
 
-              CefPostTask(TID_RENDERER,
-                          new CAfxTask([self, fn_resolve, refTexture, retobj,
-                                        bHasTarget]() {
-                            if (nullptr == self->m_Context)
-                              return;
+              self->PostCompletion([self, fn_resolve, refTexture, retobj,
+                                    bHasTarget]() {
 
-                            self->m_Context->Enter();
+                refTexture->SetValue(
+                    0, bHasTarget ? retobj
+                                  : CefV8Value::CreateNull());
 
-                            refTexture->SetValue(
-                                0, bHasTarget ? retobj
-                                              : CefV8Value::CreateNull());
-
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(0));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(0));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
 
         return true;
@@ -6389,52 +5675,31 @@ CAfxObject::AddFunction(
 
               if (!br) {
                   goto __error;
-                CefPostTask(
-                    TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                      if (nullptr == self->m_Context)
-                        return;
-
-                      self->m_Context->Enter();
+                self->PostCompletion([self, fn_resolve]() {
 
-                      CefRefPtr<CefV8Value> result =
-                          CefV8Value::CreateObject(nullptr, nullptr);
-                      result->SetValue("hr", CefV8Value::CreateInt(-1),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);
-                      result->SetValue("lastError",
-                                        CefV8Value::CreateUInt(0),
-                                        V8_PROPERTY_ATTRIBUTE_NONE);  
+                  CefRefPtr<CefV8Value> result =
+                      self->CreateErrorResult(-1, 0);
 
-                      CefV8ValueList args;
-                      args.push_back(result);
-                      fn_resolve->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                  CefV8ValueList args;
+                  args.push_back(result);
+                  fn_resolve->ExecuteFunction(nullptr, args);
+                });
                 return;
               }
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            CefV8ValueList args;
-                            args.push_back(CefV8Value::CreateInt(0));
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_resolve]() {
+                CefV8ValueList args;
+                args.push_back(CefV8Value::CreateInt(0));
+                fn_resolve->ExecuteFunction(nullptr, args);
+              });
               return;
 
             __error:
               self->Close();
 
-              CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                            if (nullptr == self->m_Context)
-                              return;
-
-                            self->m_Context->Enter();
-                            fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                            self->m_Context->Exit();
-                          }));
+              self->PostCompletion([self, fn_reject]() {
+                fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+              });
             });
             return true;
           }
@@ -6563,63 +5828,128 @@ CAfxObject::AddFunction(
                  unsigned int lastError;
                  if (!self->m_PipeServer.ReadUInt32(lastError))
                    goto __error;
-                 CefPostTask(TID_RENDERER,
-                             new CAfxTask([self, fn_resolve, hr, lastError]() {
-                               if (nullptr == self->m_Context)
-                                 return;
-
-                               self->m_Context->Enter();
-
-                               CefRefPtr<CefV8Value> result =
-                                   CefV8Value::CreateObject(nullptr, nullptr);
-                               result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                                V8_PROPERTY_ATTRIBUTE_NONE);
-                               result->SetValue(
-                                   "lastError",
-                                   CefV8Value::CreateUInt(lastError),
-                                   V8_PROPERTY_ATTRIBUTE_NONE);
-
-                               CefV8ValueList args;
-                               args.push_back(result);
-                               fn_resolve->ExecuteFunction(nullptr, args);
-
-                               self->m_Context->Exit();
-                             }));
+                 self->PostCompletion([self, fn_resolve, hr, lastError]() {
+
+                   CefRefPtr<CefV8Value> result =
+                       self->CreateErrorResult(hr, lastError);
+
+                   CefV8ValueList args;
+                   args.push_back(result);
+                   fn_resolve->ExecuteFunction(nullptr, args);
+                 });
+                 return;
+               }
+
+               self->PostCompletion([self, fn_resolve, hr]() {
+
+                 CefV8ValueList args;
+                 args.push_back(CefV8Value::CreateInt(hr));
+                 fn_resolve->ExecuteFunction(nullptr, args);
+               });
+               return;
+
+             __error:
+               self->Close();
+
+               self->PostCompletion([self, fn_reject]() {
+                 fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+               });
+             });
+
+         return true;
+       }
+
+       exceptionoverride = g_szInvalidArguments;
+       return true;
+     });
+
+     CAfxObject::AddFunction(
+         obj, "enableBulkChannel",
+         [](const CefString& name, CefRefPtr<CefV8Value> object,
+            const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+            CefString& exceptionoverride) {
+           auto self = CAfxObject::As<AfxObjectType::DrawingInteropImpl,
+                                    CDrawingInteropImpl>(object);
+           if (self == nullptr) {
+             exceptionoverride = g_szInvalidThis;
+             return true;
+           }
+
+           if (3 <= arguments.size() && arguments[0]->IsFunction() &&
+               arguments[1]->IsFunction() && arguments[2]->IsUInt()) {
+             self->m_PipeQueue.Queue([self, fn_resolve = arguments[0],
+                                      fn_reject = arguments[1],
+                                      size = arguments[2]->GetUIntValue()]() {
+               bool accepted = false;
+
+               self->m_BulkRing.Close();
+               self->m_BulkPending = 0;
+
+               if (!self->MayUse(InteropCapability_BulkChannel)) {
+                 self->PostCompletion([self, fn_resolve]() {
+                   CefV8ValueList args;
+                   args.push_back(CefV8Value::CreateBool(false));
+                   fn_resolve->ExecuteFunction(nullptr, args);
+                 });
                  return;
                }
 
-               CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve, hr]() {
-                             if (nullptr == self->m_Context)
-                               return;
+               if (0 < size) {
+                 std::string strName("afx-cefhud-interop_bulk_");
+                 strName.append(std::to_string(GetCurrentProcessId()));
+                 strName.append("_");
+                 strName.append(std::to_string(self->m_BrowserId));
+                 strName.append("_");
+                 strName.append(std::to_string(++self->m_BulkGeneration));
+
+                 self->m_BulkRing.Create(strName.c_str(), size);
+               }
+
+               // An empty name tells the peer to drop the current ring.
+               if (!self->m_PipeServer.WriteUInt32(
+                       (UINT32)DrawingReply::SetBulkChannel))
+                 goto __error;
+               if (!self->m_PipeServer.WriteStringUTF8(
+                       self->m_BulkRing.IsOpen() ? self->m_BulkRing.GetName()
+                                                 : ""))
+                 goto __error;
+               if (!self->m_PipeServer.WriteUInt32(
+                       self->m_BulkRing.IsOpen() ? self->m_BulkRing.GetSize()
+                                                 : 0))
+                 goto __error;
+
+               if (!self->m_PipeServer.Flush())
+                 goto __error;
+
+               if (!self->m_PipeServer.ReadBoolean(accepted))
+                 goto __error;
 
-                             self->m_Context->Enter();
+               if (!accepted)
+                 self->m_BulkRing.Close();
 
-                             CefV8ValueList args;
-                             args.push_back(CefV8Value::CreateInt(hr));
-                             fn_resolve->ExecuteFunction(nullptr, args);
-                             self->m_Context->Exit();
-                           }));
+               self->PostCompletion([self, fn_resolve,
+                                     result = self->m_BulkRing.IsOpen()]() {
+                 CefV8ValueList args;
+                 args.push_back(CefV8Value::CreateBool(result));
+                 fn_resolve->ExecuteFunction(nullptr, args);
+               });
                return;
 
              __error:
                self->Close();
 
-               CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                             if (nullptr == self->m_Context)
-                               return;
-
-                             self->m_Context->Enter();
-                             fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                             self->m_Context->Exit();
-                           }));
+               self->PostCompletion([self, fn_reject]() {
+                 fn_reject->ExecuteFunction(nullptr,
+                                            CefV8ValueList());
+               });
              });
 
-         return true;
-       }
+             return true;
+           }
 
-       exceptionoverride = g_szInvalidArguments;
-       return true;
-     });
+           exceptionoverride = g_szInvalidArguments;
+           return true;
+         });
 
      CAfxObject::AddFunction(
         obj, 
@@ -6765,8 +6095,6 @@ CAfxObject::AddFunction(
     return obj;
   }
 
-  void Cancel() { CancelSynchronousIo(m_PipeQueue.GetNativeThreadHandle()); }
-  
     void ClosePipes() {
     Close();
 
@@ -6775,7 +6103,7 @@ CAfxObject::AddFunction(
     } catch (const std::exception&) {
     }
     try {
-      this->ClosePipe();
+      this->CloseChannel();
     } catch (const std::exception&) {
     }
   }
@@ -6784,9 +6112,10 @@ CAfxObject::AddFunction(
     Cancel();
     ClosePipes();
 
-    m_WaitConnectionQuit = true;
-    if (m_WaitConnectionThread.joinable())
-      m_WaitConnectionThread.join();
+    m_ChannelQuit = true;
+    CancelChannel();
+    if (m_ChannelThread.joinable())
+      m_ChannelThread.join();
 
     m_PipeQueue.Abort();
     m_InteropQueue.Abort();
@@ -6804,21 +6133,84 @@ CAfxObject::AddFunction(
       : CAfxObject(AfxObjectType::DrawingInteropImpl)
       , CAfxInterop("advancedfxInterop_drawing")
       , m_BrowserId(browserId) {
-    m_WaitConnectionThread =
-        std::thread(&CDrawingInteropImpl::WaitConnectionThreadHandler, this);
+    m_RequestOpcodes = true;
   }
 
-   virtual CPipeServerConnectionThread* OnNewConnection(
-      HANDLE handle) override {
-    return new CDrawingInteropImplConnectionThread(handle, this);
-  }  
+  virtual CefRefPtr<CefV8Value> GetStats() override {
+    auto stats = CInterop::GetStats();
+    AddPipeStats(stats, GetDrawingReplyName);
+    return stats;
+  }
 
   virtual void OnClose() override {
+    m_BulkRing.Close();
+    m_BulkPending = 0;
   }
 
  private:
   CefRefPtr<CefFrame> m_Frame;
 
+  CSharedMemoryRing m_BulkRing;
+  unsigned int m_BulkPending = 0;
+  unsigned int m_BulkGeneration = 0;
+
+  // Of the last pass, passes of the same frame count as one.
+  int m_LastFrameCount = -1;
+
+  // Writes the payload of a bulk message. Once the peer accepted the bulk
+  // channel this is a Boolean (true if in the ring), followed by the UInt32
+  // offset into the ring or the raw bytes. Before it is just the raw bytes.
+  bool WriteBulkBytes(const void* bytes, UINT32 length) {
+    return WriteBulkRows(bytes, length, 1, length);
+  }
+
+  // Same as WriteBulkBytes, but packs numRows rows that are stride bytes
+  // apart.
+  bool WriteBulkRows(const void* bytes,
+                     UINT32 bytesPerRow,
+                     UINT32 numRows,
+                     UINT32 stride) {
+    const unsigned char* pRow = (const unsigned char*)bytes;
+
+    if (m_BulkRing.IsOpen()) {
+      UINT64 length = (UINT64)bytesPerRow * numRows;
+      UINT32 offset;
+      unsigned char* pDst =
+          length <= m_BulkRing.GetSize()
+              ? m_BulkRing.Allocate((UINT32)length, offset)
+              : nullptr;
+
+      if (!m_PipeServer.WriteBoolean(nullptr != pDst))
+        return false;
+
+      if (nullptr != pDst) {
+        ++m_BulkPending;
+
+        for (UINT32 i = 0; i < numRows; ++i) {
+          memcpy(pDst, pRow, bytesPerRow);
+          pDst += bytesPerRow;
+          pRow += stride;
+        }
+
+        return m_PipeServer.WriteUInt32(offset);
+      }
+    }
+
+    for (UINT32 i = 0; i < numRows; ++i) {
+      if (!m_PipeServer.WriteBytes(pRow, 0, bytesPerRow))
+        return false;
+      pRow += stride;
+    }
+
+    return true;
+  }
+
+  // The peer is done with everything written before it replied.
+  void ReleaseBulk() {
+    for (; 0 < m_BulkPending; --m_BulkPending)
+      m_BulkRing.Release();
+  }
+
  void OnClientMessage_Message(int senderId, const std::string & message)
  {
     if (nullptr == m_Context)
@@ -6837,53 +6229,6 @@ CAfxObject::AddFunction(
   m_Context->Exit();
  }
 
- class CDrawingInteropImplConnectionThread
-     : public advancedfx::interop::CPipeServerConnectionThread {
-  public:
-   CDrawingInteropImplConnectionThread(HANDLE handle, CDrawingInteropImpl* host)
-       : advancedfx::interop::CPipeServerConnectionThread(handle),
-         m_Host(host) {}
-
-   ~CDrawingInteropImplConnectionThread() {
-     m_Quit = true;
-     Cancel();
-     Join();
-   }
-
-   protected:
-   virtual void ConnectionThread() override {
-     try {
-       while (!m_Quit) {
-         ClientMessage message = (ClientMessage)ReadInt32();
-         switch (message) {
-           case ClientMessage::Message: {
-             int senderId = ReadInt32();
-             std::string argMessage;
-             ReadStringUTF8(argMessage);
-
-              CefPostTask(TID_RENDERER, new advancedfx::interop::CAfxTask(
-                                     [host = m_Host, senderId, argMessage] {
-                                       host->OnClientMessage_Message(
-                                           senderId, argMessage);
-                                     }));
-           } break;
-           default:
-             throw "CHostPipeServerConnectionThread::ConnectionThread: Unknown message.";
-         }
-       }
-     }
-     catch (const std::exception& e) {
-       DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
-                   << e.what();
-       DebugBreak();
-     }
-   }
-
-  private:
-   CDrawingInteropImpl* m_Host;
-   bool m_Quit= false;
- };
-
 private:
 
   class CAfxD3d9VertexDeclaration : public CAfxObject {
@@ -6911,7 +6256,7 @@ private:
         if (2 <= arguments.size() && arguments[0]->IsFunction() &&
             arguments[1]->IsFunction()) {
 
-          self->m_Interop->m_PipeQueue.Queue([self,
+          self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                  fn_resolve = arguments[0],
                                                  fn_reject = arguments[1]]() {
             if (self->m_DoReleased)
@@ -6928,31 +6273,18 @@ private:
             if (!self->m_Interop->m_PipeServer.Flush())
               goto __error;
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                          self->m_Interop->m_Context->Exit();
-                        }));
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
             return;
 
           __error:
             self->m_Interop->Close();
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Interop->m_Context->Exit();
-                        }));
+            self->m_Interop->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           });
 
           return true;
@@ -7008,7 +6340,7 @@ private:
         if (2 <= arguments.size() && arguments[0]->IsFunction() &&
             arguments[1]->IsFunction()) {
          
-          self->m_Interop->m_PipeQueue.Queue([self,
+          self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                  fn_resolve = arguments[0],
                                                  fn_reject = arguments[1]]() {
 
@@ -7026,31 +6358,18 @@ private:
             if (!self->m_Interop->m_PipeServer.Flush())
               goto __error;
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                          self->m_Interop->m_Context->Exit();
-                        }));
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
             return;
 
           __error:
             self->m_Interop->Close();
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Interop->m_Context->Exit();
-                        }));
+            self->m_Interop->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           });
 
           return true;
@@ -7105,9 +6424,9 @@ private:
             if (!self->m_Interop->m_PipeServer.WriteUInt32(
                     (UINT32)sizeToLock))
               goto __error;
-            if (!self->m_Interop->m_PipeServer.WriteBytes(
+            if (!self->m_Interop->WriteBulkBytes(
                     (unsigned char*)data->GetData() + offsetToLock,
-                    (DWORD)offsetToLock, (DWORD)sizeToLock))
+                    (UINT32)sizeToLock))
               goto __error;
 
      if (!self->m_Interop->m_PipeServer.Flush())
@@ -7117,59 +6436,40 @@ private:
                 if (!self->m_Interop->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->m_Interop->ReleaseBulk();
+
                if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_Interop->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Interop->m_Context)
-                          return;
-
-                        self->m_Interop->m_Context->Enter();
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                   lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->m_Interop->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Interop->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                                self->m_Interop->m_Context->Enter();
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Interop->m_Context->Exit();
-                              }));
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr]() {
+                    CefV8ValueList args;
+                    args.push_back(CefV8Value::CreateInt(hr));
+                    fn_resolve->ExecuteFunction(
+                        nullptr, args);
+                  });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
                                        return true;
         }
@@ -7224,7 +6524,7 @@ private:
         if (2 <= arguments.size() && arguments[0]->IsFunction() &&
             arguments[1]->IsFunction()) {
 
-          self->m_Interop->m_PipeQueue.Queue([self,
+          self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                  fn_resolve = arguments[0],
                                                  fn_reject = arguments[1]]() {
 
@@ -7242,31 +6542,18 @@ private:
             if (!self->m_Interop->m_PipeServer.Flush())
               goto __error;
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                          self->m_Interop->m_Context->Exit();
-                        }));
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
             return;
 
           __error:
             self->m_Interop->Close();
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Interop->m_Context->Exit();
-                        }));
+            self->m_Interop->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           });
 
           return true;
@@ -7322,9 +6609,9 @@ private:
             if (!self->m_Interop->m_PipeServer.WriteUInt32(
                     (UINT32)sizeToLock))
               goto __error;
-            if (!self->m_Interop->m_PipeServer.WriteBytes(
+            if (!self->m_Interop->WriteBulkBytes(
                     (unsigned char*)data->GetData() + offsetToLock,
-                    (DWORD)offsetToLock, (DWORD)sizeToLock))
+                    (UINT32)sizeToLock))
               goto __error;
 
      if (!self->m_Interop->m_PipeServer.Flush())
@@ -7334,59 +6621,40 @@ private:
                 if (!self->m_Interop->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->m_Interop->ReleaseBulk();
+
                if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_Interop->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Interop->m_Context)
-                          return;
-
-                        self->m_Interop->m_Context->Enter();
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                   lastError]() {
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->m_Interop->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Interop->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                                self->m_Interop->m_Context->Enter();
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Interop->m_Context->Exit();
-                              }));
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr]() {
+                    CefV8ValueList args;
+                    args.push_back(CefV8Value::CreateInt(hr));
+                    fn_resolve->ExecuteFunction(
+                        nullptr, args);
+                  });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
                                        return true;
         }
@@ -7436,7 +6704,7 @@ private:
 
             if (2 <= arguments.size() && arguments[0]->IsFunction() &&
                 arguments[1]->IsFunction()) {
-              self->m_Interop->m_PipeQueue.Queue([self,
+              self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                   fn_resolve = arguments[0],
                                                   fn_reject = arguments[1]]() {
                 if (self->m_DoReleased)
@@ -7454,31 +6722,20 @@ private:
                 if (!self->m_Interop->m_PipeServer.Flush())
                   goto __error;
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
+                self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                              fn_resolve->ExecuteFunction(nullptr,
-                                                          CefV8ValueList());
-
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                  fn_resolve->ExecuteFunction(nullptr,
+                                              CefV8ValueList());
+                });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -7532,7 +6789,7 @@ private:
             if (2 <= arguments.size() && arguments[0]->IsFunction() &&
                 arguments[1]->IsFunction()) {
 
-              self->m_Interop->m_PipeQueue.Queue([self,
+              self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                      fn_resolve = arguments[0],
                                                      fn_reject = arguments[1]]() {
 
@@ -7551,32 +6808,18 @@ private:
                 if (!self->m_Interop->m_PipeServer.Flush())
                   goto __error;
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-
-                              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                  fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                });
                 return;
 
               __error:
             self->m_Interop->Close();
 
-                CefPostTask(
-                    TID_RENDERER,
-                    new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Interop->m_Context->Exit();
-                        }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+                });
               });
 
               return true;
@@ -7636,59 +6879,37 @@ private:
                       unsigned int lastError;
                       if (!self->m_Interop->m_PipeServer.ReadUInt32(lastError))
                         goto __error;
-                      CefPostTask(
-                          TID_RENDERER,
-                          new CAfxTask([self, fn_resolve, hr, lastError]() {
-                            if (nullptr == self->m_Interop->m_Context)
-                              return;
-
-                            self->m_Interop->m_Context->Enter();
-
-                            CefRefPtr<CefV8Value> result =
-                                CefV8Value::CreateObject(nullptr, nullptr);
-                            result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                             V8_PROPERTY_ATTRIBUTE_NONE);
-                            result->SetValue("lastError",
-                                             CefV8Value::CreateUInt(lastError),
-                                             V8_PROPERTY_ATTRIBUTE_NONE);
-
-                            CefV8ValueList args;
-                            args.push_back(result);
-                            fn_resolve->ExecuteFunction(nullptr, args);
-                            self->m_Interop->m_Context->Exit();
-                          }));
-                      return;
-                    }
+                      self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                       lastError]() {
 
-                    CefPostTask(TID_RENDERER,
-                                new CAfxTask([self, fn_resolve, hr, ppSurfaceLevel, retobj]() {
-                                  if (nullptr == self->m_Interop->m_Context)
-                                    return;
+                        CefRefPtr<CefV8Value> result =
+                            self->m_Interop->CreateErrorResult(hr, lastError);
 
-                                  self->m_Interop->m_Context->Enter();
+                        CefV8ValueList args;
+                        args.push_back(result);
+                        fn_resolve->ExecuteFunction(nullptr, args);
+                      });
+                      return;
+                    }
 
-                                  ppSurfaceLevel->SetValue(0, retobj);
+                    self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                     ppSurfaceLevel, retobj]() {
 
-                                  CefV8ValueList args;
-                                  args.push_back(CefV8Value::CreateInt(hr));
-                                  fn_resolve->ExecuteFunction(nullptr, args);
+                      ppSurfaceLevel->SetValue(0, retobj);
 
-                                  self->m_Interop->m_Context->Exit();
-                                }));
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateInt(hr));
+                      fn_resolve->ExecuteFunction(nullptr, args);
+                    });
                     return;
 
                   __error:
                     self->m_Interop->Close();
 
-                    CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                                  if (nullptr == self->m_Interop->m_Context)
-                                    return;
-
-                                  self->m_Interop->m_Context->Enter();
-                                  fn_reject->ExecuteFunction(nullptr,
-                                                             CefV8ValueList());
-                                  self->m_Interop->m_Context->Exit();
-                                }));
+                    self->m_Interop->PostCompletion([self, fn_reject]() {
+                      fn_reject->ExecuteFunction(nullptr,
+                                                 CefV8ValueList());
+                    });
                   });
 
               return true;
@@ -7783,16 +7004,12 @@ private:
                   (UINT32)(dataBytesPerRow - columnOffsetBytes)))
             goto __error;
 
-          void* pData = (unsigned char*)data->GetData() + rowOffsetBytes;
-
-          for (unsigned int i = 0; i < numRows; ++i) {
-            if (!self->m_Interop->m_PipeServer.WriteBytes(
-                    (unsigned char*)pData + columnOffsetBytes, 0,
-                    dataBytesPerRow - columnOffsetBytes))
-              goto __error;
-
-            pData = (unsigned char*)pData + totalBytesPerRow;
-          }
+          if (!self->m_Interop->WriteBulkRows(
+                  (unsigned char*)data->GetData() + rowOffsetBytes +
+                      columnOffsetBytes,
+                  dataBytesPerRow - columnOffsetBytes, numRows,
+                  totalBytesPerRow))
+            goto __error;
      if (!self->m_Interop->m_PipeServer.Flush())
                   goto __error;
 
@@ -7800,59 +7017,40 @@ private:
                 if (!self->m_Interop->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->m_Interop->ReleaseBulk();
+
                if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_Interop->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Interop->m_Context)
-                          return;
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                   lastError]() {
 
-                        self->m_Interop->m_Context->Enter();
-
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
+                    CefRefPtr<CefV8Value> result =
+                        self->m_Interop->CreateErrorResult(hr, lastError);
 
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Interop->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                                self->m_Interop->m_Context->Enter();
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Interop->m_Context->Exit();
-                              }));
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr]() {
+                    CefV8ValueList args;
+                    args.push_back(CefV8Value::CreateInt(hr));
+                    fn_resolve->ExecuteFunction(
+                        nullptr, args);
+                  });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
                                        return true;
 
@@ -7890,16 +7088,12 @@ private:
                   (UINT32)(dataBytesPerRow - columnOffsetBytes)))
             goto __error;
 
-          void* pData = (unsigned char*)data->GetData() + rowOffsetBytes;
-
-          for (unsigned int i = 0; i < numRows; ++i) {
-            if (!self->m_Interop->m_PipeServer.WriteBytes(
-                    (unsigned char*)pData + columnOffsetBytes, 0,
-                    dataBytesPerRow - columnOffsetBytes))
-              goto __error;
-
-            pData = (unsigned char*)pData + totalBytesPerRow;
-          }
+          if (!self->m_Interop->WriteBulkRows(
+                  (unsigned char*)data->GetData() + rowOffsetBytes +
+                      columnOffsetBytes,
+                  dataBytesPerRow - columnOffsetBytes, numRows,
+                  totalBytesPerRow))
+            goto __error;
      if (!self->m_Interop->m_PipeServer.Flush())
                   goto __error;
 
@@ -7907,59 +7101,40 @@ private:
                 if (!self->m_Interop->m_PipeServer.ReadInt32(hr))
                   goto __error;
 
+                self->m_Interop->ReleaseBulk();
+
                if (FAILED(hr)) {
                   unsigned int lastError;
                   if (!self->m_Interop->m_PipeServer.ReadUInt32(lastError))
                     goto __error;
-                  CefPostTask(
-                      TID_RENDERER, new CAfxTask([self, fn_resolve, hr, lastError]() {
-                        if (nullptr == self->m_Interop->m_Context)
-                          return;
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr,
+                                                   lastError]() {
 
-                        self->m_Interop->m_Context->Enter();
+                    CefRefPtr<CefV8Value> result =
+                        self->m_Interop->CreateErrorResult(hr, lastError);
 
-                        CefRefPtr<CefV8Value> result =
-                            CefV8Value::CreateObject(nullptr, nullptr);
-                        result->SetValue("hr", CefV8Value::CreateInt(hr),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-                        result->SetValue("lastError",
-                                         CefV8Value::CreateUInt(lastError),
-                                         V8_PROPERTY_ATTRIBUTE_NONE);
-
-                        CefV8ValueList args;
-                        args.push_back(result);
-                        fn_resolve->ExecuteFunction(nullptr, args);
-                        self->m_Interop->m_Context->Exit();
-                      }));
+                    CefV8ValueList args;
+                    args.push_back(result);
+                    fn_resolve->ExecuteFunction(nullptr, args);
+                  });
                   return;
                 }
 
-                  CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve, hr]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                                self->m_Interop->m_Context->Enter();
-                                CefV8ValueList args;
-                                args.push_back(CefV8Value::CreateInt(hr));
-                                fn_resolve->ExecuteFunction(
-                                    nullptr, args);
-                                self->m_Interop->m_Context->Exit();
-                              }));
+                  self->m_Interop->PostCompletion([self, fn_resolve, hr]() {
+                    CefV8ValueList args;
+                    args.push_back(CefV8Value::CreateInt(hr));
+                    fn_resolve->ExecuteFunction(
+                        nullptr, args);
+                  });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
                                        return true;
           }
@@ -8017,7 +7192,7 @@ private:
             arguments[1]->IsFunction()) {
 
 
-          self->m_Interop->m_PipeQueue.Queue([self,
+          self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                  fn_resolve = arguments[0],
                                                  fn_reject = arguments[1]]() {
             if (self->m_DoReleased)
@@ -8034,31 +7209,18 @@ private:
             if (!self->m_Interop->m_PipeServer.Flush())
               goto __error;
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
+            self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-
-                          self->m_Interop->m_Context->Exit();
-                        }));
+              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+            });
             return;
 
           __error:
             self->m_Interop->Close();
 
-            CefPostTask(TID_RENDERER,
-                        new CAfxTask([self, fn_reject]() {
-                          if (nullptr == self->m_Interop->m_Context)
-                            return;
-
-                          self->m_Interop->m_Context->Enter();
-                          fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Interop->m_Context->Exit();
-                        }));
+            self->m_Interop->PostCompletion([self, fn_reject]() {
+              fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+            });
           });
 
           return true;
@@ -8107,7 +7269,7 @@ private:
             if (2 <= arguments.size() && arguments[0]->IsFunction() &&
                 arguments[1]->IsFunction()) {
 
-              self->m_Interop->m_PipeQueue.Queue([self,
+              self->m_Interop->m_PipeQueue.QueueDeferred([self,
                                                   fn_resolve = arguments[0],
                                                   fn_reject = arguments[1]]() {
 
@@ -8126,31 +7288,19 @@ private:
                 if (!self->m_Interop->m_PipeServer.Flush())
                   goto __error;
 
-                CefPostTask(TID_RENDERER,
-                            new CAfxTask([self, fn_resolve]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-
-                              fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                self->m_Interop->PostCompletion([self, fn_resolve]() {
 
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                  fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                });
                 return;
 
               __error:
                 self->m_Interop->Close();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                              if (nullptr == self->m_Interop->m_Context)
-                                return;
-
-                              self->m_Interop->m_Context->Enter();
-                              fn_reject->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                              self->m_Interop->m_Context->Exit();
-                            }));
+                self->m_Interop->PostCompletion([self, fn_reject]() {
+                  fn_reject->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+                });
               });
 
               return true;
@@ -8186,24 +7336,34 @@ private:
   std::queue<CefRefPtr<CefV8Value>> m_OnFrame;
   CefRefPtr<CefV8Value> m_OnAck;
 
-   bool m_WaitConnectionQuit = false;
-  std::thread m_WaitConnectionThread;
-
-  void WaitConnectionThreadHandler(void) {
-    std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_client_");
-    strPipeName.append(std::to_string(GetCurrentProcessId()));
-    strPipeName.append("_");
-    strPipeName.append(std::to_string(m_BrowserId));
-
-   while (!m_WaitConnectionQuit) {
-      try {
-       auto thread = this->WaitForConnection(strPipeName.c_str(), 500);
-        if (thread != nullptr) {
-            thread->Join();
-            delete thread;
-          break;
+  std::atomic<bool> m_ChannelQuit = false;
+  CPooledThread m_ChannelThread;
+
+  // The handler answers on the channel we send on.
+  void ChannelThreadHandler(void) {
+    CPipeChannel channel(GetChannel());
+
+    try {
+      while (true) {
+        ClientMessage message = (ClientMessage)channel.ReadInt32();
+        switch (message) {
+          case ClientMessage::Message: {
+            int senderId = channel.ReadInt32();
+            std::string argMessage;
+            channel.ReadStringUTF8(argMessage);
+
+            CefPostTask(TID_RENDERER,
+                        new advancedfx::interop::CAfxTask(
+                            [this, senderId, argMessage] {
+                              OnClientMessage_Message(senderId, argMessage);
+                            }));
+          } break;
+          default:
+            throw "CDrawingInteropImpl::ChannelThreadHandler: Unknown message.";
         }
-      } catch (const std::exception& e) {
+      }
+    } catch (const std::exception& e) {
+      if (!m_ChannelQuit) {
         DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                     << e.what();
         DebugBreak();
@@ -8230,25 +7390,46 @@ private:
         case DrawingMessage::OnRenderViewEnd:
           break;
         case DrawingMessage::DeviceLost: {
-          CefPostTask(TID_RENDERER, new CAfxTask([this]() {
-                        if (nullptr == m_Context)
-                          return;
-
-                        if (m_OnDeviceLost->IsValid())
-                  m_OnDeviceLost->ExecuteCallback(m_Context, CefV8ValueList());
-                      }));
+          PostCompletion([this]() {
+            if (m_OnDeviceLost->IsValid())
+              m_OnDeviceLost->ExecuteCallback(m_Context, CefV8ValueList());
+          });
 
         }
           bContinue = true;
           break;
         case DrawingMessage::DeviceRestored: {
-          CefPostTask(TID_RENDERER, new CAfxTask([this]() {
-                        if (nullptr == m_Context)
-                          return;
-                        if (m_OnDeviceReset->IsValid())
-                          m_OnDeviceReset->ExecuteCallback(m_Context,
-                                                           CefV8ValueList());
-                      }));        
+          PostCompletion([this]() {
+            if (m_OnDeviceReset->IsValid())
+              m_OnDeviceReset->ExecuteCallback(m_Context, CefV8ValueList());
+          });
+        }
+          bContinue = true;
+          break;
+        case DrawingMessage::Hello: {
+          unsigned int clientVersion[4];
+          for (int i = 0; i < 4; ++i) {
+            if (!m_PipeServer.ReadUInt32(clientVersion[i]))
+              return __LINE__;
+          }
+
+          UINT32 offered;
+          if (!m_PipeServer.ReadUInt32(offered))
+            return __LINE__;
+
+          m_ClientVersion.Set(clientVersion[0], clientVersion[1],
+                              clientVersion[2], clientVersion[3]);
+          NegotiateCapabilities(offered, g_DrawingCapabilities);
+
+          if (!m_PipeServer.WriteUInt32(m_ServerVersion.GetMajor()) ||
+              !m_PipeServer.WriteUInt32(m_ServerVersion.GetMinor()) ||
+              !m_PipeServer.WriteUInt32(m_ServerVersion.GetPatch()) ||
+              !m_PipeServer.WriteUInt32(m_ServerVersion.GetBuild()) ||
+              !m_PipeServer.WriteUInt32(m_Capabilities))
+            return __LINE__;
+
+          if (!m_PipeServer.Flush())
+            return __LINE__;
         }
           bContinue = true;
           break;
@@ -8266,6 +7447,11 @@ private:
       if (!m_PipeServer.ReadInt32(outFrameCount))
           return __LINE__;
 
+      if (outFrameCount != m_LastFrameCount) {
+        m_LastFrameCount = outFrameCount;
+        CountFrame();
+      }
+
       if (!m_PipeServer.ReadUInt32(outPass))
         return __LINE__;
 
@@ -8339,8 +7525,7 @@ CefRefPtr<CefV8Value> CreateDrawingInterop(CefRefPtr<CefBrowser> browser,
 class CEngineInteropImpl : public CAfxObject,
                            public CInterop,
                            public CAfxInterop,
-                           public CPipeServer,
-                           public CPipeClient {
+                           public CPipeChannel {
   IMPLEMENT_REFCOUNTING(CEngineInteropImpl);
 
  public:
@@ -8355,27 +7540,12 @@ class CEngineInteropImpl : public CAfxObject,
    CefRefPtr<CEngineInteropImpl> self =
        new CEngineInteropImpl(browser->GetIdentifier());
 
-   std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_handler_");
-   strPipeName.append(std::to_string(handlerId));
-
    try {
-      while(true)
-      {
-      bool bError = false;
-      try {
-        self->OpenPipe(strPipeName.c_str(), INFINITE);
-        Sleep(100);
-      }
-      catch(const std::exception&)
-      {
-        bError = true;
-      }
-
-      if(!bError) break;
-      }
-     self->WriteUInt32(GetCurrentProcessId());
+     self->OpenChannel(handlerId);
      self->WriteInt32(browser->GetIdentifier());
      self->Flush();
+     self->m_ChannelThread =
+         CPooledThread(&CEngineInteropImpl::ChannelThreadHandler, self.get());
     } catch (const std::exception& e) {
      DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                  << e.what();
@@ -8439,28 +7609,17 @@ class CEngineInteropImpl : public CAfxObject,
                self->WriteStringUTF8(str.ToString());
                self->Flush();
 
-               CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                             if (nullptr == self->m_Context)
-                               return;
-                             self->m_Context->Enter();
-                             fn_resolve->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                             self->m_Context->Exit();
-                           }));
+               self->PostCompletion([self, fn_resolve]() {
+                 fn_resolve->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+               });
              } catch (const std::exception& e) {
-               CefPostTask(
-                   TID_RENDERER,
-                   new CAfxTask(
-                       [self, fn_reject, error_msg = std::string(e.what())]() {
-                         if (nullptr == self->m_Context)
-                           return;
-
-                         self->m_Context->Enter();
-                         CefV8ValueList args;
-                         args.push_back(CefV8Value::CreateString(error_msg));
-                         fn_reject->ExecuteFunction(nullptr, args);
-                         self->m_Context->Exit();
-                       }));
+               self->PostCompletion([self, fn_reject,
+                                     error_msg = std::string(e.what())]() {
+                 CefV8ValueList args;
+                 args.push_back(CefV8Value::CreateString(error_msg));
+                 fn_reject->ExecuteFunction(nullptr, args);
+               });
              }
            });
 
@@ -8471,12 +7630,109 @@ class CEngineInteropImpl : public CAfxObject,
          return true;
        });
 
-   self->m_OnMessage = CAfxObject::AddCallback(obj, "onMessage");
+   CAfxObject::AddFunction(
+       obj, "getStats",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self = CAfxObject::As<AfxObjectType::EngineInteropImpl,
+                                    CEngineInteropImpl>(object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
+
+         retval = self->GetStats();
+         return true;
+       });
+
+   self->m_OnMessage = CAfxObject::AddCallback(obj, "onMessage");
+
+   self->m_OnError = CAfxObject::AddCallback(obj, "onError");
+
+   CAfxObject::AddFunction(
+       obj, "setPipeName",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self = CAfxObject::As<AfxObjectType::EngineInteropImpl,
+                                  CEngineInteropImpl>(object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
+
+         if (1 <= arguments.size() && arguments[0]->IsString()) {
+           self->m_PipeQueue.Queue(
+               [self, pipeName = arguments[0]->GetStringValue().ToString()]() {
+                 self->SetPipeName(pipeName.c_str());
+               });
+
+           return true;
+         }
+
+         exceptionoverride = g_szInvalidArguments;
+         return true;
+       });
+
+   CAfxObject::AddFunction(
+       obj, "setPipeTimeouts",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self = CAfxObject::As<AfxObjectType::EngineInteropImpl,
+                                  CEngineInteropImpl>(object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
+
+         if (2 <= arguments.size() && arguments[0]->IsUInt() &&
+             arguments[1]->IsUInt()) {
+           self->m_PipeQueue.Queue(
+               [self, readTimeOutMs = arguments[0]->GetUIntValue(),
+                writeTimeOutMs = arguments[1]->GetUIntValue()]() {
+                 self->SetPipeTimeouts(readTimeOutMs, writeTimeOutMs);
+               });
+           return true;
+         }
+
+         exceptionoverride = g_szInvalidArguments;
+         return true;
+       });
+
+   CAfxObject::AddFunction(
+       obj, "setCapture",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self = CAfxObject::As<AfxObjectType::EngineInteropImpl,
+                                  CEngineInteropImpl>(object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
 
-   self->m_OnError = CAfxObject::AddCallback(obj, "onError");
+         if (3 <= arguments.size() && arguments[0]->IsFunction() &&
+             arguments[1]->IsFunction() && arguments[2]->IsString()) {
+           self->m_PipeQueue.Queue(
+               [self, fn_resolve = arguments[0], fn_reject = arguments[1],
+                path = arguments[2]->GetStringValue().ToString()]() {
+                 bool bOk = self->SetCapture(path.c_str());
+                 self->PostCompletion([self, fn_resolve, fn_reject, bOk]() {
+                   (bOk ? fn_resolve : fn_reject)
+                       ->ExecuteFunction(nullptr, CefV8ValueList());
+                 });
+               });
+           return true;
+         }
+
+         exceptionoverride = g_szInvalidArguments;
+         return true;
+       });
 
    CAfxObject::AddFunction(
-       obj, "setPipeName",
+       obj, "setReplay",
        [](const CefString& name, CefRefPtr<CefV8Value> object,
           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
           CefString& exceptionoverride) {
@@ -8487,10 +7743,18 @@ class CEngineInteropImpl : public CAfxObject,
            return true;
          }
 
-         if (1 <= arguments.size() && arguments[0]->IsString()) {
+         if (3 <= arguments.size() && arguments[0]->IsFunction() &&
+             arguments[1]->IsFunction() && arguments[2]->IsString()) {
+           bool paced = 4 <= arguments.size() && arguments[3]->IsBool() &&
+                        arguments[3]->GetBoolValue();
            self->m_PipeQueue.Queue(
-               [self, pipeName = arguments[0]->GetStringValue().ToString()]() {
-                 self->SetPipeName(pipeName.c_str());
+               [self, fn_resolve = arguments[0], fn_reject = arguments[1],
+                path = arguments[2]->GetStringValue().ToString(), paced]() {
+                 bool bOk = self->SetReplay(path.c_str(), paced);
+                 self->PostCompletion([self, fn_resolve, fn_reject, bOk]() {
+                   (bOk ? fn_resolve : fn_reject)
+                       ->ExecuteFunction(nullptr, CefV8ValueList());
+                 });
                });
            return true;
          }
@@ -8515,25 +7779,15 @@ CAfxObject::AddFunction(
              arguments[1]->IsFunction()) {
            self->m_PipeQueue.Queue([self, fn_resolve = arguments[0],
                                        fn_reject = arguments[1]]() {
-             if (self->Connection()) {
-               CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                             if (nullptr == self->m_Context)
-                               return;
-
-                             self->m_Context->Enter();
-                             fn_resolve->ExecuteFunction(nullptr,
-                                                         CefV8ValueList());
-                             self->m_Context->Exit();
-                           }));
+             if (self->Connection(self->m_ReadTimeOutMs, self->m_WriteTimeOutMs)) {
+               self->PostCompletion([self, fn_resolve]() {
+                 fn_resolve->ExecuteFunction(nullptr,
+                                             CefV8ValueList());
+               });
              } else {
-               CefPostTask(TID_RENDERER, new CAfxTask([self, fn_reject]() {
-                             if (nullptr == self->m_Context)
-                               return;
-
-                             self->m_Context->Enter();
-                             fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
-                             self->m_Context->Exit();
-                           }));
+               self->PostCompletion([self, fn_reject]() {
+                 fn_reject->ExecuteFunction(nullptr, CefV8ValueList());
+               });
              }
            });
            return true;
@@ -8575,15 +7829,10 @@ CAfxObject::AddFunction(
              arguments[1]->IsFunction()) {
 
            self->m_PipeQueue.Queue([self, fn_resolve = arguments[0]]() {
-             self->Close();
-             CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                           if (nullptr == self->m_Context)
-                             return;
-
-                           self->m_Context->Enter();
-                           fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                           self->m_Context->Exit();
-                         }));
+             self->Close(true);
+             self->PostCompletion([self, fn_resolve]() {
+               fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+             });
            });
            return true;
          }
@@ -8609,7 +7858,7 @@ CAfxObject::AddFunction(
           if (3 <= arguments.size() && arguments[0]->IsFunction() &&
               arguments[1]->IsFunction()) {
         self->m_PipeQueue.Queue(
-            [self, fn_resolve = arguments[0], fn_reject = arguments[1], filter = new CAfxValue(arguments[2])]() {
+            [self, fn_resolve = arguments[0], fn_reject = arguments[1], filter = CAfxValueArena::FromV8Value(arguments[2])]() {
 
           self->DoPump(fn_resolve, fn_reject, filter, nullptr);
         });
@@ -8998,6 +8247,56 @@ CAfxObject::AddFunction(
          return true;
        });
 
+   CAfxObject::AddFunction(
+       obj, "setFloat32Matrices",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self =
+             CAfxObject::As<AfxObjectType::EngineInteropImpl, CEngineInteropImpl>(
+                 object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
+
+         if (1 == arguments.size() && arguments[0]->IsBool()) {
+           self->m_PipeQueue.Queue(
+               [self, value = arguments[0]->GetBoolValue()] {
+                 self->m_Float32Matrices = value;
+               });
+
+           return true;
+         }
+         exceptionoverride = g_szInvalidArguments;
+         return true;
+       });
+
+   CAfxObject::AddFunction(
+       obj, "setGameEventsColumnar",
+       [](const CefString& name, CefRefPtr<CefV8Value> object,
+          const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+          CefString& exceptionoverride) {
+         auto self =
+             CAfxObject::As<AfxObjectType::EngineInteropImpl, CEngineInteropImpl>(
+                 object);
+         if (self == nullptr) {
+           exceptionoverride = g_szInvalidThis;
+           return true;
+         }
+
+         if (1 == arguments.size() && arguments[0]->IsBool()) {
+           self->m_PipeQueue.Queue(
+               [self, value = arguments[0]->GetBoolValue()] {
+                 self->m_GameEventsColumnarNext = value;
+               });
+
+           return true;
+         }
+         exceptionoverride = g_szInvalidArguments;
+         return true;
+       });
+
    //
 
    if (out)
@@ -9006,12 +8305,10 @@ CAfxObject::AddFunction(
    return obj;
 }
 
-  void Cancel() { CancelSynchronousIo(m_PipeQueue.GetNativeThreadHandle()); }
-
     void ClosePipes() {
   Close();
   try {
-    this->ClosePipe();
+    this->CloseChannel();
   } catch (const std::exception&) {
   }
 }
@@ -9020,31 +8317,33 @@ CAfxObject::AddFunction(
   Cancel();
   ClosePipes();
 
-  m_WaitConnectionQuit = true;
-  if (m_WaitConnectionThread.joinable())
-    m_WaitConnectionThread.join();
+  m_ChannelQuit = true;
+  CancelChannel();
+  if (m_ChannelThread.joinable())
+    m_ChannelThread.join();
 
     m_PipeQueue.Abort();
   m_InteropQueue.Abort();
 
+    m_NewFloat32Array = nullptr;
     m_Context = nullptr;
 
  }
 
 private:
     int m_BrowserId;
-    CVersion m_ServerVersion;
-    CVersion m_ClientVersion;
 
  protected:
 
      
   CEngineInteropImpl(int browserId)
       : CAfxObject(AfxObjectType::EngineInteropImpl), CAfxInterop("advancedfxInterop"),
-        m_BrowserId(browserId),
-        m_ServerVersion(7, 0, 0, 0) {
-    m_WaitConnectionThread =
-        std::thread(&CEngineInteropImpl::WaitConnectionThreadHandler, this);
+        m_BrowserId(browserId) {}
+
+  virtual CefRefPtr<CefV8Value> GetStats() override {
+    auto stats = CInterop::GetStats();
+    AddPipeStats(stats, GetEngineMessageName);
+    return stats;
   }
 
   
@@ -9053,35 +8352,146 @@ private:
     m_NewConnection = true;
   }
 
-  virtual CPipeServerConnectionThread* OnNewConnection(
-      HANDLE handle) override {
-    return new CEngineInteropImplConnectionThread(handle, this);
-  }
-
-    bool IsPumpFilter(CefRefPtr<CAfxValue> filter,
+    bool IsPumpFilter(CefRefPtr<CValue> filter,
                                       const char* what) {
     if (filter != nullptr && filter->IsObject()) {
       auto value = filter->GetChild(what);
-      if (value && value->IsV8Function()) {
+      if (value && value->IsFunction()) {
         return true;
       }
     }
     return false;
   }
 
-  CefRefPtr<CefV8Value> GetPumpFilter(CefRefPtr<CAfxValue> filter,
+  CefRefPtr<CefV8Value> GetPumpFilter(CefRefPtr<CValue> filter,
                                       const char* what) {
       if (filter != nullptr && filter->IsObject()) {
-      auto value = filter->GetChild(what);
-      if (value && value->IsV8Function()) {
-        return value->GetFunction();
-      }
+      return CAfxValueArena::GetV8Function(filter->GetChild(what));
     }
     return nullptr;
   }
 
   int m_PumpResumeAt = 0;
 
+  CefRefPtr<CAfxValueArena> m_ValueArena;
+
+  // Arena for the values of the current pump step. Reused once the renderer
+  // let go of all values of the previous step.
+  CefRefPtr<CAfxValueArena> GetPumpValueArena() {
+    if (nullptr == m_ValueArena || !m_ValueArena->HasOneRef())
+      m_ValueArena = new CAfxValueArena();
+    else
+      m_ValueArena->Clear();
+    return m_ValueArena;
+  }
+
+  // Game events collected for onGameEvents, in m_GameEventsArena or, if
+  // m_GameEventsColumnar, in m_GameEventBuffer.
+  std::vector<CValue*> m_GameEvents;
+  CefRefPtr<CAfxValueArena> m_GameEventsArena;
+  CGameEventBuffer m_GameEventBuffer;
+
+  // setGameEventsColumnar() takes effect when the next frame starts, so a
+  // batch is never split between the two.
+  bool m_GameEventsColumnar = false;
+  bool m_GameEventsColumnarNext = false;
+
+  // For m_GameEventBuffer, by event id. Made again when the settings change.
+  std::map<int, GameEventSchemaPtr> m_GameEventSchemas;
+  uint32_t m_NextGameEventSchemaId = 1;
+
+  CefRefPtr<CAfxValueArena> GetGameEventsArena() {
+    if (m_GameEvents.empty()) {
+      if (nullptr == m_GameEventsArena || !m_GameEventsArena->HasOneRef())
+        m_GameEventsArena = new CAfxValueArena();
+      else
+        m_GameEventsArena->Clear();
+    }
+    return m_GameEventsArena;
+  }
+
+  /**
+   * @returns the collected game events as an array in order of arrival or,
+   *   if m_GameEventsColumnar, as {schemas, buffer}. nullptr if there are
+   *   none.
+   */
+  CefRefPtr<CValue> TakeGameEvents() {
+    if (m_GameEventsColumnar)
+      return TakeGameEventColumns();
+
+    if (m_GameEvents.empty())
+      return nullptr;
+
+    CValue* result =
+        m_GameEventsArena->CreateArray((uint32_t)m_GameEvents.size());
+    for (size_t i = 0; i < m_GameEvents.size(); ++i)
+      result->SetArrayElement((uint32_t)i, m_GameEvents[i]);
+    m_GameEvents.clear();
+    return result;
+  }
+
+  CefRefPtr<CValue> TakeGameEventColumns() {
+    if (0 == m_GameEventBuffer.GetEventCount())
+      return nullptr;
+
+    CefRefPtr<CAfxValueArena> arena = GetPumpValueArena();
+
+    std::vector<GameEventSchemaPtr> schemas;
+    m_GameEventBuffer.TakeNewSchemas(schemas);
+
+    CValue* objSchemas = arena->CreateArray((uint32_t)schemas.size());
+    for (size_t i = 0; i < schemas.size(); ++i) {
+      objSchemas->SetArrayElement(
+          (uint32_t)i, CreateGameEventSchemaValue(*arena, *schemas[i]));
+    }
+
+    CValue* objBuffer =
+        arena->CreateBytes(nullptr, (uint32_t)m_GameEventBuffer.GetSize());
+    m_GameEventBuffer.Write(objBuffer->GetBytesData());
+    m_GameEventBuffer.Clear();
+
+    CValue* result = arena->CreateObject(2);
+    result->SetChild("schemas", objSchemas);
+    result->SetChild("buffer", objBuffer);
+    return result;
+  }
+
+  static CValue* CreateGameEventSchemaValue(CValueArena& arena,
+                                            const GameEventSchema_s& schema) {
+    CValue* obj = arena.CreateObject(3);
+    obj->SetChild("id", arena.CreateUInt(schema.Id));
+    obj->SetChild("name", arena.CreateString(schema.Name));
+
+    CValue* objColumns = arena.CreateArray((uint32_t)schema.Columns.size());
+    for (size_t i = 0; i < schema.Columns.size(); ++i) {
+      const GameEventColumn_s& column = schema.Columns[i];
+      const char* type = GetGameEventColumnTypeName(column.Type);
+
+      CValue* objColumn = arena.CreateObject(4);
+      objColumn->SetChild("name", arena.CreateString(column.Name));
+      if (nullptr != column.Enrichment) {
+        objColumn->SetChild(
+            "enrichment",
+            arena.CreateString(column.Enrichment,
+                               (uint32_t)strlen(column.Enrichment)));
+      }
+      objColumn->SetChild("type",
+                          arena.CreateString(type, (uint32_t)strlen(type)));
+      objColumn->SetChild(
+          "width", arena.CreateUInt(GetGameEventColumnWidth(column.Type)));
+      objColumns->SetArrayElement((uint32_t)i, objColumn);
+    }
+    obj->SetChild("columns", objColumns);
+
+    return obj;
+  }
+
+  // Drops what was collected and not taken.
+  void ClearGameEvents() {
+    m_GameEvents.clear();
+    m_GameEventBuffer.Clear();
+  }
+
   float m_Tx = 0;
   float m_Ty = 0;
   float m_Tz = 0;
@@ -9092,8 +8502,8 @@ private:
 
   void DoPump(CefRefPtr<CefV8Value> fn_resolve,
               CefRefPtr<CefV8Value> fn_reject,
-              CefRefPtr<CAfxValue> filter,
-              CefRefPtr<CAfxValue> obj) {
+              CefRefPtr<CValue> filter,
+              CefRefPtr<CValue> obj) {
     int errorLine = 0;
 
     if (!GetConnected())
@@ -9112,6 +8522,8 @@ private:
         goto __4;
       case 5:
         goto __5;
+      case 6:
+        goto __6;
       default:
         AFX_GOTO_ERROR;
     }
@@ -9120,6 +8532,9 @@ private:
     if (m_NewConnection) {
       m_NewConnection = false;
 
+      // Events collected on the old connection are not delivered:
+      ClearGameEvents();
+
       // Check if our version is supported by client:
 
       if (!m_PipeServer.WriteInt32(m_ServerVersion.GetMajor()))
@@ -9145,6 +8560,12 @@ private:
         AFX_GOTO_ERROR
 #endif
 
+      // The client version isn't known yet, so 7.0 clients get the 7.1
+      // here as well. That's fine: they only act on the major above and
+      // from our side they get the 7.0 stream, since the capabilities
+      // below are only exchanged with clients that said 7.1 themselves.
+      // 7.1 clients on the other hand need the minor to know whether to
+      // expect the capabilities.
       if (!m_PipeServer.WriteUInt32(m_ServerVersion.GetMinor())) {
         errorLine = __LINE__;
         goto error;
@@ -9202,28 +8623,75 @@ private:
       if (!m_PipeServer.WriteBoolean(true))
         AFX_GOTO_ERROR
 
-      //
+      // Clients from 7.1 on pick from the capabilities offered:
+      if (!(m_ClientVersion < CVersion(7, 1, 0, 0))) {
+        if (!m_PipeServer.WriteUInt32(g_EngineCapabilities))
+          AFX_GOTO_ERROR
 
-      if (!WriteGameEventSettings(false, filter))
-        AFX_GOTO_ERROR
+        if (!m_PipeServer.Flush())
+          AFX_GOTO_ERROR
 
-      if (!m_PipeServer.Flush())
+        UINT32 accepted;
+        if (!m_PipeServer.ReadUInt32(accepted))
+          AFX_GOTO_ERROR
+
+        NegotiateCapabilities(accepted, g_EngineCapabilities);
+      }
+
+      bool resumable = m_SessionResumable;
+      m_SessionResumable = false;
+      m_SessionAgreed = false;
+
+      bool resumed = false;
+
+      if (m_Negotiated &&
+          0 != (m_Capabilities & InteropCapability_SessionResume)) {
+        if (!m_PipeServer.WriteUInt64(resumable ? m_SessionToken : 0))
+          AFX_GOTO_ERROR
+
+        if (!m_PipeServer.Flush())
+          AFX_GOTO_ERROR
+
+        if (!m_PipeServer.ReadBoolean(resumed))
+          AFX_GOTO_ERROR
+
+        // Client claims a session we didn't offer:
+        if (resumed && !resumable)
+          AFX_GOTO_ERROR
+
+        if (resumed) {
+          // What got lost with the connection has to be sent again:
+          if (!m_PipeServer.WriteCompressedUInt32(
+                  (UINT32)m_KnownGameEvents.size()))
+            AFX_GOTO_ERROR
+          for (auto it = m_KnownGameEvents.begin();
+               it != m_KnownGameEvents.end(); ++it) {
+            if (!m_PipeServer.WriteInt32(it->first))
+              AFX_GOTO_ERROR
+          }
+        } else {
+          m_SessionToken = NewSessionToken();
+          if (!m_PipeServer.WriteUInt64(m_SessionToken))
+            AFX_GOTO_ERROR
+        }
+
+        m_SessionAgreed = true;
+      }
+
+      //
+
+      if (!SendGameEventSettings(resumed, filter))
         AFX_GOTO_ERROR
 
       auto onNewConnection = GetPumpFilter(filter, "onNewConnection");
       if (nullptr != onNewConnection) {
         m_PumpResumeAt = 1;
-        CefPostTask(TID_RENDERER, new CAfxTask([this, onNewConnection,
-                                                fn_resolve, fn_reject]() {
-                      if (nullptr == m_Context)
-                        return;
-                      m_Context->Enter();
-                      CefV8ValueList args;
-                      args.push_back(fn_resolve);
-                      args.push_back(fn_reject);
-                      onNewConnection->ExecuteFunction(nullptr, args);
-                      m_Context->Exit();
-                    }));
+        PostCompletion([this, onNewConnection, fn_resolve, fn_reject]() {
+          CefV8ValueList args;
+          args.push_back(fn_resolve);
+          args.push_back(fn_reject);
+          onNewConnection->ExecuteFunction(nullptr, args);
+        });
         return;
       }
     }
@@ -9233,100 +8701,50 @@ private:
   }
 
   __1 : {
+    // Some messages go on with the next one right away:
+    EndMessage();
+
     UINT32 engineMessage;
     if (!m_PipeServer.ReadUInt32(engineMessage))
       AFX_GOTO_ERROR
 
-    switch ((EngineMessage)engineMessage) {
-      case EngineMessage::BeforeFrameStart: {
-        // Read incoming commands from client:
-        {
-          UINT32 commandIndex = 0;
-          UINT32 commandCount;
-          if (!m_PipeServer.ReadCompressedUInt32(commandCount))
-            AFX_GOTO_ERROR
-
-          CefRefPtr<CAfxValue> objCommands =
-              CAfxValue::CreateArray((int)commandCount);
-
-          while (0 < commandCount) {
-            UINT32 argIndex = 0;
-            UINT32 argCount;
-            if (!m_PipeServer.ReadCompressedUInt32(argCount))
-              AFX_GOTO_ERROR
-
-            CefRefPtr<CAfxValue> objArgs =
-                CAfxValue::CreateArray((int)argCount);
+    BeginMessage(engineMessage);
 
-            objCommands->SetArrayElement((int)commandIndex, objArgs);
+    // The client got everything we sent before, so it has the same state:
+    m_SessionResumable = m_SessionAgreed;
 
-            while (0 < argCount) {
-              std::string str;
-
-              if (!m_PipeServer.ReadStringUTF8(str))
-                AFX_GOTO_ERROR
-
-              objArgs->SetArrayElement((int)argIndex,
-                                       CAfxValue::CreateString(str));
+    switch ((EngineMessage)engineMessage) {
+      case EngineMessage::BeforeFrameStart: {
+        CountFrame();
 
-              --argCount;
-              ++argIndex;
-            }
+        auto onGameEvents = GetPumpFilter(filter, "onGameEvents");
+        CefRefPtr<CValue> objEvents;
+        if (nullptr != onGameEvents)
+          objEvents = TakeGameEvents();
 
-            --commandCount;
-            ++commandIndex;
-          }
+        // Nobody to deliver the rest to anymore:
+        ClearGameEvents();
 
-          auto onCommands = GetPumpFilter(filter, "onCommands");
-          if (nullptr != onCommands) {
-            m_PumpResumeAt = 2;
-            CefPostTask(
-                TID_RENDERER, new CAfxTask([this, onCommands, fn_resolve,
-                                            fn_reject, filter, objCommands]() {
-                  if (nullptr == m_Context)
-                    return;
+        m_GameEventsColumnar = m_GameEventsColumnarNext;
 
-                  m_Context->Enter();
-                  CefV8ValueList args;
-                  args.push_back(CefV8Value::CreateFunction(
-                      "resolve",
-                      new CAfxCallbackFn([this, fn_resolve, fn_reject, filter](
-                                             const CefString& name,
-                                             CefRefPtr<CefV8Value> object,
-                                             const CefV8ValueList& arguments,
-                                             CefRefPtr<CefV8Value>& retval,
-                                             CefString& exception) -> bool {
-                        m_PipeQueue.Queue(
-                            [this, fn_resolve, fn_reject, filter,
-                             obj = 1 <= arguments.size()
-                                       ? CAfxValue::FromV8Value(arguments[0])
-                                       : nullptr]() {
-                              DoPump(fn_resolve, fn_reject, filter, obj);
-                            });
-                        return true;
-                      })));
-                  args.push_back(fn_reject);
-                  args.push_back(objCommands->ToV8Value());
-                  onCommands->ExecuteFunction(nullptr, args);
-                  m_Context->Exit();
-                }));
-            return;
-          }
+        if (nullptr != objEvents) {
+          m_PumpResumeAt = 6;
+          PostCompletion(
+              [this, onGameEvents, fn_resolve, fn_reject, objEvents]() {
+                CefV8ValueList args;
+                args.push_back(fn_resolve);
+                args.push_back(fn_reject);
+                args.push_back(CAfxValueArena::ToV8Value(objEvents.get(),
+                                                         m_PropertyNames));
+                onGameEvents->ExecuteFunction(nullptr, args);
+              });
+          return;
         }
-        if (!m_PipeServer.WriteCompressedUInt32((UINT32)(0)))
-          AFX_GOTO_ERROR
-
-        if (!m_PipeServer.Flush())
-          AFX_GOTO_ERROR
-
-        m_PumpResumeAt = 1;
-        goto __resolve;
-      } break;
+      }
+        goto __6;
 
       case EngineMessage::BeforeFrameRenderStart: {
-        if (!WriteGameEventSettings(true, filter))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.Flush())
+        if (!SendGameEventSettings(true, filter))
           AFX_GOTO_ERROR
 
         m_PumpResumeAt = 1;
@@ -9370,110 +8788,24 @@ private:
       case EngineMessage::OnRenderView: {
         struct RenderInfo_s renderInfo;
 
-        if (!m_PipeServer.ReadInt32(renderInfo.FrameCount))
-          AFX_GOTO_ERROR
-
-        if (!m_PipeServer.ReadSingle(renderInfo.AbsoluteFrameTime))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.CurTime))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.FrameTime))
-          AFX_GOTO_ERROR
-
-        if (!m_PipeServer.ReadInt32(renderInfo.View.X))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadInt32(renderInfo.View.Y))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadInt32(renderInfo.View.Width))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadInt32(renderInfo.View.Height))
-          AFX_GOTO_ERROR
-
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M00))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M01))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M02))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M03))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M10))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M11))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M12))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M13))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M20))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M21))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M22))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M23))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M30))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M31))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M32))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ViewMatrix.M33))
-          AFX_GOTO_ERROR
-
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M00))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M01))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M02))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M03))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M10))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M11))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M12))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M13))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M20))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M21))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M22))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M23))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M30))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M31))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M32))
-          AFX_GOTO_ERROR
-        if (!m_PipeServer.ReadSingle(renderInfo.View.ProjectionMatrix.M33))
+        if (!ReadRenderInfo(m_PipeServer, renderInfo))
           AFX_GOTO_ERROR
 
         auto onRenderViewBegin = GetPumpFilter(filter, "onRenderViewBegin");
         if (nullptr != onRenderViewBegin) {
           m_PumpResumeAt = 3;
-          CefPostTask(
-              TID_RENDERER,
-              new CAfxTask([this, onRenderViewBegin, fn_resolve, fn_reject,
-                            filter,
-                            renderInfo = CreateAfxRenderInfo(renderInfo)]() {
-                if (nullptr == m_Context)
-                  return;
-
-                m_Context->Enter();
-                CefV8ValueList args;
-                args.push_back(fn_resolve);
-                args.push_back(fn_reject);
-                args.push_back(renderInfo->ToV8Value());
-                onRenderViewBegin->ExecuteFunction(nullptr, args);
-                m_Context->Exit();
-              }));
+          PostCompletion([this, onRenderViewBegin, fn_resolve, fn_reject,
+                          filter,
+                          renderInfo = CefRefPtr<CValue>(CreateAfxRenderInfo(
+                              *GetPumpValueArena(), renderInfo,
+                              m_Float32Matrices))]() {
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            args.push_back(CAfxValueArena::ToV8Value(
+                renderInfo.get(), m_PropertyNames, GetNewFloat32Array()));
+            onRenderViewBegin->ExecuteFunction(nullptr, args);
+          });
           return;
         }
 
@@ -9485,19 +8817,13 @@ private:
         auto onRenderViewEnd = GetPumpFilter(filter, "onRenderViewEnd");
         if (nullptr != onRenderViewEnd) {
           m_PumpResumeAt = 4;
-          CefPostTask(TID_RENDERER, new CAfxTask([this, onRenderViewEnd,
-                                                  fn_resolve, fn_reject]() {
-                        if (nullptr == m_Context)
-                          return;
+          PostCompletion([this, onRenderViewEnd, fn_resolve, fn_reject]() {
 
-                        m_Context->Enter();
-
-                        CefV8ValueList args;
-                        args.push_back(fn_resolve);
-                        args.push_back(fn_reject);
-                        onRenderViewEnd->ExecuteFunction(nullptr, args);
-                        m_Context->Exit();
-                      }));
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            onRenderViewEnd->ExecuteFunction(nullptr, args);
+          });
           return;
         }
       }
@@ -9508,18 +8834,12 @@ private:
         auto onHudBegin = GetPumpFilter(filter, "onRenderViewHudBegin");
         if (nullptr != onHudBegin) {
           m_PumpResumeAt = 1;
-          CefPostTask(TID_RENDERER,
-                      new CAfxTask([this, onHudBegin, fn_resolve, fn_reject]() {
-                        if (nullptr == m_Context)
-                          return;
-
-                        m_Context->Enter();
-                        CefV8ValueList args;
-                        args.push_back(fn_resolve);
-                        args.push_back(fn_reject);
-                        onHudBegin->ExecuteFunction(nullptr, args);
-                        m_Context->Exit();
-                      }));
+          PostCompletion([this, onHudBegin, fn_resolve, fn_reject]() {
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            onHudBegin->ExecuteFunction(nullptr, args);
+          });
           return;
         }
       }
@@ -9530,18 +8850,12 @@ private:
         auto onHudEnd = GetPumpFilter(filter, "onRenderViewHudEnd");
         if (nullptr != onHudEnd) {
           m_PumpResumeAt = 1;
-          CefPostTask(TID_RENDERER,
-                      new CAfxTask([this, onHudEnd, fn_resolve, fn_reject]() {
-                        if (nullptr == m_Context)
-                          return;
-
-                        m_Context->Enter();
-                        CefV8ValueList args;
-                        args.push_back(fn_resolve);
-                        args.push_back(fn_reject);
-                        onHudEnd->ExecuteFunction(nullptr, args);
-                        m_Context->Exit();
-                      }));
+          PostCompletion([this, onHudEnd, fn_resolve, fn_reject]() {
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            onHudEnd->ExecuteFunction(nullptr, args);
+          });
           return;
         }
       }
@@ -9605,61 +8919,61 @@ private:
           AFX_GOTO_ERROR
 
         auto onViewOverride = GetPumpFilter(filter, "onViewOverride");
-        if (nullptr != onViewOverride) {
-          m_PumpResumeAt = 5;
-          CefPostTask(
-              TID_RENDERER,
-              new CAfxTask([this, onViewOverride, tx = m_Tx, ty = m_Ty,
-                            tz = m_Tz, rx = m_Rx, ry = m_Ry, rz = m_Rz,
-                            fov = m_Fov, fn_resolve, fn_reject, filter]() {
-                if (nullptr == m_Context)
-                  return;
-
-                m_Context->Enter();
-
-                CefV8ValueList args;
-                args.push_back(CefV8Value::CreateFunction(
-                    "resolve",
-                    new CAfxCallbackFn([this, fn_reject, fn_resolve, filter](
-                                           const CefString& name,
-                                           CefRefPtr<CefV8Value> object,
-                                           const CefV8ValueList& arguments,
-                                           CefRefPtr<CefV8Value>& retval,
-                                           CefString& exception) -> bool {
-                      m_PipeQueue.Queue(
-                          [this, fn_resolve, fn_reject, filter,
-                           obj = 1 <= arguments.size()
-                                     ? CAfxValue::FromV8Value(arguments[0])
-                                     : nullptr]() {
-                            DoPump(fn_resolve, fn_reject, filter, obj);
-                          });
-
-                      return true;
-                    })));
-                args.push_back(fn_reject);
-                CefRefPtr<CefV8Value> obj2 =
-                    CefV8Value::CreateObject(nullptr, nullptr);
-
-                obj2->SetValue("tX", CefV8Value::CreateDouble(tx),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("tY", CefV8Value::CreateDouble(ty),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("tZ", CefV8Value::CreateDouble(tz),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("rX", CefV8Value::CreateDouble(rx),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("rY", CefV8Value::CreateDouble(ry),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("rZ", CefV8Value::CreateDouble(rz),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-                obj2->SetValue("fov", CefV8Value::CreateDouble(fov),
-                               V8_PROPERTY_ATTRIBUTE_NONE);
-
-                args.push_back(obj2);
-
-                onViewOverride->ExecuteFunction(nullptr, args);
-                m_Context->Exit();
-              }));
+        if (nullptr != onViewOverride) {
+          m_PumpResumeAt = 5;
+          PostCompletion([this, onViewOverride, tx = m_Tx, ty = m_Ty, tz = m_Tz,
+                          rx = m_Rx, ry = m_Ry, rz = m_Rz, fov = m_Fov,
+                          fn_resolve, fn_reject, filter]() {
+
+            CefV8ValueList args;
+            args.push_back(CefV8Value::CreateFunction(
+                "resolve",
+                new CAfxCallbackFn([this, fn_reject, fn_resolve, filter](
+                                       const CefString& name,
+                                       CefRefPtr<CefV8Value> object,
+                                       const CefV8ValueList& arguments,
+                                       CefRefPtr<CefV8Value>& retval,
+                                       CefString& exception) -> bool {
+                  m_PipeQueue.Queue(
+                      [this, fn_resolve, fn_reject, filter,
+                       obj = 1 <= arguments.size()
+                                 ? CAfxValueArena::FromV8Value(arguments[0])
+                                 : nullptr]() {
+                        DoPump(fn_resolve, fn_reject, filter, obj);
+                      });
+
+                  return true;
+                })));
+            args.push_back(fn_reject);
+            CefRefPtr<CefV8Value> obj2 =
+                CefV8Value::CreateObject(nullptr, nullptr);
+
+            obj2->SetValue(m_PropertyNames.Get("tX"),
+                           CefV8Value::CreateDouble(tx),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("tY"),
+                           CefV8Value::CreateDouble(ty),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("tZ"),
+                           CefV8Value::CreateDouble(tz),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("rX"),
+                           CefV8Value::CreateDouble(rx),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("rY"),
+                           CefV8Value::CreateDouble(ry),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("rZ"),
+                           CefV8Value::CreateDouble(rz),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+            obj2->SetValue(m_PropertyNames.Get("fov"),
+                           CefV8Value::CreateDouble(fov),
+                           V8_PROPERTY_ATTRIBUTE_NONE);
+
+            args.push_back(obj2);
+
+            onViewOverride->ExecuteFunction(nullptr, args);
+          });
           return;
         }
 
@@ -9674,11 +8988,37 @@ private:
       }
 
       case EngineMessage::GameEvent: {
-        bool bReturn = false;
-        m_PumpResumeAt = 1;
-        if (!ReadGameEvent(fn_resolve, fn_reject, filter, bReturn))
+        // Collected till the next frame starts, the client doesn't wait:
+        if (IsPumpFilter(filter, "onGameEvents")) {
+          if (m_GameEventsColumnar) {
+            if (!ReadGameEventColumns())
+              AFX_GOTO_ERROR
+          } else {
+            CValue* objEvent;
+            if (!ReadGameEvent(*GetGameEventsArena(), objEvent))
+              AFX_GOTO_ERROR
+            m_GameEvents.push_back(objEvent);
+          }
+          goto __1;
+        }
+
+        CefRefPtr<CAfxValueArena> arena = GetPumpValueArena();
+        CValue* objEvent;
+        if (!ReadGameEvent(*arena, objEvent))
           AFX_GOTO_ERROR
-        if (bReturn) {
+
+        auto onGameEvent = GetPumpFilter(filter, "onGameEvent");
+        if (nullptr != onGameEvent) {
+          m_PumpResumeAt = 1;
+          PostCompletion([this, onGameEvent, fn_resolve, fn_reject,
+                          objEvent = CefRefPtr<CValue>(objEvent)]() {
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            args.push_back(
+                CAfxValueArena::ToV8Value(objEvent.get(), m_PropertyNames));
+            onGameEvent->ExecuteFunction(nullptr, args);
+          });
           return;
         }
       }
@@ -9689,18 +9029,12 @@ private:
         auto onForceEndQueue = GetPumpFilter(filter, "onForceEndQueue");
             if (nullptr != onForceEndQueue) {
           m_PumpResumeAt = 1;
-          CefPostTask(TID_RENDERER, new CAfxTask([this, onForceEndQueue,
-                                                  fn_resolve, fn_reject]() {
-                        if (nullptr == m_Context)
-                          return;
-
-                        m_Context->Enter();
-                        CefV8ValueList args;
-                        args.push_back(fn_resolve);
-                        args.push_back(fn_reject);
-                        onForceEndQueue->ExecuteFunction(nullptr, args);
-                        m_Context->Exit();
-                      }));
+          PostCompletion([this, onForceEndQueue, fn_resolve, fn_reject]() {
+            CefV8ValueList args;
+            args.push_back(fn_resolve);
+            args.push_back(fn_reject);
+            onForceEndQueue->ExecuteFunction(nullptr, args);
+          });
           return;
         }
       }
@@ -9712,15 +9046,15 @@ private:
     AFX_GOTO_ERROR
 
   __2 : {
-    int len = nullptr != obj && obj->IsArray() ? obj->GetArraySize() : 0;
+    uint32_t len = nullptr != obj ? obj->GetArraySize() : 0;
 
     if (!m_PipeServer.WriteCompressedUInt32((UINT32)(len)))
       AFX_GOTO_ERROR
 
-    for (int i = 0; i < len; ++i) {
+    for (uint32_t i = 0; i < len; ++i) {
       auto elem = obj->GetArrayElement(i);
       if (nullptr != elem && elem->IsString()) {
-        if (!m_PipeServer.WriteStringUTF8(elem->GetString()))
+        if (!m_PipeServer.WriteStringUTF8(elem->GetString().ToString()))
           AFX_GOTO_ERROR      
       }
       else {
@@ -9764,6 +9098,9 @@ private:
     if (!m_PipeServer.WriteBoolean(outAfterRenderView))
       AFX_GOTO_ERROR
 
+    if (!m_PipeServer.Send())
+      AFX_GOTO_ERROR  // client is waiting
+
     /*bool done = !(true || outBeforeTranslucentShadow ||
     outAfterTranslucentShadow || outBeforeTranslucent || outAfterTranslucent ||
     outBeforeHud || outAfterHud || outAfterRenderView);
@@ -9779,18 +9116,12 @@ private:
     auto onDone = GetPumpFilter(filter, "onDone");
     if (nullptr != onDone) {
       m_PumpResumeAt = 1;
-      CefPostTask(TID_RENDERER,
-                  new CAfxTask([this, onDone, fn_resolve, fn_reject]() {
-                    if (nullptr == m_Context)
-                      return;
-
-                    m_Context->Enter();
-                    CefV8ValueList args;
-                    args.push_back(fn_resolve);
-                    args.push_back(fn_reject);
-                    onDone->ExecuteFunction(nullptr, args);
-                    m_Context->Exit();
-                  }));
+      PostCompletion([this, onDone, fn_resolve, fn_reject]() {
+        CefV8ValueList args;
+        args.push_back(fn_resolve);
+        args.push_back(fn_reject);
+        onDone->ExecuteFunction(nullptr, args);
+      });
       return;
     }
     m_PumpResumeAt = 1;
@@ -9801,43 +9132,43 @@ private:
     bool overriden = false;
 
     if (nullptr != obj && obj->IsObject()) {
-      CefRefPtr<CAfxValue> v8Tx = obj->GetChild("tX");
+      CValue* v8Tx = obj->GetChild("tX");
       if (nullptr != v8Tx && v8Tx->IsDouble()) {
         m_Tx = (float)v8Tx->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Ty = obj->GetChild("tY");
+      CValue* v8Ty = obj->GetChild("tY");
       if (nullptr != v8Ty && v8Ty->IsDouble()) {
         m_Ty = (float)v8Ty->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Tz = obj->GetChild("tZ");
+      CValue* v8Tz = obj->GetChild("tZ");
       if (nullptr != v8Tz && v8Tz->IsDouble()) {
         m_Tz = (float)v8Tz->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Rx = obj->GetChild("rX");
+      CValue* v8Rx = obj->GetChild("rX");
       if (nullptr != v8Rx && v8Rx->IsDouble()) {
         m_Rx = (float)v8Rx->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Ry = obj->GetChild("rY");
+      CValue* v8Ry = obj->GetChild("rY");
       if (nullptr != v8Ry && v8Ry->IsDouble()) {
         m_Ry = (float)v8Ry->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Rz = obj->GetChild("rZ");
+      CValue* v8Rz = obj->GetChild("rZ");
       if (nullptr != v8Rz && v8Rz->IsDouble()) {
         m_Rz = (float)v8Rz->GetDouble();
         overriden = true;
       }
 
-      CefRefPtr<CAfxValue> v8Fov = obj->GetChild("fov");
+      CValue* v8Fov = obj->GetChild("fov");
       if (nullptr != v8Fov && v8Fov->IsDouble()) {
         m_Fov = (float)v8Fov->GetDouble();
         overriden = true;
@@ -9873,30 +9204,104 @@ private:
     m_PumpResumeAt = 1;
     goto __resolve;
 
+  __6 : {
+    // Read incoming commands from client:
+    {
+      UINT32 commandIndex = 0;
+      UINT32 commandCount;
+      if (!m_PipeServer.ReadCompressedUInt32(commandCount))
+        AFX_GOTO_ERROR
+
+      CefRefPtr<CAfxValueArena> arena = GetPumpValueArena();
+
+      CefRefPtr<CValue> objCommands = arena->CreateArray(commandCount);
+
+      while (0 < commandCount) {
+        UINT32 argIndex = 0;
+        UINT32 argCount;
+        if (!m_PipeServer.ReadCompressedUInt32(argCount))
+          AFX_GOTO_ERROR
+
+        CValue* objArgs = arena->CreateArray(argCount);
+
+        objCommands->SetArrayElement(commandIndex, objArgs);
+
+        while (0 < argCount) {
+          StringView_s str;
+
+          if (!m_PipeServer.ReadStringUTF8(*arena, str))
+            AFX_GOTO_ERROR
+
+          objArgs->SetArrayElement(argIndex, arena->CreateString(str));
+
+          --argCount;
+          ++argIndex;
+        }
+
+        --commandCount;
+        ++commandIndex;
+      }
+
+      auto onCommands = GetPumpFilter(filter, "onCommands");
+      if (nullptr != onCommands) {
+        m_PumpResumeAt = 2;
+        PostCompletion([this, onCommands, fn_resolve, fn_reject, filter,
+                        objCommands]() {
+          CefV8ValueList args;
+          args.push_back(CefV8Value::CreateFunction(
+              "resolve",
+              new CAfxCallbackFn([this, fn_resolve, fn_reject, filter](
+                                     const CefString& name,
+                                     CefRefPtr<CefV8Value> object,
+                                     const CefV8ValueList& arguments,
+                                     CefRefPtr<CefV8Value>& retval,
+                                     CefString& exception) -> bool {
+                m_PipeQueue.Queue(
+                    [this, fn_resolve, fn_reject, filter,
+                     obj = 1 <= arguments.size()
+                               ? CAfxValueArena::FromV8Value(arguments[0])
+                               : nullptr]() {
+                      DoPump(fn_resolve, fn_reject, filter, obj);
+                    });
+                return true;
+              })));
+          args.push_back(fn_reject);
+          args.push_back(CAfxValueArena::ToV8Value(objCommands.get(),
+                                                   m_PropertyNames));
+          onCommands->ExecuteFunction(nullptr, args);
+        });
+        return;
+      }
+    }
+    if (!m_PipeServer.WriteCompressedUInt32((UINT32)(0)))
+      AFX_GOTO_ERROR
+
+    if (!m_PipeServer.Flush())
+      AFX_GOTO_ERROR
+
+    m_PumpResumeAt = 1;
+    goto __resolve;
+  }
+
   __resolve:
-    CefPostTask(TID_RENDERER, new CAfxTask([this, fn_resolve, errorLine]() {
-                  if (nullptr == m_Context)
-                    return;
+    EndMessage();
 
-                  m_Context->Enter();
-                  fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                  m_Context->Exit();
-                }));
+    PostCompletion([this, fn_resolve, errorLine]() {
+      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+    });
     return;
 
   error:
     m_PumpResumeAt = 0;
-    CefPostTask(TID_RENDERER, new CAfxTask([this, fn_reject, errorLine]() {
-                  if (nullptr == m_Context)
-                    return;
-
-                  m_Context->Enter();
-                  CefV8ValueList args;
-                  args.push_back(CefV8Value::CreateString(
-                      "AfxInterop.cpp:" + std::to_string(errorLine)));
-                  fn_reject->ExecuteFunction(nullptr, args);
-                  m_Context->Exit();
-                }));
+    m_MessageOpcode = g_NoOpcode;
+    PostCompletion([this, fn_reject, errorLine,
+                    timedOut = m_PipeServer.GetTimedOut()]() {
+      CefV8ValueList args;
+      args.push_back(CefV8Value::CreateString(
+          "AfxInterop.cpp:" + std::to_string(errorLine) +
+          (timedOut ? ": timed out" : "")));
+      fn_reject->ExecuteFunction(nullptr, args);
+    });
   }
 
  private:
@@ -9918,129 +9323,99 @@ private:
  }
 
 
- class CEngineInteropImplConnectionThread
-     : public advancedfx::interop::CPipeServerConnectionThread {
-  public:
-   CEngineInteropImplConnectionThread(HANDLE handle, CEngineInteropImpl* host)
-       : advancedfx::interop::CPipeServerConnectionThread(handle),
-         m_Host(host) {}
-
-   ~CEngineInteropImplConnectionThread() {
-     m_Quit = true;
-     Cancel();
-     Join();
-   }
-
-  protected:
-   virtual void ConnectionThread() override {
-     try {
-       while (!m_Quit) {
-         ClientMessage message = (ClientMessage)ReadInt32();
-         switch (message) {
-           case ClientMessage::Message: {
-             int senderId = ReadInt32();
-             std::string argMessage;
-             ReadStringUTF8(argMessage);
-
-              CefPostTask(TID_RENDERER,
-                         new advancedfx::interop::CAfxTask(
-                                     [host = m_Host, senderId, argMessage] {
-                                       host->OnClientMessage_Message(
-                                           senderId, argMessage);
-                                     }));
-           } break;
-           default:
-             throw "CEngineInteropImplConnectionThread::ConnectionThread: Unknown message.";
-         }
-       }
-     } catch (const std::exception& e) {
-       DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
-                   << e.what();
-       DebugBreak();
+private:
+  static CValue* CreateAfxMatrix4x4(
+      CValueArena& arena,
+      const struct advancedfx::interop::Matrix4x4_s& value) {
+    CValue* obj = arena.CreateArray(16);
 
-     }
-   }
+    obj->SetArrayElement(0, arena.CreateDouble(value.M00));
+    obj->SetArrayElement(1, arena.CreateDouble(value.M01));
+    obj->SetArrayElement(2, arena.CreateDouble(value.M02));
+    obj->SetArrayElement(3, arena.CreateDouble(value.M03));
 
-  private:
-   CEngineInteropImpl* m_Host;
-   bool m_Quit = false;
- };
+    obj->SetArrayElement(4, arena.CreateDouble(value.M10));
+    obj->SetArrayElement(5, arena.CreateDouble(value.M11));
+    obj->SetArrayElement(6, arena.CreateDouble(value.M12));
+    obj->SetArrayElement(7, arena.CreateDouble(value.M13));
 
-private:
-  static CefRefPtr<CAfxValue> CreateAfxMatrix4x4(
-      const struct advancedfx::interop::Matrix4x4_s& value) {
-   CefRefPtr<CAfxValue> obj = CAfxValue::CreateArray(16);
-
-    obj->SetArrayElement(0, CAfxValue::CreateDouble(value.M00));
-   obj->SetArrayElement(
-       1, CAfxValue::CreateDouble(value.M01));
-    obj->SetArrayElement(
-        2, CAfxValue::CreateDouble(value.M02));
-   obj->SetArrayElement(
-       3, CAfxValue::CreateDouble(value.M03));
-
-    obj->SetArrayElement(
-       4, CAfxValue::CreateDouble(value.M10));
-   obj->SetArrayElement(
-       5, CAfxValue::CreateDouble(value.M11));
-    obj->SetArrayElement(
-        6, CAfxValue::CreateDouble(value.M12));
-   obj->SetArrayElement(
-       7, CAfxValue::CreateDouble(value.M13));
-
-    obj->SetArrayElement(
-       8, CAfxValue::CreateDouble(value.M20));
-   obj->SetArrayElement(
-       9, CAfxValue::CreateDouble(value.M21));
-    obj->SetArrayElement(
-        10, CAfxValue::CreateDouble(value.M22));
-   obj->SetArrayElement(
-       11, CAfxValue::CreateDouble(value.M23));
-
-    obj->SetArrayElement(
-       12, CAfxValue::CreateDouble(value.M30));
-   obj->SetArrayElement(
-       13, CAfxValue::CreateDouble(value.M31));
-    obj->SetArrayElement(
-        14, CAfxValue::CreateDouble(value.M32));
-   obj->SetArrayElement(
-       15, CAfxValue::CreateDouble(value.M33));
+    obj->SetArrayElement(8, arena.CreateDouble(value.M20));
+    obj->SetArrayElement(9, arena.CreateDouble(value.M21));
+    obj->SetArrayElement(10, arena.CreateDouble(value.M22));
+    obj->SetArrayElement(11, arena.CreateDouble(value.M23));
+
+    obj->SetArrayElement(12, arena.CreateDouble(value.M30));
+    obj->SetArrayElement(13, arena.CreateDouble(value.M31));
+    obj->SetArrayElement(14, arena.CreateDouble(value.M32));
+    obj->SetArrayElement(15, arena.CreateDouble(value.M33));
 
     return obj;
   }
 
-  static CefRefPtr<CAfxValue> CreateAfxView(
-      const struct advancedfx::interop::View_s& value) {
-    CefRefPtr<CAfxValue> obj = CAfxValue::CreateObject();
-
-    obj->SetChild("x", CAfxValue::CreateInt(value.X));
-    obj->SetChild("y", CAfxValue::CreateInt(value.Y));
-    obj->SetChild("width", CAfxValue::CreateInt(value.Width));
-    obj->SetChild("height", CAfxValue::CreateInt(value.Height));
-    obj->SetChild("viewMatrix", CreateAfxMatrix4x4(value.ViewMatrix));
-    obj->SetChild("projectionMatrix",
-                  CreateAfxMatrix4x4(value.ProjectionMatrix));
+  // With float32Matrices the matrices are Float32Arrays (row by row) on one
+  // buffer, plus viewProjectionMatrix.
+  static CValue* CreateAfxView(
+      CValueArena& arena,
+      const struct advancedfx::interop::View_s& value,
+      bool float32Matrices) {
+    CValue* obj = arena.CreateObject(7);
+
+    obj->SetChild("x", arena.CreateInt(value.X));
+    obj->SetChild("y", arena.CreateInt(value.Y));
+    obj->SetChild("width", arena.CreateInt(value.Width));
+    obj->SetChild("height", arena.CreateInt(value.Height));
+
+    if (float32Matrices) {
+      Matrix4x4_s matrices[3] = {value.ViewMatrix, value.ProjectionMatrix};
+      MultiplyMatrix4x4(value.ProjectionMatrix, value.ViewMatrix, matrices[2]);
+
+      CValue* buffer = arena.CreateFloat32Buffer(&matrices[0].M00, 3 * 16);
+      obj->SetChild("viewMatrix", arena.CreateFloat32Array(buffer, 0, 16));
+      obj->SetChild("projectionMatrix",
+                    arena.CreateFloat32Array(buffer, 16, 16));
+      obj->SetChild("viewProjectionMatrix",
+                    arena.CreateFloat32Array(buffer, 32, 16));
+    } else {
+      obj->SetChild("viewMatrix",
+                    CreateAfxMatrix4x4(arena, value.ViewMatrix));
+      obj->SetChild("projectionMatrix",
+                    CreateAfxMatrix4x4(arena, value.ProjectionMatrix));
+    }
 
     return obj;
   }
 
-  static CefRefPtr<CAfxValue> CreateAfxRenderInfo(
-      const struct advancedfx::interop::RenderInfo_s& value) {
-    CefRefPtr<CAfxValue> obj = CAfxValue::CreateObject();
+  static CValue* CreateAfxRenderInfo(
+      CValueArena& arena,
+      const struct advancedfx::interop::RenderInfo_s& value,
+      bool float32Matrices) {
+    CValue* obj = arena.CreateObject(5);
 
-    obj->SetChild("view", CreateAfxView(value.View));
+    obj->SetChild("view", CreateAfxView(arena, value.View, float32Matrices));
 
-    obj->SetChild("frameCount", CAfxValue::CreateInt(value.FrameCount));
+    obj->SetChild("frameCount", arena.CreateInt(value.FrameCount));
     obj->SetChild("absoluteFrameTime",
-                  CAfxValue::CreateDouble(value.AbsoluteFrameTime));
-    obj->SetChild("curTime", CAfxValue::CreateDouble(value.CurTime));
-    obj->SetChild("frameTime", CAfxValue::CreateDouble(value.FrameTime));
+                  arena.CreateDouble(value.AbsoluteFrameTime));
+    obj->SetChild("curTime", arena.CreateDouble(value.CurTime));
+    obj->SetChild("frameTime", arena.CreateDouble(value.FrameTime));
 
     return obj;
   }
 
   bool m_NewConnection = true;
 
+  // Pipe thread only.
+  bool m_Float32Matrices = false;
+
+  // Renderer thread only, see CAfxValueArena::CreateNewFloat32Array().
+  CefRefPtr<CefV8Value> m_NewFloat32Array;
+
+  CefRefPtr<CefV8Value> GetNewFloat32Array() {
+    if (nullptr == m_NewFloat32Array)
+      m_NewFloat32Array = CAfxValueArena::CreateNewFloat32Array(m_Context);
+    return m_NewFloat32Array;
+  }
+
   CHandleCalcCallbacks m_HandleCalcCallbacks;
   CVecAngCalcCallbacks m_VecAngCalcCallbacks;
   CCamCalcCallbacks m_CamCalcCallbacks;
@@ -10051,33 +9426,42 @@ private:
   CefRefPtr<CAfxCallback> m_OnMessage;
   CefRefPtr<CAfxCallback> m_OnError;
 
-  bool m_WaitConnectionQuit = false;
-  std::thread m_WaitConnectionThread;
-
-  void WaitConnectionThreadHandler(void) {
-    std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_client_");
-    strPipeName.append(std::to_string(GetCurrentProcessId()));
-    strPipeName.append("_");
-    strPipeName.append(std::to_string(m_BrowserId));
-
-    while (!m_WaitConnectionQuit) {
-      try {
-        auto thread = this->WaitForConnection(strPipeName.c_str(), 500);
-        if (thread != nullptr) {
-          thread->Join();
-          delete thread;
-          break;
+  std::atomic<bool> m_ChannelQuit = false;
+  CPooledThread m_ChannelThread;
+
+  // The handler answers on the channel we send on.
+  void ChannelThreadHandler(void) {
+    CPipeChannel channel(GetChannel());
+
+    try {
+      while (true) {
+        ClientMessage message = (ClientMessage)channel.ReadInt32();
+        switch (message) {
+          case ClientMessage::Message: {
+            int senderId = channel.ReadInt32();
+            std::string argMessage;
+            channel.ReadStringUTF8(argMessage);
+
+            CefPostTask(TID_RENDERER,
+                        new advancedfx::interop::CAfxTask(
+                            [this, senderId, argMessage] {
+                              OnClientMessage_Message(senderId, argMessage);
+                            }));
+          } break;
+          default:
+            throw "CEngineInteropImpl::ChannelThreadHandler: Unknown message.";
         }
-      } catch (const std::exception& e) {
+      }
+    } catch (const std::exception& e) {
+      if (!m_ChannelQuit) {
         DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                     << e.what();
         DebugBreak();
-
       }
     }
   }
 
-  bool DoRenderPass(CefRefPtr<CAfxValue> filter,
+  bool DoRenderPass(CefRefPtr<CValue> filter,
                     const char* what,
                     CefRefPtr<CefV8Value> fn_resolve,
                     CefRefPtr<CefV8Value> fn_reject,
@@ -10087,98 +9471,26 @@ private:
 
     View_s view;
 
-    if (!m_PipeServer.ReadInt32(view.X))
-      return false;
-    if (!m_PipeServer.ReadInt32(view.Y))
-      return false;
-    if (!m_PipeServer.ReadInt32(view.Width))
-      return false;
-    if (!m_PipeServer.ReadInt32(view.Height))
-      return false;
-
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M00))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M01))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M02))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M03))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M10))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M11))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M12))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M13))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M20))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M21))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M22))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M23))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M30))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M31))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M32))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ViewMatrix.M33))
-      return false;
-
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M00))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M01))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M02))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M03))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M10))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M11))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M12))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M13))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M20))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M21))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M22))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M23))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M30))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M31))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M32))
-      return false;
-    if (!m_PipeServer.ReadSingle(view.ProjectionMatrix.M33))
+    if (!ReadView(m_PipeServer, view))
       return false;
 
     auto onRenderPass = GetPumpFilter(filter, what);
     if (nullptr != onRenderPass) {
       m_PumpResumeAt = 1;
       bReturn = true;
-      CefPostTask(TID_RENDERER, new CAfxTask([this, onRenderPass,
-                                              argView = CreateAfxView(view), fn_resolve, fn_reject]() {
-                    if (nullptr == m_Context)
-                      return;
-
-                    m_Context->Enter();
-                    CefV8ValueList args;
-                    args.push_back(fn_resolve);
-                    args.push_back(fn_reject);
-                    args.push_back(argView->ToV8Value());
-                    onRenderPass->ExecuteFunction(nullptr, args);
-                    m_Context->Exit();
-                  }));
+      PostCompletion([this, onRenderPass,
+                      argView = CefRefPtr<CValue>(
+                          CreateAfxView(*GetPumpValueArena(), view,
+                                        m_Float32Matrices)),
+                      fn_resolve, fn_reject]() {
+        CefV8ValueList args;
+        args.push_back(fn_resolve);
+        args.push_back(fn_reject);
+        args.push_back(
+            CAfxValueArena::ToV8Value(argView.get(), m_PropertyNames,
+                                      GetNewFloat32Array()));
+        onRenderPass->ExecuteFunction(nullptr, args);
+      });
       return true;
     }
 
@@ -10220,93 +9532,48 @@ private:
   bool m_GameEventsTransmitTick = false;
   bool m_GameEventsTransmitSystemTime = false;
 
-  struct KnownGameEventKey_s {
-    std::string Key;
-    GameEventFieldType Type;
-
-    KnownGameEventKey_s(const std::string& key, GameEventFieldType fieldType)
-        : Key(key), Type(fieldType) {}
-  };
-
-  struct KnownGameEvent_s {
-    std::string Name;
-    std::list<KnownGameEventKey_s> Keys;
-
-    KnownGameEvent_s() {}
-  };
-
-  std::map<int, KnownGameEvent_s> m_KnownGameEvents;
-
-  bool ReadGameEvent(CefRefPtr<CefV8Value> fn_resolve,
-                     CefRefPtr<CefV8Value> fn_reject,
-                     CefRefPtr<CAfxValue> filter,
-                     bool& bReturn) {
-    
-    bReturn = false;
-
-    int iEventId;
-    if (!m_PipeServer.ReadInt32(iEventId))
+  KnownGameEvents_t m_KnownGameEvents;
+
+  // Session the client can resume after the connection broke, see
+  // InteropCapability_SessionResume. Only resumable while the client is
+  // known to have the same game event settings as we do.
+  uint64_t m_SessionToken = 0;
+  bool m_SessionAgreed = false;
+  bool m_SessionResumable = false;
+
+  static uint64_t NewSessionToken() {
+    std::random_device random;
+    uint64_t result = ((uint64_t)random() << 32) | random();
+    return 0 != result ? result : 1;
+  }
+
+  /**
+   * Reads the event of a GameEvent message into arena.
+   */
+  bool ReadGameEvent(CAfxValueArena& arena, CValue*& objEvent) {
+    KnownGameEvents_t::iterator itKnown;
+    if (!ReadGameEventHeader(m_PipeServer, m_KnownGameEvents, itKnown)) {
+      // Might have a description only half:
+      m_SessionResumable = false;
       return false;
-
-    std::map<int, KnownGameEvent_s>::iterator itKnown;
-    if (0 == iEventId) {
-      if (!m_PipeServer.ReadInt32(iEventId))
-        return false;
-
-      auto resultEmplace = m_KnownGameEvents.emplace(std::piecewise_construct,
-                                                     std::make_tuple(iEventId),
-                                                     std::make_tuple());
-
-      if (!resultEmplace.second)
-        return false;
-
-      itKnown = resultEmplace.first;
-
-      std::string strName;
-      if (!m_PipeServer.ReadStringUTF8(itKnown->second.Name))
-        return false;
-
-      while (true) {
-        bool bHasNext;
-        if (!m_PipeServer.ReadBoolean(bHasNext))
-          return false;
-        if (!bHasNext)
-          break;
-
-        std::string strKey;
-        if (!m_PipeServer.ReadStringUTF8(strKey))
-          return false;
-
-        int iEventType;
-        if (!m_PipeServer.ReadInt32(iEventType))
-          return false;
-
-        itKnown->second.Keys.emplace_back(strKey,
-                                          (GameEventFieldType)iEventType);
-      }
-    } else {
-      itKnown = m_KnownGameEvents.find(iEventId);
     }
 
-    if (itKnown == m_KnownGameEvents.end())
-      return false;
-
-    CefRefPtr<CAfxValue> objEvent = CAfxValue::CreateObject();
+    objEvent = arena.CreateObject();
 
-    objEvent->SetChild("name", CAfxValue::CreateString(itKnown->second.Name));
+    objEvent->SetChild("name", arena.CreateString(itKnown->second.Name));
 
     if (m_GameEventsTransmitClientTime) {
       float clientTime;
       if (!m_PipeServer.ReadSingle(clientTime))
         return false;
-      objEvent->SetChild("clientTime", CAfxValue::CreateDouble(clientTime));
+      objEvent->SetChild("clientTime", arena.CreateDouble(clientTime));
     }
 
     if (m_GameEventsTransmitTick) {
       int tick;
       if (!m_PipeServer.ReadInt32(tick))
         return false;
-      objEvent->SetChild("tick", CAfxValue::CreateInt(tick));
+      objEvent->SetChild("tick", arena.CreateInt(tick));
     }
 
     if (m_GameEventsTransmitSystemTime) {
@@ -10314,10 +9581,10 @@ private:
       if (!m_PipeServer.ReadUInt64(systemTime))
         return false;
       objEvent->SetChild("systemTime",
-                         CAfxValue::CreateTime((time_t)systemTime));
+                         arena.CreateTime((int64_t)systemTime));
     }
 
-    std::string tmpString;
+    StringView_s tmpString;
     float tmpFloat;
     int tmpLong;
     short tmpShort;
@@ -10325,55 +9592,55 @@ private:
     bool tmpBool;
     unsigned __int64 tmpUint64;
 
-   CefRefPtr<CAfxValue> objKeys = CAfxValue::CreateObject();
+    CValue* objKeys =
+        arena.CreateObject((uint32_t)itKnown->second.Keys.size());
 
     for (auto itKey = itKnown->second.Keys.begin();
          itKey != itKnown->second.Keys.end(); ++itKey) {
-     CefRefPtr<CAfxValue> objKey = CAfxValue::CreateObject();
+      CValue* objKey = arena.CreateObject(3);
 
-      objKey->SetChild("type", CAfxValue::CreateInt((int)itKey->Type));
+      objKey->SetChild("type", arena.CreateInt((int)itKey->Type));
 
       switch (itKey->Type) {
         case GameEventFieldType::CString:
-          if (!m_PipeServer.ReadStringUTF8(tmpString))
+          if (!m_PipeServer.ReadStringUTF8(arena, tmpString))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateString(tmpString));
+          objKey->SetChild("value", arena.CreateString(tmpString));
           break;
         case GameEventFieldType::Float:
           if (!m_PipeServer.ReadSingle(tmpFloat))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateDouble(tmpFloat));
+          objKey->SetChild("value", arena.CreateDouble(tmpFloat));
           break;
         case GameEventFieldType::Long:
           if (!m_PipeServer.ReadInt32(tmpLong))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateInt(tmpLong));
+          objKey->SetChild("value", arena.CreateInt(tmpLong));
           break;
         case GameEventFieldType::Short:
           if (!m_PipeServer.ReadInt16(tmpShort))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateInt(tmpShort));
+          objKey->SetChild("value", arena.CreateInt(tmpShort));
           break;
         case GameEventFieldType::Byte:
           if (!m_PipeServer.ReadByte(tmpByte))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateUInt(tmpByte));
+          objKey->SetChild("value", arena.CreateUInt(tmpByte));
           break;
         case GameEventFieldType::Bool:
           if (!m_PipeServer.ReadBoolean(tmpBool))
             return false;
-          objKey->SetChild("value", CAfxValue::CreateBool(tmpBool));
+          objKey->SetChild("value", arena.CreateBool(tmpBool));
           break;
         case GameEventFieldType::Uint64:
           if (!m_PipeServer.ReadUInt64(tmpUint64))
             return false;
-          CefRefPtr<CAfxValue> objValue = CAfxValue::CreateArray(2);
-          objValue->SetArrayElement(0, CAfxValue::CreateUInt(
-                                    (unsigned int)(tmpUint64 & 0x0ffffffff)));
+          CValue* objValue = arena.CreateArray(2);
+          objValue->SetArrayElement(
+              0, arena.CreateUInt((unsigned int)(tmpUint64 & 0x0ffffffff)));
           objValue->SetArrayElement(
-              1,
-              CAfxValue::CreateUInt(
-                                    (unsigned int)(tmpUint64 & 0x0ffffffff)));
+              1, arena.CreateUInt(
+                     (unsigned int)((tmpUint64 >> 32) & 0x0ffffffff)));
           objKey->SetChild("value", objValue);
           break;
       }
@@ -10383,87 +9650,66 @@ private:
       if (itEnrichment != m_GameEventsEnrichments.end()) {
         int enrichmentType = itEnrichment->second;
 
-        CefRefPtr<CAfxValue> objEnrichments =
-            CAfxValue::CreateObject();
+        CValue* objEnrichments = arena.CreateObject();
 
-        if (enrichmentType & (1 << 0)) {
+        if (enrichmentType & GameEventEnrichment_UserIdWithSteamId) {
           uint64_t value;
           if (!m_PipeServer.ReadUInt64(value))
             return false;
 
-          CefRefPtr<CAfxValue> objValue = CAfxValue::CreateArray(2);
+          CValue* objValue = arena.CreateArray(2);
           objValue->SetArrayElement(
-              0, CAfxValue::CreateUInt((unsigned int)(value & 0x0ffffffff)));
-          objValue->SetArrayElement(1, CAfxValue::CreateUInt(
+              0, arena.CreateUInt((unsigned int)(value & 0x0ffffffff)));
+          objValue->SetArrayElement(1, arena.CreateUInt(
                                  (unsigned int)((value >> 32) & 0x0ffffffff)));
 
           objEnrichments->SetChild("userIdWithSteamId", objValue);
         }
 
-        if (enrichmentType & (1 << 1)) {
+        if (enrichmentType & GameEventEnrichment_EntnumWithOrigin) {
           Vector_s value;
-          if (!m_PipeServer.ReadSingle(value.X))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Y))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Z))
+          if (!ReadVector(m_PipeServer, value))
             return false;
 
-          CefRefPtr<CAfxValue> objValue =
-              CAfxValue::CreateObject();
-          objValue->SetChild("x", CAfxValue::CreateDouble(value.X));
-          objValue->SetChild("y", CAfxValue::CreateDouble(value.Y));
-          objValue->SetChild("z", CAfxValue::CreateDouble(value.Z));
+          CValue* objValue = arena.CreateObject(3);
+          objValue->SetChild("x", arena.CreateDouble(value.X));
+          objValue->SetChild("y", arena.CreateDouble(value.Y));
+          objValue->SetChild("z", arena.CreateDouble(value.Z));
           objEnrichments->SetChild("entnumWithOrigin", objValue);
         }
 
-        if (enrichmentType & (1 << 2)) {
+        if (enrichmentType & GameEventEnrichment_EntnumWithAngles) {
           QAngle_s value;
-          if (!m_PipeServer.ReadSingle(value.Pitch))
+          if (!ReadQAngle(m_PipeServer, value))
             return false;
-          if (!m_PipeServer.ReadSingle(value.Yaw))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Roll))
-            return false;
-          CefRefPtr<CAfxValue> objValue =
-              CAfxValue::CreateObject();
-          objValue->SetChild("pitch", CAfxValue::CreateDouble(value.Pitch));
-          objValue->SetChild("yaw", CAfxValue::CreateDouble(value.Yaw));
-          objValue->SetChild("roll", CAfxValue::CreateDouble(value.Roll));
+          CValue* objValue = arena.CreateObject(3);
+          objValue->SetChild("pitch", arena.CreateDouble(value.Pitch));
+          objValue->SetChild("yaw", arena.CreateDouble(value.Yaw));
+          objValue->SetChild("roll", arena.CreateDouble(value.Roll));
 
           objEnrichments->SetChild("entnumWithAngles", objValue);
         }
 
-        if (enrichmentType & (1 << 3)) {
+        if (enrichmentType & GameEventEnrichment_UseridWithEyePosition) {
           Vector_s value;
-          if (!m_PipeServer.ReadSingle(value.X))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Y))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Z))
+          if (!ReadVector(m_PipeServer, value))
             return false;
 
-          CefRefPtr<CAfxValue> objValue =
-              CAfxValue::CreateObject();
-          objValue->SetChild("x", CAfxValue::CreateDouble(value.X));
-          objValue->SetChild("y", CAfxValue::CreateDouble(value.Y));
-          objValue->SetChild("z", CAfxValue::CreateDouble(value.Z));
+          CValue* objValue = arena.CreateObject(3);
+          objValue->SetChild("x", arena.CreateDouble(value.X));
+          objValue->SetChild("y", arena.CreateDouble(value.Y));
+          objValue->SetChild("z", arena.CreateDouble(value.Z));
           objEnrichments->SetChild("useridWithEyePosition", objValue);
         }
 
-        if (enrichmentType & (1 << 4)) {
+        if (enrichmentType & GameEventEnrichment_UseridWithEyeAngles) {
           QAngle_s value;
-          if (!m_PipeServer.ReadSingle(value.Pitch))
+          if (!ReadQAngle(m_PipeServer, value))
             return false;
-          if (!m_PipeServer.ReadSingle(value.Yaw))
-            return false;
-          if (!m_PipeServer.ReadSingle(value.Roll))
-            return false;
-          CefRefPtr<CAfxValue> objValue =
-              CAfxValue::CreateObject();
-          objValue->SetChild("pitch", CAfxValue::CreateDouble(value.Pitch));
-          objValue->SetChild("yaw", CAfxValue::CreateDouble(value.Yaw));
-          objValue->SetChild("roll", CAfxValue::CreateDouble(value.Roll));
+          CValue* objValue = arena.CreateObject(3);
+          objValue->SetChild("pitch", arena.CreateDouble(value.Pitch));
+          objValue->SetChild("yaw", arena.CreateDouble(value.Yaw));
+          objValue->SetChild("roll", arena.CreateDouble(value.Roll));
 
           objEnrichments->SetChild("useridWithEyeAngels", objValue);
         }
@@ -10476,35 +9722,69 @@ private:
 
     objEvent->SetChild("keys", objKeys);
 
-    auto onGameEvent = GetPumpFilter(filter, "onGameEvent");
-    if (nullptr != onGameEvent) {
-      bReturn = true;
-      CefPostTask(TID_RENDERER, new CAfxTask([this, onGameEvent, objEvent, fn_resolve, fn_reject]() {
-                    if (nullptr == m_Context)
-                      return;
+    return true;
+  }
 
-                m_Context->Enter();
-                    CefV8ValueList args;
-                args.push_back(fn_resolve);
-                    args.push_back(fn_reject);
-                args.push_back(objEvent->ToV8Value());
-                    onGameEvent->ExecuteFunction(nullptr, args);
-                m_Context->Exit();
-                       }));
+  /**
+   * Reads the event of a GameEvent message into m_GameEventBuffer.
+   */
+  bool ReadGameEventColumns() {
+    KnownGameEvents_t::iterator itKnown;
+    if (!ReadGameEventHeader(m_PipeServer, m_KnownGameEvents, itKnown)) {
+      // Might have a description only half:
+      m_SessionResumable = false;
+      return false;
     }
 
-    return true;
+    return m_GameEventBuffer.ReadEvent(m_PipeServer,
+                                       GetGameEventSchema(itKnown));
+  }
+
+  const GameEventSchemaPtr& GetGameEventSchema(
+      KnownGameEvents_t::iterator itKnown) {
+    auto it = m_GameEventSchemas.find(itKnown->first);
+    if (it != m_GameEventSchemas.end())
+      return it->second;
+
+    std::vector<unsigned int> enrichments;
+    for (auto itKey = itKnown->second.Keys.begin();
+         itKey != itKnown->second.Keys.end(); ++itKey) {
+      auto itEnrichment = m_GameEventsEnrichments.find(
+          GameEventEnrichmentKey_s(itKnown->second.Name, itKey->Key));
+      enrichments.push_back(itEnrichment != m_GameEventsEnrichments.end()
+                                ? itEnrichment->second
+                                : 0);
+    }
+
+    return m_GameEventSchemas[itKnown->first] = CreateGameEventSchema(
+               m_NextGameEventSchemaId++, itKnown->second,
+               m_GameEventsTransmitClientTime, m_GameEventsTransmitTick,
+               m_GameEventsTransmitSystemTime, enrichments);
+  }
+
+  /**
+   * Writes and flushes the game event settings. Delta changes are applied
+   * to our state as they are written, so the session is not resumable until
+   * the client's next message shows it read them.
+   */
+  bool SendGameEventSettings(bool delta, CefRefPtr<CValue> filter) {
+    m_SessionResumable = false;
+
+    if (!WriteGameEventSettings(delta, filter))
+      return false;
+
+    return m_PipeServer.Flush();
   }
 
-  bool WriteGameEventSettings(bool delta, CefRefPtr<CAfxValue> filter) {
+  bool WriteGameEventSettings(bool delta, CefRefPtr<CValue> filter) {
 
-    auto onGameEvent = GetPumpFilter(filter, "onGameEvent");
+    bool gameEvents = IsPumpFilter(filter, "onGameEvent") ||
+                      IsPumpFilter(filter, "onGameEvents");
 
-    if (!m_PipeServer.WriteBoolean(nullptr != onGameEvent ? true
-                                                                   : false))
+    if (!m_PipeServer.WriteBoolean(gameEvents))
       return false;
 
-    if (nullptr == onGameEvent)
+    if (!gameEvents)
       return true;
 
     if (!delta) {
@@ -10535,6 +9815,9 @@ private:
 
     m_GameEventsTransmitChanged = false;
 
+    // Events are sent with the new settings from now on:
+    m_GameEventSchemas.clear();
+
     // Allow removals:
     if (delta) {
       if (!m_PipeServer.WriteCompressedUInt32(
@@ -10746,8 +10029,7 @@ CefRefPtr<CefV8Value> CreateEngineInterop(CefRefPtr<CefBrowser> browser,
 
 class CInteropImpl : public CAfxObject,
     public CInterop,
-                     public CPipeServer,
-                     public CPipeClient{
+                     public CPipeChannel {
   IMPLEMENT_REFCOUNTING(CInteropImpl);
  public:
   static CefRefPtr<CefV8Value> Create(CefRefPtr<CefBrowser> browser,
@@ -10758,27 +10040,12 @@ class CInteropImpl : public CAfxObject,
                                       CefRefPtr<CInterop>* out = nullptr) {
     CefRefPtr<CInteropImpl> self = new CInteropImpl(browser->GetIdentifier());
 
-    std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_handler_");
-    strPipeName.append(std::to_string(handlerId));
-
     try {
-      while(true)
-      {
-      bool bError = false;
-      try {
-        self->OpenPipe(strPipeName.c_str(), INFINITE);
-        Sleep(100);
-      }
-      catch(const std::exception&)
-      {
-        bError = true;
-      }
-
-      if(!bError) break;
-      }
-      self->WriteUInt32(GetCurrentProcessId());
+      self->OpenChannel(handlerId);
       self->WriteInt32(browser->GetIdentifier());
       self->Flush();
+      self->m_ChannelThread =
+          CPooledThread(&CInteropImpl::ChannelThreadHandler, self.get());
     } catch (const std::exception& e) {
       DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                   << e.what();
@@ -10843,29 +10110,16 @@ class CInteropImpl : public CAfxObject,
                     self->WriteStringUTF8(str.ToString());
                     self->Flush();
 
-                    CefPostTask(
-                        TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
+                    self->PostCompletion([self, fn_resolve]() {
+                      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                    });
                   } catch (const std::exception& e) {
-                    CefPostTask(
-                        TID_RENDERER,
-                        new CAfxTask([self, fn_reject,
-                                      error_msg = std::string(e.what())]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          CefV8ValueList args;
-                          args.push_back(CefV8Value::CreateString(error_msg));
-                          fn_reject->ExecuteFunction(nullptr, args);
-                          self->m_Context->Exit();
-                        }));
+                    self->PostCompletion([self, fn_reject,
+                                          error_msg = std::string(e.what())]() {
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateString(error_msg));
+                      fn_reject->ExecuteFunction(nullptr, args);
+                    });
                   }
                 });
 
@@ -10902,29 +10156,16 @@ CAfxObject::AddFunction(
                     self->WriteStringUTF8(argStr);
                     self->Flush();
 
-                    CefPostTask(
-                        TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
-                          self->m_Context->Exit();
-                        }));
+                    self->PostCompletion([self, fn_resolve]() {
+                      fn_resolve->ExecuteFunction(nullptr, CefV8ValueList());
+                    });
                   } catch (const std::exception& e) {
-                    CefPostTask(
-                        TID_RENDERER,
-                        new CAfxTask([self, fn_reject,
-                                      error_msg = std::string(e.what())]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                          self->m_Context->Enter();
-                          CefV8ValueList args;
-                          args.push_back(CefV8Value::CreateString(error_msg));
-                          fn_reject->ExecuteFunction(nullptr, args);
-                          self->m_Context->Exit();
-                        }));
+                    self->PostCompletion([self, fn_reject,
+                                          error_msg = std::string(e.what())]() {
+                      CefV8ValueList args;
+                      args.push_back(CefV8Value::CreateString(error_msg));
+                      fn_reject->ExecuteFunction(nullptr, args);
+                    });
                   }
                 });
 
@@ -10962,28 +10203,17 @@ CAfxObject::AddFunction(
                 self->WriteStringUTF8(argStr);
                 self->Flush();
 
-                CefPostTask(TID_RENDERER, new CAfxTask([self, fn_resolve]() {
-                              if (nullptr == self->m_Context)
-                                return;
-
-                              self->m_Context->Enter();
-                              fn_resolve->ExecuteFunction(nullptr,
-                                                          CefV8ValueList());
-                              self->m_Context->Exit();
-                            }));
+                self->PostCompletion([self, fn_resolve]() {
+                  fn_resolve->ExecuteFunction(nullptr,
+                                              CefV8ValueList());
+                });
               } catch (const std::exception& e) {
-                CefPostTask(
-                    TID_RENDERER,
-                    new CAfxTask([self, fn_reject, error_msg = std::string(e.what())]() {
-                          if (nullptr == self->m_Context)
-                            return;
-
-                      self->m_Context->Enter();
-                      CefV8ValueList args;
-                      args.push_back(CefV8Value::CreateString(error_msg));
-                      fn_reject->ExecuteFunction(nullptr, args);
-                      self->m_Context->Exit();
-                    }));
+                self->PostCompletion([self, fn_reject,
+                                      error_msg = std::string(e.what())]() {
+                  CefV8ValueList args;
+                  args.push_back(CefV8Value::CreateString(error_msg));
+                  fn_reject->ExecuteFunction(nullptr, args);
+                });
               }
             });
 
@@ -10994,6 +10224,22 @@ CAfxObject::AddFunction(
       return true;
     });
 
+    CAfxObject::AddFunction(
+        obj, "getStats",
+        [](const CefString& name, CefRefPtr<CefV8Value> object,
+           const CefV8ValueList& arguments, CefRefPtr<CefV8Value>& retval,
+           CefString& exceptionoverride) {
+          auto self = CAfxObject::As<AfxObjectType::InteropImpl,
+                                     CInteropImpl>(object);
+          if (self == nullptr) {
+            exceptionoverride = g_szInvalidThis;
+            return true;
+          }
+
+          retval = self->GetStats();
+          return true;
+        });
+
     self->m_OnMessage = CAfxObject::AddCallback(obj, "onMessage");
 
     self->m_OnError = CAfxObject::AddCallback(obj, "onError");
@@ -11010,7 +10256,7 @@ CAfxObject::AddFunction(
     void ClosePipes() {
 
     try {
-      this->ClosePipe();
+      this->CloseChannel();
     } catch (const std::exception&) {
     }
   }
@@ -11018,9 +10264,10 @@ CAfxObject::AddFunction(
  virtual void CloseInterop() override {
     ClosePipes();
 
-    m_WaitConnectionQuit = true;
-    if (m_WaitConnectionThread.joinable())
-      m_WaitConnectionThread.join();
+    m_ChannelQuit = true;
+    CancelChannel();
+    if (m_ChannelThread.joinable())
+      m_ChannelThread.join();
 
     m_InteropQueue.Abort();
 
@@ -11032,42 +10279,43 @@ CAfxObject::AddFunction(
   int m_BrowserId;
 
 public:
-   CInteropImpl(int browserId) : CAfxObject(AfxObjectType::InteropImpl), m_BrowserId(browserId) {
-     m_WaitConnectionThread =
-         std::thread(&CInteropImpl::WaitConnectionThreadHandler, this);
-   }
-
-   virtual CPipeServerConnectionThread* OnNewConnection(
-       HANDLE handle) override {
-     return new CInteropImplConnectionThread(handle, this);
-   }
+   CInteropImpl(int browserId) : CAfxObject(AfxObjectType::InteropImpl), m_BrowserId(browserId) {}
 
  private:
   CefRefPtr<CAfxCallback> m_OnMessage;
   CefRefPtr<CAfxCallback> m_OnError;
 
-bool m_WaitConnectionQuit = false;
-  std::thread m_WaitConnectionThread;
-
-  void WaitConnectionThreadHandler(void) {
-    std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_client_");
-    strPipeName.append(std::to_string(GetCurrentProcessId()));
-    strPipeName.append("_");
-    strPipeName.append(std::to_string(m_BrowserId));
-
-   while (!m_WaitConnectionQuit) {
-      try {
-       auto thread = this->WaitForConnection(strPipeName.c_str(), 500);
-        if (thread != nullptr) {
-          thread->Join();
-          delete thread;
-          break;
+  std::atomic<bool> m_ChannelQuit = false;
+  CPooledThread m_ChannelThread;
+
+  // The handler answers on the channel we send on.
+  void ChannelThreadHandler(void) {
+    CPipeChannel channel(GetChannel());
+
+    try {
+      while (true) {
+        ClientMessage message = (ClientMessage)channel.ReadInt32();
+        switch (message) {
+          case ClientMessage::Message: {
+            int senderId = channel.ReadInt32();
+            std::string argMessage;
+            channel.ReadStringUTF8(argMessage);
+
+            CefPostTask(TID_RENDERER,
+                        new advancedfx::interop::CAfxTask(
+                            [this, senderId, argMessage] {
+                              OnClientMessage_Message(senderId, argMessage);
+                            }));
+          } break;
+          default:
+            throw "CInteropImpl::ChannelThreadHandler: Unknown message.";
         }
-      } catch (const std::exception& e) {
+      }
+    } catch (const std::exception& e) {
+      if (!m_ChannelQuit) {
         DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
                     << e.what();
         DebugBreak();
-
       }
     }
   }
@@ -11089,53 +10337,6 @@ bool m_WaitConnectionQuit = false;
   m_Context->Exit();
  }
 
- class CInteropImplConnectionThread
-     : public advancedfx::interop::CPipeServerConnectionThread {
-  public:
-   CInteropImplConnectionThread(HANDLE handle, CInteropImpl* host)
-       : advancedfx::interop::CPipeServerConnectionThread(handle),
-         m_Host(host) {}
-
-   ~CInteropImplConnectionThread() {
-     m_Quit = true;
-     Cancel();
-     Join();
-   }
-
-  protected:
-   virtual void ConnectionThread() override {
-     try {
-       while (!m_Quit) {
-         ClientMessage message = (ClientMessage)ReadInt32();
-         switch (message) {
-           case ClientMessage::Message: {
-             int senderId = ReadInt32();
-             std::string argMessage;
-             ReadStringUTF8(argMessage);
-             CefPostTask(TID_RENDERER,
-                         new advancedfx::interop::CAfxTask(
-                                     [host = m_Host, senderId, argMessage] {
-                                       host->OnClientMessage_Message(
-                                           senderId, argMessage);
-                                     }));
-           } break;
-           default:
-             throw "CInteropImplConnectionThread::ConnectionThread: Unknown message.";
-         }
-       }
-     } catch (const std::exception& e) {
-       DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
-                   << e.what();
-       DebugBreak();
-
-     }
-   }
-
-  private:
-   CInteropImpl* m_Host;
-   bool m_Quit = false;
- };
-
 };
 
 CefRefPtr<CefV8Value> CreateInterop(CefRefPtr<CefBrowser> browser,
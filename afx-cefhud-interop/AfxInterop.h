@@ -7,15 +7,22 @@
 #include <list>
 #include <string>
 #include <functional>
+#include <unordered_map>
 #include <mutex>
 #include <memory>
+#include <vector>
 
 #include <malloc.h>
+#include <string.h>
 
 #include <windows.h>
 #include <d3d9types.h>
 
-#define TEN_MINUTES_IN_MILLISECONDS (10*60*60*1000)
+#include "AfxMux.h"
+#include "AfxStats.h"
+#include "AfxTaskPool.h"
+#include "AfxThreadedQueue.h"
+#include "AfxTransport.h"
 
 namespace advancedfx {
 namespace interop {
@@ -38,15 +45,29 @@ class CAfxTask : public CefTask {
   DISALLOW_COPY_AND_ASSIGN(CAfxTask);
 };
 
-class CPipeHandle {
+class CPipeHandle : public CTransport {
  public:
   HANDLE GetHandle() { return m_Handle; }
 
   virtual ~CPipeHandle() {}
 
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) override;
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  virtual bool FlushTransport() override;
+
  protected:
   HANDLE m_Handle = INVALID_HANDLE_VALUE;
   std::mutex m_PipeMutex;
+  DWORD m_LastError = ERROR_SUCCESS;
+
+  // Primitives are collected here until Flush() or the next read.
+  CWriteBuffer m_WriteBuffer;
+
+  CReadBuffer m_ReadBuffer;
 };
 
 struct CPipeException : public std::exception {
@@ -58,37 +79,6 @@ struct CPipeException : public std::exception {
   const char* what() const throw() { return "PipeIOException"; }
 };
 
-class CThreadedQueue {
-  typedef std::function<void(void)> fp_t;
-
- public:
-  CThreadedQueue();
-  ~CThreadedQueue();
-
-  void Abort();
-
-  void Queue(const fp_t& op);
-  void Queue(fp_t&& op);
-
-  CThreadedQueue(const CThreadedQueue& rhs) = delete;
-  CThreadedQueue& operator=(const CThreadedQueue& rhs) = delete;
-  CThreadedQueue(CThreadedQueue&& rhs) = delete;
-  CThreadedQueue& operator=(CThreadedQueue&& rhs) = delete;
-
-  std::thread::native_handle_type GetNativeThreadHandle(){
-    return m_Thread.native_handle();
-  }
-
- private:
-  std::mutex m_Lock;
-  std::thread m_Thread;
-  std::queue<fp_t> m_Queue;
-  std::condition_variable m_Cv;
-  bool m_Quit = false;
-
-  void QueueThreadHandler(void);
-};
-
 class CPipeReader : public virtual CPipeHandle {
  public:
   /**
@@ -237,7 +227,7 @@ public:
       m_Handle = handle;
 
       m_Thread =
-          std::thread(&CPipeServerConnectionThread::ConnectionThread, this);
+          CPooledThread(&CPipeServerConnectionThread::ConnectionThread, this);
   }
 
   HANDLE GetHandle() { return m_Handle;
@@ -259,6 +249,7 @@ public:
     std::unique_lock<std::mutex> lock(m_PipeMutex);
 
     if (m_Handle != INVALID_HANDLE_VALUE) {
+      m_WriteBuffer.WriteTo(*this);
       FlushFileBuffers(m_Handle);
       DisconnectNamedPipe(m_Handle);
       CloseHandle(m_Handle);
@@ -266,16 +257,22 @@ public:
     }
   }
 
+  /**
+   * Makes the pending read or write on the pipe fail. Can be called from any
+   * thread.
+   */
   void Cancel() {
     std::unique_lock<std::mutex> lock(m_PipeMutex);
 
     if (m_Handle != INVALID_HANDLE_VALUE) {
-      CancelSynchronousIo(m_Thread.native_handle());
+      // Only the I/O on this connection's pipe, the pool thread running it
+      // can be serving others before and after:
+      CancelIoEx(m_Handle, nullptr);
     }
   }
 
 protected:
-  std::thread m_Thread;
+  CPooledThread m_Thread;
 
   virtual void ConnectionThread() = 0;
 };
@@ -296,15 +293,28 @@ class CPipeServer {
 
 public:
   /**
+   * @returns nullptr if no client connected or if cancelled.
    * @throws exception
    */
  CPipeServerConnectionThread * WaitForConnection(const char* pipeName,
      DWORD pipeTimeOut);
 
+ /**
+  * Makes the pending and all further WaitForConnection calls return nullptr.
+  * Can be called from any thread.
+  */
+ void CancelWaitForConnection();
+
 protected:
  virtual CPipeServerConnectionThread* OnNewConnection(
      HANDLE handle) = 0;
 
+private:
+ std::mutex m_WaitMutex;
+ // The pipe WaitForConnection is waiting on.
+ HANDLE m_WaitHandle = INVALID_HANDLE_VALUE;
+ std::string m_WaitPipeName;
+ bool m_WaitCancelled = false;
 };
 
 class CPipeClient : public CPipeReaderWriter {
@@ -331,6 +341,51 @@ public:
   void ClosePipe();
 };
 
+// A channel on the connection between a render process and the handler in the
+// browser process, all interops of a render process share that connection.
+// A reading thread should use its own CPipeChannel on the same channel, so it
+// doesn't share the buffers with the writing one.
+class CPipeChannel : public CPipeReaderWriter {
+ public:
+  CPipeChannel() {}
+
+  explicit CPipeChannel(const std::shared_ptr<CMuxChannel>& channel)
+      : m_Channel(channel) {}
+
+  virtual ~CPipeChannel() { CloseChannel(); }
+
+  /**
+   * Opens a new channel to the handler, connects to it first if this process
+   * isn't yet.
+   * @throws exception
+   */
+  void OpenChannel(DWORD handlerId);
+
+  const std::shared_ptr<CMuxChannel>& GetChannel() { return m_Channel; }
+
+  /**
+   * Sends what is pending and closes the channel for both directions.
+   */
+  void CloseChannel();
+
+  /**
+   * Makes the pending and all further calls on the channel fail, also in
+   * other CPipeChannel on it. Can be called from any thread.
+   */
+  void CancelChannel();
+
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) override;
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  virtual bool FlushTransport() override;
+
+ private:
+  std::shared_ptr<CMuxChannel> m_Channel;
+};
+
 enum class ClientMessage : int {
   Message = 1
 };
@@ -346,10 +401,36 @@ enum class HostGpuMessage : int {
   OnAfterRender = 2
 };
 
+// V8 property names by their UTF-8 spelling, converted to a CefString the
+// first time they are needed instead of for every object they are set on.
+// Renderer thread only.
+class CPropertyNames {
+ public:
+  const CefString& Get(const char* name) {
+    return Get(name, (uint32_t)strlen(name));
+  }
+
+  const CefString& Get(const StringView_s& name) {
+    return Get(name.Data, name.Length);
+  }
+
+  const CefString& Get(const char* name, uint32_t length);
+
+ private:
+  // Owns the keys of m_Names.
+  CStringArena m_Keys;
+  std::unordered_map<StringView_s, CefString, StringViewHash_s,
+                     StringViewEqual_s>
+      m_Names;
+};
+
 class CInterop : public virtual CefBaseRefCounted {
   public:
   CefRefPtr<CefV8Context> m_Context;
 
+  // Renderer thread only.
+  CPropertyNames m_PropertyNames;
+
   virtual void CloseInterop() = 0;
 
   virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser,
@@ -360,8 +441,39 @@ class CInterop : public virtual CefBaseRefCounted {
       return false;
   }
 
+  /**
+   * Runs fn on the renderer thread inside m_Context, drops it if the context
+   * is gone by then. Can be called from any thread, what is posted until the
+   * renderer gets to it runs in one task and one scope of the context.
+   */
+  void PostCompletion(std::function<void(void)>&& fn);
+
+  /**
+   * @returns the counters of the interop's queues and completions, what
+   * getStats() returns to the page. Must be called inside m_Context.
+   */
+  virtual CefRefPtr<CefV8Value> GetStats();
+
+  /**
+   * @returns {hr, lastError}, what a function resolves with when HLAE
+   * failed it. Must be called inside m_Context.
+   */
+  CefRefPtr<CefV8Value> CreateErrorResult(int hr, unsigned int lastError);
+
   protected:
     CThreadedQueue m_InteropQueue;
+
+  private:
+    std::mutex m_CompletionsMutex;
+    std::vector<std::function<void(void)>> m_Completions;
+    bool m_CompletionsPosted = false;
+    uint64_t m_CompletionsPostedAt = 0;
+    std::atomic<uint64_t> m_CompletionsQueued{0};
+    // From posting to running the task:
+    CLatencyHistogram m_CompletionWaitStats;
+    CLatencyHistogram m_CompletionRunStats;
+
+    void RunCompletions();
 };
 
 CefRefPtr<CefV8Value> CreateInterop(CefRefPtr<CefBrowser> browser,
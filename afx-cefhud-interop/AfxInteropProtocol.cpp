@@ -0,0 +1,227 @@
+#include "AfxInteropProtocol.h"
+
+#include <string.h>
+
+#include <tuple>
+
+namespace advancedfx {
+namespace interop {
+
+void MultiplyMatrix4x4(const Matrix4x4_s& a,
+                       const Matrix4x4_s& b,
+                       Matrix4x4_s& outValue) {
+  // The members are 16 floats, row by row (see AFX_WIRE_STRUCT):
+  const float* lhs = &a.M00;
+  const float* rhs = &b.M00;
+  float result[16];
+
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      result[4 * row + col] =
+          lhs[4 * row + 0] * rhs[0 + col] + lhs[4 * row + 1] * rhs[4 + col] +
+          lhs[4 * row + 2] * rhs[8 + col] + lhs[4 * row + 3] * rhs[12 + col];
+    }
+  }
+
+  memcpy(&outValue, result, sizeof(result));
+}
+
+bool ReadGameEventHeader(CTransportStream& stream,
+                         KnownGameEvents_t& knownGameEvents,
+                         KnownGameEvents_t::iterator& outKnown) {
+  int iEventId;
+  if (!stream.ReadInt32(iEventId))
+    return false;
+
+  if (0 != iEventId) {
+    outKnown = knownGameEvents.find(iEventId);
+    return outKnown != knownGameEvents.end();
+  }
+
+  if (!stream.ReadInt32(iEventId))
+    return false;
+
+  auto resultEmplace = knownGameEvents.emplace(
+      std::piecewise_construct, std::make_tuple(iEventId), std::make_tuple());
+
+  if (!resultEmplace.second)
+    return false;
+
+  outKnown = resultEmplace.first;
+
+  if (!stream.ReadStringUTF8(outKnown->second.Name))
+    return false;
+
+  while (true) {
+    bool bHasNext;
+    if (!stream.ReadBoolean(bHasNext))
+      return false;
+    if (!bHasNext)
+      break;
+
+    std::string strKey;
+    if (!stream.ReadStringUTF8(strKey))
+      return false;
+
+    int iEventType;
+    if (!stream.ReadInt32(iEventType))
+      return false;
+
+    outKnown->second.Keys.emplace_back(strKey, (GameEventFieldType)iEventType);
+  }
+
+  return true;
+}
+
+const char* GetEngineMessageName(uint32_t opcode) {
+  switch ((EngineMessage)opcode) {
+    case EngineMessage::LevelInitPreEntity:
+      return "LevelInitPreEntity";
+    case EngineMessage::LevelShutDown:
+      return "LevelShutDown";
+    case EngineMessage::BeforeFrameStart:
+      return "BeforeFrameStart";
+    case EngineMessage::OnRenderView:
+      return "OnRenderView";
+    case EngineMessage::OnRenderViewEnd:
+      return "OnRenderViewEnd";
+    case EngineMessage::BeforeFrameRenderStart:
+      return "BeforeFrameRenderStart";
+    case EngineMessage::AfterFrameRenderStart:
+      return "AfterFrameRenderStart";
+    case EngineMessage::OnViewOverride:
+      return "OnViewOverride";
+    case EngineMessage::BeforeTranslucentShadow:
+      return "BeforeTranslucentShadow";
+    case EngineMessage::AfterTranslucentShadow:
+      return "AfterTranslucentShadow";
+    case EngineMessage::BeforeTranslucent:
+      return "BeforeTranslucent";
+    case EngineMessage::AfterTranslucent:
+      return "AfterTranslucent";
+    case EngineMessage::BeforeHud:
+      return "BeforeHud";
+    case EngineMessage::AfterHud:
+      return "AfterHud";
+    case EngineMessage::GameEvent:
+      return "GameEvent";
+    case EngineMessage::ForceEndQueue:
+      return "ForceEndQueue";
+    default:
+      break;
+  }
+
+  return nullptr;
+}
+
+const char* GetDrawingReplyName(uint32_t opcode) {
+  switch ((DrawingReply)opcode) {
+    case DrawingReply::Skip:
+      return "Skip";
+    case DrawingReply::Retry:
+      return "Retry";
+    case DrawingReply::Continue:
+      return "Continue";
+    case DrawingReply::Finished:
+      return "Finished";
+    case DrawingReply::D3d9CreateVertexDeclaration:
+      return "D3d9CreateVertexDeclaration";
+    case DrawingReply::ReleaseD3d9VertexDeclaration:
+      return "ReleaseD3d9VertexDeclaration";
+    case DrawingReply::D3d9CreateIndexBuffer:
+      return "D3d9CreateIndexBuffer";
+    case DrawingReply::ReleaseD3d9IndexBuffer:
+      return "ReleaseD3d9IndexBuffer";
+    case DrawingReply::UpdateD3d9IndexBuffer:
+      return "UpdateD3d9IndexBuffer";
+    case DrawingReply::D3d9CreateVertexBuffer:
+      return "D3d9CreateVertexBuffer";
+    case DrawingReply::ReleaseD3d9VertexBuffer:
+      return "ReleaseD3d9VertexBuffer";
+    case DrawingReply::UpdateD3d9VertexBuffer:
+      return "UpdateD3d9VertexBuffer";
+    case DrawingReply::D3d9CreateTexture:
+      return "D3d9CreateTexture";
+    case DrawingReply::ReleaseD3d9Texture:
+      return "ReleaseD3d9Texture";
+    case DrawingReply::UpdateD3d9Texture:
+      return "UpdateD3d9Texture";
+    case DrawingReply::D3d9CreateVertexShader:
+      return "D3d9CreateVertexShader";
+    case DrawingReply::ReleaseD3d9VertexShader:
+      return "ReleaseD3d9VertexShader";
+    case DrawingReply::D3d9CreatePixelShader:
+      return "D3d9CreatePixelShader";
+    case DrawingReply::ReleaseD3d9PixelShader:
+      return "ReleaseD3d9PixelShader";
+    case DrawingReply::D3d9SetViewport:
+      return "D3d9SetViewport";
+    case DrawingReply::D3d9SetRenderState:
+      return "D3d9SetRenderState";
+    case DrawingReply::D3d9SetSamplerState:
+      return "D3d9SetSamplerState";
+    case DrawingReply::D3d9SetTexture:
+      return "D3d9SetTexture";
+    case DrawingReply::D3d9SetTextureStageState:
+      return "D3d9SetTextureStageState";
+    case DrawingReply::D3d9SetTransform:
+      return "D3d9SetTransform";
+    case DrawingReply::D3d9SetIndices:
+      return "D3d9SetIndices";
+    case DrawingReply::D3d9SetStreamSource:
+      return "D3d9SetStreamSource";
+    case DrawingReply::D3d9SetStreamSourceFreq:
+      return "D3d9SetStreamSourceFreq";
+    case DrawingReply::D3d9SetVertexDeclaration:
+      return "D3d9SetVertexDeclaration";
+    case DrawingReply::D3d9SetVertexShader:
+      return "D3d9SetVertexShader";
+    case DrawingReply::D3d9SetVertexShaderConstantF:
+      return "D3d9SetVertexShaderConstantF";
+    case DrawingReply::D3d9SetVertexShaderConstantI:
+      return "D3d9SetVertexShaderConstantI";
+    case DrawingReply::D3d9SetVertexShaderConstantB:
+      return "D3d9SetVertexShaderConstantB";
+    case DrawingReply::D3d9SetPixelShader:
+      return "D3d9SetPixelShader";
+    case DrawingReply::D3d9SetPixelShaderConstantB:
+      return "D3d9SetPixelShaderConstantB";
+    case DrawingReply::D3d9SetPixelShaderConstantF:
+      return "D3d9SetPixelShaderConstantF";
+    case DrawingReply::D3d9SetPixelShaderConstantI:
+      return "D3d9SetPixelShaderConstantI";
+    case DrawingReply::D3d9DrawPrimitive:
+      return "D3d9DrawPrimitive";
+    case DrawingReply::D3d9DrawIndexedPrimitive:
+      return "D3d9DrawIndexedPrimitive";
+    case DrawingReply::WaitForGpu:
+      return "WaitForGpu";
+    case DrawingReply::BeginCleanState:
+      return "BeginCleanState";
+    case DrawingReply::EndCleanState:
+      return "EndCleanState";
+    case DrawingReply::D3d9UpdateTexture:
+      return "D3d9UpdateTexture";
+    case DrawingReply::DrawPrimitiveUP:
+      return "DrawPrimitiveUP";
+    case DrawingReply::GetRenderTarget:
+      return "GetRenderTarget";
+    case DrawingReply::SetRenderTarget:
+      return "SetRenderTarget";
+    case DrawingReply::ReleaseD3d9Surface:
+      return "ReleaseD3d9Surface";
+    case DrawingReply::D3d9TextureGetSurfaceLevel:
+      return "D3d9TextureGetSurfaceLevel";
+    case DrawingReply::D3d9StretchRect:
+      return "D3d9StretchRect";
+    case DrawingReply::SetBulkChannel:
+      return "SetBulkChannel";
+    default:
+      break;
+  }
+
+  return nullptr;
+}
+
+}  // namespace interop
+}  // namespace advancedfx
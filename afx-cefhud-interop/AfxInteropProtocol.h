@@ -0,0 +1,454 @@
+#pragma once
+
+#include "AfxTransport.h"
+
+#include <stddef.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <type_traits>
+
+namespace advancedfx {
+namespace interop {
+
+// Wire format shared with HLAE. Everything in here must stay free of CEF and
+// Windows dependencies, so the benchmark and tools can use it too.
+
+enum class GameEventFieldType : int {
+  Local = 0,
+  CString = 1,
+  Float = 2,
+  Long = 3,
+  Short = 4,
+  Byte = 5,
+  Bool = 6,
+  Uint64 = 7
+};
+
+enum class EngineMessage : unsigned int {
+  Invalid = 0,
+  LevelInitPreEntity = 1,
+  LevelShutDown = 2,
+  BeforeFrameStart = 3,
+  OnRenderView = 4,
+  OnRenderViewEnd = 5,
+  BeforeFrameRenderStart = 6,
+  AfterFrameRenderStart = 7,
+  OnViewOverride = 8,
+  BeforeTranslucentShadow = 9,
+  AfterTranslucentShadow = 10,
+  BeforeTranslucent = 11,
+  AfterTranslucent = 12,
+  BeforeHud = 13,
+  AfterHud = 14,
+  GameEvent = 15,
+  ForceEndQueue = 16
+};
+
+enum class DrawingMessage : unsigned int {
+  Invalid = 0,
+  PreapareDraw = 1,
+  BeforeTranslucentShadow = 2,
+  AfterTranslucentShadow = 3,
+  BeforeTranslucent = 4,
+  AfterTranslucent = 5,
+  BeforeHud = 6,
+  AfterHud = 7,
+  OnRenderViewEnd = 8,
+
+  DeviceLost = 9,
+  DeviceRestored = 10,
+
+  // Optional first message of clients from 7.1 on: UInt32 major, minor,
+  // patch, build of the client, UInt32 offered InteropCapability_e. Answered
+  // with the server version and the agreed capabilities the same way.
+  Hello = 11,
+};
+
+// Optional protocol features, negotiated at connect time. Clients older than
+// 7.1 don't negotiate and get none of them, that is the legacy byte stream.
+enum InteropCapability_e : uint32_t {
+  // Bulk payloads may go through a shared memory ring, see SetBulkChannel.
+  InteropCapability_BulkChannel = 1 << 0,
+  // Engine connections only. Right after the capabilities the interop sends
+  // the UInt64 token of the session to resume, 0 for none, and the client
+  // answers with a Boolean whether it still has that session.
+  // If so, the interop sends the CompressedUInt32 count and Int32 ids of the
+  // game event descriptions it has, the client must send the others again.
+  // The session keeps the game event settings, so the ones that follow are
+  // a delta.
+  // If not, the interop sends the UInt64 token of the new session.
+  InteropCapability_SessionResume = 1 << 1,
+};
+
+// What this side supports on engine and drawing connections.
+const uint32_t g_EngineCapabilities =
+    InteropCapability_BulkChannel | InteropCapability_SessionResume;
+const uint32_t g_DrawingCapabilities = InteropCapability_BulkChannel;
+
+enum class PrepareDrawReply : unsigned int {
+  Skip = 1,
+  Retry = 2,
+  Continue = 3
+};
+
+enum class DrawingReply : unsigned int {
+  Skip = 1,
+  Retry = 2,
+  Continue = 3,
+  Finished = 4,
+
+  D3d9CreateVertexDeclaration = 5,
+  ReleaseD3d9VertexDeclaration = 6,
+
+  D3d9CreateIndexBuffer = 7,
+  ReleaseD3d9IndexBuffer = 8,
+  UpdateD3d9IndexBuffer = 9,
+
+  D3d9CreateVertexBuffer = 10,
+  ReleaseD3d9VertexBuffer = 11,
+  UpdateD3d9VertexBuffer = 12,
+
+  D3d9CreateTexture = 13,
+  ReleaseD3d9Texture = 14,
+  UpdateD3d9Texture = 15,
+
+  D3d9CreateVertexShader = 16,
+  ReleaseD3d9VertexShader = 17,
+
+  D3d9CreatePixelShader = 18,
+  ReleaseD3d9PixelShader = 19,
+
+  D3d9SetViewport = 20,
+  D3d9SetRenderState = 21,
+  D3d9SetSamplerState = 22,
+  D3d9SetTexture = 23,
+  D3d9SetTextureStageState = 24,
+  D3d9SetTransform = 25,
+  D3d9SetIndices = 26,
+  D3d9SetStreamSource = 27,
+  D3d9SetStreamSourceFreq = 28,
+  D3d9SetVertexDeclaration = 29,
+  D3d9SetVertexShader = 30,
+  D3d9SetVertexShaderConstantF = 31,
+  D3d9SetVertexShaderConstantI = 32,
+  D3d9SetVertexShaderConstantB = 33,
+  D3d9SetPixelShader = 34,
+  D3d9SetPixelShaderConstantB = 35,
+  D3d9SetPixelShaderConstantF = 36,
+  D3d9SetPixelShaderConstantI = 37,
+  D3d9DrawPrimitive = 38,
+  D3d9DrawIndexedPrimitive = 39,
+
+  WaitForGpu = 40,
+  BeginCleanState = 41,
+  EndCleanState = 42,
+
+  D3d9UpdateTexture = 43,
+  DrawPrimitiveUP = 44,
+
+  GetRenderTarget = 45,
+  SetRenderTarget = 46,
+
+  ReleaseD3d9Surface = 47,
+  D3d9TextureGetSurfaceLevel = 48,
+
+  D3d9StretchRect = 49,
+
+  SetBulkChannel = 50
+};
+struct Matrix4x4_s {
+  float M00;
+  float M01;
+  float M02;
+  float M03;
+  float M10;
+  float M11;
+  float M12;
+  float M13;
+  float M20;
+  float M21;
+  float M22;
+  float M23;
+  float M30;
+  float M31;
+  float M32;
+  float M33;
+
+    float operator[](size_t index) const {
+    switch (index) {
+      case 0:
+        return M00;
+      case 1:
+        return M01;
+      case 2:
+        return M02;
+      case 3:
+        return M03;
+      case 4:
+        return M10;
+      case 5:
+        return M11;
+      case 6:
+        return M12;
+      case 7:
+        return M13;
+      case 8:
+        return M20;
+      case 9:
+        return M21;
+      case 10:
+        return M22;
+      case 11:
+        return M23;
+      case 12:
+        return M30;
+      case 13:
+        return M31;
+      case 14:
+        return M32;
+      case 15:
+        return M33;
+      default:
+        return M00;
+
+    }
+  }
+
+  float& operator[](size_t index){
+      switch (index) {
+        case 0:
+            return M00;
+        case 1:
+          return M01;
+        case 2:
+          return M02;
+        case 3:
+          return M03;
+        case 4:
+          return M10;
+        case 5:
+          return M11;
+        case 6:
+          return M12;
+        case 7:
+          return M13;
+        case 8:
+          return M20;
+        case 9:
+          return M21;
+        case 10:
+          return M22;
+        case 11:
+          return M23;
+        case 12:
+          return M30;
+        case 13:
+          return M31;
+        case 14:
+          return M32;
+        case 15:
+          return M33;
+        default:
+          return M00;
+    }
+  }
+};
+
+enum RenderPassType_e {
+  RenderPassType_BeforeTranslucentShadow = 2,
+  RenderPassType_AfterTranslucentShadow = 3,
+  RenderPassType_BeforeTranslucent = 4,
+  RenderPassType_AfterTranslucent = 5
+};
+
+struct View_s {
+  int X;
+  int Y;
+  int Width;
+  int Height;
+  struct Matrix4x4_s ViewMatrix;
+  struct Matrix4x4_s ProjectionMatrix;
+};
+
+// Members are in wire order.
+struct RenderInfo_s {
+  int FrameCount;
+  float AbsoluteFrameTime;
+  float CurTime;
+  float FrameTime;
+  struct View_s View;
+};
+
+struct Vector_s {
+  float X = 0;
+  float Y = 0;
+  float Z = 0;
+};
+
+struct QAngle_s {
+  float Pitch = 0;
+  float Yaw = 0;
+  float Roll = 0;
+};
+
+// The structs above are read and written with a single copy, so their
+// layout has to be the wire layout (little endian, no padding):
+
+#define AFX_WIRE_STRUCT(type, size)                          \
+  static_assert(std::is_trivially_copyable<type>::value,     \
+                #type " must be trivially copyable.");       \
+  static_assert(sizeof(type) == (size), #type " has the wrong size.")
+
+#define AFX_WIRE_FIELD(type, field, offset)        \
+  static_assert(offsetof(type, field) == (offset), \
+                #type "::" #field " is at the wrong offset.")
+
+AFX_WIRE_STRUCT(Matrix4x4_s, 64);
+AFX_WIRE_FIELD(Matrix4x4_s, M00, 0);
+AFX_WIRE_FIELD(Matrix4x4_s, M10, 16);
+AFX_WIRE_FIELD(Matrix4x4_s, M20, 32);
+AFX_WIRE_FIELD(Matrix4x4_s, M33, 60);
+
+AFX_WIRE_STRUCT(View_s, 144);
+AFX_WIRE_FIELD(View_s, X, 0);
+AFX_WIRE_FIELD(View_s, Y, 4);
+AFX_WIRE_FIELD(View_s, Width, 8);
+AFX_WIRE_FIELD(View_s, Height, 12);
+AFX_WIRE_FIELD(View_s, ViewMatrix, 16);
+AFX_WIRE_FIELD(View_s, ProjectionMatrix, 80);
+
+AFX_WIRE_STRUCT(RenderInfo_s, 160);
+AFX_WIRE_FIELD(RenderInfo_s, FrameCount, 0);
+AFX_WIRE_FIELD(RenderInfo_s, AbsoluteFrameTime, 4);
+AFX_WIRE_FIELD(RenderInfo_s, CurTime, 8);
+AFX_WIRE_FIELD(RenderInfo_s, FrameTime, 12);
+AFX_WIRE_FIELD(RenderInfo_s, View, 16);
+
+AFX_WIRE_STRUCT(Vector_s, 12);
+AFX_WIRE_FIELD(Vector_s, X, 0);
+AFX_WIRE_FIELD(Vector_s, Y, 4);
+AFX_WIRE_FIELD(Vector_s, Z, 8);
+
+AFX_WIRE_STRUCT(QAngle_s, 12);
+AFX_WIRE_FIELD(QAngle_s, Pitch, 0);
+AFX_WIRE_FIELD(QAngle_s, Yaw, 4);
+AFX_WIRE_FIELD(QAngle_s, Roll, 8);
+
+template <class T>
+inline bool ReadWireStruct(CTransportStream& stream, T& outValue) {
+  return stream.ReadBytes(&outValue, 0, (uint32_t)sizeof(T));
+}
+
+template <class T>
+inline bool WriteWireStruct(CTransportStream& stream, const T& value) {
+  return stream.WriteBytes(&value, 0, (uint32_t)sizeof(T));
+}
+
+struct KnownGameEventKey_s {
+  std::string Key;
+  GameEventFieldType Type;
+
+  KnownGameEventKey_s(const std::string& key, GameEventFieldType fieldType)
+      : Key(key), Type(fieldType) {}
+};
+
+struct KnownGameEvent_s {
+  std::string Name;
+  std::list<KnownGameEventKey_s> Keys;
+
+  KnownGameEvent_s() {}
+};
+
+typedef std::map<int, KnownGameEvent_s> KnownGameEvents_t;
+
+// What HLAE can send along with the value of a game event key, set per key
+// with gameEventSetEnrichment. They follow the value in this order.
+enum GameEventEnrichment_e : unsigned int {
+  // UInt64.
+  GameEventEnrichment_UserIdWithSteamId = 1 << 0,
+  // Vector_s.
+  GameEventEnrichment_EntnumWithOrigin = 1 << 1,
+  // QAngle_s.
+  GameEventEnrichment_EntnumWithAngles = 1 << 2,
+  // Vector_s.
+  GameEventEnrichment_UseridWithEyePosition = 1 << 3,
+  // QAngle_s.
+  GameEventEnrichment_UseridWithEyeAngles = 1 << 4,
+};
+
+inline bool ReadMatrix4x4(CTransportStream& stream, Matrix4x4_s& outValue) {
+  return ReadWireStruct(stream, outValue);
+}
+
+inline bool WriteMatrix4x4(CTransportStream& stream, const Matrix4x4_s& value) {
+  return WriteWireStruct(stream, value);
+}
+
+/**
+ * outValue = a * b, rows times columns. For HLAE's matrices (they transform
+ * column vectors) MultiplyMatrix4x4(projection, view, out) gives the
+ * view-projection matrix.
+ */
+void MultiplyMatrix4x4(const Matrix4x4_s& a,
+                       const Matrix4x4_s& b,
+                       Matrix4x4_s& outValue);
+
+inline bool ReadView(CTransportStream& stream, View_s& outValue) {
+  return ReadWireStruct(stream, outValue);
+}
+
+inline bool WriteView(CTransportStream& stream, const View_s& value) {
+  return WriteWireStruct(stream, value);
+}
+
+/**
+ * Reads the OnRenderView payload (following the message id).
+ */
+inline bool ReadRenderInfo(CTransportStream& stream, RenderInfo_s& outValue) {
+  return ReadWireStruct(stream, outValue);
+}
+
+inline bool WriteRenderInfo(CTransportStream& stream,
+                            const RenderInfo_s& value) {
+  return WriteWireStruct(stream, value);
+}
+
+inline bool ReadVector(CTransportStream& stream, Vector_s& outValue) {
+  return ReadWireStruct(stream, outValue);
+}
+
+inline bool WriteVector(CTransportStream& stream, const Vector_s& value) {
+  return WriteWireStruct(stream, value);
+}
+
+inline bool ReadQAngle(CTransportStream& stream, QAngle_s& outValue) {
+  return ReadWireStruct(stream, outValue);
+}
+
+inline bool WriteQAngle(CTransportStream& stream, const QAngle_s& value) {
+  return WriteWireStruct(stream, value);
+}
+
+/**
+ * Reads the event id of a GameEvent message and, when HLAE sends the event
+ * for the first time, its description.
+ * @returns false on error or if the event is unknown.
+ */
+bool ReadGameEventHeader(CTransportStream& stream,
+                         KnownGameEvents_t& knownGameEvents,
+                         KnownGameEvents_t::iterator& outKnown);
+
+/**
+ * @returns the name of an EngineMessage, nullptr if opcode is none.
+ */
+const char* GetEngineMessageName(uint32_t opcode);
+
+/**
+ * @returns the name of a DrawingReply, nullptr if opcode is none.
+ */
+const char* GetDrawingReplyName(uint32_t opcode);
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,333 @@
+#include "AfxMux.h"
+
+namespace advancedfx {
+namespace interop {
+
+static const uint32_t g_MuxHeaderSize = 9;
+
+// CMuxChannel /////////////////////////////////////////////////////////////////
+
+bool CMuxChannel::ReadSome(void* bytes, uint32_t length, uint32_t& outRead) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Cv.wait(lock, [this] {
+    return m_Cancelled || m_PeerClosed || m_Head < m_Bytes.size();
+  });
+
+  size_t available = m_Bytes.size() - m_Head;
+  if (m_Cancelled || 0 == available)
+    return false;
+
+  uint32_t chunk = length < available ? length : (uint32_t)available;
+  memcpy(bytes, &m_Bytes[m_Head], chunk);
+  m_Head += chunk;
+  if (m_Head == m_Bytes.size()) {
+    m_Bytes.clear();
+    m_Head = 0;
+  }
+
+  // Granting in big steps keeps the Credit frames rare:
+  uint32_t grant = 0;
+  m_Consumed += chunk;
+  if (g_MuxWindowSize / 2 <= m_Consumed && !m_PeerClosed) {
+    grant = m_Consumed;
+    m_Consumed = 0;
+    m_PeerCredit += grant;
+  }
+
+  lock.unlock();
+
+  if (0 < grant) {
+    if (auto connection = m_Connection.lock())
+      connection->WriteFrame(m_Id, MuxFrame::Credit, &grant, sizeof(grant));
+  }
+
+  outRead = chunk;
+  return true;
+}
+
+bool CMuxChannel::WriteSome(const void* bytes,
+                            uint32_t length,
+                            uint32_t& outWritten) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Cv.wait(lock, [this] {
+    return m_Cancelled || m_Closed || m_PeerClosed || 0 < m_Credit;
+  });
+
+  if (m_Cancelled || m_Closed || m_PeerClosed)
+    return false;
+
+  uint32_t chunk = length;
+  if (m_Credit < chunk)
+    chunk = m_Credit;
+  if (g_MuxMaxFrameSize < chunk)
+    chunk = g_MuxMaxFrameSize;
+  m_Credit -= chunk;
+
+  lock.unlock();
+
+  auto connection = m_Connection.lock();
+  if (nullptr == connection ||
+      !connection->WriteFrame(m_Id, MuxFrame::Data, bytes, chunk))
+    return false;
+
+  outWritten = chunk;
+  return true;
+}
+
+bool CMuxChannel::FlushTransport() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  return !m_Cancelled && !m_Closed && !m_PeerClosed && !m_Connection.expired();
+}
+
+void CMuxChannel::Close() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  if (m_Closed)
+    return;
+
+  m_Closed = true;
+  bool peerClosed = m_PeerClosed;
+  m_Cv.notify_all();
+
+  lock.unlock();
+
+  if (auto connection = m_Connection.lock()) {
+    if (!peerClosed)
+      connection->WriteFrame(m_Id, MuxFrame::Close, nullptr, 0);
+    else
+      connection->ReleaseChannel(m_Id);
+  }
+}
+
+void CMuxChannel::Cancel() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Cancelled = true;
+  m_Cv.notify_all();
+}
+
+bool CMuxChannel::OnData(const unsigned char* bytes, uint32_t length) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  if (m_PeerCredit < length)
+    return false;
+  m_PeerCredit -= length;
+
+  // Nobody reads anymore:
+  if (m_Closed || m_Cancelled)
+    return true;
+
+  if (0 < m_Head && m_Bytes.size() <= 2 * m_Head) {
+    m_Bytes.erase(m_Bytes.begin(), m_Bytes.begin() + m_Head);
+    m_Head = 0;
+  }
+
+  m_Bytes.insert(m_Bytes.end(), bytes, bytes + length);
+  m_Cv.notify_all();
+  return true;
+}
+
+void CMuxChannel::OnCredit(uint32_t credit) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Credit += credit;
+  m_Cv.notify_all();
+}
+
+bool CMuxChannel::OnPeerClose() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_PeerClosed = true;
+  m_Cv.notify_all();
+  return m_Closed;
+}
+
+// CMuxConnection //////////////////////////////////////////////////////////////
+
+std::shared_ptr<CMuxChannel> CMuxConnection::OpenChannel() {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  if (m_Shutdown)
+    return nullptr;
+
+  uint32_t id = m_NextId;
+  m_NextId += 2;
+
+  auto channel = std::make_shared<CMuxChannel>(shared_from_this(), id);
+  m_Channels.emplace(id, channel);
+
+  lock.unlock();
+
+  if (!WriteFrame(id, MuxFrame::Open, nullptr, 0)) {
+    ReleaseChannel(id);
+    return nullptr;
+  }
+
+  return channel;
+}
+
+std::shared_ptr<CMuxChannel> CMuxConnection::AcceptChannel() {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  m_AcceptCv.wait(lock, [this] { return m_Shutdown || !m_Accepted.empty(); });
+
+  if (m_Accepted.empty())
+    return nullptr;
+
+  auto channel = m_Accepted.front();
+  m_Accepted.pop_front();
+  return channel;
+}
+
+bool CMuxConnection::Run() {
+  CReadBuffer readBuffer;
+  std::vector<unsigned char> payload;
+  bool result = true;
+
+  while (true) {
+    unsigned char header[g_MuxHeaderSize];
+    if (!readBuffer.Read(*m_Transport, header, sizeof(header)))
+      break;
+
+    uint32_t id;
+    uint32_t length;
+    memcpy(&id, &header[0], sizeof(id));
+    MuxFrame kind = (MuxFrame)header[4];
+    memcpy(&length, &header[5], sizeof(length));
+
+    if (g_MuxMaxFrameSize < length) {
+      result = false;
+      break;
+    }
+
+    payload.resize(length);
+    if (0 < length && !readBuffer.Read(*m_Transport, payload.data(), length))
+      break;
+
+    if (!Dispatch(id, kind, payload.data(), length)) {
+      result = false;
+      break;
+    }
+  }
+
+  Shutdown();
+
+  return result;
+}
+
+void CMuxConnection::Shutdown() {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  m_Shutdown = true;
+  std::map<uint32_t, std::shared_ptr<CMuxChannel>> channels;
+  channels.swap(m_Channels);
+  m_Accepted.clear();
+  m_AcceptCv.notify_all();
+
+  lock.unlock();
+
+  // Like a close by the peer, so what arrived already can still be read:
+  for (auto& it : channels)
+    it.second->OnPeerClose();
+}
+
+void CMuxConnection::OnOpenChannel(
+    const std::shared_ptr<CMuxChannel>& channel) {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  m_Accepted.push_back(channel);
+  m_AcceptCv.notify_one();
+}
+
+bool CMuxConnection::Dispatch(uint32_t id,
+                              MuxFrame kind,
+                              const unsigned char* bytes,
+                              uint32_t length) {
+  switch (kind) {
+    case MuxFrame::Open: {
+      std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+      // The peer must use its own ids and not reuse one:
+      if (0 < length || (id & 1) == (m_NextId & 1) ||
+          m_Channels.end() != m_Channels.find(id))
+        return false;
+
+      if (m_Shutdown)
+        return true;
+
+      auto channel = std::make_shared<CMuxChannel>(shared_from_this(), id);
+      m_Channels.emplace(id, channel);
+
+      lock.unlock();
+
+      OnOpenChannel(channel);
+    } break;
+    case MuxFrame::Data: {
+      // Might have been closed and released on our side already.
+      if (auto channel = FindChannel(id))
+        return channel->OnData(bytes, length);
+    } break;
+    case MuxFrame::Credit: {
+      uint32_t credit;
+      if (sizeof(credit) != length)
+        return false;
+      memcpy(&credit, bytes, sizeof(credit));
+      if (auto channel = FindChannel(id))
+        channel->OnCredit(credit);
+    } break;
+    case MuxFrame::Close: {
+      if (0 < length)
+        return false;
+      if (auto channel = FindChannel(id)) {
+        if (channel->OnPeerClose())
+          ReleaseChannel(id);
+      }
+    } break;
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+bool CMuxConnection::WriteFrame(uint32_t id,
+                                MuxFrame kind,
+                                const void* bytes,
+                                uint32_t length) {
+  std::unique_lock<std::mutex> lock(m_WriteMutex);
+
+  // One write per frame, so frames from different threads don't interleave
+  // and small frames don't cost two writes.
+  m_WriteFrame.resize(g_MuxHeaderSize + length);
+  memcpy(&m_WriteFrame[0], &id, sizeof(id));
+  m_WriteFrame[4] = (unsigned char)kind;
+  memcpy(&m_WriteFrame[5], &length, sizeof(length));
+  if (0 < length)
+    memcpy(&m_WriteFrame[g_MuxHeaderSize], bytes, length);
+
+  return m_Transport->WriteAll(m_WriteFrame.data(),
+                               (uint32_t)m_WriteFrame.size()) &&
+         m_Transport->FlushTransport();
+}
+
+std::shared_ptr<CMuxChannel> CMuxConnection::FindChannel(uint32_t id) {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  auto it = m_Channels.find(id);
+  if (m_Channels.end() == it)
+    return nullptr;
+
+  return it->second;
+}
+
+void CMuxConnection::ReleaseChannel(uint32_t id) {
+  std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+
+  m_Channels.erase(id);
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "AfxTransport.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace advancedfx {
+namespace interop {
+
+// Logical channels multiplexed over one transport:
+//
+//   UInt32 channel, UInt8 kind, UInt32 length, length bytes
+//
+// kind is a MuxFrame. Channel ids are picked by the side opening the channel,
+// the side that connected uses odd ids, the side that accepted even ones.
+//
+// Flow control is per channel: a side may have at most g_MuxWindowSize bytes
+// of Data in flight that the reading side did not consume yet, the reader
+// grants more with Credit frames. So a channel nobody reads from never stalls
+// the others.
+
+enum class MuxFrame : uint8_t {
+  // No payload.
+  Open = 1,
+  Data = 2,
+  // UInt32 bytes the sender may send additionally.
+  Credit = 3,
+  // No payload, the sender is done with the channel.
+  Close = 4
+};
+
+const uint32_t g_MuxWindowSize = 256 * 1024;
+
+const uint32_t g_MuxMaxFrameSize = 64 * 1024;
+
+class CMuxConnection;
+
+// A logical channel, usable like any other transport. Reads and writes can
+// happen on different threads at the same time.
+class CMuxChannel : public CTransport {
+ public:
+  CMuxChannel(const std::shared_ptr<CMuxConnection>& connection, uint32_t id)
+      : m_Connection(connection), m_Id(id) {}
+
+  CMuxChannel(const CMuxChannel& rhs) = delete;
+  CMuxChannel& operator=(const CMuxChannel& rhs) = delete;
+
+  uint32_t GetId() const { return m_Id; }
+
+  /**
+   * Blocks until data arrived, fails once the peer closed the channel and
+   * everything it sent has been read.
+   */
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) override;
+
+  /**
+   * Blocks while the peer's window is full.
+   */
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  // Data frames are handed to the connection as they are written.
+  virtual bool FlushTransport() override;
+
+  /**
+   * Tells the peer the channel is done and makes further writes on both
+   * sides fail. What the peer sent already can still be read.
+   */
+  void Close();
+
+  /**
+   * Makes the pending and all further calls fail. Can be called from any
+   * thread.
+   */
+  void Cancel();
+
+ private:
+  friend class CMuxConnection;
+
+  std::weak_ptr<CMuxConnection> m_Connection;
+  uint32_t m_Id;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Cv;
+
+  std::vector<unsigned char> m_Bytes;
+  size_t m_Head = 0;
+
+  // What we may still send.
+  uint32_t m_Credit = g_MuxWindowSize;
+  // What we consumed, but not granted back yet.
+  uint32_t m_Consumed = 0;
+  // What the peer may still send, to detect misbehaving peers.
+  uint32_t m_PeerCredit = g_MuxWindowSize;
+
+  bool m_Closed = false;
+  bool m_PeerClosed = false;
+  bool m_Cancelled = false;
+
+  /**
+   * Called by the connection on its reading thread.
+   * @returns false if the peer exceeded its window.
+   */
+  bool OnData(const unsigned char* bytes, uint32_t length);
+
+  void OnCredit(uint32_t credit);
+
+  /**
+   * @returns true if the channel was closed on our side too.
+   */
+  bool OnPeerClose();
+};
+
+// Owner of the shared transport. Must be held by a std::shared_ptr, the
+// channels only keep a weak reference, so they fail instead of crashing once
+// the connection is gone.
+class CMuxConnection : public std::enable_shared_from_this<CMuxConnection> {
+ public:
+  /**
+   * @param initiator true on the side that connected, false on the side that
+   * accepted.
+   */
+  CMuxConnection(CTransport* transport, bool initiator)
+      : m_Transport(transport), m_NextId(initiator ? 1 : 2) {}
+
+  virtual ~CMuxConnection() {}
+
+  CMuxConnection(const CMuxConnection& rhs) = delete;
+  CMuxConnection& operator=(const CMuxConnection& rhs) = delete;
+
+  /**
+   * Opens a new channel, this does not wait for the peer.
+   * @returns nullptr on error.
+   */
+  std::shared_ptr<CMuxChannel> OpenChannel();
+
+  /**
+   * Blocks until the peer opened a channel.
+   * @returns nullptr once the connection is shut down.
+   */
+  std::shared_ptr<CMuxChannel> AcceptChannel();
+
+  /**
+   * Reads and dispatches frames on the calling thread until the transport
+   * fails or the peer misbehaves, then shuts down.
+   * @returns false on a protocol error.
+   */
+  bool Run();
+
+  /**
+   * Makes all channels and further OpenChannel() / AcceptChannel() calls
+   * fail. Doesn't touch the transport, to get Run() to return, cancel that.
+   */
+  void Shutdown();
+
+  bool IsShutdown() {
+    std::unique_lock<std::mutex> lock(m_ChannelsMutex);
+    return m_Shutdown;
+  }
+
+ protected:
+  /**
+   * Called on the thread in Run() when the peer opened channel, must not
+   * block. Default queues it for AcceptChannel().
+   */
+  virtual void OnOpenChannel(const std::shared_ptr<CMuxChannel>& channel);
+
+ private:
+  friend class CMuxChannel;
+
+  CTransport* m_Transport;
+
+  std::mutex m_WriteMutex;
+  std::vector<unsigned char> m_WriteFrame;
+
+  std::mutex m_ChannelsMutex;
+  std::condition_variable m_AcceptCv;
+  std::map<uint32_t, std::shared_ptr<CMuxChannel>> m_Channels;
+  std::deque<std::shared_ptr<CMuxChannel>> m_Accepted;
+  uint32_t m_NextId;
+  bool m_Shutdown = false;
+
+  /**
+   * @returns false on a protocol error.
+   */
+  bool Dispatch(uint32_t id,
+                MuxFrame kind,
+                const unsigned char* bytes,
+                uint32_t length);
+
+  bool WriteFrame(uint32_t id,
+                  MuxFrame kind,
+                  const void* bytes,
+                  uint32_t length);
+
+  std::shared_ptr<CMuxChannel> FindChannel(uint32_t id);
+
+  /**
+   * Forgets channel once both sides closed it.
+   */
+  void ReleaseChannel(uint32_t id);
+};
+
+}  // namespace interop
+}  // namespace advancedfx
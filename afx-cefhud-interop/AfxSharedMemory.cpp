@@ -0,0 +1,58 @@
+#include "AfxSharedMemory.h"
+
+namespace advancedfx {
+namespace interop {
+
+// CSharedMemoryRing ///////////////////////////////////////////////////////////
+
+unsigned char* CSharedMemoryRing::Allocate(uint32_t length,
+                                           uint32_t& outOffset) {
+  if (!IsOpen() || 0 == length || GetSize() < length)
+    return nullptr;
+
+  if (m_Blocks.empty()) {
+    m_Head = 0;
+    m_Tail = 0;
+  }
+
+  uint32_t offset;
+
+  if (m_Blocks.empty() || m_Tail < m_Head) {
+    // Free space is [m_Head, size) and [0, m_Tail).
+    if (length <= GetSize() - m_Head)
+      offset = m_Head;
+    else if (length < m_Tail)
+      offset = 0;
+    else
+      return nullptr;
+  } else {
+    // Wrapped, free space is [m_Head, m_Tail).
+    if (m_Head + length < m_Tail)
+      offset = m_Head;
+    else
+      return nullptr;
+  }
+
+  m_Blocks.push_back(offset);
+  m_Head = offset + length;
+
+  outOffset = offset;
+  return m_Memory.GetData() + offset;
+}
+
+void CSharedMemoryRing::Release() {
+  if (m_Blocks.empty())
+    return;
+
+  m_Blocks.pop_front();
+
+  if (m_Blocks.empty()) {
+    m_Head = 0;
+    m_Tail = 0;
+  } else {
+    m_Tail = m_Blocks.front();
+  }
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace advancedfx {
+namespace interop {
+
+// Named memory mapping both processes can see.
+class CSharedMemory {
+ public:
+  CSharedMemory() {}
+
+  ~CSharedMemory() { Close(); }
+
+  CSharedMemory(const CSharedMemory& rhs) = delete;
+  CSharedMemory& operator=(const CSharedMemory& rhs) = delete;
+
+  /**
+   * Creates a new mapping, fails if name is already taken.
+   * @returns false on error.
+   */
+  bool Create(const char* name, uint32_t size);
+
+  /**
+   * Maps a mapping created by the peer.
+   * @returns false on error.
+   */
+  bool Open(const char* name, uint32_t size);
+
+  void Close();
+
+  bool IsOpen() const { return nullptr != m_Data; }
+
+  unsigned char* GetData() const { return m_Data; }
+
+  uint32_t GetSize() const { return m_Size; }
+
+  const std::string& GetName() const { return m_Name; }
+
+ private:
+  unsigned char* m_Data = nullptr;
+  uint32_t m_Size = 0;
+  std::string m_Name;
+#ifdef _WIN32
+  HANDLE m_Handle = NULL;
+#else
+  bool m_Owner = false;
+#endif
+};
+
+// Ring of variable sized blocks in shared memory. The writer allocates a
+// block, fills it and sends only its offset to the peer. Blocks are released
+// in the order they were allocated, once the peer replied to the message
+// referencing them.
+class CSharedMemoryRing {
+ public:
+  bool Create(const char* name, uint32_t size) {
+    Reset();
+    return m_Memory.Create(name, size);
+  }
+
+  void Close() {
+    Reset();
+    m_Memory.Close();
+  }
+
+  bool IsOpen() const { return m_Memory.IsOpen(); }
+
+  const std::string& GetName() const { return m_Memory.GetName(); }
+
+  uint32_t GetSize() const { return m_Memory.GetSize(); }
+
+  /**
+   * Reserves length contiguous bytes.
+   * @returns nullptr if there is no room (left).
+   */
+  unsigned char* Allocate(uint32_t length, uint32_t& outOffset);
+
+  /**
+   * Releases the oldest allocated block.
+   */
+  void Release();
+
+  void Reset() {
+    m_Blocks.clear();
+    m_Head = 0;
+    m_Tail = 0;
+  }
+
+ private:
+  CSharedMemory m_Memory;
+  std::deque<uint32_t> m_Blocks;
+  uint32_t m_Head = 0;
+  uint32_t m_Tail = 0;
+};
+
+}  // namespace interop
+}  // namespace advancedfx
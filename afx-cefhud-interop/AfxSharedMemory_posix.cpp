@@ -0,0 +1,90 @@
+#include "AfxSharedMemory.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace advancedfx {
+namespace interop {
+
+// CSharedMemory ///////////////////////////////////////////////////////////////
+
+// shm_open wants a single leading slash.
+static std::string GetShmName(const char* name) {
+  std::string result("/");
+  result.append('/' == name[0] ? name + 1 : name);
+  return result;
+}
+
+static unsigned char* MapShm(int fd, uint32_t size) {
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return MAP_FAILED == data ? nullptr : (unsigned char*)data;
+}
+
+bool CSharedMemory::Create(const char* name, uint32_t size) {
+  Close();
+
+  std::string shmName = GetShmName(name);
+
+  int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (-1 == fd)
+    return false;
+
+  if (-1 == ftruncate(fd, size)) {
+    close(fd);
+    shm_unlink(shmName.c_str());
+    return false;
+  }
+
+  m_Data = MapShm(fd, size);
+  close(fd);
+
+  if (nullptr == m_Data) {
+    shm_unlink(shmName.c_str());
+    return false;
+  }
+
+  m_Size = size;
+  m_Name = name;
+  m_Owner = true;
+  return true;
+}
+
+bool CSharedMemory::Open(const char* name, uint32_t size) {
+  Close();
+
+  int fd = shm_open(GetShmName(name).c_str(), O_RDWR, 0600);
+  if (-1 == fd)
+    return false;
+
+  m_Data = MapShm(fd, size);
+  close(fd);
+
+  if (nullptr == m_Data)
+    return false;
+
+  m_Size = size;
+  m_Name = name;
+  m_Owner = false;
+  return true;
+}
+
+void CSharedMemory::Close() {
+  if (nullptr != m_Data) {
+    munmap(m_Data, m_Size);
+    m_Data = nullptr;
+  }
+
+  // Like a file mapping the name goes away with its creator.
+  if (m_Owner) {
+    shm_unlink(GetShmName(m_Name.c_str()).c_str());
+    m_Owner = false;
+  }
+
+  m_Size = 0;
+  m_Name.clear();
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,73 @@
+#include "AfxSharedMemory.h"
+
+namespace advancedfx {
+namespace interop {
+
+// CSharedMemory ///////////////////////////////////////////////////////////////
+
+bool CSharedMemory::Create(const char* name, uint32_t size) {
+  Close();
+
+  m_Handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                0, size, name);
+
+  if (NULL == m_Handle)
+    return false;
+
+  if (ERROR_ALREADY_EXISTS == GetLastError()) {
+    CloseHandle(m_Handle);
+    m_Handle = NULL;
+    return false;
+  }
+
+  m_Data = (unsigned char*)MapViewOfFile(m_Handle, FILE_MAP_ALL_ACCESS, 0, 0,
+                                         size);
+
+  if (nullptr == m_Data) {
+    Close();
+    return false;
+  }
+
+  m_Size = size;
+  m_Name = name;
+  return true;
+}
+
+bool CSharedMemory::Open(const char* name, uint32_t size) {
+  Close();
+
+  m_Handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+
+  if (NULL == m_Handle)
+    return false;
+
+  m_Data = (unsigned char*)MapViewOfFile(m_Handle, FILE_MAP_ALL_ACCESS, 0, 0,
+                                         size);
+
+  if (nullptr == m_Data) {
+    Close();
+    return false;
+  }
+
+  m_Size = size;
+  m_Name = name;
+  return true;
+}
+
+void CSharedMemory::Close() {
+  if (nullptr != m_Data) {
+    UnmapViewOfFile(m_Data);
+    m_Data = nullptr;
+  }
+
+  if (NULL != m_Handle) {
+    CloseHandle(m_Handle);
+    m_Handle = NULL;
+  }
+
+  m_Size = 0;
+  m_Name.clear();
+}
+
+}  // namespace interop
+}  // namespace advancedfx
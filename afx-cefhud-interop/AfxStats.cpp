@@ -0,0 +1,56 @@
+#include "AfxStats.h"
+
+#include <chrono>
+
+namespace advancedfx {
+namespace interop {
+
+uint64_t GetStatsTimeNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// CLatencyHistogram ///////////////////////////////////////////////////////////
+
+static int GetLatencyBucket(uint64_t ns) {
+  int bucket = 0;
+  for (uint64_t us = ns / 1000; 0 != us && bucket < g_LatencyBuckets - 1;
+       us >>= 1)
+    ++bucket;
+  return bucket;
+}
+
+// Without a read-modify-write, since nobody else writes value. Readers still
+// see whole values.
+static void IncreaseExclusive(std::atomic<uint64_t>& value, uint64_t by) {
+  value.store(value.load(std::memory_order_relaxed) + by,
+              std::memory_order_relaxed);
+}
+
+void CLatencyHistogram::Add(uint64_t ns) {
+  int bucket = GetLatencyBucket(ns);
+
+  m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  m_TotalNs.fetch_add(ns, std::memory_order_relaxed);
+  m_Count.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t maxNs = m_MaxNs.load(std::memory_order_relaxed);
+  while (maxNs < ns && !m_MaxNs.compare_exchange_weak(
+                           maxNs, ns, std::memory_order_relaxed)) {
+  }
+}
+
+void CLatencyHistogram::AddExclusive(uint64_t ns) {
+  int bucket = GetLatencyBucket(ns);
+
+  IncreaseExclusive(m_Buckets[bucket], 1);
+  IncreaseExclusive(m_TotalNs, ns);
+  IncreaseExclusive(m_Count, 1);
+
+  if (m_MaxNs.load(std::memory_order_relaxed) < ns)
+    m_MaxNs.store(ns, std::memory_order_relaxed);
+}
+
+}  // namespace interop
+}  // namespace advancedfx
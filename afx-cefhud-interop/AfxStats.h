@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace advancedfx {
+namespace interop {
+
+// Buckets of a CLatencyHistogram.
+const int g_LatencyBuckets = 20;
+
+/**
+ * @returns a monotonic time in nanoseconds, for measuring durations.
+ */
+uint64_t GetStatsTimeNs();
+
+// Counts durations by their order of magnitude: bucket 0 holds the ones below
+// 1 microsecond, bucket i the ones below 2^i microseconds, the last one
+// everything longer. Any thread can add and read, reads don't see a
+// consistent snapshot though, just the counters at roughly the same time.
+class CLatencyHistogram {
+ public:
+  void Add(uint64_t ns);
+
+  /**
+   * Like Add(), but cheaper, for histograms that only one thread at a time
+   * adds to (with the hand over synchronized otherwise).
+   */
+  void AddExclusive(uint64_t ns);
+
+  uint64_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+
+  uint64_t GetTotalNs() const {
+    return m_TotalNs.load(std::memory_order_relaxed);
+  }
+
+  uint64_t GetMaxNs() const { return m_MaxNs.load(std::memory_order_relaxed); }
+
+  uint64_t GetBucket(int index) const {
+    return m_Buckets[index].load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> m_Count{0};
+  std::atomic<uint64_t> m_TotalNs{0};
+  std::atomic<uint64_t> m_MaxNs{0};
+  std::atomic<uint64_t> m_Buckets[g_LatencyBuckets] = {};
+};
+
+// Opcodes a COpcodeStats keeps apart, higher ones are not counted.
+const uint32_t g_StatsOpcodes = 64;
+
+// A CLatencyHistogram per protocol opcode.
+class COpcodeStats {
+ public:
+  void Add(uint32_t opcode, uint64_t ns) {
+    if (opcode < g_StatsOpcodes)
+      m_Opcodes[opcode].Add(ns);
+  }
+
+  const CLatencyHistogram& Get(uint32_t opcode) const {
+    return m_Opcodes[opcode];
+  }
+
+ private:
+  CLatencyHistogram m_Opcodes[g_StatsOpcodes];
+};
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,107 @@
+#include "AfxTaskPool.h"
+
+#include <chrono>
+
+namespace advancedfx {
+namespace interop {
+
+// How long threads beyond the core size wait for tasks before they end.
+static const std::chrono::seconds g_TaskPoolIdleTimeout(10);
+
+// CTaskPool ///////////////////////////////////////////////////////////////////
+
+CTaskPool& CTaskPool::Get() {
+  static CTaskPool* pool = new CTaskPool();
+  return *pool;
+}
+
+CTaskPool::CTaskPool() {
+  m_CoreSize = std::thread::hardware_concurrency();
+  if (m_CoreSize < 1)
+    m_CoreSize = 1;
+}
+
+void CTaskPool::Submit(std::function<void(void)>&& fn) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Tasks.emplace_back(std::move(fn));
+
+  if (0 < m_Idle) {
+    --m_Idle;
+    ++m_Wakeups;
+    m_Cv.notify_one();
+  } else if (m_Workers.size() - m_Ended.size() < g_TaskPoolMaxThreads) {
+    StartWorker();
+  }
+  // Else the next worker done with its task picks it up.
+}
+
+void CTaskPool::StartWorker() {
+  // These returned already or are about to:
+  for (auto& it : m_Ended) {
+    it->Thread.join();
+    m_Workers.erase(it);
+  }
+  m_Ended.clear();
+
+  // The worker waits for m_Mutex, so Thread is set before it runs.
+  auto worker = m_Workers.emplace(m_Workers.end());
+  worker->Thread = std::thread(&CTaskPool::WorkerThreadHandler, this, worker);
+}
+
+void CTaskPool::WorkerThreadHandler(std::list<CWorker>::iterator worker) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  while (true) {
+    if (!m_Tasks.empty()) {
+      std::function<void(void)> task(std::move(m_Tasks.front()));
+      m_Tasks.pop_front();
+
+      lock.unlock();
+      task();
+      task = nullptr;
+      lock.lock();
+      continue;
+    }
+
+    ++m_Idle;
+    bool woken = m_Cv.wait_for(lock, g_TaskPoolIdleTimeout,
+                               [this] { return 0 < m_Wakeups; });
+    if (woken) {
+      --m_Wakeups;
+      continue;
+    }
+
+    --m_Idle;
+    if (m_CoreSize < m_Workers.size() - m_Ended.size()) {
+      m_Ended.push_back(worker);
+      break;
+    }
+  }
+}
+
+// CPooledThread ///////////////////////////////////////////////////////////////
+
+void CPooledThread::Start(std::function<void(void)>&& fn) {
+  CTaskPool::Get().Submit([state = m_State, fn = std::move(fn)]() {
+    fn();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Done = true;
+    state->Cv.notify_all();
+  });
+}
+
+void CPooledThread::join() {
+  if (nullptr == m_State)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_State->Mutex);
+  m_State->Cv.wait(lock, [this] { return m_State->Done; });
+  lock.unlock();
+
+  m_State.reset();
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace advancedfx {
+namespace interop {
+
+// Most threads a CTaskPool starts.
+const size_t g_TaskPoolMaxThreads = 64;
+
+// The threads shared by all queues and connections of a process.
+//
+// Keeps one thread per CPU around, tasks may block (most of ours wait for
+// pipes), so when no thread is idle a new one is started for the task, up to
+// g_TaskPoolMaxThreads. Threads beyond the CPU count end after they have been
+// idle for a while, so the count follows what is running at the same time, not
+// how many queues and connections exist.
+//
+// Once the pool is saturated, tasks wait in the order they were submitted for
+// the next thread that is done with its task. Connection threads (see
+// CPooledThread) hold theirs for as long as the connection lasts, so with that
+// many connections queues stall until one ends. Tasks waiting for pipes hold
+// theirs at most for the pipe's timeout.
+class CTaskPool {
+ public:
+  static CTaskPool& Get();
+
+  /**
+   * Runs fn on one of the threads, later if all are busy and no more can be
+   * started. Can be called from any thread.
+   */
+  void Submit(std::function<void(void)>&& fn);
+
+  CTaskPool(const CTaskPool& rhs) = delete;
+  CTaskPool& operator=(const CTaskPool& rhs) = delete;
+
+ private:
+  struct CWorker {
+    std::thread Thread;
+  };
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Cv;
+  std::deque<std::function<void(void)>> m_Tasks;
+
+  std::list<CWorker> m_Workers;
+  // Ended, but not joined yet.
+  std::vector<std::list<CWorker>::iterator> m_Ended;
+  size_t m_CoreSize;
+  // Waiting for tasks and not woken yet.
+  size_t m_Idle = 0;
+  // Woken, but didn't pick up yet.
+  size_t m_Wakeups = 0;
+
+  CTaskPool();
+
+  // Never destroyed, threads might still use it while the process exits.
+  ~CTaskPool() {}
+
+  void StartWorker();
+
+  void WorkerThreadHandler(std::list<CWorker>::iterator worker);
+};
+
+// Like a std::thread, but runs on the CTaskPool, so the thread is reused once
+// the function returned.
+class CPooledThread {
+ public:
+  CPooledThread() {}
+
+  template <class Fn, class... Args>
+  explicit CPooledThread(Fn&& fn, Args&&... args)
+      : m_State(std::make_shared<CState>()) {
+    Start(std::bind(std::forward<Fn>(fn), std::forward<Args>(args)...));
+  }
+
+  CPooledThread(CPooledThread&& rhs) = default;
+  CPooledThread& operator=(CPooledThread&& rhs) = default;
+
+  CPooledThread(const CPooledThread& rhs) = delete;
+  CPooledThread& operator=(const CPooledThread& rhs) = delete;
+
+  bool joinable() const { return nullptr != m_State; }
+
+  /**
+   * Waits until the function returned. Must not be called from it.
+   */
+  void join();
+
+  void detach() { m_State.reset(); }
+
+ private:
+  struct CState {
+    std::mutex Mutex;
+    std::condition_variable Cv;
+    bool Done = false;
+  };
+
+  std::shared_ptr<CState> m_State;
+
+  void Start(std::function<void(void)>&& fn);
+};
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,220 @@
+#include "AfxThreadedQueue.h"
+
+#include "AfxTaskPool.h"
+
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || \
+    defined(__x86_64__)
+#include <immintrin.h>
+#define AFX_CPU_PAUSE() _mm_pause()
+#else
+#define AFX_CPU_PAUSE() ((void)0)
+#endif
+
+namespace advancedfx {
+namespace interop {
+
+// How often a queue that ran empty checks for tasks before it parks, roughly
+// 10 - 50 us.
+static const int g_TaskQueueSpins = 1024;
+
+// CThreadedQueue //////////////////////////////////////////////////////////////
+
+CThreadedQueue::CThreadedQueue()
+    : m_Spins(1 < std::thread::hardware_concurrency() ? g_TaskQueueSpins : 0) {
+}
+
+CThreadedQueue::~CThreadedQueue() {
+  Abort();
+
+  // Destroy what never ran:
+  for (CLane& lane : m_Lanes) {
+    while (nullptr != lane.First) {
+      CTaskNode* node = lane.First;
+      lane.First = node->Next;
+      node->Finish(node, false);
+      delete node;
+    }
+  }
+
+  while (nullptr != m_FreeNodes) {
+    CTaskNode* node = m_FreeNodes;
+    m_FreeNodes = node->Next;
+    delete node;
+  }
+}
+
+void CThreadedQueue::Abort() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  m_Quit = true;
+  m_TaskCv.notify_all();
+  m_RunCv.wait(lock, [this] { return !m_Scheduled; });
+}
+
+CThreadedQueue::Wake_e CThreadedQueue::Push(CTaskNode* node, Lane_e lane) {
+  node->Next = nullptr;
+  // Only changes under m_Mutex:
+  node->Ticket = m_NextTicket.load(std::memory_order_relaxed);
+  m_NextTicket.store(node->Ticket + 1, std::memory_order_relaxed);
+
+  CLane& to = m_Lanes[lane];
+  if (nullptr == to.Last)
+    to.First = node;
+  else
+    to.Last->Next = node;
+  to.Last = node;
+
+  if (m_Quit)
+    return Wake_None;
+
+  // One wake up is enough:
+  if (m_Parked) {
+    m_Parked = false;
+    return Wake_Parked;
+  }
+
+  if (m_Scheduled)
+    return Wake_None;
+
+  m_Scheduled = true;
+  return Wake_Schedule;
+}
+
+void CThreadedQueue::Schedule() {
+  CTaskPool::Get().Submit([this]() { Run(); });
+}
+
+CTaskNode* CThreadedQueue::PopNext() {
+  CLane& regular = m_Lanes[Lane_Regular];
+  CLane& deferred = m_Lanes[Lane_Deferred];
+
+  CTaskNode* next = regular.First;
+  CTaskNode* nextDeferred = deferred.First;
+
+  CLane* lane = &regular;
+
+  if (nullptr == nextDeferred) {
+    m_Overtaken = 0;
+  } else if (nullptr == next ||
+             (next->Barrier && nextDeferred->Ticket < next->Ticket) ||
+             g_TaskDeferLimit <= m_Overtaken) {
+    m_Overtaken = 0;
+    lane = &deferred;
+    next = nextDeferred;
+  } else {
+    ++m_Overtaken;
+  }
+
+  if (nullptr == next)
+    return nullptr;
+
+  lane->First = next->Next;
+  if (nullptr == lane->First)
+    lane->Last = nullptr;
+
+  return next;
+}
+
+bool CThreadedQueue::SpinForTasks(std::unique_lock<std::mutex>& lock) {
+  if (0 == m_Spins)
+    return false;
+
+  // Producers don't wake us meanwhile, since we are neither parked nor
+  // unscheduled:
+  uint64_t queued = m_NextTicket.load(std::memory_order_relaxed);
+  lock.unlock();
+
+  bool queuedMore = false;
+  for (int i = 0; i < m_Spins && !queuedMore; ++i) {
+    AFX_CPU_PAUSE();
+    queuedMore = queued != m_NextTicket.load(std::memory_order_relaxed);
+  }
+
+  lock.lock();
+  return queuedMore;
+}
+
+void CThreadedQueue::Run(void) {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  // When the task before ended, if we didn't wait since.
+  uint64_t endedAt = 0;
+
+  while (!m_Quit) {
+    CTaskNode* next = PopNext();
+    if (nullptr == next) {
+      endedAt = 0;
+      if (SpinForTasks(lock))
+        continue;
+
+      // Tasks tend to come in bursts, waiting a bit saves a trip through
+      // the pool:
+      m_Parked = true;
+      bool woken = m_TaskCv.wait_for(lock, g_TaskParkTime, [this] {
+        return m_Quit || !IsEmpty();
+      });
+      m_Parked = false;
+
+      if (!woken)
+        break;
+      continue;
+    }
+
+    m_RunningTicket = next->Ticket;
+
+    lock.unlock();
+
+    // Saves reading the clock for tasks that run back to back, the
+    // histograms are ours alone, since there is only one Run() at a time:
+    uint64_t startedAt = 0 != endedAt ? endedAt : GetStatsTimeNs();
+    if (startedAt < next->QueuedAt)
+      startedAt = next->QueuedAt;
+    m_WaitStats.AddExclusive(startedAt - next->QueuedAt);
+
+    if (nullptr != m_Observer)
+      m_Observer->OnTaskBegin();
+
+    next->Finish(next, true);
+
+    endedAt = GetStatsTimeNs();
+    uint64_t runNs = endedAt - startedAt;
+    m_RunStats.AddExclusive(runNs);
+
+    if (nullptr != m_Observer)
+      m_Observer->OnTaskEnd(runNs);
+
+    lock.lock();
+
+    next->Next = m_FreeNodes;
+    m_FreeNodes = next;
+    ++m_FreeCount;
+  }
+
+  // The burst is over, what it needed beyond the usual can go:
+  CTaskNode* unused = nullptr;
+  if (g_TaskFreeNodes < m_FreeCount) {
+    CTaskNode* last = m_FreeNodes;
+    for (size_t i = 1; i < g_TaskFreeNodes; ++i)
+      last = last->Next;
+    unused = last->Next;
+    last->Next = nullptr;
+    m_FreeCount = g_TaskFreeNodes;
+  }
+
+  m_Scheduled = false;
+
+  // Abort() may destroy us once we let go of m_Mutex.
+  m_RunCv.notify_all();
+  lock.unlock();
+
+  while (nullptr != unused) {
+    CTaskNode* node = unused;
+    unused = node->Next;
+    delete node;
+  }
+}
+
+}  // namespace interop
+}  // namespace advancedfx
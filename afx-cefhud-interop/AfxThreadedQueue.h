@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdint.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "AfxStats.h"
+
+namespace advancedfx {
+namespace interop {
+
+// Closures up to this size are stored in the queue's nodes, bigger ones are
+// moved to the heap.
+const size_t g_TaskInlineSize = 96;
+
+// Nodes a queue keeps for reuse once it hands its thread back, the ones a
+// burst needed beyond that are freed.
+const size_t g_TaskFreeNodes = 64;
+
+// Regular tasks that may overtake a waiting deferred one.
+const int g_TaskDeferLimit = 16;
+
+// How long a queue that ran empty keeps its pool thread, waiting for more
+// tasks, before it hands it back.
+const std::chrono::microseconds g_TaskParkTime(100);
+
+struct CTaskNode {
+  CTaskNode* Next;
+
+  // Order in which the tasks were queued, across lanes.
+  uint64_t Ticket;
+  bool Barrier;
+  // GetStatsTimeNs() when it was queued.
+  uint64_t QueuedAt;
+
+  // Runs the task if run is true and destroys it.
+  void (*Finish)(CTaskNode* node, bool run);
+
+  alignas(std::max_align_t) unsigned char Storage[g_TaskInlineSize];
+};
+
+// Is told about each task a CThreadedQueue runs, on the thread running it.
+class CTaskObserver {
+ public:
+  virtual void OnTaskBegin() = 0;
+
+  virtual void OnTaskEnd(uint64_t runNs) = 0;
+};
+
+// Runs tasks one after the other, on the threads of the CTaskPool. Any thread
+// can queue.
+//
+// Tasks run in the order they were queued, except for deferred ones: these
+// wait while regular tasks are queued (even ones queued after them), so work
+// nothing waits for can't delay work that something waits for. Deferred tasks
+// still run in order among themselves, before any barrier queued after them,
+// and at the latest after g_TaskDeferLimit regular ones.
+//
+// The closures are stored in nodes the queue recycles, so queueing usually
+// doesn't allocate. Both lanes are guarded by one mutex, which is only held to
+// link and unlink nodes, not while a task runs. The queue only takes a pool
+// thread while it has tasks: once it ran empty, it spins briefly, then waits
+// g_TaskParkTime for more and then hands the thread back. Queueing to a queue
+// without a thread hands it to the pool again.
+class CThreadedQueue {
+ public:
+  CThreadedQueue();
+  ~CThreadedQueue();
+
+  /**
+   * Waits for the running task, tasks still queued and queued from now on
+   * are not run. Must not be called from a task.
+   */
+  void Abort();
+
+  template <class Fn>
+  void Queue(Fn&& fn) {
+    Add(std::forward<Fn>(fn), Lane_Regular, false);
+  }
+
+  /**
+   * Queues fn behind the regular tasks, for work whose order relative to
+   * them doesn't matter.
+   */
+  template <class Fn>
+  void QueueDeferred(Fn&& fn) {
+    Add(std::forward<Fn>(fn), Lane_Deferred, false);
+  }
+
+  /**
+   * Queues a regular task that runs only after the deferred tasks queued
+   * before it, for tasks that change what the deferred ones work on.
+   */
+  template <class Fn>
+  void QueueBarrier(Fn&& fn) {
+    Add(std::forward<Fn>(fn), Lane_Regular, true);
+  }
+
+  /**
+   * Cancels the tasks queued so far: they still run, so they can settle what
+   * waits for them, but IsCancelled() tells them to skip their work. Can be
+   * called from any thread.
+   */
+  void Cancel() {
+    m_CancelTicket.store(m_NextTicket.load(std::memory_order_relaxed));
+  }
+
+  /**
+   * @returns true if the running task was queued before Cancel(). Must be
+   * called from a task.
+   */
+  bool IsCancelled() const { return m_RunningTicket < m_CancelTicket.load(); }
+
+  /**
+   * Must be set before the first task is queued, observer must outlive the
+   * queue or its Abort().
+   */
+  void SetObserver(CTaskObserver* observer) { m_Observer = observer; }
+
+  /**
+   * @returns the number of tasks queued so far.
+   */
+  uint64_t GetQueued() const {
+    return m_NextTicket.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @returns how long the started tasks waited after being queued, its
+   * count is the number of tasks started so far.
+   */
+  const CLatencyHistogram& GetWaitStats() const { return m_WaitStats; }
+
+  /**
+   * @returns how long the tasks took to run.
+   */
+  const CLatencyHistogram& GetRunStats() const { return m_RunStats; }
+
+  CThreadedQueue(const CThreadedQueue& rhs) = delete;
+  CThreadedQueue& operator=(const CThreadedQueue& rhs) = delete;
+  CThreadedQueue(CThreadedQueue&& rhs) = delete;
+  CThreadedQueue& operator=(CThreadedQueue&& rhs) = delete;
+
+ private:
+  enum Lane_e { Lane_Regular = 0, Lane_Deferred = 1, Lane_Count = 2 };
+
+  struct CLane {
+    // Runs next.
+    CTaskNode* First = nullptr;
+    // Producers append here.
+    CTaskNode* Last = nullptr;
+  };
+
+  const int m_Spins;
+
+  // Guards the lanes, the free nodes, m_NextTicket changing, m_Overtaken,
+  // m_Scheduled, m_Parked and m_Quit.
+  std::mutex m_Mutex;
+  CLane m_Lanes[Lane_Count];
+  // Already run, for reuse.
+  CTaskNode* m_FreeNodes = nullptr;
+  size_t m_FreeCount = 0;
+  std::atomic<uint64_t> m_NextTicket{0};
+  // Tasks with a lower ticket are cancelled.
+  std::atomic<uint64_t> m_CancelTicket{0};
+  uint64_t m_RunningTicket = 0;
+  // Regular tasks run while deferred ones were waiting.
+  int m_Overtaken = 0;
+
+  CTaskObserver* m_Observer = nullptr;
+  CLatencyHistogram m_WaitStats;
+  CLatencyHistogram m_RunStats;
+
+  // Handed to the pool and not done running yet.
+  bool m_Scheduled = false;
+  // Ran empty and waits for tasks on m_TaskCv.
+  bool m_Parked = false;
+  bool m_Quit = false;
+  std::condition_variable m_TaskCv;
+  std::condition_variable m_RunCv;
+
+  // What Add() has to do once the task is linked.
+  enum Wake_e { Wake_None, Wake_Parked, Wake_Schedule };
+
+  template <class Fn>
+  void Add(Fn&& fn, Lane_e lane, bool barrier) {
+    typedef typename std::decay<Fn>::type Task_t;
+
+    uint64_t queuedAt = GetStatsTimeNs();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    CTaskNode* node = AllocateNode(lock);
+    Emplace<Task_t>(node, std::forward<Fn>(fn), IsInline_t<Task_t>());
+    node->Barrier = barrier;
+    node->QueuedAt = queuedAt;
+
+    Wake_e wake = Push(node, lane);
+
+    lock.unlock();
+
+    if (Wake_Parked == wake)
+      m_TaskCv.notify_one();
+    else if (Wake_Schedule == wake)
+      Schedule();
+  }
+
+  template <class Task_t>
+  using IsInline_t =
+      std::integral_constant<bool,
+                             sizeof(Task_t) <= g_TaskInlineSize &&
+                                 alignof(Task_t) <= alignof(std::max_align_t)>;
+
+  // lock must hold m_Mutex, it is let go of while allocating.
+  CTaskNode* AllocateNode(std::unique_lock<std::mutex>& lock) {
+    CTaskNode* node = m_FreeNodes;
+    if (nullptr != node) {
+      m_FreeNodes = node->Next;
+      --m_FreeCount;
+      return node;
+    }
+
+    lock.unlock();
+    node = new CTaskNode();
+    lock.lock();
+    return node;
+  }
+
+  template <class Task_t, class Fn>
+  static void Emplace(CTaskNode* node, Fn&& fn, std::true_type) {
+    new (node->Storage) Task_t(std::forward<Fn>(fn));
+    node->Finish = [](CTaskNode* node, bool run) {
+      Task_t* task = reinterpret_cast<Task_t*>(node->Storage);
+      if (run)
+        (*task)();
+      task->~Task_t();
+    };
+  }
+
+  template <class Task_t, class Fn>
+  static void Emplace(CTaskNode* node, Fn&& fn, std::false_type) {
+    *reinterpret_cast<Task_t**>(node->Storage) =
+        new Task_t(std::forward<Fn>(fn));
+    node->Finish = [](CTaskNode* node, bool run) {
+      Task_t* task = *reinterpret_cast<Task_t**>(node->Storage);
+      if (run)
+        (*task)();
+      delete task;
+    };
+  }
+
+  // Must hold m_Mutex.
+  Wake_e Push(CTaskNode* node, Lane_e lane);
+
+  void Schedule();
+
+  /**
+   * Unlinks the task to run next. Must hold m_Mutex.
+   * @returns nullptr if the queue is empty.
+   */
+  CTaskNode* PopNext();
+
+  /**
+   * lock must hold m_Mutex, it is let go of while spinning. Doesn't spin on
+   * machines with a single CPU.
+   * @returns true if tasks were queued meanwhile.
+   */
+  bool SpinForTasks(std::unique_lock<std::mutex>& lock);
+
+  // Must hold m_Mutex.
+  bool IsEmpty() const {
+    return nullptr == m_Lanes[Lane_Regular].First &&
+           nullptr == m_Lanes[Lane_Deferred].First;
+  }
+
+  // Runs on a pool thread while m_Scheduled is set.
+  void Run(void);
+};
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,340 @@
+#include "AfxTransport.h"
+
+#include <chrono>
+
+namespace advancedfx {
+namespace interop {
+
+bool CTransport::ReadAll(void* bytes, uint32_t length) {
+  unsigned char* p = static_cast<unsigned char*>(bytes);
+  bool result = true;
+
+  BeginRead();
+
+  while (0 < length) {
+    uint32_t bytesRead = 0;
+    if (!ReadSome(p, length, bytesRead)) {
+      result = false;
+      break;
+    }
+    p += bytesRead;
+    length -= bytesRead;
+  }
+
+  EndRead();
+
+  return result;
+}
+
+bool CTransport::WriteAll(const void* bytes, uint32_t length) {
+  const unsigned char* p = static_cast<const unsigned char*>(bytes);
+  bool result = true;
+
+  BeginWrite();
+
+  while (0 < length) {
+    uint32_t bytesWritten = 0;
+    if (!WriteSome(p, length, bytesWritten)) {
+      result = false;
+      break;
+    }
+    p += bytesWritten;
+    length -= bytesWritten;
+  }
+
+  EndWrite();
+
+  return result;
+}
+
+// CEndpointTransport //////////////////////////////////////////////////////////
+
+static uint64_t GetSteadyMs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t CEndpointTransport::GetDeadline(uint32_t timeoutMs) {
+  if (AFX_INFINITE_TIMEOUT == timeoutMs)
+    return 0;
+
+  return GetSteadyMs() + timeoutMs;
+}
+
+uint32_t CEndpointTransport::GetTimeLeftMs(uint64_t deadline) {
+  if (0 == deadline)
+    return AFX_INFINITE_TIMEOUT;
+
+  uint64_t now = GetSteadyMs();
+
+  // Still try once when it's up, the data might be there already:
+  return now < deadline ? (uint32_t)(deadline - now) : 0;
+}
+
+bool CWriteBuffer::WriteTo(CTransport& transport) {
+  if (m_Bytes.empty())
+    return true;
+
+  bool result = transport.WriteAll(m_Bytes.data(), (uint32_t)m_Bytes.size());
+
+  m_Bytes.clear();
+
+  return result;
+}
+
+bool CReadBuffer::ReadSlow(CTransport& transport,
+                           void* bytes,
+                           uint32_t length) {
+  unsigned char* p = static_cast<unsigned char*>(bytes);
+  bool result = true;
+
+  // The deadline is for the whole value, not for each part of it:
+  transport.BeginRead();
+
+  while (0 < length) {
+    if (0 == m_Count) {
+      // Big payloads go straight to the destination, no point in copying.
+      if (Capacity() / 2 <= length) {
+        uint32_t bytesRead = 0;
+        if (!transport.ReadSome(p, length, bytesRead)) {
+          result = false;
+          break;
+        }
+        p += bytesRead;
+        length -= bytesRead;
+        continue;
+      }
+
+      if (!Fill(transport)) {
+        result = false;
+        break;
+      }
+    }
+
+    uint32_t chunk = Capacity() - m_Head;
+    if (m_Count < chunk)
+      chunk = m_Count;
+    if (length < chunk)
+      chunk = length;
+
+    memcpy(p, &m_Bytes[m_Head], chunk);
+    Consume(chunk);
+    p += chunk;
+    length -= chunk;
+  }
+
+  transport.EndRead();
+
+  return result;
+}
+
+bool CReadBuffer::Fill(CTransport& transport) {
+  if (m_Count == Capacity())
+    return true;
+
+  uint32_t tail = m_Head + m_Count;
+  if (tail >= Capacity())
+    tail -= Capacity();
+
+  uint32_t free = (m_Head <= tail ? Capacity() : m_Head) - tail;
+
+  uint32_t bytesRead = 0;
+  if (!transport.ReadSome(&m_Bytes[tail], free, bytesRead))
+    return false;
+
+  m_Count += bytesRead;
+  return true;
+}
+
+// StringViewHash_s ////////////////////////////////////////////////////////////
+
+size_t StringViewHash_s::operator()(const StringView_s& value) const {
+  // FNV-1a
+  uint32_t result = 2166136261u;
+  for (uint32_t i = 0; i < value.Length; ++i) {
+    result ^= (unsigned char)value.Data[i];
+    result *= 16777619u;
+  }
+  return result;
+}
+
+// CStringArena ////////////////////////////////////////////////////////////////
+
+char* CStringArena::AllocateSlow(uint32_t length, uint32_t alignment) {
+  while (m_Chunk + 1 < m_Chunks.size()) {
+    Chunk_s& chunk = m_Chunks[++m_Chunk];
+    char* result = Align(chunk.Bytes.get(), alignment);
+    m_End = chunk.Bytes.get() + chunk.Size;
+    if (result <= m_End && (uintptr_t)(m_End - result) >= length) {
+      m_Next = result + length;
+      return result;
+    }
+  }
+
+  // Big enough for length wherever new char[] puts it:
+  uint32_t size = length + alignment - 1;
+
+  Chunk_s chunk;
+  chunk.Size = m_ChunkSize < size ? size : m_ChunkSize;
+  chunk.Bytes.reset(new char[chunk.Size]);
+  m_Chunks.emplace_back(std::move(chunk));
+  m_Chunk = m_Chunks.size() - 1;
+
+  char* result = Align(m_Chunks.back().Bytes.get(), alignment);
+  m_Next = result + length;
+  m_End = m_Chunks.back().Bytes.get() + m_Chunks.back().Size;
+  return result;
+}
+
+// CTransportStream ////////////////////////////////////////////////////////////
+
+bool CTransportStream::ReadBytes(void* bytes,
+                                 uint32_t offset,
+                                 uint32_t length) {
+  // The peer won't answer before it got the whole request:
+  if (!WritePending())
+    return false;
+
+  if (m_Sent) {
+    m_Sent = false;
+    Count(m_RoundTrips, 1);
+  }
+
+  m_RequestPending = false;
+
+  if (!m_ReadBuffer.Read(*m_Transport, (unsigned char*)bytes + offset,
+                         length)) {
+    m_Failed = true;
+    return false;
+  }
+
+  Count(m_BytesRead, length);
+  return true;
+}
+
+bool CTransportStream::ReadBoolean(bool& outValue) {
+  uint8_t tmp;
+
+  if (ReadBytes(&tmp, 0, sizeof(tmp))) {
+    outValue = 0 != tmp;
+    return true;
+  }
+
+  return false;
+}
+
+bool CTransportStream::ReadCompressedUInt32(uint32_t& outValue) {
+  uint8_t value;
+
+  if (!ReadByte(value))
+    return false;
+
+  if (value < 255) {
+    outValue = value;
+    return true;
+  }
+
+  return ReadUInt32(outValue);
+}
+
+bool CTransportStream::ReadCompressedInt32(int32_t& outValue) {
+  signed char value;
+
+  if (!ReadSByte(value))
+    return false;
+
+  if (value < 127) {
+    outValue = value;
+    return true;
+  }
+
+  return ReadInt32(outValue);
+}
+
+bool CTransportStream::ReadStringUTF8(std::string& outValue) {
+  uint32_t length;
+
+  if (!ReadCompressedUInt32(length))
+    return false;
+
+  outValue.resize(length);
+
+  if (0 < length && !ReadBytes(&outValue[0], 0, length))
+    return false;
+
+  return true;
+}
+
+bool CTransportStream::ReadStringUTF8(CStringArena& arena,
+                                      StringView_s& outValue) {
+  uint32_t length;
+
+  if (!ReadCompressedUInt32(length))
+    return false;
+
+  char* bytes = arena.Allocate(length);
+
+  if (0 < length && !ReadBytes(bytes, 0, length))
+    return false;
+
+  outValue.Data = bytes;
+  outValue.Length = length;
+  return true;
+}
+
+bool CTransportStream::Flush() {
+  if (!WritePending())
+    return false;
+
+  if (!m_Transport->FlushTransport()) {
+    m_Failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool CTransportStream::Send() {
+  return WritePending();
+}
+
+bool CTransportStream::WritePending() {
+  size_t size = m_WriteBuffer.Size();
+  if (0 == size)
+    return true;
+
+  if (!m_WriteBuffer.WriteTo(*m_Transport)) {
+    m_Failed = true;
+    return false;
+  }
+
+  m_Sent = true;
+  Count(m_BytesWritten, size);
+  return true;
+}
+
+bool CTransportStream::WriteCompressedUInt32(uint32_t value) {
+  if (value <= 255 - 1) {
+    return WriteByte((uint8_t)value);
+  } else {
+    return WriteByte(255) && WriteUInt32(value);
+  }
+}
+
+bool CTransportStream::WriteCompressedInt32(int32_t value) {
+  if (-128 <= value && value <= 127 - 1) {
+    return WriteSByte((signed char)value);
+  } else {
+    return WriteSByte(127) && WriteInt32(value);
+  }
+}
+
+bool CTransportStream::WriteStringUTF8(const std::string& value) {
+  uint32_t length = (uint32_t)value.length();
+
+  return WriteCompressedUInt32(length) && WriteBytes(value.c_str(), 0, length);
+}
+
+}  // namespace interop
+}  // namespace advancedfx
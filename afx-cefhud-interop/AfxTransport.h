@@ -0,0 +1,727 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define TEN_MINUTES_IN_MILLISECONDS (10*60*1000)
+
+#define AFX_INFINITE_TIMEOUT 0xFFFFFFFF
+
+namespace advancedfx {
+namespace interop {
+
+// Raw byte stream the interop protocol is spoken over.
+class CTransport {
+ public:
+  virtual ~CTransport() {}
+
+  /**
+   * Reads at least one and at most length bytes.
+   * @returns false on error.
+   */
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) = 0;
+
+  /**
+   * Writes at least one and at most length bytes.
+   * @returns false on error.
+   */
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) = 0;
+
+  /**
+   * Waits until the peer has picked up everything written so far, if the
+   * transport supports that.
+   * @returns false on error.
+   */
+  virtual bool FlushTransport() = 0;
+
+  /**
+   * Makes the ReadSome calls until EndRead() one read, so a timeout of the
+   * transport is for all of them together and not for each.
+   */
+  virtual void BeginRead() {}
+
+  virtual void EndRead() {}
+
+  /**
+   * Like BeginRead(), but for WriteSome.
+   */
+  virtual void BeginWrite() {}
+
+  virtual void EndWrite() {}
+
+  bool ReadAll(void* bytes, uint32_t length);
+
+  bool WriteAll(const void* bytes, uint32_t length);
+};
+
+// Collects the primitives written between two flushes into one contiguous
+// frame, so a frame costs a single write on the transport. The wire format is
+// unchanged, the peer can not tell the difference.
+class CWriteBuffer {
+ public:
+  CWriteBuffer() { m_Bytes.reserve(4096); }
+
+  void Append(const void* bytes, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    m_Bytes.insert(m_Bytes.end(), p, p + length);
+  }
+
+  bool Empty() const { return m_Bytes.empty(); }
+
+  size_t Size() const { return m_Bytes.size(); }
+
+  const unsigned char* Data() const { return m_Bytes.data(); }
+
+  void Clear() { m_Bytes.clear(); }
+
+  /**
+   * Hands the collected frame to the transport. The buffer is empty
+   * afterwards, also on error.
+   * @returns false on error.
+   */
+  bool WriteTo(CTransport& transport);
+
+ private:
+  std::vector<unsigned char> m_Bytes;
+};
+
+// Read-ahead ring: a single read on the transport picks up as much as the
+// peer has sent (up to the capacity), the typed readers are then served from
+// memory.
+class CReadBuffer {
+ public:
+  explicit CReadBuffer(uint32_t capacity = 64 * 1024)
+      : m_Bytes(capacity) {}
+
+  /**
+   * Only blocks on the transport if the buffered bytes are not enough.
+   * @returns false on error.
+   */
+  bool Read(CTransport& transport, void* bytes, uint32_t length) {
+    if (length <= m_Count && length <= Capacity() - m_Head) {
+      memcpy(bytes, &m_Bytes[m_Head], length);
+      Consume(length);
+      return true;
+    }
+
+    return ReadSlow(transport, bytes, length);
+  }
+
+  uint32_t Available() const { return m_Count; }
+
+  /**
+   * Drops everything buffered, use when the transport is re-opened.
+   */
+  void Clear() {
+    m_Head = 0;
+    m_Count = 0;
+  }
+
+ private:
+  std::vector<unsigned char> m_Bytes;
+  uint32_t m_Head = 0;
+  uint32_t m_Count = 0;
+
+  uint32_t Capacity() const { return (uint32_t)m_Bytes.size(); }
+
+  void Consume(uint32_t length) {
+    m_Head += length;
+    if (m_Head >= Capacity())
+      m_Head -= Capacity();
+    m_Count -= length;
+    if (0 == m_Count)
+      m_Head = 0;
+  }
+
+  bool ReadSlow(CTransport& transport, void* bytes, uint32_t length);
+
+  bool Fill(CTransport& transport);
+};
+
+// String bytes owned by a CStringArena, not 0-terminated.
+struct StringView_s {
+  const char* Data = nullptr;
+  uint32_t Length = 0;
+
+  std::string ToString() const { return std::string(Data, Length); }
+};
+
+// Hashes and compares StringView_s keys of unordered containers by content.
+struct StringViewHash_s {
+  size_t operator()(const StringView_s& value) const;
+};
+
+struct StringViewEqual_s {
+  bool operator()(const StringView_s& lhs, const StringView_s& rhs) const {
+    return lhs.Length == rhs.Length &&
+           0 == memcmp(lhs.Data, rhs.Data, lhs.Length);
+  }
+};
+
+// Bump allocator for the strings of a message. Clear() keeps the chunks, so
+// decoding into a reused arena doesn't allocate once it has grown.
+class CStringArena {
+ public:
+  explicit CStringArena(uint32_t chunkSize = 4096) : m_ChunkSize(chunkSize) {}
+
+  CStringArena(const CStringArena& rhs) = delete;
+  CStringArena& operator=(const CStringArena& rhs) = delete;
+
+  /**
+   * @param alignment power of 2.
+   */
+  char* Allocate(uint32_t length, uint32_t alignment = 1) {
+    char* result = Align(m_Next, alignment);
+    if (nullptr == m_Next || m_End < result ||
+        (uintptr_t)(m_End - result) < length)
+      return AllocateSlow(length, alignment);
+    m_Next = result + length;
+    return result;
+  }
+
+  StringView_s Store(const char* bytes, uint32_t length) {
+    StringView_s result;
+    result.Data = Allocate(length);
+    result.Length = length;
+    memcpy((char*)result.Data, bytes, length);
+    return result;
+  }
+
+  StringView_s Store(const std::string& value) {
+    return Store(value.c_str(), (uint32_t)value.length());
+  }
+
+  /**
+   * Invalidates all views handed out so far.
+   */
+  void Clear() {
+    m_Chunk = 0;
+    if (!m_Chunks.empty()) {
+      m_Next = m_Chunks[0].Bytes.get();
+      m_End = m_Next + m_Chunks[0].Size;
+    }
+  }
+
+ private:
+  struct Chunk_s {
+    std::unique_ptr<char[]> Bytes;
+    uint32_t Size;
+  };
+
+  uint32_t m_ChunkSize;
+  std::vector<Chunk_s> m_Chunks;
+  size_t m_Chunk = 0;
+  // Free bytes of m_Chunks[m_Chunk].
+  char* m_Next = nullptr;
+  char* m_End = nullptr;
+
+  static char* Align(char* p, uint32_t alignment) {
+    return (char*)(((uintptr_t)p + alignment - 1) &
+                   ~(uintptr_t)(alignment - 1));
+  }
+
+  char* AllocateSlow(uint32_t length, uint32_t alignment);
+};
+
+// Opcode of a request that wrote none, see CTransportStream::BeginRequest().
+const uint32_t g_NoOpcode = 0xFFFFFFFF;
+
+// Typed protocol primitives on top of a transport. Writes are collected until
+// Flush() or Send(), reads are served from the read-ahead.
+//
+// One thread at a time uses a stream, the counters can be read from any.
+class CTransportStream {
+ public:
+  explicit CTransportStream(CTransport* transport = nullptr)
+      : m_Transport(transport) {}
+
+  virtual ~CTransportStream() {}
+
+  CTransport* GetTransport() const { return m_Transport; }
+
+  void SetTransport(CTransport* transport) {
+    m_Transport = transport;
+    ResetBuffers();
+  }
+
+  /**
+   * Drops pending writes and buffered reads.
+   */
+  void ResetBuffers() {
+    m_WriteBuffer.Clear();
+    m_ReadBuffer.Clear();
+    m_Sent = false;
+    m_Failed = false;
+  }
+
+  /**
+   * @returns true if a read or write on the transport failed since the last
+   *   ResetBuffers(), what is pending might be half a frame then.
+   */
+  bool GetFailed() const { return m_Failed; }
+
+  /**
+   * @returns the bytes handed to the transport so far.
+   */
+  uint64_t GetBytesWritten() const {
+    return m_BytesWritten.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @returns the bytes read so far.
+   */
+  uint64_t GetBytesRead() const {
+    return m_BytesRead.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @returns how often reading had to wait for the peer's answer to what was
+   * written before.
+   */
+  uint64_t GetRoundTrips() const {
+    return m_RoundTrips.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Takes the next UInt32 written as the opcode of a new request, unless
+   * something is read before.
+   */
+  void BeginRequest() {
+    m_RequestPending = true;
+    m_RequestOpcode = g_NoOpcode;
+  }
+
+  /**
+   * @returns the opcode since BeginRequest(), g_NoOpcode if there is none.
+   */
+  uint32_t GetRequestOpcode() const { return m_RequestOpcode; }
+
+  bool ReadBytes(void* bytes, uint32_t offset, uint32_t length);
+
+  bool ReadBoolean(bool& outValue);
+
+  bool ReadByte(uint8_t& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadSByte(signed char& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadInt16(int16_t& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadUInt32(uint32_t& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadCompressedUInt32(uint32_t& outValue);
+
+  bool ReadInt32(int32_t& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadCompressedInt32(int32_t& outValue);
+
+  bool ReadStringUTF8(std::string& outValue);
+
+  /**
+   * Reads a string into arena, outValue stays valid until the arena is
+   * cleared.
+   */
+  bool ReadStringUTF8(CStringArena& arena, StringView_s& outValue);
+
+  bool ReadUInt64(uint64_t& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool ReadSingle(float& outValue) {
+    return ReadBytes(&outValue, 0, (uint32_t)sizeof(outValue));
+  }
+
+  bool WriteBytes(const void* bytes, uint32_t offset, uint32_t length) {
+    m_WriteBuffer.Append((const unsigned char*)bytes + offset, length);
+    return true;
+  }
+
+  /**
+   * Sends everything written so far and waits until the peer picked it up.
+   */
+  bool Flush();
+
+  /**
+   * Hands what was written so far to the transport without waiting for the
+   * peer to pick it up.
+   */
+  bool Send();
+
+  bool WriteBoolean(bool value) {
+    uint8_t tmp = value ? 1 : 0;
+    return WriteBytes(&tmp, 0, sizeof(tmp));
+  }
+
+  bool WriteByte(uint8_t value) { return WriteBytes(&value, 0, sizeof(value)); }
+
+  bool WriteSByte(signed char value) {
+    return WriteBytes(&value, 0, sizeof(value));
+  }
+
+  bool WriteUInt32(uint32_t value) {
+    if (m_RequestPending) {
+      m_RequestPending = false;
+      m_RequestOpcode = value;
+    }
+    return WriteBytes(&value, 0, sizeof(value));
+  }
+
+  bool WriteCompressedUInt32(uint32_t value);
+
+  bool WriteInt32(int32_t value) {
+    return WriteBytes(&value, 0, sizeof(value));
+  }
+
+  bool WriteCompressedInt32(int32_t value);
+
+  bool WriteUInt64(uint64_t value) {
+    return WriteBytes(&value, 0, sizeof(value));
+  }
+
+  bool WriteSingle(float value) { return WriteBytes(&value, 0, sizeof(value)); }
+
+  bool WriteStringUTF8(const std::string& value);
+
+ private:
+  CTransport* m_Transport;
+
+  CWriteBuffer m_WriteBuffer;
+
+  CReadBuffer m_ReadBuffer;
+
+  std::atomic<uint64_t> m_BytesWritten{0};
+  std::atomic<uint64_t> m_BytesRead{0};
+  std::atomic<uint64_t> m_RoundTrips{0};
+  // Wrote to the transport since the last read.
+  bool m_Sent = false;
+  bool m_Failed = false;
+
+  bool m_RequestPending = false;
+  uint32_t m_RequestOpcode = g_NoOpcode;
+
+  /**
+   * Hands m_WriteBuffer to the transport.
+   */
+  bool WritePending();
+
+  static void Count(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+};
+
+// Transport that is established by name, either by listening for a peer or
+// by connecting to one.
+class CEndpointTransport : public CTransport {
+ public:
+  /**
+   * Creates the listening end for name.
+   * @returns false on error.
+   */
+  virtual bool Listen(const char* name) = 0;
+
+  /**
+   * Blocks until a peer connected to the listening end.
+   * @returns false on error.
+   */
+  virtual bool Accept() = 0;
+
+  /**
+   * Connects to the peer listening on name.
+   * @returns false on error.
+   */
+  virtual bool Open(const char* name) = 0;
+
+  /**
+   * Like Open(), but if nobody listens on name yet, waits until someone
+   * does. Can be cancelled.
+   * @returns false on error or timeout.
+   */
+  virtual bool OpenWhenReady(const char* name, uint32_t timeoutMs) = 0;
+
+  virtual bool IsOpen() const = 0;
+
+  virtual void Close() = 0;
+
+  /**
+   * Makes the pending and all further calls fail, until the next Listen() or
+   * Open(). Can be called from any thread.
+   */
+  virtual void Cancel() = 0;
+
+  /**
+   * Timeout for a read or write, AFX_INFINITE_TIMEOUT waits forever. A read
+   * is a ReadSome call or everything between BeginRead() and EndRead(), the
+   * same goes for writes. Accept() has no deadline, but can be cancelled.
+   */
+  void SetTimeouts(uint32_t readTimeoutMs, uint32_t writeTimeoutMs) {
+    m_ReadTimeoutMs = readTimeoutMs;
+    m_WriteTimeoutMs = writeTimeoutMs;
+  }
+
+  /**
+   * @returns true if the last failed call ran into its deadline.
+   */
+  bool GetTimedOut() const { return m_TimedOut; }
+
+  virtual void BeginRead() override {
+    m_ReadDeadline = GetDeadline(m_ReadTimeoutMs);
+  }
+
+  virtual void EndRead() override { m_ReadDeadline = 0; }
+
+  virtual void BeginWrite() override {
+    m_WriteDeadline = GetDeadline(m_WriteTimeoutMs);
+  }
+
+  virtual void EndWrite() override { m_WriteDeadline = 0; }
+
+ protected:
+  uint32_t m_ReadTimeoutMs = AFX_INFINITE_TIMEOUT;
+  uint32_t m_WriteTimeoutMs = AFX_INFINITE_TIMEOUT;
+  // Reads and writes may run on different threads.
+  std::atomic<bool> m_TimedOut{false};
+
+  /**
+   * @returns the deadline of the current read, 0 if there is none.
+   */
+  uint64_t GetReadDeadline() const {
+    return 0 != m_ReadDeadline ? m_ReadDeadline : GetDeadline(m_ReadTimeoutMs);
+  }
+
+  /**
+   * @returns the deadline of the current write, 0 if there is none.
+   */
+  uint64_t GetWriteDeadline() const {
+    return 0 != m_WriteDeadline ? m_WriteDeadline
+                                : GetDeadline(m_WriteTimeoutMs);
+  }
+
+  /**
+   * @returns the steady clock time in ms timeoutMs from now, 0 for
+   *   AFX_INFINITE_TIMEOUT.
+   */
+  static uint64_t GetDeadline(uint32_t timeoutMs);
+
+  /**
+   * @returns the ms left until deadline, AFX_INFINITE_TIMEOUT for 0.
+   */
+  static uint32_t GetTimeLeftMs(uint64_t deadline);
+
+ private:
+  // Only touched by the thread reading or writing respectively.
+  uint64_t m_ReadDeadline = 0;
+  uint64_t m_WriteDeadline = 0;
+};
+
+#ifdef _WIN32
+
+// Windows named pipe, name is relative to \\.\pipe\. Uses overlapped I/O, so
+// calls can time out or be cancelled. A read and a write can be pending at
+// the same time.
+class CNamedPipeTransport : public CEndpointTransport {
+ public:
+  CNamedPipeTransport();
+  virtual ~CNamedPipeTransport();
+
+  virtual bool Listen(const char* name) override;
+  virtual bool Accept() override;
+
+  /**
+   * Like Listen(), but for Accept(outPeer), which can hand out any number of
+   * peers.
+   * @returns false on error.
+   */
+  bool ListenShared(const char* name);
+
+  /**
+   * Blocks until a peer connected and hands the connection to outPeer, this
+   * keeps listening for the next one.
+   * @returns false on error.
+   */
+  bool Accept(CNamedPipeTransport& outPeer);
+  virtual bool Open(const char* name) override;
+  virtual bool OpenWhenReady(const char* name, uint32_t timeoutMs) override;
+  virtual bool IsOpen() const override {
+    return INVALID_HANDLE_VALUE != m_Handle;
+  }
+  virtual void Close() override;
+  virtual void Cancel() override;
+
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) override;
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  // The pipes are created without buffers, so a write only completes once
+  // the peer took the data. FlushFileBuffers can't be waited on with a
+  // deadline, so it is not used.
+  virtual bool FlushTransport() override { return IsOpen(); }
+
+  HANDLE GetHandle() const { return m_Handle; }
+
+  DWORD GetErrorCode() const { return m_LastError; }
+
+  // Blocking primitives shared with the handle based pipe classes, they
+  // invalidate handle if it turns out to be invalid.
+
+  static bool ReadSome(HANDLE& handle,
+                       DWORD& outLastError,
+                       void* bytes,
+                       uint32_t length,
+                       uint32_t& outRead);
+
+  static bool WriteSome(HANDLE& handle,
+                        DWORD& outLastError,
+                        const void* bytes,
+                        uint32_t length,
+                        uint32_t& outWritten);
+
+  static bool FlushTransport(HANDLE& handle, DWORD& outLastError);
+
+  /**
+   * Named event that is set whenever a server end for the pipe is created,
+   * clients wait on it instead of polling for the pipe to appear. Works with
+   * both relative and full pipe names.
+   * @returns NULL on error.
+   */
+  static HANDLE CreateReadyEvent(const char* name);
+
+ private:
+  struct Io_s {
+    OVERLAPPED Overlapped;
+    HANDLE Event;
+  };
+
+  HANDLE m_Handle = INVALID_HANDLE_VALUE;
+  std::atomic<DWORD> m_LastError{ERROR_SUCCESS};
+  std::string m_ListenName;
+  DWORD m_MaxInstances = 1;
+  HANDLE m_ReadyEvent = NULL;
+  Io_s m_ReadIo;
+  Io_s m_WriteIo;
+  HANDLE m_CancelEvent;
+
+  bool CreateInstance();
+
+  bool Connect(const std::string& pipeName);
+
+  bool BeginIo(Io_s& io);
+
+  bool EndIo(Io_s& io, BOOL result, uint32_t timeoutMs, DWORD& outBytes);
+};
+
+typedef CNamedPipeTransport CPlatformEndpointTransport;
+
+#else
+
+// Unix domain stream socket. Relative names are placed in $XDG_RUNTIME_DIR
+// (or /tmp). Non-blocking, waits in poll() together with a cancel pipe.
+class CUnixSocketTransport : public CEndpointTransport {
+ public:
+  CUnixSocketTransport();
+  virtual ~CUnixSocketTransport();
+
+  virtual bool Listen(const char* name) override;
+  virtual bool Accept() override;
+
+  /**
+   * Like Listen(), but for Accept(outPeer), which can hand out any number of
+   * peers.
+   * @returns false on error.
+   */
+  bool ListenShared(const char* name);
+
+  /**
+   * Blocks until a peer connected and hands the connection to outPeer, this
+   * keeps listening for the next one.
+   * @returns false on error.
+   */
+  bool Accept(CUnixSocketTransport& outPeer);
+
+  virtual bool Open(const char* name) override;
+
+  /**
+   * There is nothing to wait on for a socket path to appear, so this retries
+   * with a short backoff.
+   */
+  virtual bool OpenWhenReady(const char* name, uint32_t timeoutMs) override;
+
+  virtual bool IsOpen() const override { return -1 != m_Fd || -1 != m_ListenFd; }
+  virtual void Close() override;
+  virtual void Cancel() override;
+
+  virtual bool ReadSome(void* bytes, uint32_t length, uint32_t& outRead) override;
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override;
+
+  // Sockets have nothing like FlushFileBuffers.
+  virtual bool FlushTransport() override { return -1 != m_Fd; }
+
+  int GetFd() const { return m_Fd; }
+
+  int GetErrorCode() const { return m_LastError; }
+
+  /**
+   * Connects two unnamed sockets to each other (socketpair).
+   * @returns false on error.
+   */
+  static bool CreatePair(CUnixSocketTransport& a, CUnixSocketTransport& b);
+
+  static std::string GetSocketPath(const char* name);
+
+ private:
+  int m_Fd = -1;
+  int m_ListenFd = -1;
+  std::atomic<int> m_LastError{0};
+  std::string m_ListenPath;
+  std::atomic<bool> m_Cancelled{false};
+  int m_CancelFds[2];
+
+  void ResetCancel();
+
+  bool Listen(const char* name, int backlog);
+
+  bool Connect(const char* name);
+
+  /**
+   * @returns -1 on error.
+   */
+  int AcceptFd();
+
+  /**
+   * @returns false on error, timeout or cancellation.
+   */
+  bool Wait(int fd, short events, uint32_t timeoutMs);
+};
+
+typedef CUnixSocketTransport CPlatformEndpointTransport;
+
+#endif
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,466 @@
+#include "AfxTransport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+
+namespace advancedfx {
+namespace interop {
+
+// CUnixSocketTransport ////////////////////////////////////////////////////////
+
+std::string CUnixSocketTransport::GetSocketPath(const char* name) {
+  if ('/' == name[0])
+    return name;
+
+  const char* dir = getenv("XDG_RUNTIME_DIR");
+  if (nullptr == dir || '\0' == dir[0])
+    dir = "/tmp";
+
+  std::string result(dir);
+  result.append("/");
+  result.append(name);
+  return result;
+}
+
+static bool MakeSocketAddress(const std::string& path, sockaddr_un& outAddr) {
+  if (sizeof(outAddr.sun_path) <= path.length())
+    return false;
+
+  memset(&outAddr, 0, sizeof(outAddr));
+  outAddr.sun_family = AF_UNIX;
+  memcpy(outAddr.sun_path, path.c_str(), path.length() + 1);
+  return true;
+}
+
+static void SetNoSigPipe(int fd) {
+#ifdef SO_NOSIGPIPE
+  int value = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof(value));
+#else
+  (void)fd;
+#endif
+}
+
+static void SetNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Removes the socket file at addr if nobody listens on it anymore, i.e. it is
+// left over from a crashed process. A named pipe does not outlive its owner,
+// but it can't be taken over from a running one either.
+// @returns 0 if addr is free now, an errno otherwise.
+static int RemoveStaleSocket(const sockaddr_un& addr) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == fd)
+    return errno;
+
+  // Non-blocking, so a full backlog doesn't stall the probe:
+  SetNonBlocking(fd);
+
+  int result = 0;
+  if (-1 == connect(fd, (const sockaddr*)&addr, sizeof(addr))) {
+    if (ECONNREFUSED == errno) {
+      if (-1 == unlink(addr.sun_path) && ENOENT != errno)
+        result = errno;
+    } else if (ENOENT != errno) {
+      result = EADDRINUSE;
+    }
+  } else {
+    result = EADDRINUSE;
+  }
+
+  close(fd);
+  return result;
+}
+
+CUnixSocketTransport::CUnixSocketTransport() {
+  if (-1 == pipe(m_CancelFds)) {
+    m_CancelFds[0] = -1;
+    m_CancelFds[1] = -1;
+  } else {
+    SetNonBlocking(m_CancelFds[0]);
+    SetNonBlocking(m_CancelFds[1]);
+  }
+}
+
+CUnixSocketTransport::~CUnixSocketTransport() {
+  Close();
+
+  if (-1 != m_CancelFds[0]) {
+    close(m_CancelFds[0]);
+    close(m_CancelFds[1]);
+  }
+}
+
+void CUnixSocketTransport::Cancel() {
+  m_Cancelled = true;
+
+  if (-1 != m_CancelFds[1]) {
+    char value = 1;
+    while (-1 == write(m_CancelFds[1], &value, 1) && EINTR == errno)
+      ;
+  }
+}
+
+void CUnixSocketTransport::ResetCancel() {
+  m_Cancelled = false;
+
+  if (-1 != m_CancelFds[0]) {
+    char buffer[64];
+    while (0 < read(m_CancelFds[0], buffer, sizeof(buffer)))
+      ;
+  }
+}
+
+bool CUnixSocketTransport::Wait(int fd, short events, uint32_t timeoutMs) {
+  m_TimedOut = false;
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeoutMs);
+
+  while (true) {
+    int waitMs = -1;
+    if (AFX_INFINITE_TIMEOUT != timeoutMs) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      waitMs = 0 < left ? (int)left : 0;
+    }
+
+    pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = events;
+    fds[0].revents = 0;
+    fds[1].fd = m_CancelFds[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    int result = poll(fds, 2, waitMs);
+
+    if (-1 == result) {
+      if (EINTR == errno)
+        continue;
+      m_LastError = errno;
+      return false;
+    }
+
+    if (0 == result) {
+      m_TimedOut = true;
+      m_LastError = ETIMEDOUT;
+      return false;
+    }
+
+    if (fds[1].revents) {
+      m_LastError = ECANCELED;
+      return false;
+    }
+
+    // Errors and hang-ups are reported by the following call.
+    return true;
+  }
+}
+
+bool CUnixSocketTransport::Listen(const char* name) {
+  return Listen(name, 1);
+}
+
+bool CUnixSocketTransport::ListenShared(const char* name) {
+  return Listen(name, SOMAXCONN);
+}
+
+bool CUnixSocketTransport::Listen(const char* name, int backlog) {
+  if (IsOpen())
+    return false;
+
+  ResetCancel();
+
+  std::string path = GetSocketPath(name);
+  sockaddr_un addr;
+  if (!MakeSocketAddress(path, addr)) {
+    m_LastError = ENAMETOOLONG;
+    return false;
+  }
+
+  int error = RemoveStaleSocket(addr);
+  if (0 != error) {
+    m_LastError = error;
+    return false;
+  }
+
+  m_ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == m_ListenFd) {
+    m_LastError = errno;
+    return false;
+  }
+
+  if (-1 == bind(m_ListenFd, (sockaddr*)&addr, sizeof(addr)) ||
+      -1 == listen(m_ListenFd, backlog)) {
+    m_LastError = errno;
+    close(m_ListenFd);
+    m_ListenFd = -1;
+    return false;
+  }
+
+  SetNonBlocking(m_ListenFd);
+
+  m_ListenPath = path;
+  return true;
+}
+
+bool CUnixSocketTransport::Accept() {
+  if (-1 == m_ListenFd || -1 != m_Fd)
+    return false;
+
+  m_Fd = AcceptFd();
+  if (-1 == m_Fd)
+    return false;
+
+  // Single instance, same as the named pipe.
+  close(m_ListenFd);
+  m_ListenFd = -1;
+
+  return true;
+}
+
+bool CUnixSocketTransport::Accept(CUnixSocketTransport& outPeer) {
+  if (-1 == m_ListenFd || outPeer.IsOpen())
+    return false;
+
+  int fd = AcceptFd();
+  if (-1 == fd)
+    return false;
+
+  outPeer.ResetCancel();
+  outPeer.m_Fd = fd;
+  return true;
+}
+
+int CUnixSocketTransport::AcceptFd() {
+  int fd;
+
+  while (true) {
+    if (!Wait(m_ListenFd, POLLIN, AFX_INFINITE_TIMEOUT))
+      return -1;
+
+    fd = accept(m_ListenFd, nullptr, nullptr);
+
+    if (-1 != fd)
+      break;
+
+    if (EINTR != errno && EAGAIN != errno && EWOULDBLOCK != errno &&
+        ECONNABORTED != errno) {
+      m_LastError = errno;
+      return -1;
+    }
+  }
+
+  SetNoSigPipe(fd);
+  SetNonBlocking(fd);
+
+  return fd;
+}
+
+bool CUnixSocketTransport::Open(const char* name) {
+  if (IsOpen())
+    return false;
+
+  ResetCancel();
+
+  return Connect(name);
+}
+
+bool CUnixSocketTransport::OpenWhenReady(const char* name, uint32_t timeoutMs) {
+  if (IsOpen())
+    return false;
+
+  ResetCancel();
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(timeoutMs);
+  uint32_t backoffMs = 1;
+
+  while (!Connect(name)) {
+    // Not there yet or not listening yet:
+    if (ENOENT != m_LastError && ECONNREFUSED != m_LastError)
+      return false;
+
+    uint32_t waitMs = backoffMs;
+    if (AFX_INFINITE_TIMEOUT != timeoutMs) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      if (left <= 0) {
+        m_TimedOut = true;
+        m_LastError = ETIMEDOUT;
+        return false;
+      }
+      if (left < waitMs)
+        waitMs = (uint32_t)left;
+    }
+
+    // Only the cancel pipe is polled, so timing out is the normal case:
+    if (!Wait(-1, 0, waitMs) && !m_TimedOut)
+      return false;
+
+    if (backoffMs < 32)
+      backoffMs *= 2;
+  }
+
+  m_TimedOut = false;
+  return true;
+}
+
+bool CUnixSocketTransport::Connect(const char* name) {
+  sockaddr_un addr;
+  if (!MakeSocketAddress(GetSocketPath(name), addr)) {
+    m_LastError = ENAMETOOLONG;
+    return false;
+  }
+
+  m_Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == m_Fd) {
+    m_LastError = errno;
+    return false;
+  }
+
+  if (-1 == connect(m_Fd, (sockaddr*)&addr, sizeof(addr))) {
+    m_LastError = errno;
+    close(m_Fd);
+    m_Fd = -1;
+    return false;
+  }
+
+  SetNoSigPipe(m_Fd);
+  SetNonBlocking(m_Fd);
+
+  return true;
+}
+
+void CUnixSocketTransport::Close() {
+  if (-1 != m_Fd) {
+    close(m_Fd);
+    m_Fd = -1;
+  }
+
+  if (-1 != m_ListenFd) {
+    close(m_ListenFd);
+    m_ListenFd = -1;
+  }
+
+  if (!m_ListenPath.empty()) {
+    unlink(m_ListenPath.c_str());
+    m_ListenPath.clear();
+  }
+}
+
+bool CUnixSocketTransport::ReadSome(void* bytes,
+                                    uint32_t length,
+                                    uint32_t& outRead) {
+  if (-1 == m_Fd) {
+    m_LastError = EBADF;
+    return false;
+  }
+
+  uint64_t deadline = GetReadDeadline();
+  ssize_t result;
+
+  while (true) {
+    if (m_Cancelled) {
+      m_LastError = ECANCELED;
+      return false;
+    }
+
+    result = recv(m_Fd, bytes, length, 0);
+
+    if (-1 != result)
+      break;
+
+    if (EAGAIN == errno || EWOULDBLOCK == errno) {
+      if (!Wait(m_Fd, POLLIN, GetTimeLeftMs(deadline)))
+        return false;
+    } else if (EINTR != errno) {
+      m_LastError = errno;
+      return false;
+    }
+  }
+
+  if (0 == result) {
+    // Peer closed, ReadFile fails with ERROR_BROKEN_PIPE in that case.
+    m_LastError = EPIPE;
+    return false;
+  }
+
+  outRead = (uint32_t)result;
+  return true;
+}
+
+bool CUnixSocketTransport::WriteSome(const void* bytes,
+                                     uint32_t length,
+                                     uint32_t& outWritten) {
+  if (-1 == m_Fd) {
+    m_LastError = EBADF;
+    return false;
+  }
+
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  flags |= MSG_NOSIGNAL;
+#endif
+
+  uint64_t deadline = GetWriteDeadline();
+  ssize_t result;
+
+  while (true) {
+    if (m_Cancelled) {
+      m_LastError = ECANCELED;
+      return false;
+    }
+
+    result = send(m_Fd, bytes, length, flags);
+
+    if (-1 != result)
+      break;
+
+    if (EAGAIN == errno || EWOULDBLOCK == errno) {
+      if (!Wait(m_Fd, POLLOUT, GetTimeLeftMs(deadline)))
+        return false;
+    } else if (EINTR != errno) {
+      m_LastError = errno;
+      return false;
+    }
+  }
+
+  outWritten = (uint32_t)result;
+  return true;
+}
+
+bool CUnixSocketTransport::CreatePair(CUnixSocketTransport& a,
+                                      CUnixSocketTransport& b) {
+  if (a.IsOpen() || b.IsOpen())
+    return false;
+
+  int fds[2];
+  if (-1 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+    a.m_LastError = b.m_LastError = errno;
+    return false;
+  }
+
+  SetNoSigPipe(fds[0]);
+  SetNoSigPipe(fds[1]);
+  SetNonBlocking(fds[0]);
+  SetNonBlocking(fds[1]);
+
+  a.m_Fd = fds[0];
+  b.m_Fd = fds[1];
+  return true;
+}
+
+}  // namespace interop
+}  // namespace advancedfx
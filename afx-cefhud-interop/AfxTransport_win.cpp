@@ -0,0 +1,401 @@
+#include "AfxTransport.h"
+
+namespace advancedfx {
+namespace interop {
+
+// CNamedPipeTransport /////////////////////////////////////////////////////////
+
+CNamedPipeTransport::CNamedPipeTransport() {
+  m_ReadIo.Event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  m_WriteIo.Event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  m_CancelEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+}
+
+CNamedPipeTransport::~CNamedPipeTransport() {
+  Close();
+  CloseHandle(m_CancelEvent);
+  CloseHandle(m_WriteIo.Event);
+  CloseHandle(m_ReadIo.Event);
+}
+
+bool CNamedPipeTransport::Listen(const char* name) {
+  if (INVALID_HANDLE_VALUE != m_Handle)
+    return false;
+
+  ResetEvent(m_CancelEvent);
+
+  m_ListenName = "\\\\.\\pipe\\";
+  m_ListenName.append(name);
+  m_MaxInstances = 1;
+  m_ReadyEvent = CreateReadyEvent(name);
+
+  return CreateInstance();
+}
+
+bool CNamedPipeTransport::ListenShared(const char* name) {
+  if (INVALID_HANDLE_VALUE != m_Handle)
+    return false;
+
+  ResetEvent(m_CancelEvent);
+
+  m_ListenName = "\\\\.\\pipe\\";
+  m_ListenName.append(name);
+  m_MaxInstances = PIPE_UNLIMITED_INSTANCES;
+  m_ReadyEvent = CreateReadyEvent(name);
+
+  return CreateInstance();
+}
+
+bool CNamedPipeTransport::CreateInstance() {
+  m_Handle = CreateNamedPipeA(m_ListenName.c_str(),
+                              PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                              PIPE_READMODE_BYTE | PIPE_TYPE_BYTE | PIPE_WAIT |
+                                  PIPE_REJECT_REMOTE_CLIENTS,
+                              m_MaxInstances, 0, 0, TEN_MINUTES_IN_MILLISECONDS,
+                              nullptr);
+
+  if (INVALID_HANDLE_VALUE == m_Handle) {
+    m_LastError = ::GetLastError();
+    return false;
+  }
+
+  // Wake up clients waiting in OpenWhenReady():
+  if (NULL != m_ReadyEvent)
+    SetEvent(m_ReadyEvent);
+
+  return true;
+}
+
+HANDLE CNamedPipeTransport::CreateReadyEvent(const char* name) {
+  std::string pipeName(name);
+  if (0 == pipeName.compare(0, 9, "\\\\.\\pipe\\"))
+    pipeName.erase(0, 9);
+
+  // Backslashes are reserved in kernel object names:
+  for (auto& c : pipeName) {
+    if ('\\' == c)
+      c = '/';
+  }
+
+  std::string eventName("Local\\afx-cefhud-interop_ready_");
+  eventName.append(pipeName);
+
+  return CreateEventA(nullptr, TRUE, FALSE, eventName.c_str());
+}
+
+bool CNamedPipeTransport::Accept() {
+  if (!BeginIo(m_ReadIo))
+    return false;
+
+  BOOL result = ConnectNamedPipe(m_Handle, &m_ReadIo.Overlapped);
+
+  if (!result && ERROR_PIPE_CONNECTED == ::GetLastError())
+    return true;
+
+  DWORD bytes;
+  return EndIo(m_ReadIo, result, AFX_INFINITE_TIMEOUT, bytes);
+}
+
+bool CNamedPipeTransport::Accept(CNamedPipeTransport& outPeer) {
+  if (outPeer.IsOpen() || !Accept())
+    return false;
+
+  ResetEvent(outPeer.m_CancelEvent);
+  outPeer.m_Handle = m_Handle;
+
+  // If this fails, the next Accept() will:
+  CreateInstance();
+
+  return true;
+}
+
+bool CNamedPipeTransport::Open(const char* name) {
+  if (INVALID_HANDLE_VALUE != m_Handle)
+    return false;
+
+  ResetEvent(m_CancelEvent);
+
+  std::string strPipeName("\\\\.\\pipe\\");
+  strPipeName.append(name);
+
+  return Connect(strPipeName);
+}
+
+bool CNamedPipeTransport::OpenWhenReady(const char* name, uint32_t timeoutMs) {
+  if (INVALID_HANDLE_VALUE != m_Handle)
+    return false;
+
+  ResetEvent(m_CancelEvent);
+  m_TimedOut = false;
+
+  std::string strPipeName("\\\\.\\pipe\\");
+  strPipeName.append(name);
+
+  HANDLE readyEvent = CreateReadyEvent(name);
+  if (NULL == readyEvent) {
+    m_LastError = ::GetLastError();
+    return false;
+  }
+
+  ULONGLONG deadline = GetTickCount64() + timeoutMs;
+  bool result = false;
+
+  while (true) {
+    // Reset before trying, so a server showing up in between is not missed:
+    ResetEvent(readyEvent);
+
+    if (Connect(strPipeName)) {
+      result = true;
+      break;
+    }
+
+    DWORD waitMs = INFINITE;
+    if (AFX_INFINITE_TIMEOUT != timeoutMs) {
+      ULONGLONG now = GetTickCount64();
+      waitMs = now < deadline ? (DWORD)(deadline - now) : 0;
+    }
+
+    if (ERROR_PIPE_BUSY == m_LastError) {
+      // All instances taken, this waits for one to free up:
+      if (!WaitNamedPipeA(strPipeName.c_str(),
+                          INFINITE == waitMs ? NMPWAIT_WAIT_FOREVER
+                                             : (0 < waitMs ? waitMs : 1))) {
+        DWORD lastError = ::GetLastError();
+        if (ERROR_SEM_TIMEOUT == lastError) {
+          m_TimedOut = true;
+          m_LastError = ERROR_TIMEOUT;
+          break;
+        }
+        // Gone in between, try again.
+        if (ERROR_FILE_NOT_FOUND != lastError) {
+          m_LastError = lastError;
+          break;
+        }
+      }
+      if (WAIT_OBJECT_0 == WaitForSingleObject(m_CancelEvent, 0)) {
+        m_LastError = ERROR_OPERATION_ABORTED;
+        break;
+      }
+      continue;
+    }
+
+    if (ERROR_FILE_NOT_FOUND != m_LastError)
+      break;
+
+    HANDLE handles[2] = {readyEvent, m_CancelEvent};
+    DWORD waitResult = WaitForMultipleObjects(2, handles, FALSE, waitMs);
+
+    if (WAIT_TIMEOUT == waitResult) {
+      m_TimedOut = true;
+      m_LastError = ERROR_TIMEOUT;
+      break;
+    }
+    if (WAIT_OBJECT_0 != waitResult) {
+      m_LastError =
+          WAIT_FAILED == waitResult ? ::GetLastError() : ERROR_OPERATION_ABORTED;
+      break;
+    }
+  }
+
+  CloseHandle(readyEvent);
+
+  return result;
+}
+
+bool CNamedPipeTransport::Connect(const std::string& strPipeName) {
+  m_Handle = CreateFileA(strPipeName.c_str(), GENERIC_WRITE | GENERIC_READ, 0,
+                         nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+
+  if (INVALID_HANDLE_VALUE == m_Handle) {
+    m_LastError = ::GetLastError();
+    return false;
+  }
+
+  return true;
+}
+
+void CNamedPipeTransport::Close() {
+  if (INVALID_HANDLE_VALUE != m_Handle) {
+    CloseHandle(m_Handle);
+    m_Handle = INVALID_HANDLE_VALUE;
+  }
+
+  if (NULL != m_ReadyEvent) {
+    ResetEvent(m_ReadyEvent);
+    CloseHandle(m_ReadyEvent);
+    m_ReadyEvent = NULL;
+  }
+}
+
+void CNamedPipeTransport::Cancel() {
+  SetEvent(m_CancelEvent);
+}
+
+bool CNamedPipeTransport::ReadSome(void* bytes,
+                                   uint32_t length,
+                                   uint32_t& outRead) {
+  if (!BeginIo(m_ReadIo))
+    return false;
+
+  DWORD bytesRead = 0;
+  if (!EndIo(m_ReadIo,
+             ReadFile(m_Handle, bytes, length, nullptr, &m_ReadIo.Overlapped),
+             GetTimeLeftMs(GetReadDeadline()), bytesRead))
+    return false;
+
+  outRead = bytesRead;
+  return true;
+}
+
+bool CNamedPipeTransport::WriteSome(const void* bytes,
+                                    uint32_t length,
+                                    uint32_t& outWritten) {
+  if (!BeginIo(m_WriteIo))
+    return false;
+
+  DWORD bytesWritten = 0;
+  if (!EndIo(m_WriteIo,
+             WriteFile(m_Handle, bytes, length, nullptr,
+                       &m_WriteIo.Overlapped),
+             GetTimeLeftMs(GetWriteDeadline()), bytesWritten))
+    return false;
+
+  outWritten = bytesWritten;
+  return true;
+}
+
+bool CNamedPipeTransport::BeginIo(Io_s& io) {
+  m_TimedOut = false;
+
+  if (INVALID_HANDLE_VALUE == m_Handle) {
+    m_LastError = ERROR_INVALID_HANDLE;
+    return false;
+  }
+
+  if (WAIT_OBJECT_0 == WaitForSingleObject(m_CancelEvent, 0)) {
+    m_LastError = ERROR_OPERATION_ABORTED;
+    return false;
+  }
+
+  memset(&io.Overlapped, 0, sizeof(io.Overlapped));
+  io.Overlapped.hEvent = io.Event;
+  ResetEvent(io.Event);
+
+  return true;
+}
+
+bool CNamedPipeTransport::EndIo(Io_s& io,
+                                BOOL result,
+                                uint32_t timeoutMs,
+                                DWORD& outBytes) {
+  if (!result) {
+    DWORD lastError = ::GetLastError();
+
+    if (ERROR_IO_PENDING == lastError) {
+      HANDLE handles[2] = {io.Event, m_CancelEvent};
+
+      DWORD waitResult =
+          WaitForMultipleObjects(2, handles, FALSE, (DWORD)timeoutMs);
+
+      if (WAIT_OBJECT_0 != waitResult) {
+        CancelIoEx(m_Handle, &io.Overlapped);
+
+        // Might have completed before it got cancelled:
+        if (GetOverlappedResult(m_Handle, &io.Overlapped, &outBytes, TRUE))
+          return true;
+
+        lastError = ::GetLastError();
+
+        if (ERROR_OPERATION_ABORTED == lastError &&
+            WAIT_TIMEOUT == waitResult) {
+          m_TimedOut = true;
+          lastError = ERROR_TIMEOUT;
+        }
+
+        m_LastError = lastError;
+        return false;
+      }
+    } else if (ERROR_MORE_DATA != lastError) {
+      if (ERROR_INVALID_HANDLE == lastError)
+        m_Handle = INVALID_HANDLE_VALUE;
+      m_LastError = lastError;
+      return false;
+    }
+  }
+
+  if (!GetOverlappedResult(m_Handle, &io.Overlapped, &outBytes, FALSE)) {
+    DWORD lastError = ::GetLastError();
+    if (ERROR_MORE_DATA != lastError) {
+      m_LastError = lastError;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool CNamedPipeTransport::ReadSome(HANDLE& handle,
+                                   DWORD& outLastError,
+                                   void* bytes,
+                                   uint32_t length,
+                                   uint32_t& outRead) {
+  DWORD bytesRead = 0;
+
+  if (!(ReadFile(handle, bytes, length, &bytesRead, nullptr))) {
+    DWORD lastError = ::GetLastError();
+    switch (lastError) {
+      case ERROR_MORE_DATA:
+        break;
+      case ERROR_INVALID_HANDLE:
+        handle = INVALID_HANDLE_VALUE;
+      default:
+        outLastError = lastError;
+        return false;
+    }
+  }
+
+  outRead = bytesRead;
+  return true;
+}
+
+bool CNamedPipeTransport::WriteSome(HANDLE& handle,
+                                    DWORD& outLastError,
+                                    const void* bytes,
+                                    uint32_t length,
+                                    uint32_t& outWritten) {
+  DWORD bytesWritten = 0;
+
+  if (!(WriteFile(handle, bytes, length, &bytesWritten, nullptr))) {
+    DWORD lastError = ::GetLastError();
+    switch (lastError) {
+      case ERROR_MORE_DATA:
+        break;
+      case ERROR_INVALID_HANDLE:
+        handle = INVALID_HANDLE_VALUE;
+      default:
+        outLastError = lastError;
+        return false;
+    }
+  }
+
+  outWritten = bytesWritten;
+  return true;
+}
+
+bool CNamedPipeTransport::FlushTransport(HANDLE& handle, DWORD& outLastError) {
+  if (!FlushFileBuffers(handle)) {
+    DWORD lastError = ::GetLastError();
+    switch (lastError) {
+      case ERROR_INVALID_HANDLE:
+        handle = INVALID_HANDLE_VALUE;
+      default:
+        outLastError = lastError;
+        return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,187 @@
+#include "AfxValue.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <type_traits>
+
+namespace advancedfx {
+namespace interop {
+
+// Clear() just forgets the nodes:
+static_assert(std::is_trivially_destructible<CValue>::value,
+              "CValue must be trivially destructible.");
+
+// CValue //////////////////////////////////////////////////////////////////////
+
+StringView_s CValue::GetString() const {
+  StringView_s result;
+  if (m_Type == Type::String) {
+    result.Data = m_Value.String;
+    result.Length = m_Size;
+  }
+  return result;
+}
+
+const float* CValue::GetFloat32Data() const {
+  if (m_Type == Type::Float32Buffer)
+    return m_Value.Floats;
+  if (m_Type == Type::Float32Array)
+    return m_Value.Buffer->m_Value.Floats + m_Capacity;
+  return nullptr;
+}
+
+void CValue::SetArrayElement(uint32_t index, CValue* value) {
+  if (m_Type != Type::Array || m_Size <= index)
+    return;
+
+  assert(nullptr == value || value->m_Arena == m_Arena);
+
+  m_Value.Elements[index] = value;
+}
+
+StringView_s CValue::GetChildName(uint32_t index) const {
+  StringView_s result;
+  result.Data = m_Value.Members[index].Name;
+  result.Length = m_Value.Members[index].NameLength;
+  return result;
+}
+
+uint32_t CValue::LowerBound(const char* name, uint32_t nameLength) const {
+  uint32_t first = 0;
+  uint32_t count = m_Size;
+
+  while (0 < count) {
+    uint32_t step = count / 2;
+    const Member_s& member = m_Value.Members[first + step];
+
+    uint32_t length =
+        member.NameLength < nameLength ? member.NameLength : nameLength;
+    int cmp = memcmp(member.Name, name, length);
+    if (cmp < 0 || (0 == cmp && member.NameLength < nameLength)) {
+      first += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+
+  return first;
+}
+
+CValue* CValue::GetChild(const char* name) const {
+  if (m_Type != Type::Object)
+    return nullptr;
+
+  uint32_t nameLength = (uint32_t)strlen(name);
+  uint32_t index = LowerBound(name, nameLength);
+  if (index < m_Size) {
+    const Member_s& member = m_Value.Members[index];
+    if (member.NameLength == nameLength &&
+        0 == memcmp(member.Name, name, nameLength))
+      return member.Value;
+  }
+
+  return nullptr;
+}
+
+void CValue::SetChild(const char* name, CValue* value) {
+  if (m_Type != Type::Object)
+    return;
+
+  assert(nullptr == value || value->m_Arena == m_Arena);
+
+  uint32_t nameLength = (uint32_t)strlen(name);
+  uint32_t index = LowerBound(name, nameLength);
+  if (index < m_Size) {
+    Member_s& member = m_Value.Members[index];
+    if (member.NameLength == nameLength &&
+        0 == memcmp(member.Name, name, nameLength)) {
+      member.Value = value;
+      return;
+    }
+  }
+
+  if (m_Size == m_Capacity) {
+    // The old members stay in the arena until it is cleared.
+    uint32_t capacity = 0 < m_Capacity ? 2 * m_Capacity : 4;
+    Member_s* members = (Member_s*)m_Arena->Allocate(
+        capacity * sizeof(Member_s), alignof(Member_s));
+    if (0 < m_Size)
+      memcpy(members, m_Value.Members, m_Size * sizeof(Member_s));
+    m_Value.Members = members;
+    m_Capacity = capacity;
+  }
+
+  memmove(&m_Value.Members[index + 1], &m_Value.Members[index],
+          (m_Size - index) * sizeof(Member_s));
+
+  Member_s& member = m_Value.Members[index];
+  member.Name = m_Arena->Store(name, nameLength).Data;
+  member.NameLength = nameLength;
+  member.Value = value;
+  ++m_Size;
+}
+
+// CValueArena /////////////////////////////////////////////////////////////////
+
+CValue* CValueArena::CreateArray(uint32_t size) {
+  CValue* result = New(CValue::Type::Array);
+  result->m_Value.Elements =
+      (CValue**)Allocate(size * sizeof(CValue*), alignof(CValue*));
+  if (0 < size)
+    memset(result->m_Value.Elements, 0, size * sizeof(CValue*));
+  result->m_Size = size;
+  return result;
+}
+
+CValue* CValueArena::CreateObject(uint32_t capacity) {
+  CValue* result = New(CValue::Type::Object);
+  result->m_Value.Members = (CValue::Member_s*)Allocate(
+      capacity * sizeof(CValue::Member_s), alignof(CValue::Member_s));
+  result->m_Capacity = capacity;
+  return result;
+}
+
+CValue* CValueArena::CreateFloat32Buffer(const float* data, uint32_t length) {
+  CValue* result = New(CValue::Type::Float32Buffer);
+  result->m_Value.Floats =
+      (float*)Allocate(length * sizeof(float), alignof(float));
+  if (0 < length) {
+    if (nullptr != data)
+      memcpy(result->m_Value.Floats, data, length * sizeof(float));
+    else
+      memset(result->m_Value.Floats, 0, length * sizeof(float));
+  }
+  result->m_Size = length;
+  return result;
+}
+
+CValue* CValueArena::CreateBytes(const void* data, uint32_t length) {
+  CValue* result = New(CValue::Type::Bytes);
+  result->m_Value.Bytes = (unsigned char*)Allocate(length, 8);
+  if (0 < length) {
+    if (nullptr != data)
+      memcpy(result->m_Value.Bytes, data, length);
+    else
+      memset(result->m_Value.Bytes, 0, length);
+  }
+  result->m_Size = length;
+  return result;
+}
+
+CValue* CValueArena::CreateFloat32Array(CValue* buffer,
+                                        uint32_t offset,
+                                        uint32_t length) {
+  assert(buffer->IsFloat32Buffer() && buffer->m_Arena == this);
+  assert(offset <= buffer->m_Size && length <= buffer->m_Size - offset);
+
+  CValue* result = New(CValue::Type::Float32Array);
+  result->m_Value.Buffer = buffer;
+  result->m_Capacity = offset;
+  result->m_Size = length;
+  return result;
+}
+
+}  // namespace interop
+}  // namespace advancedfx
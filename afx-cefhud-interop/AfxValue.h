@@ -0,0 +1,324 @@
+#pragma once
+
+#include "AfxTransport.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+
+namespace advancedfx {
+namespace interop {
+
+class CValueArena;
+
+// A node of a value tree built in a CValueArena, the pump's representation
+// of what is marshalled from and to JavaScript.
+//
+// Nodes are owned by their arena: they are never destroyed on their own, and
+// children must come from the same arena as their parent. Objects keep their
+// members sorted by name, so lookups are a binary search and they enumerate
+// in the same order a std::map would.
+//
+// AddRef() / Release() count on the arena, so a CefRefPtr to any node keeps
+// the whole tree alive.
+class CValue {
+ public:
+  enum class Type : uint8_t {
+    Invalid,
+    Array,
+    Object,
+    Bool,
+    Int,
+    UInt,
+    Double,
+    Function,
+    String,
+    Time,
+    Float32Buffer,
+    Float32Array,
+    Bytes
+  };
+
+  CValue(const CValue& rhs) = delete;
+  CValue& operator=(const CValue& rhs) = delete;
+
+  void AddRef() const;
+  bool Release() const;
+
+  CValueArena* GetArena() const { return m_Arena; }
+
+  Type GetType() const { return m_Type; }
+
+  bool IsArray() const { return m_Type == Type::Array; }
+  bool IsObject() const { return m_Type == Type::Object; }
+  bool IsBool() const { return m_Type == Type::Bool; }
+  bool IsFunction() const { return m_Type == Type::Function; }
+  bool IsString() const { return m_Type == Type::String; }
+  bool IsTime() const { return m_Type == Type::Time; }
+  bool IsFloat32Buffer() const { return m_Type == Type::Float32Buffer; }
+  bool IsFloat32Array() const { return m_Type == Type::Float32Array; }
+  bool IsBytes() const { return m_Type == Type::Bytes; }
+
+  bool IsInt() const { return m_Type == Type::Int || m_Type == Type::UInt; }
+  bool IsUInt() const { return m_Type == Type::Int || m_Type == Type::UInt; }
+
+  bool IsDouble() const {
+    return m_Type == Type::Int || m_Type == Type::UInt ||
+           m_Type == Type::Double;
+  }
+
+  bool GetBool() const { return m_Type == Type::Bool && m_Value.Bool; }
+
+  int GetInt() const {
+    if (m_Type == Type::Int)
+      return m_Value.Int;
+    if (m_Type == Type::UInt)
+      return (int)m_Value.UInt;
+    return 0;
+  }
+
+  unsigned int GetUInt() const {
+    if (m_Type == Type::Int)
+      return (unsigned int)m_Value.Int;
+    if (m_Type == Type::UInt)
+      return m_Value.UInt;
+    return 0;
+  }
+
+  double GetDouble() const {
+    if (m_Type == Type::Int)
+      return (double)m_Value.Int;
+    if (m_Type == Type::UInt)
+      return (double)m_Value.UInt;
+    if (m_Type == Type::Double)
+      return m_Value.Double;
+    return 0;
+  }
+
+  int64_t GetTime() const { return m_Type == Type::Time ? m_Value.Time : 0; }
+
+  // Index into the function table of the arena, see CValueArena.
+  uint32_t GetFunction() const {
+    return m_Type == Type::Function ? m_Value.Function : 0;
+  }
+
+  // Valid as long as the arena is not cleared.
+  StringView_s GetString() const;
+
+  // Floats of a Float32Buffer or Float32Array, valid as long as the arena is
+  // not cleared.
+  const float* GetFloat32Data() const;
+
+  uint32_t GetFloat32Length() const {
+    return m_Type == Type::Float32Buffer || m_Type == Type::Float32Array
+               ? m_Size
+               : 0;
+  }
+
+  // The Float32Buffer a Float32Array views, nullptr for other types.
+  CValue* GetFloat32Buffer() const {
+    return m_Type == Type::Float32Array ? m_Value.Buffer : nullptr;
+  }
+
+  // Where in its buffer a Float32Array starts, in floats.
+  uint32_t GetFloat32Offset() const {
+    return m_Type == Type::Float32Array ? m_Capacity : 0;
+  }
+
+  // Contents of a Bytes value, valid as long as the arena is not cleared.
+  unsigned char* GetBytesData() const {
+    return m_Type == Type::Bytes ? m_Value.Bytes : nullptr;
+  }
+
+  uint32_t GetBytesLength() const {
+    return m_Type == Type::Bytes ? m_Size : 0;
+  }
+
+  uint32_t GetArraySize() const { return m_Type == Type::Array ? m_Size : 0; }
+
+  // @returns nullptr if index is out of range or the element was not set.
+  CValue* GetArrayElement(uint32_t index) const {
+    if (m_Type == Type::Array && index < m_Size)
+      return m_Value.Elements[index];
+    return nullptr;
+  }
+
+  void SetArrayElement(uint32_t index, CValue* value);
+
+  uint32_t GetChildCount() const {
+    return m_Type == Type::Object ? m_Size : 0;
+  }
+
+  // Children by index, in name order.
+  StringView_s GetChildName(uint32_t index) const;
+  CValue* GetChildAt(uint32_t index) const {
+    return m_Value.Members[index].Value;
+  }
+
+  // @returns nullptr if this is no object or has no such child.
+  CValue* GetChild(const char* name) const;
+
+  // Replaces a child of the same name.
+  void SetChild(const char* name, CValue* value);
+
+ private:
+  friend class CValueArena;
+
+  struct Member_s {
+    const char* Name;
+    uint32_t NameLength;
+    CValue* Value;
+  };
+
+  CValueArena* m_Arena;
+  Type m_Type;
+  // String length, array size, number of members, floats or bytes.
+  uint32_t m_Size = 0;
+  // Allocated members of an object, offset of a Float32Array.
+  uint32_t m_Capacity = 0;
+  union Value_u {
+    bool Bool;
+    int Int;
+    unsigned int UInt;
+    double Double;
+    int64_t Time;
+    uint32_t Function;
+    const char* String;
+    CValue** Elements;
+    Member_s* Members;
+    float* Floats;
+    CValue* Buffer;
+    unsigned char* Bytes;
+  } m_Value;
+
+  CValue(CValueArena* arena, Type type) : m_Arena(arena), m_Type(type) {
+    m_Value.Double = 0;
+  }
+
+  // @returns the index of the first member not less than name.
+  uint32_t LowerBound(const char* name, uint32_t nameLength) const;
+};
+
+// Bump allocates the nodes and strings of value trees. Clear() keeps the
+// memory, so a reused arena stops allocating once it has grown to the size
+// of the largest message.
+//
+// Reference counted, starts with a count of 0; deleted when the last
+// reference goes away.
+class CValueArena : public CStringArena {
+ public:
+  CValueArena() {}
+
+  void AddRef() const { m_RefCount.fetch_add(1, std::memory_order_relaxed); }
+
+  bool Release() const {
+    if (1 == m_RefCount.fetch_sub(1, std::memory_order_acq_rel)) {
+      delete this;
+      return true;
+    }
+    return false;
+  }
+
+  bool HasOneRef() const {
+    return 1 == m_RefCount.load(std::memory_order_acquire);
+  }
+
+  // Elements are nullptr until set.
+  CValue* CreateArray(uint32_t size);
+
+  // capacity is a hint, objects grow as needed.
+  CValue* CreateObject(uint32_t capacity = 4);
+
+  CValue* CreateBool(bool value) {
+    CValue* result = New(CValue::Type::Bool);
+    result->m_Value.Bool = value;
+    return result;
+  }
+
+  CValue* CreateInt(int value) {
+    CValue* result = New(CValue::Type::Int);
+    result->m_Value.Int = value;
+    return result;
+  }
+
+  CValue* CreateUInt(unsigned int value) {
+    CValue* result = New(CValue::Type::UInt);
+    result->m_Value.UInt = value;
+    return result;
+  }
+
+  CValue* CreateDouble(double value) {
+    CValue* result = New(CValue::Type::Double);
+    result->m_Value.Double = value;
+    return result;
+  }
+
+  CValue* CreateTime(int64_t value) {
+    CValue* result = New(CValue::Type::Time);
+    result->m_Value.Time = value;
+    return result;
+  }
+
+  CValue* CreateFunction(uint32_t index) {
+    CValue* result = New(CValue::Type::Function);
+    result->m_Value.Function = index;
+    return result;
+  }
+
+  // Copies the string into the arena.
+  CValue* CreateString(const char* value, uint32_t length) {
+    return CreateString(Store(value, length));
+  }
+
+  CValue* CreateString(const std::string& value) {
+    return CreateString(Store(value));
+  }
+
+  // view must be owned by this arena already, it is not copied.
+  CValue* CreateString(const StringView_s& view) {
+    CValue* result = New(CValue::Type::String);
+    result->m_Value.String = view.Data;
+    result->m_Size = view.Length;
+    return result;
+  }
+
+  // Copies length floats from data, zeroes them if data is nullptr.
+  CValue* CreateFloat32Buffer(const float* data, uint32_t length);
+
+  // A view of length floats of buffer, starting at offset.
+  CValue* CreateFloat32Array(CValue* buffer, uint32_t offset, uint32_t length);
+
+  // Copies length bytes from data, zeroes them if data is nullptr. Aligned
+  // to 8, so typed arrays of any width can view them.
+  CValue* CreateBytes(const void* data, uint32_t length);
+
+  /**
+   * Invalidates all values handed out so far.
+   */
+  virtual void Clear() { CStringArena::Clear(); }
+
+ protected:
+  virtual ~CValueArena() {}
+
+ private:
+  friend class CValue;
+
+  mutable std::atomic<int> m_RefCount{0};
+
+  CValue* New(CValue::Type type) {
+    return new (Allocate(sizeof(CValue), alignof(CValue))) CValue(this, type);
+  }
+};
+
+inline void CValue::AddRef() const {
+  m_Arena->AddRef();
+}
+
+inline bool CValue::Release() const {
+  return m_Arena->Release();
+}
+
+}  // namespace interop
+}  // namespace advancedfx
@@ -0,0 +1,1361 @@
+// Microbenchmark for the HLAE <-> afx-cefhud-interop protocol.
+//
+// Usage: afx-cefhud-interop-benchmark [filter]
+//
+// Only runs the benchmarks whose name contains filter. Decoding is measured
+// against recorded bytes replayed from memory, so the numbers don't include
+// any kernel time, the round trip benchmarks go through the real platform
+// endpoint transport (named pipe / Unix domain socket).
+
+#include "AfxCapture.h"
+#include "AfxGameEventBuffer.h"
+#include "AfxInteropProtocol.h"
+#include "AfxMux.h"
+#include "AfxThreadedQueue.h"
+#include "AfxTransport.h"
+#include "AfxValue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace advancedfx::interop;
+
+namespace {
+
+// Replays the given bytes over and over again, discards everything written.
+class CLoopTransport : public CTransport {
+ public:
+  void SetBytes(const std::vector<unsigned char>& bytes) {
+    m_Bytes = bytes;
+    m_Position = 0;
+  }
+
+  virtual bool ReadSome(void* bytes,
+                        uint32_t length,
+                        uint32_t& outRead) override {
+    if (m_Bytes.empty())
+      return false;
+
+    if (m_Position == m_Bytes.size())
+      m_Position = 0;
+
+    size_t chunk = std::min((size_t)length, m_Bytes.size() - m_Position);
+    memcpy(bytes, &m_Bytes[m_Position], chunk);
+    m_Position += chunk;
+
+    outRead = (uint32_t)chunk;
+    return true;
+  }
+
+  virtual bool WriteSome(const void* /* bytes */,
+                         uint32_t length,
+                         uint32_t& outWritten) override {
+    outWritten = length;
+    return true;
+  }
+
+  virtual bool FlushTransport() override { return true; }
+
+ private:
+  std::vector<unsigned char> m_Bytes;
+  size_t m_Position = 0;
+};
+
+// Keeps everything written.
+class CRecordTransport : public CTransport {
+ public:
+  const std::vector<unsigned char>& GetBytes() const { return m_Bytes; }
+
+  virtual bool ReadSome(void* /* bytes */,
+                        uint32_t /* length */,
+                        uint32_t& /* outRead */) override {
+    return false;
+  }
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override {
+    m_Bytes.insert(m_Bytes.end(), (const unsigned char*)bytes,
+                   (const unsigned char*)bytes + length);
+    outWritten = length;
+    return true;
+  }
+
+  virtual bool FlushTransport() override { return true; }
+
+ private:
+  std::vector<unsigned char> m_Bytes;
+};
+
+// Writes with fn into a buffer and returns the bytes.
+template <class Fn>
+std::vector<unsigned char> Record(Fn fn) {
+  CRecordTransport transport;
+  CTransportStream stream(&transport);
+  fn(stream);
+  stream.Send();
+  return transport.GetBytes();
+}
+
+// Defeats dead code elimination.
+volatile uint64_t g_Sink = 0;
+
+const char* g_Filter = nullptr;
+
+bool IsSelected(const char* name) {
+  return nullptr == g_Filter || nullptr != strstr(name, g_Filter);
+}
+
+double ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/**
+ * Runs fn(iterations) with growing iteration counts until it takes long
+ * enough to be measured and prints the per operation cost.
+ * @param bytesPerOp wire bytes per operation, 0 to omit throughput.
+ */
+template <class Fn>
+void Run(const char* name, size_t bytesPerOp, Fn fn) {
+  if (!IsSelected(name))
+    return;
+
+  const double minNs = 250.0 * 1000 * 1000;
+
+  uint32_t iterations = 1000;
+  double elapsedNs;
+
+  while (true) {
+    auto start = std::chrono::steady_clock::now();
+    if (!fn(iterations)) {
+      printf("%-44s FAILED\n", name);
+      return;
+    }
+    elapsedNs = ElapsedNs(start);
+
+    if (minNs <= elapsedNs || (1u << 30) <= iterations)
+      break;
+
+    iterations *= 2;
+  }
+
+  double nsPerOp = elapsedNs / iterations;
+
+  if (0 < bytesPerOp) {
+    printf("%-44s %12.1f ns/op %10.1f MB/s\n", name, nsPerOp,
+           bytesPerOp * 1000.0 / nsPerOp);
+  } else {
+    printf("%-44s %12.1f ns/op\n", name, nsPerOp);
+  }
+}
+
+// Primitives //////////////////////////////////////////////////////////////////
+
+const uint32_t g_ValueCount = 1024;
+
+std::string MakeString(size_t length) {
+  std::string result(length, 'x');
+  for (size_t i = 0; i < length; ++i)
+    result[i] = (char)('a' + i % 26);
+  return result;
+}
+
+template <class WriteFn, class ReadFn>
+void RunPrimitive(const char* writeName,
+                  const char* readName,
+                  WriteFn write,
+                  ReadFn read) {
+  std::vector<unsigned char> bytes = Record([&](CTransportStream& stream) {
+    for (uint32_t i = 0; i < g_ValueCount; ++i)
+      write(stream, i);
+  });
+  size_t bytesPerOp = bytes.size() / g_ValueCount;
+
+  Run(writeName, bytesPerOp, [&](uint32_t iterations) {
+    CLoopTransport transport;
+    CTransportStream stream(&transport);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      if (!write(stream, i % g_ValueCount))
+        return false;
+      if (0 == (i + 1) % g_ValueCount && !stream.Send())
+        return false;
+    }
+    return stream.Send();
+  });
+
+  Run(readName, bytesPerOp, [&](uint32_t iterations) {
+    CLoopTransport transport;
+    transport.SetBytes(bytes);
+    CTransportStream stream(&transport);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      if (!read(stream))
+        return false;
+    }
+    return true;
+  });
+}
+
+// Reads into a CStringArena that is cleared every stringsPerMessage strings,
+// like the pump does per message.
+void RunArenaString(const char* name, const std::string& value) {
+  const uint32_t stringsPerMessage = 64;
+
+  std::vector<unsigned char> bytes = Record([&](CTransportStream& stream) {
+    stream.WriteStringUTF8(value);
+  });
+
+  Run(name, bytes.size(), [&](uint32_t iterations) {
+    CLoopTransport transport;
+    transport.SetBytes(bytes);
+    CTransportStream stream(&transport);
+    CStringArena arena;
+    for (uint32_t i = 0; i < iterations; ++i) {
+      if (0 == i % stringsPerMessage)
+        arena.Clear();
+      StringView_s view;
+      if (!stream.ReadStringUTF8(arena, view))
+        return false;
+      g_Sink += view.Length;
+    }
+    return true;
+  });
+}
+
+void RunPrimitives() {
+  RunPrimitive(
+      "WriteBoolean", "ReadBoolean",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteBoolean(0 != (i & 1));
+      },
+      [](CTransportStream& stream) {
+        bool value;
+        if (!stream.ReadBoolean(value))
+          return false;
+        g_Sink += value;
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteInt32", "ReadInt32",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteInt32((int32_t)i);
+      },
+      [](CTransportStream& stream) {
+        int32_t value;
+        if (!stream.ReadInt32(value))
+          return false;
+        g_Sink += value;
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteSingle", "ReadSingle",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteSingle((float)i);
+      },
+      [](CTransportStream& stream) {
+        float value;
+        if (!stream.ReadSingle(value))
+          return false;
+        g_Sink += (uint64_t)value;
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteCompressedUInt32 (1 byte)", "ReadCompressedUInt32 (1 byte)",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteCompressedUInt32(i % 200);
+      },
+      [](CTransportStream& stream) {
+        uint32_t value;
+        if (!stream.ReadCompressedUInt32(value))
+          return false;
+        g_Sink += value;
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteCompressedUInt32 (5 bytes)", "ReadCompressedUInt32 (5 bytes)",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteCompressedUInt32(100000 + i);
+      },
+      [](CTransportStream& stream) {
+        uint32_t value;
+        if (!stream.ReadCompressedUInt32(value))
+          return false;
+        g_Sink += value;
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteCompressedInt32 (1 byte)", "ReadCompressedInt32 (1 byte)",
+      [](CTransportStream& stream, uint32_t i) {
+        return stream.WriteCompressedInt32((int32_t)(i % 200) - 100);
+      },
+      [](CTransportStream& stream) {
+        int32_t value;
+        if (!stream.ReadCompressedInt32(value))
+          return false;
+        g_Sink += value;
+        return true;
+      });
+
+  const std::string shortString = MakeString(16);
+  const std::string longString = MakeString(256);
+
+  RunPrimitive(
+      "WriteStringUTF8 (16 chars)", "ReadStringUTF8 (16 chars)",
+      [&](CTransportStream& stream, uint32_t /* i */) {
+        return stream.WriteStringUTF8(shortString);
+      },
+      [](CTransportStream& stream) {
+        std::string value;
+        if (!stream.ReadStringUTF8(value))
+          return false;
+        g_Sink += value.length();
+        return true;
+      });
+
+  RunPrimitive(
+      "WriteStringUTF8 (256 chars)", "ReadStringUTF8 (256 chars)",
+      [&](CTransportStream& stream, uint32_t /* i */) {
+        return stream.WriteStringUTF8(longString);
+      },
+      [](CTransportStream& stream) {
+        std::string value;
+        if (!stream.ReadStringUTF8(value))
+          return false;
+        g_Sink += value.length();
+        return true;
+      });
+
+  RunArenaString("ReadStringUTF8 (16 chars, arena)", shortString);
+  RunArenaString("ReadStringUTF8 (256 chars, arena)", longString);
+}
+
+// Messages ////////////////////////////////////////////////////////////////////
+
+RenderInfo_s MakeRenderInfo() {
+  RenderInfo_s result;
+  result.FrameCount = 4711;
+  result.AbsoluteFrameTime = 1.0f / 60;
+  result.CurTime = 123.25f;
+  result.FrameTime = 1.0f / 60;
+  result.View.X = 0;
+  result.View.Y = 0;
+  result.View.Width = 1920;
+  result.View.Height = 1080;
+  for (size_t i = 0; i < 16; ++i) {
+    result.View.ViewMatrix[i] = 0.5f * i;
+    result.View.ProjectionMatrix[i] = 0.25f * i;
+  }
+  return result;
+}
+
+void RunRenderView() {
+  RenderInfo_s renderInfo = MakeRenderInfo();
+
+  std::vector<unsigned char> bytes = Record([&](CTransportStream& stream) {
+    WriteRenderInfo(stream, renderInfo);
+  });
+
+  Run("Decode OnRenderView", bytes.size(), [&](uint32_t iterations) {
+    CLoopTransport transport;
+    transport.SetBytes(bytes);
+    CTransportStream stream(&transport);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      RenderInfo_s value;
+      if (!ReadRenderInfo(stream, value))
+        return false;
+      g_Sink += value.FrameCount;
+    }
+    return true;
+  });
+
+  // The matrices of CEngineInteropImpl::CreateAfxView, as numbers and as
+  // Float32Arrays on one buffer (with the view-projection computed):
+  Run("OnRenderView matrices (numbers)", bytes.size(),
+      [&](uint32_t iterations) {
+        CValueArena* arena = new CValueArena();
+        arena->AddRef();
+        for (uint32_t i = 0; i < iterations; ++i) {
+          arena->Clear();
+          const Matrix4x4_s* matrices[2] = {&renderInfo.View.ViewMatrix,
+                                            &renderInfo.View.ProjectionMatrix};
+          CValue* obj = arena->CreateObject();
+          for (const Matrix4x4_s* matrix : matrices) {
+            CValue* arr = arena->CreateArray(16);
+            for (uint32_t j = 0; j < 16; ++j)
+              arr->SetArrayElement(j, arena->CreateDouble((*matrix)[j]));
+            obj->SetChild(matrix == matrices[0] ? "viewMatrix"
+                                                : "projectionMatrix",
+                          arr);
+          }
+          g_Sink += obj->GetChildCount();
+        }
+        arena->Release();
+        return true;
+      });
+
+  Run("OnRenderView matrices (float32)", bytes.size(),
+      [&](uint32_t iterations) {
+        CValueArena* arena = new CValueArena();
+        arena->AddRef();
+        for (uint32_t i = 0; i < iterations; ++i) {
+          arena->Clear();
+          Matrix4x4_s matrices[3] = {renderInfo.View.ViewMatrix,
+                                     renderInfo.View.ProjectionMatrix};
+          MultiplyMatrix4x4(matrices[1], matrices[0], matrices[2]);
+          CValue* buffer = arena->CreateFloat32Buffer(&matrices[0].M00, 48);
+          CValue* obj = arena->CreateObject();
+          obj->SetChild("viewMatrix", arena->CreateFloat32Array(buffer, 0, 16));
+          obj->SetChild("projectionMatrix",
+                        arena->CreateFloat32Array(buffer, 16, 16));
+          obj->SetChild("viewProjectionMatrix",
+                        arena->CreateFloat32Array(buffer, 32, 16));
+          g_Sink += obj->GetChildCount();
+        }
+        arena->Release();
+        return true;
+      });
+}
+
+// Modelled after CS:GO's player_death.
+const int g_GameEventId = 23;
+
+struct GameEventKeyDesc_s {
+  const char* Name;
+  GameEventFieldType Type;
+};
+
+const GameEventKeyDesc_s g_GameEventKeys[] = {
+    {"userid", GameEventFieldType::Short},
+    {"attacker", GameEventFieldType::Short},
+    {"assister", GameEventFieldType::Short},
+    {"assistedflash", GameEventFieldType::Bool},
+    {"weapon", GameEventFieldType::CString},
+    {"weapon_itemid", GameEventFieldType::CString},
+    {"weapon_fauxitemid", GameEventFieldType::CString},
+    {"weapon_originalowner_xuid", GameEventFieldType::CString},
+    {"headshot", GameEventFieldType::Bool},
+    {"dominated", GameEventFieldType::Short},
+    {"revenge", GameEventFieldType::Short},
+    {"wipe", GameEventFieldType::Short},
+    {"penetrated", GameEventFieldType::Short},
+    {"noreplay", GameEventFieldType::Bool},
+    {"noscope", GameEventFieldType::Bool},
+    {"thrusmoke", GameEventFieldType::Bool},
+    {"attackerblind", GameEventFieldType::Bool},
+    {"distance", GameEventFieldType::Float}};
+
+bool WriteGameEventDescription(CTransportStream& stream) {
+  if (!stream.WriteInt32(0) || !stream.WriteInt32(g_GameEventId) ||
+      !stream.WriteStringUTF8("player_death"))
+    return false;
+
+  for (const auto& key : g_GameEventKeys) {
+    if (!stream.WriteBoolean(true) || !stream.WriteStringUTF8(key.Name) ||
+        !stream.WriteInt32((int)key.Type))
+      return false;
+  }
+
+  return stream.WriteBoolean(false);
+}
+
+bool WriteGameEventValues(CTransportStream& stream) {
+  for (const auto& key : g_GameEventKeys) {
+    bool result = true;
+    switch (key.Type) {
+      case GameEventFieldType::CString:
+        result = stream.WriteStringUTF8("weapon_ak47");
+        break;
+      case GameEventFieldType::Float:
+        result = stream.WriteSingle(12.5f);
+        break;
+      case GameEventFieldType::Long:
+        result = stream.WriteInt32(42);
+        break;
+      case GameEventFieldType::Short: {
+        int16_t value = 7;
+        result = stream.WriteBytes(&value, 0, sizeof(value));
+      } break;
+      case GameEventFieldType::Byte:
+        result = stream.WriteByte(1);
+        break;
+      case GameEventFieldType::Bool:
+        result = stream.WriteBoolean(true);
+        break;
+      case GameEventFieldType::Uint64:
+        result = stream.WriteUInt64(76561197960287930ull);
+        break;
+      default:
+        break;
+    }
+    if (!result)
+      return false;
+  }
+
+  return true;
+}
+
+// Same reads as CEngineInteropImpl::ReadGameEvent, minus building the value
+// tree.
+struct GameEventValue_s {
+  GameEventFieldType Type;
+  std::string String;
+  double Number = 0;
+  uint64_t Uint64 = 0;
+};
+
+bool ReadGameEventValues(CTransportStream& stream,
+                         const KnownGameEvent_s& known,
+                         std::vector<GameEventValue_s>& outValues) {
+  outValues.resize(known.Keys.size());
+
+  size_t index = 0;
+  for (auto itKey = known.Keys.begin(); itKey != known.Keys.end();
+       ++itKey, ++index) {
+    GameEventValue_s& value = outValues[index];
+    value.Type = itKey->Type;
+
+    switch (itKey->Type) {
+      case GameEventFieldType::CString:
+        if (!stream.ReadStringUTF8(value.String))
+          return false;
+        break;
+      case GameEventFieldType::Float: {
+        float tmp;
+        if (!stream.ReadSingle(tmp))
+          return false;
+        value.Number = tmp;
+      } break;
+      case GameEventFieldType::Long: {
+        int32_t tmp;
+        if (!stream.ReadInt32(tmp))
+          return false;
+        value.Number = tmp;
+      } break;
+      case GameEventFieldType::Short: {
+        int16_t tmp;
+        if (!stream.ReadInt16(tmp))
+          return false;
+        value.Number = tmp;
+      } break;
+      case GameEventFieldType::Byte: {
+        uint8_t tmp;
+        if (!stream.ReadByte(tmp))
+          return false;
+        value.Number = tmp;
+      } break;
+      case GameEventFieldType::Bool: {
+        bool tmp;
+        if (!stream.ReadBoolean(tmp))
+          return false;
+        value.Number = tmp;
+      } break;
+      case GameEventFieldType::Uint64:
+        if (!stream.ReadUInt64(value.Uint64))
+          return false;
+        break;
+      default:
+        break;
+    }
+  }
+
+  return true;
+}
+
+// Same reads as CEngineInteropImpl::ReadGameEvent, into a value tree.
+CValue* ReadGameEventTree(CTransportStream& stream,
+                          const KnownGameEvent_s& known,
+                          CValueArena& arena) {
+  CValue* objEvent = arena.CreateObject();
+  objEvent->SetChild("name", arena.CreateString(known.Name));
+
+  CValue* objKeys = arena.CreateObject((uint32_t)known.Keys.size());
+
+  for (auto itKey = known.Keys.begin(); itKey != known.Keys.end(); ++itKey) {
+    CValue* objKey = arena.CreateObject(3);
+    objKey->SetChild("type", arena.CreateInt((int)itKey->Type));
+
+    CValue* objValue = nullptr;
+    switch (itKey->Type) {
+      case GameEventFieldType::CString: {
+        StringView_s tmp;
+        if (!stream.ReadStringUTF8(arena, tmp))
+          return nullptr;
+        objValue = arena.CreateString(tmp);
+      } break;
+      case GameEventFieldType::Float: {
+        float tmp;
+        if (!stream.ReadSingle(tmp))
+          return nullptr;
+        objValue = arena.CreateDouble(tmp);
+      } break;
+      case GameEventFieldType::Long: {
+        int32_t tmp;
+        if (!stream.ReadInt32(tmp))
+          return nullptr;
+        objValue = arena.CreateInt(tmp);
+      } break;
+      case GameEventFieldType::Short: {
+        int16_t tmp;
+        if (!stream.ReadInt16(tmp))
+          return nullptr;
+        objValue = arena.CreateInt(tmp);
+      } break;
+      case GameEventFieldType::Byte: {
+        uint8_t tmp;
+        if (!stream.ReadByte(tmp))
+          return nullptr;
+        objValue = arena.CreateUInt(tmp);
+      } break;
+      case GameEventFieldType::Bool: {
+        bool tmp;
+        if (!stream.ReadBoolean(tmp))
+          return nullptr;
+        objValue = arena.CreateBool(tmp);
+      } break;
+      case GameEventFieldType::Uint64: {
+        uint64_t tmp;
+        if (!stream.ReadUInt64(tmp))
+          return nullptr;
+        objValue = arena.CreateArray(2);
+        objValue->SetArrayElement(
+            0, arena.CreateUInt((unsigned int)(tmp & 0x0ffffffff)));
+        objValue->SetArrayElement(
+            1, arena.CreateUInt((unsigned int)(tmp >> 32)));
+      } break;
+      default:
+        break;
+    }
+    objKey->SetChild("value", objValue);
+
+    objKeys->SetChild(itKey->Key.c_str(), objKey);
+  }
+
+  objEvent->SetChild("keys", objKeys);
+  return objEvent;
+}
+
+void RunGameEvent() {
+  std::vector<unsigned char> described =
+      Record([](CTransportStream& stream) {
+        WriteGameEventDescription(stream);
+        WriteGameEventValues(stream);
+      });
+
+  std::vector<unsigned char> known = Record([](CTransportStream& stream) {
+    stream.WriteInt32(g_GameEventId);
+    WriteGameEventValues(stream);
+  });
+
+  Run("Decode GameEvent (first, with description)", described.size(),
+      [&](uint32_t iterations) {
+        CLoopTransport transport;
+        transport.SetBytes(described);
+        CTransportStream stream(&transport);
+        KnownGameEvents_t knownGameEvents;
+        std::vector<GameEventValue_s> values;
+        for (uint32_t i = 0; i < iterations; ++i) {
+          knownGameEvents.clear();
+          KnownGameEvents_t::iterator itKnown;
+          if (!ReadGameEventHeader(stream, knownGameEvents, itKnown) ||
+              !ReadGameEventValues(stream, itKnown->second, values))
+            return false;
+          g_Sink += values.size();
+        }
+        return true;
+      });
+
+  Run("Decode GameEvent (known)", known.size(), [&](uint32_t iterations) {
+    KnownGameEvents_t knownGameEvents;
+    {
+      CLoopTransport transport;
+      transport.SetBytes(described);
+      CTransportStream stream(&transport);
+      KnownGameEvents_t::iterator itKnown;
+      if (!ReadGameEventHeader(stream, knownGameEvents, itKnown))
+        return false;
+    }
+
+    CLoopTransport transport;
+    transport.SetBytes(known);
+    CTransportStream stream(&transport);
+    std::vector<GameEventValue_s> values;
+    for (uint32_t i = 0; i < iterations; ++i) {
+      KnownGameEvents_t::iterator itKnown;
+      if (!ReadGameEventHeader(stream, knownGameEvents, itKnown) ||
+          !ReadGameEventValues(stream, itKnown->second, values))
+        return false;
+      g_Sink += values.size();
+    }
+    return true;
+  });
+
+  // Reuses the arena per event, like the pump does once the renderer let go
+  // of the previous one.
+  Run("Decode GameEvent (known, value tree)", known.size(),
+      [&](uint32_t iterations) {
+        KnownGameEvents_t knownGameEvents;
+        {
+          CLoopTransport transport;
+          transport.SetBytes(described);
+          CTransportStream stream(&transport);
+          KnownGameEvents_t::iterator itKnown;
+          if (!ReadGameEventHeader(stream, knownGameEvents, itKnown))
+            return false;
+        }
+
+        CLoopTransport transport;
+        transport.SetBytes(known);
+        CTransportStream stream(&transport);
+        CValueArena* arena = new CValueArena();
+        arena->AddRef();
+        bool result = true;
+        for (uint32_t i = 0; i < iterations; ++i) {
+          arena->Clear();
+          KnownGameEvents_t::iterator itKnown;
+          CValue* objEvent = nullptr;
+          if (!ReadGameEventHeader(stream, knownGameEvents, itKnown) ||
+              nullptr == (objEvent = ReadGameEventTree(
+                              stream, itKnown->second, *arena))) {
+            result = false;
+            break;
+          }
+          g_Sink += objEvent->GetChild("keys")->GetChildCount();
+        }
+        arena->Release();
+        return result;
+      });
+
+  // A frame's worth of events into one buffer, like onGameEvents gets them
+  // with setGameEventsColumnar(true).
+  const uint32_t eventsPerBatch = 64;
+
+  Run("Decode GameEvent (known, columnar)", known.size(),
+      [&](uint32_t iterations) {
+        KnownGameEvents_t knownGameEvents;
+        {
+          CLoopTransport transport;
+          transport.SetBytes(described);
+          CTransportStream stream(&transport);
+          KnownGameEvents_t::iterator itKnown;
+          if (!ReadGameEventHeader(stream, knownGameEvents, itKnown))
+            return false;
+        }
+
+        GameEventSchemaPtr schema = CreateGameEventSchema(
+            1, knownGameEvents.begin()->second, false, false, false,
+            std::vector<unsigned int>());
+
+        CLoopTransport transport;
+        transport.SetBytes(known);
+        CTransportStream stream(&transport);
+        CGameEventBuffer buffer;
+        std::vector<uint64_t> bytes;
+        for (uint32_t i = 0; i < iterations; ++i) {
+          KnownGameEvents_t::iterator itKnown;
+          if (!ReadGameEventHeader(stream, knownGameEvents, itKnown) ||
+              !buffer.ReadEvent(stream, schema))
+            return false;
+
+          if (eventsPerBatch == buffer.GetEventCount() ||
+              i + 1 == iterations) {
+            bytes.resize((buffer.GetSize() + 7) / 8);
+            buffer.Write((unsigned char*)bytes.data());
+            g_Sink += bytes.size();
+            buffer.Clear();
+          }
+        }
+        return true;
+      });
+}
+
+// One BatchUpdateResult round with this many callbacks per calc type.
+const int g_CalcsPerType = 4;
+
+bool WriteCalcBatch(CTransportStream& stream) {
+  Vector_s vector;
+  QAngle_s qAngle;
+
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !stream.WriteInt32(i))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !WriteVector(stream, vector) ||
+        !WriteQAngle(stream, qAngle))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !WriteVector(stream, vector) ||
+        !WriteQAngle(stream, qAngle) || !stream.WriteSingle(90.0f))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !stream.WriteSingle(90.0f))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !stream.WriteBoolean(true))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.WriteBoolean(true) || !stream.WriteInt32(i))
+      return false;
+  }
+
+  return true;
+}
+
+// Same reads as the CCalcCallbacks::BatchUpdateResult implementations.
+bool ReadCalcBatch(CTransportStream& stream) {
+  bool hasResult;
+  int32_t intValue;
+  float floatValue;
+  bool boolValue;
+  Vector_s vector;
+  QAngle_s qAngle;
+
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult && !stream.ReadInt32(intValue))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult &&
+        !(ReadVector(stream, vector) && ReadQAngle(stream, qAngle)))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult &&
+        !(ReadVector(stream, vector) && ReadQAngle(stream, qAngle) &&
+          stream.ReadSingle(floatValue)))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult && !stream.ReadSingle(floatValue))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult && !stream.ReadBoolean(boolValue))
+      return false;
+  }
+  for (int i = 0; i < g_CalcsPerType; ++i) {
+    if (!stream.ReadBoolean(hasResult))
+      return false;
+    if (hasResult && !stream.ReadInt32(intValue))
+      return false;
+  }
+
+  g_Sink += intValue;
+  return true;
+}
+
+void RunCalcBatch() {
+  std::vector<unsigned char> bytes = Record(WriteCalcBatch);
+
+  Run("Decode calc batch (6 types x 4 callbacks)", bytes.size(),
+      [&](uint32_t iterations) {
+        CLoopTransport transport;
+        transport.SetBytes(bytes);
+        CTransportStream stream(&transport);
+        for (uint32_t i = 0; i < iterations; ++i) {
+          if (!ReadCalcBatch(stream))
+            return false;
+        }
+        return true;
+      });
+}
+
+// Capture /////////////////////////////////////////////////////////////////////
+
+std::string GetCapturePath() {
+  const char* dir = getenv("TMPDIR");
+  if (nullptr == dir)
+    dir = getenv("TEMP");
+  if (nullptr == dir)
+    dir = ".";
+
+  char buffer[64];
+#ifdef _WIN32
+  snprintf(buffer, sizeof(buffer), "/afx-cefhud-interop_benchmark_%lu.afxcap",
+           (unsigned long)GetCurrentProcessId());
+#else
+  snprintf(buffer, sizeof(buffer), "/afx-cefhud-interop_benchmark_%lu.afxcap",
+           (unsigned long)getpid());
+#endif
+  return std::string(dir) + buffer;
+}
+
+/**
+ * Decoding with the tap recording everything, and decoding the recording
+ * again through the replay transport.
+ */
+void RunCapture() {
+  RenderInfo_s renderInfo = MakeRenderInfo();
+
+  std::vector<unsigned char> bytes = Record([&](CTransportStream& stream) {
+    WriteRenderInfo(stream, renderInfo);
+  });
+
+  std::string path = GetCapturePath();
+
+  // The loop transport hands out one message per read, so each message is a
+  // record of its own, like with a real peer.
+  auto capture = [&](uint32_t iterations) {
+    CCaptureWriter capture;
+    if (!capture.Open(path.c_str()))
+      return false;
+    capture.WriteConnect();
+
+    CLoopTransport transport;
+    transport.SetBytes(bytes);
+    CTapTransport tap(&transport, &capture);
+    CTransportStream stream(&tap);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      RenderInfo_s value;
+      if (!ReadRenderInfo(stream, value))
+        return false;
+      g_Sink += value.FrameCount;
+    }
+    return true;
+  };
+
+  Run("Decode OnRenderView (capture)", bytes.size(), capture);
+
+  CReplayTransport replay;
+  bool captured = capture(g_ValueCount) && replay.Open(path.c_str());
+  remove(path.c_str());
+  if (!captured)
+    return;
+
+  Run("Decode OnRenderView (replay)", bytes.size(), [&](uint32_t iterations) {
+    replay.Rewind();
+    if (!replay.NextConnection())
+      return false;
+
+    CTransportStream stream(&replay);
+    for (uint32_t i = 0; i < iterations; ++i) {
+      RenderInfo_s value;
+      if (!ReadRenderInfo(stream, value)) {
+        // Capture exhausted, start over:
+        stream.ResetBuffers();
+        replay.Rewind();
+        if (!replay.NextConnection() || !ReadRenderInfo(stream, value))
+          return false;
+      }
+      g_Sink += value.FrameCount;
+    }
+    return !replay.GetDiverged();
+  });
+}
+
+// Round trip //////////////////////////////////////////////////////////////////
+
+std::string GetEndpointName() {
+  char buffer[64];
+#ifdef _WIN32
+  snprintf(buffer, sizeof(buffer), "afx-cefhud-interop_benchmark_%lu",
+           (unsigned long)GetCurrentProcessId());
+#else
+  snprintf(buffer, sizeof(buffer), "afx-cefhud-interop_benchmark_%lu",
+           (unsigned long)getpid());
+#endif
+  return buffer;
+}
+
+void PrintSamples(const char* name, bool failed, std::vector<double>& samples) {
+  if (failed || samples.empty()) {
+    printf("%-44s FAILED\n", name);
+    return;
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  double sum = 0;
+  for (double sample : samples)
+    sum += sample;
+
+  printf("%-44s %12.1f ns/op  p50 %10.1f ns  p99 %10.1f ns\n", name,
+         sum / samples.size(), samples[samples.size() / 2],
+         samples[samples.size() * 99 / 100]);
+}
+
+/**
+ * Sends requestSize bytes to an echo thread, which answers with an Int32
+ * after it read them, like HLAE does for most drawing replies.
+ */
+void RunRoundTrip(const char* name, uint32_t requestSize, uint32_t count) {
+  if (!IsSelected(name))
+    return;
+
+  std::string endpointName = GetEndpointName();
+
+  CPlatformEndpointTransport serverTransport;
+  if (!serverTransport.Listen(endpointName.c_str())) {
+    printf("%-44s FAILED (listen)\n", name);
+    return;
+  }
+
+  std::thread server([&serverTransport, requestSize]() {
+    if (!serverTransport.Accept())
+      return;
+
+    CTransportStream stream(&serverTransport);
+    std::vector<unsigned char> request(requestSize);
+
+    while (true) {
+      int32_t sequence;
+      if (!stream.ReadInt32(sequence) || sequence < 0)
+        break;
+      if (0 < requestSize && !stream.ReadBytes(&request[0], 0, requestSize))
+        break;
+      if (!stream.WriteInt32(sequence) || !stream.Flush())
+        break;
+    }
+
+    serverTransport.Close();
+  });
+
+  CPlatformEndpointTransport clientTransport;
+  bool failed = !clientTransport.Open(endpointName.c_str());
+
+  CTransportStream stream(&clientTransport);
+  std::vector<unsigned char> request(requestSize, 0x55);
+  std::vector<double> samples;
+  samples.reserve(count);
+
+  for (uint32_t i = 0; !failed && i < count; ++i) {
+    auto start = std::chrono::steady_clock::now();
+
+    int32_t reply;
+    if (!stream.WriteInt32((int32_t)i) ||
+        (0 < requestSize && !stream.WriteBytes(&request[0], 0, requestSize)) ||
+        !stream.Flush() || !stream.ReadInt32(reply) || reply != (int32_t)i) {
+      failed = true;
+      break;
+    }
+
+    samples.push_back(ElapsedNs(start));
+  }
+
+  if (clientTransport.IsOpen()) {
+    stream.WriteInt32(-1);
+    stream.Flush();
+  } else {
+    serverTransport.Cancel();
+  }
+
+  server.join();
+  clientTransport.Close();
+
+  PrintSamples(name, failed, samples);
+}
+
+/**
+ * Same as RunRoundTrip, but channelCount threads do their round trips at the
+ * same time, each on its own channel of one multiplexed connection.
+ */
+void RunMuxRoundTrip(const char* name,
+                     uint32_t channelCount,
+                     uint32_t requestSize,
+                     uint32_t count) {
+  if (!IsSelected(name))
+    return;
+
+  std::string endpointName = GetEndpointName();
+
+  CPlatformEndpointTransport serverTransport;
+  if (!serverTransport.Listen(endpointName.c_str())) {
+    printf("%-44s FAILED (listen)\n", name);
+    return;
+  }
+
+  std::thread server([&serverTransport, requestSize]() {
+    if (!serverTransport.Accept())
+      return;
+
+    auto connection = std::make_shared<CMuxConnection>(&serverTransport, false);
+    std::vector<std::thread> echos;
+
+    std::thread acceptor([connection, &echos, requestSize]() {
+      while (auto channel = connection->AcceptChannel()) {
+        echos.emplace_back([channel, requestSize]() {
+          CTransportStream stream(channel.get());
+          std::vector<unsigned char> request(requestSize);
+
+          while (true) {
+            int32_t sequence;
+            if (!stream.ReadInt32(sequence) || sequence < 0)
+              break;
+            if (0 < requestSize &&
+                !stream.ReadBytes(&request[0], 0, requestSize))
+              break;
+            if (!stream.WriteInt32(sequence) || !stream.Flush())
+              break;
+          }
+
+          channel->Close();
+        });
+      }
+    });
+
+    connection->Run();
+    acceptor.join();
+    for (auto& echo : echos)
+      echo.join();
+
+    serverTransport.Close();
+  });
+
+  CPlatformEndpointTransport clientTransport;
+  std::atomic<bool> failed{!clientTransport.Open(endpointName.c_str())};
+
+  auto connection = std::make_shared<CMuxConnection>(&clientTransport, true);
+  std::thread demux([connection]() { connection->Run(); });
+
+  std::mutex samplesMutex;
+  std::vector<double> samples;
+  samples.reserve(channelCount * count);
+
+  std::vector<std::thread> clients;
+  for (uint32_t c = 0; !failed && c < channelCount; ++c) {
+    clients.emplace_back([&, requestSize, count]() {
+      auto channel = connection->OpenChannel();
+      if (nullptr == channel) {
+        failed = true;
+        return;
+      }
+
+      CTransportStream stream(channel.get());
+      std::vector<unsigned char> request(requestSize, 0x55);
+      std::vector<double> mySamples;
+      mySamples.reserve(count);
+
+      for (uint32_t i = 0; i < count; ++i) {
+        auto start = std::chrono::steady_clock::now();
+
+        int32_t reply;
+        if (!stream.WriteInt32((int32_t)i) ||
+            (0 < requestSize &&
+             !stream.WriteBytes(&request[0], 0, requestSize)) ||
+            !stream.Flush() || !stream.ReadInt32(reply) ||
+            reply != (int32_t)i) {
+          failed = true;
+          break;
+        }
+
+        mySamples.push_back(ElapsedNs(start));
+      }
+
+      stream.WriteInt32(-1);
+      stream.Flush();
+      channel->Close();
+
+      std::unique_lock<std::mutex> lock(samplesMutex);
+      samples.insert(samples.end(), mySamples.begin(), mySamples.end());
+    });
+  }
+
+  for (auto& client : clients)
+    client.join();
+
+  clientTransport.Cancel();
+  serverTransport.Cancel();
+  demux.join();
+  server.join();
+  clientTransport.Close();
+
+  PrintSamples(name, failed.load(), samples);
+}
+
+// The CThreadedQueue from before closures were stored inline and queues ran on
+// the task pool, as a baseline. Unlike CThreadedQueue it keeps no wait and run
+// time stats, which cost two clock reads per task.
+class CMutexQueue {
+  typedef std::function<void(void)> fp_t;
+
+ public:
+  CMutexQueue() { m_Thread = std::thread(&CMutexQueue::QueueThreadHandler, this); }
+
+  ~CMutexQueue() {
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Quit = true;
+    m_Cv.notify_all();
+    lock.unlock();
+    m_Thread.join();
+  }
+
+  void Queue(fp_t&& op) {
+    std::unique_lock<std::mutex> lock(m_Lock);
+    m_Queue.push(std::move(op));
+    m_Cv.notify_one();
+  }
+
+ private:
+  std::mutex m_Lock;
+  std::thread m_Thread;
+  std::queue<fp_t> m_Queue;
+  std::condition_variable m_Cv;
+  bool m_Quit = false;
+
+  void QueueThreadHandler(void) {
+    std::unique_lock<std::mutex> lock(m_Lock);
+
+    do {
+      m_Cv.wait(lock, [this] { return (m_Queue.size() || m_Quit); });
+
+      if (!m_Quit && m_Queue.size()) {
+        auto op = std::move(m_Queue.front());
+        m_Queue.pop();
+        lock.unlock();
+        op();
+        lock.lock();
+      }
+    } while (!m_Quit);
+  }
+};
+
+// About what the interop's tasks capture: this and a few CefRefPtr.
+struct TaskCapture_s {
+  void* Pointers[5];
+};
+
+/**
+ * Queues tasks one at a time and measures until each started running.
+ * @param idleUs time between tasks, long enough for the queue to park.
+ */
+template <class Queue_t>
+void RunTaskLatency(const char* name, uint32_t idleUs, uint32_t count) {
+  if (!IsSelected(name))
+    return;
+
+  Queue_t queue;
+  std::atomic<uint32_t> done{0};
+  std::vector<double> samples(count);
+  TaskCapture_s capture = {};
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (0 < idleUs)
+      std::this_thread::sleep_for(std::chrono::microseconds(idleUs));
+
+    auto start = std::chrono::steady_clock::now();
+    queue.Queue([&samples, &done, i, start, capture]() {
+      samples[i] = ElapsedNs(start);
+      g_Sink = g_Sink + (uint64_t)(uintptr_t)capture.Pointers[0];
+      done.store(i + 1, std::memory_order_release);
+    });
+
+    while (done.load(std::memory_order_acquire) != i + 1)
+      std::this_thread::yield();
+  }
+
+  PrintSamples(name, false, samples);
+}
+
+/**
+ * producerCount threads queue count tasks each as fast as they can.
+ */
+template <class Queue_t>
+void RunTaskThroughput(const char* name,
+                       uint32_t producerCount,
+                       uint32_t count) {
+  if (!IsSelected(name))
+    return;
+
+  std::atomic<uint64_t> done{0};
+  uint64_t total = (uint64_t)producerCount * count;
+  auto start = std::chrono::steady_clock::now();
+
+  {
+    Queue_t queue;
+    std::vector<std::thread> producers;
+    TaskCapture_s capture = {};
+
+    for (uint32_t p = 0; p < producerCount; ++p) {
+      producers.emplace_back([&queue, &done, capture, count]() {
+        for (uint32_t i = 0; i < count; ++i) {
+          queue.Queue([&done, capture]() {
+            g_Sink = g_Sink + (uint64_t)(uintptr_t)capture.Pointers[0];
+            done.fetch_add(1, std::memory_order_relaxed);
+          });
+        }
+      });
+    }
+
+    for (auto& producer : producers)
+      producer.join();
+
+    while (done.load(std::memory_order_relaxed) != total)
+      std::this_thread::yield();
+  }
+
+  double ns = ElapsedNs(start);
+  printf("%-44s %12.1f ns/op %12.0f ops/s\n", name, ns / total,
+         total / (ns / 1e9));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (2 <= argc)
+    g_Filter = argv[1];
+
+  RunPrimitives();
+  RunRenderView();
+  RunGameEvent();
+  RunCalcBatch();
+  RunCapture();
+  RunRoundTrip("Round trip (4 B request)", 0, 20000);
+  RunRoundTrip("Round trip (64 KiB request)", 64 * 1024, 2000);
+  RunMuxRoundTrip("Mux round trip (1 channel, 4 B request)", 1, 0, 20000);
+  RunMuxRoundTrip("Mux round trip (8 channels, 4 B request)", 8, 0, 5000);
+  RunMuxRoundTrip("Mux round trip (8 channels, 64 KiB request)", 8,
+                  64 * 1024, 500);
+  RunTaskLatency<CMutexQueue>("Task latency (old queue)", 0, 100000);
+  RunTaskLatency<CThreadedQueue>("Task latency (queue)", 0, 100000);
+  RunTaskLatency<CMutexQueue>("Task latency, idle (old queue)", 200, 2000);
+  RunTaskLatency<CThreadedQueue>("Task latency, idle (queue)", 200, 2000);
+  RunTaskThroughput<CMutexQueue>("Task throughput, 1 producer (old queue)", 1,
+                                 1000000);
+  RunTaskThroughput<CThreadedQueue>("Task throughput, 1 producer (queue)", 1,
+                                    1000000);
+  RunTaskThroughput<CMutexQueue>("Task throughput, 4 producers (old queue)", 4,
+                                 250000);
+  RunTaskThroughput<CThreadedQueue>("Task throughput, 4 producers (queue)", 4,
+                                    250000);
+
+  return 0;
+}
@@ -992,20 +992,8 @@ MyD3D11CreateDevice(_In_opt_ IDXGIAdapter* pAdapter,
     try {
       std::unique_lock<std::mutex> lock(g_GpuPipeClientMutex);
 
-      while (true)
-      {
-        bool bError = false;
-        try {
-          g_GpuPipeClient.OpenPipe(strPipeName.c_str(), INFINITE);
-          Sleep(100);
-        }
-        catch(const std::exception&)
-        {
-          bError = true;
-        }
-
-        if(!bError) break;
-      }
+      // Waits for the handler to create the pipe:
+      g_GpuPipeClient.OpenPipe(strPipeName.c_str(), INFINITE);
 
       //MessageBoxA(0, strPipeName.c_str(), "CLIENT", MB_OK);
 
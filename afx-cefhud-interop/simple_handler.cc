@@ -36,30 +36,46 @@ std::string GetDataURI(const std::string& data, const std::string& mime_type) {
 
 
 SimpleHandler::SimpleHandler(class SimpleApp * simpleApp) : simple_app_(simpleApp), g_GpuPipeServer(this) {
-    m_BrowserWaitConnectionThread =
-      std::thread(&SimpleHandler::BrowserWaitConnectionThreadHandler, this);
+    m_BrowserWaitConnectionThread = advancedfx::interop::CPooledThread(
+        &SimpleHandler::BrowserWaitConnectionThreadHandler, this);
 }
 
 SimpleHandler::~SimpleHandler() {
   m_BrowserWaitConnectionQuit = true;
-  CancelSynchronousIo(m_BrowserWaitConnectionThread.native_handle());
+  m_HandlerEndpoint.Cancel();
   if (m_BrowserWaitConnectionThread.joinable())
     m_BrowserWaitConnectionThread.join();
 }
 
 
 void SimpleHandler::BrowserWaitConnectionThreadHandler(void) {
-  std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_handler_");
+  std::string strPipeName("afx-cefhud-interop_handler_");
   strPipeName.append(std::to_string(GetCurrentProcessId()));
 
-   while (!m_BrowserWaitConnectionQuit) {
-    try {
-      this->WaitForConnection(strPipeName.c_str(), 500);
-    } catch (const std::exception& e) {
-      DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": " << e.what();
-      DebugBreak();
+  // One connection per render process, its interops share it.
+  if (!m_HandlerEndpoint.ListenShared(strPipeName.c_str())) {
+    DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
+                << "ListenShared failed: " << m_HandlerEndpoint.GetErrorCode();
+    DebugBreak();
+    return;
+  }
+
+  while (!m_BrowserWaitConnectionQuit) {
+    auto connection = std::make_shared<CHandlerConnection>(this);
+
+    if (!m_HandlerEndpoint.Accept(connection->GetTransport())) {
+      if (!m_BrowserWaitConnectionQuit) {
+        DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
+                    << "Accept failed: " << m_HandlerEndpoint.GetErrorCode();
+        DebugBreak();
+      }
+      break;
     }
+
+    connection->Start();
   }
+
+  m_HandlerEndpoint.Close();
 }
 
 void SimpleHandler::OnTitleChange(CefRefPtr<CefBrowser> browser,
@@ -30,8 +30,7 @@ class SimpleHandler : public CefClient,
                       public CefRenderHandler,
                       public CefLifeSpanHandler,
                       public CefLoadHandler,
-                      public CefRequestHandler,
-                      private advancedfx::interop::CPipeServer {
+                      public CefRequestHandler {
  public:
 
   explicit SimpleHandler(class SimpleApp * simpleApp);
@@ -145,10 +144,34 @@ class SimpleHandler : public CefClient,
  protected:
   class CHostPipeServerConnectionThread;
 
-  advancedfx::interop::CPipeServerConnectionThread * OnNewConnection(HANDLE handle) override {
-    //MessageBoxA(NULL, "A", "NEW", MB_OK);
-    return new CHostPipeServerConnectionThread(handle, this);
-  }
+  // A render process' connection, each of its interops opens a channel.
+  class CHandlerConnection : public advancedfx::interop::CMuxConnection {
+   public:
+    CHandlerConnection(SimpleHandler* host)
+        : advancedfx::interop::CMuxConnection(&m_Transport, false),
+          m_Host(host) {}
+
+    advancedfx::interop::CPlatformEndpointTransport& GetTransport() {
+      return m_Transport;
+    }
+
+    void Start() {
+      advancedfx::interop::CPooledThread([self = shared_from_this()] {
+        self->Run();
+      }).detach();
+    }
+
+   protected:
+    virtual void OnOpenChannel(
+        const std::shared_ptr<advancedfx::interop::CMuxChannel>& channel)
+        override {
+      new CHostPipeServerConnectionThread(channel, m_Host);
+    }
+
+   private:
+    advancedfx::interop::CPlatformEndpointTransport m_Transport;
+    SimpleHandler* m_Host;
+  };
 
  private:
 
@@ -247,11 +270,17 @@ class SimpleHandler : public CefClient,
   };
 
   class CHostPipeServerConnectionThread
-      : public advancedfx::interop::CPipeServerConnectionThread {
+      : public advancedfx::interop::CPipeChannel {
    public:
-    CHostPipeServerConnectionThread(HANDLE handle, SimpleHandler* host)
-        : advancedfx::interop::CPipeServerConnectionThread(handle),
-          m_Host(host) {}
+    CHostPipeServerConnectionThread(
+        const std::shared_ptr<advancedfx::interop::CMuxChannel>& channel,
+        SimpleHandler* host)
+        : advancedfx::interop::CPipeChannel(channel),
+          m_Host(host),
+          m_ClientConnection(channel) {
+      m_Thread = advancedfx::interop::CPooledThread(
+          &CHostPipeServerConnectionThread::ConnectionThread, this);
+    }
 
     void Lock() { m_SupressUpdates = true;
     }
@@ -307,8 +336,9 @@ class SimpleHandler : public CefClient,
         lock.unlock();
  
         m_Quit = true;
-        Cancel();
-        Join();
+        CancelChannel();
+        if (m_Thread.joinable())
+          m_Thread.join();
 
         delete this;
 
@@ -317,34 +347,18 @@ class SimpleHandler : public CefClient,
 
    protected:
 
-    virtual void ConnectionThread() override {
-      DWORD processId;
+    void ConnectionThread() {
       int browserId;
 
-      processId = ReadUInt32();
-      browserId = ReadInt32();
-
-      if(browserId)
-      {
-        std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_client_");
-        strPipeName.append(std::to_string(processId));
-        strPipeName.append("_");
-        strPipeName.append(std::to_string(browserId));
-
-        while(true)
-        {
-          bool bError = false;
-          try {
-           m_ClientConnection.OpenPipe(strPipeName.c_str(), INFINITE);
-            Sleep(100);
-          }
-          catch(const std::exception&)
-          {
-            bError = true;
-          }
-
-          if(!bError) break;
-        }
+      try {
+        browserId = ReadInt32();
+      } catch (const std::exception& e) {
+        DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
+                    << e.what();
+        CloseChannel();
+        m_Thread.detach();
+        delete this;
+        return;
       }
 
       {
@@ -408,29 +422,28 @@ class SimpleHandler : public CefClient,
 
       m_Owner->Connection = nullptr;
 
-      try {
-        m_ClientConnection.ClosePipe();
-      } catch (const std::exception& e) {
-        DLOG(ERROR) << "Error in " << __FILE__ << ":" << __LINE__ << ": "
-                    << e.what();
-        DebugBreak();
+      {
+        std::unique_lock<std::mutex> lock(m_ClientConnectionMutex);
+        m_ClientConnection.CloseChannel();
       }
 
-      ClosePipe();
+      CloseChannel();
 
       if (!m_ExternalAbort) {
-        Detach();
+        m_Thread.detach();
 
         delete this;
       }
     }
 
    private:
+    advancedfx::interop::CPooledThread m_Thread;
     bool m_Quit = false;
     bool m_ExternalAbort = false;
     SimpleHandler* m_Host;
     BrowserMapElem* m_Owner = nullptr;
-    advancedfx::interop::CPipeClient m_ClientConnection;
+    // Writes the ClientMessages, the thread reads on the other one.
+    advancedfx::interop::CPipeChannel m_ClientConnection;
     std::mutex m_ClientConnectionMutex;
 
     std::atomic<bool> m_UseClearTexture = false;
@@ -440,13 +453,13 @@ class SimpleHandler : public CefClient,
   class CGpuPipeServer : public advancedfx::interop::CPipeServer {
    public:
     CGpuPipeServer(SimpleHandler* host) : m_Host(host) {
-      m_GpuWaitConnectionThread =
-          std::thread(&CGpuPipeServer::GpuWaitConnectionThreadHandler, this);
+      m_GpuWaitConnectionThread = advancedfx::interop::CPooledThread(
+          &CGpuPipeServer::GpuWaitConnectionThreadHandler, this);
     }
       
     ~CGpuPipeServer() {
       m_GpuWaitConnectionQuit = true;
-      CancelSynchronousIo(m_GpuWaitConnectionThread.native_handle());
+      CancelWaitForConnection();
       if (m_GpuWaitConnectionThread.joinable())
         m_GpuWaitConnectionThread.join();
     }
@@ -549,7 +562,7 @@ class SimpleHandler : public CefClient,
      std::mutex m_ConnectionsMutex;
 
   bool m_GpuWaitConnectionQuit = false;
-     std::thread m_GpuWaitConnectionThread;
+     advancedfx::interop::CPooledThread m_GpuWaitConnectionThread;
 
      void GpuWaitConnectionThreadHandler(void) {
        std::string strPipeName("\\\\.\\pipe\\afx-cefhud-interop_gpu_handler_");
@@ -575,7 +588,8 @@ private:
   bool is_closing_;
 
   bool m_BrowserWaitConnectionQuit = false;
-  std::thread m_BrowserWaitConnectionThread;
+  advancedfx::interop::CPooledThread m_BrowserWaitConnectionThread;
+  advancedfx::interop::CPlatformEndpointTransport m_HandlerEndpoint;
   void BrowserWaitConnectionThreadHandler(void);
 
   std::mutex m_BrowserMutex;
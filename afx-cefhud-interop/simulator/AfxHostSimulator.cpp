@@ -0,0 +1,1350 @@
+// Stand-in for the HLAE side of the interop protocol, so CEngineInteropImpl
+// and CDrawingInteropImpl can be load tested without the game.
+//
+// Usage: afx-cefhud-interop-simulator [options]
+//
+//   --engine <name>        drive the engine interop listening on name
+//   --drawing <name>       drive the drawing interop listening on name
+//   --frames <n>           frames to simulate, 0 runs until killed (600)
+//   --fps <n>              target frame rate, 0 runs unthrottled (0)
+//   --passes <n>           render passes per frame, 0 - 7 (7)
+//   --commands <n>         console commands per frame (1)
+//   --events <n>           game events per frame (8)
+//   --storm <every>:<n>    n extra game events every <every> frames (off)
+//   --calc-miss <percent>  calc requests answered without a result (0)
+//   --fail-every <n>       answer every n-th drawing command with E_FAIL (off)
+//   --reconnect-every <n>  drop the connection every n frames (off)
+//   --no-bulk              refuse bulk channels
+//   --no-resume            don't resume engine sessions after reconnecting
+//   --legacy               don't negotiate versions and capabilities
+//   --report <seconds>     seconds between progress lines, 0 for none (1)
+//
+// On Windows name is relative to \\.\pipe\, elsewhere it is the path of the
+// Unix domain socket. The simulator keeps trying to connect until the interop
+// listens. Frame times are the time the simulated game spends blocked on the
+// interop, so they don't include the pacing.
+
+#include "AfxInteropProtocol.h"
+#include "AfxSharedMemory.h"
+#include "AfxTransport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+namespace {
+
+const int32_t g_E_FAIL = (int32_t)0x80004005;
+
+// ERROR_GEN_FAILURE, what HLAE reports when it has nothing better.
+const uint32_t g_LastError = 31;
+
+const uint32_t g_MaxRetries = 16;
+
+struct Options_s {
+  std::string EngineName;
+  std::string DrawingName;
+  uint32_t Frames = 600;
+  uint32_t Fps = 0;
+  uint32_t Passes = 7;
+  uint32_t Commands = 1;
+  uint32_t Events = 8;
+  uint32_t StormEvery = 0;
+  uint32_t StormEvents = 0;
+  uint32_t CalcMissPercent = 0;
+  uint32_t FailEvery = 0;
+  uint32_t ReconnectEvery = 0;
+  bool Bulk = true;
+  bool Resume = true;
+  bool Legacy = false;
+  uint32_t ReportSeconds = 1;
+};
+
+// Counters of one side, written by its thread and polled by the reporter.
+struct Stats_s {
+  std::atomic<uint64_t> Frames{0};
+  // Engine messages, drawing commands:
+  std::atomic<uint64_t> Messages{0};
+  std::atomic<uint64_t> Events{0};
+  std::atomic<uint64_t> Calcs{0};
+  std::atomic<uint64_t> Failed{0};
+  std::atomic<uint64_t> Retries{0};
+  std::atomic<uint64_t> Reconnects{0};
+  std::atomic<uint64_t> BulkBytes{0};
+  std::atomic<uint64_t> InlineBytes{0};
+
+  // Only touched by the owning thread, read after it finished:
+  std::vector<uint32_t> FrameUs;
+  std::chrono::steady_clock::duration Elapsed{0};
+};
+
+class CRandom {
+ public:
+  explicit CRandom(uint32_t seed) : m_State(seed ? seed : 1) {}
+
+  uint32_t Next() {
+    m_State ^= m_State << 13;
+    m_State ^= m_State >> 17;
+    m_State ^= m_State << 5;
+    return m_State;
+  }
+
+  float NextFloat(float range) {
+    return (float)(Next() % 65536) / 65536.0f * range;
+  }
+
+ private:
+  uint32_t m_State;
+};
+
+// Sleeps the rest of the frame period, doesn't try to catch up once behind.
+class CFramePacer {
+ public:
+  explicit CFramePacer(uint32_t fps)
+      : m_Period(0 < fps ? std::chrono::microseconds(1000000 / fps)
+                         : std::chrono::microseconds(0)),
+        m_Next(std::chrono::steady_clock::now()) {}
+
+  void Wait() {
+    if (0 == m_Period.count())
+      return;
+
+    m_Next += m_Period;
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_Next)
+      std::this_thread::sleep_until(m_Next);
+    else
+      m_Next = now;
+  }
+
+ private:
+  std::chrono::microseconds m_Period;
+  std::chrono::steady_clock::time_point m_Next;
+};
+
+// Game events //////////////////////////////////////////////////////////////
+
+struct GameEventKey_s {
+  const char* Name;
+  GameEventFieldType Type;
+};
+
+struct GameEventDescription_s {
+  int32_t Id;
+  const char* Name;
+  std::vector<GameEventKey_s> Keys;
+};
+
+const GameEventDescription_s g_GameEvents[] = {
+    {1,
+     "weapon_fire",
+     {{"userid", GameEventFieldType::Short},
+      {"weapon", GameEventFieldType::CString},
+      {"silenced", GameEventFieldType::Bool}}},
+    {2,
+     "bullet_impact",
+     {{"userid", GameEventFieldType::Short},
+      {"x", GameEventFieldType::Float},
+      {"y", GameEventFieldType::Float},
+      {"z", GameEventFieldType::Float}}},
+    {3,
+     "player_hurt",
+     {{"userid", GameEventFieldType::Short},
+      {"attacker", GameEventFieldType::Short},
+      {"health", GameEventFieldType::Byte},
+      {"armor", GameEventFieldType::Byte},
+      {"weapon", GameEventFieldType::CString},
+      {"dmg_health", GameEventFieldType::Short},
+      {"dmg_armor", GameEventFieldType::Byte},
+      {"hitgroup", GameEventFieldType::Byte}}},
+    {4,
+     "player_death",
+     {{"userid", GameEventFieldType::Short},
+      {"attacker", GameEventFieldType::Short},
+      {"assister", GameEventFieldType::Short},
+      {"weapon", GameEventFieldType::CString},
+      {"headshot", GameEventFieldType::Bool},
+      {"penetrated", GameEventFieldType::Short},
+      {"splitscreenplayer", GameEventFieldType::Local}}},
+    {5,
+     "player_connect",
+     {{"name", GameEventFieldType::CString},
+      {"index", GameEventFieldType::Byte},
+      {"userid", GameEventFieldType::Short},
+      {"networkid", GameEventFieldType::CString},
+      {"xuid", GameEventFieldType::Uint64},
+      {"bot", GameEventFieldType::Bool}}},
+    {6,
+     "round_start",
+     {{"timelimit", GameEventFieldType::Long},
+      {"fraglimit", GameEventFieldType::Long},
+      {"objective", GameEventFieldType::CString}}}};
+
+const size_t g_GameEventCount = sizeof(g_GameEvents) / sizeof(g_GameEvents[0]);
+
+const char* const g_Weapons[] = {"ak47", "m4a1", "awp", "deagle", "glock"};
+
+// Simulator ////////////////////////////////////////////////////////////////
+
+class CSimulator {
+ public:
+  CSimulator(const char* side, const Options_s& options, Stats_s& stats)
+      : m_Side(side),
+        m_Options(options),
+        m_Stats(stats),
+        m_Stream(&m_Transport),
+        m_Random(0x2a) {}
+
+  virtual ~CSimulator() {}
+
+  /**
+   * Connects to name and runs the configured number of frames.
+   * @returns false on error.
+   */
+  bool Run(const std::string& name) {
+    if (!Connect(name))
+      return false;
+
+    CFramePacer pacer(m_Options.Fps);
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t frame = 0;
+         0 == m_Options.Frames || frame < m_Options.Frames; ++frame) {
+      auto frameStart = std::chrono::steady_clock::now();
+
+      // Like a pipe hiccup, the interop has to pump again to get us back:
+      if (0 < frame && 0 < m_Options.ReconnectEvery &&
+          0 == frame % m_Options.ReconnectEvery) {
+        m_Transport.Close();
+        ++m_Stats.Reconnects;
+        if (!Connect(name)) {
+          m_Stats.Elapsed = std::chrono::steady_clock::now() - start;
+          return false;
+        }
+      }
+
+      if (!DoFrame(frame)) {
+        m_Stats.Elapsed = std::chrono::steady_clock::now() - start;
+        printf("%s: failed in %s of frame %u.\n", m_Side, m_Step, frame);
+        m_Transport.Close();
+        return false;
+      }
+
+      m_Stats.FrameUs.push_back(
+          (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - frameStart)
+              .count());
+      ++m_Stats.Frames;
+
+      pacer.Wait();
+    }
+
+    m_Stats.Elapsed = std::chrono::steady_clock::now() - start;
+    m_Transport.Close();
+    return true;
+  }
+
+ protected:
+  const char* m_Side;
+  const Options_s& m_Options;
+  Stats_s& m_Stats;
+  CPlatformEndpointTransport m_Transport;
+  CTransportStream m_Stream;
+  CRandom m_Random;
+  // What is being done, for error messages:
+  const char* m_Step = "connect";
+
+  /**
+   * Waits for the interop to listen and does the handshake.
+   * @returns false on error.
+   */
+  bool Connect(const std::string& name) {
+    m_Step = "connect";
+
+    printf("%s: waiting for %s ...\n", m_Side, name.c_str());
+    if (!m_Transport.OpenWhenReady(name.c_str(), AFX_INFINITE_TIMEOUT)) {
+      printf("%s: connecting failed.\n", m_Side);
+      return false;
+    }
+    m_Stream.ResetBuffers();
+
+    printf("%s: connected to %s.\n", m_Side, name.c_str());
+
+    if (!OnConnected()) {
+      printf("%s: handshake failed in %s.\n", m_Side, m_Step);
+      m_Transport.Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  virtual bool OnConnected() = 0;
+
+  virtual bool DoFrame(uint32_t frame) = 0;
+
+  // What the simulator would like to use, as far as the options allow.
+  uint32_t GetWantedCapabilities() const {
+    return m_Options.Bulk ? (uint32_t)InteropCapability_BulkChannel : 0;
+  }
+
+  static View_s MakeView() {
+    View_s view;
+    memset(&view, 0, sizeof(view));
+    view.Width = 1920;
+    view.Height = 1080;
+    for (size_t i = 0; i < 16; i += 5) {
+      view.ViewMatrix[i] = 1;
+      view.ProjectionMatrix[i] = 1;
+    }
+    return view;
+  }
+};
+
+// HLAE's engine connection.
+class CEngineSimulator : public CSimulator {
+ public:
+  CEngineSimulator(const Options_s& options, Stats_s& stats)
+      : CSimulator("engine", options, stats) {}
+
+ protected:
+  virtual bool OnConnected() override {
+    m_Step = "handshake";
+
+    int32_t serverMajor;
+    if (!m_Stream.ReadInt32(serverMajor))
+      return false;
+
+    bool supported = 7 == serverMajor;
+    if (!m_Stream.WriteBoolean(supported) || !m_Stream.Flush() || !supported)
+      return false;
+
+    bool is64;
+    uint32_t serverMinor, serverPatch, serverBuild;
+    if (!m_Stream.ReadBoolean(is64) || !m_Stream.ReadUInt32(serverMinor) ||
+        !m_Stream.ReadUInt32(serverPatch) || !m_Stream.ReadUInt32(serverBuild))
+      return false;
+
+    printf("engine: interop %i.%u.%u.%u (%s).\n", serverMajor, serverMinor,
+           serverPatch, serverBuild, is64 ? "64 bit" : "32 bit");
+
+    // Capabilities are negotiated from 7.1 on:
+    bool negotiate = !m_Options.Legacy && 1 <= serverMinor;
+
+    const uint32_t clientVersion[4] = {7, negotiate ? 1u : 0u, 0, 0};
+    for (size_t i = 0; i < 4; ++i) {
+      if (!m_Stream.WriteUInt32(clientVersion[i]))
+        return false;
+    }
+    if (!m_Stream.WriteBoolean(true) || !m_Stream.Flush())
+      return false;
+
+    bool accepted;
+    if (!m_Stream.ReadBoolean(accepted) || !accepted)
+      return false;
+
+    uint32_t capabilities = 0;
+    if (negotiate) {
+      uint32_t wanted = GetWantedCapabilities();
+      if (m_Options.Resume)
+        wanted |= InteropCapability_SessionResume;
+
+      uint32_t offered;
+      if (!m_Stream.ReadUInt32(offered))
+        return false;
+      capabilities = offered & wanted;
+      if (!m_Stream.WriteUInt32(capabilities) || !m_Stream.Flush())
+        return false;
+      printf("engine: capabilities 0x%x.\n", capabilities);
+    }
+
+    bool resumed = false;
+    if (0 != (capabilities & InteropCapability_SessionResume)) {
+      m_Step = "session";
+      if (!ResumeSession(resumed))
+        return false;
+    }
+
+    m_Step = "game event settings";
+    return ReadGameEventSettings(resumed);
+  }
+
+  virtual bool DoFrame(uint32_t frame) override {
+    m_Step = "BeforeFrameStart";
+    if (!DoBeforeFrameStart())
+      return false;
+
+    m_Step = "GameEvent";
+    uint32_t events = m_Options.Events;
+    if (0 < m_Options.StormEvery && 0 == frame % m_Options.StormEvery)
+      events += m_Options.StormEvents;
+    if (!DoGameEvents(events))
+      return false;
+
+    m_Step = "BeforeFrameRenderStart";
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::BeforeFrameRenderStart) ||
+        !m_Stream.Flush() || !ReadGameEventSettings(true))
+      return false;
+    ++m_Stats.Messages;
+
+    m_Step = "AfterFrameRenderStart";
+    if (!DoCalcs())
+      return false;
+
+    m_Step = "OnViewOverride";
+    if (!DoViewOverride())
+      return false;
+
+    m_Step = "OnRenderView";
+    if (!DoRenderView(frame))
+      return false;
+
+    return m_Stream.Flush();
+  }
+
+ private:
+  enum CalcType_e {
+    CalcType_Handle,
+    CalcType_VecAng,
+    CalcType_Cam,
+    CalcType_Fov,
+    CalcType_Bool,
+    CalcType_Int,
+    CalcType_Count
+  };
+
+  typedef std::pair<std::string, std::string> EnrichmentKey_t;
+
+  bool m_GameEventsEnabled = false;
+  bool m_TransmitClientTime = false;
+  bool m_TransmitTick = false;
+  bool m_TransmitSystemTime = false;
+  std::set<std::string> m_Allow;
+  std::set<std::string> m_Deny;
+  std::map<EnrichmentKey_t, uint32_t> m_Enrichments;
+  std::set<int32_t> m_KnownGameEvents;
+  size_t m_NextGameEvent = 0;
+  uint64_t m_SessionToken = 0;
+  std::vector<std::string> m_CalcNames[CalcType_Count];
+
+  bool ReadStrings(std::set<std::string>& set, bool erase) {
+    uint32_t count;
+    if (!m_Stream.ReadCompressedUInt32(count))
+      return false;
+
+    for (; 0 < count; --count) {
+      std::string value;
+      if (!m_Stream.ReadStringUTF8(value))
+        return false;
+      if (erase)
+        set.erase(value);
+      else
+        set.insert(value);
+    }
+
+    return true;
+  }
+
+  bool ResumeSession(bool& outResumed) {
+    uint64_t token;
+    if (!m_Stream.ReadUInt64(token))
+      return false;
+
+    outResumed = 0 != token && token == m_SessionToken;
+    if (!m_Stream.WriteBoolean(outResumed) || !m_Stream.Flush())
+      return false;
+
+    if (!outResumed) {
+      // The full game event settings follow and clear the rest.
+      return m_Stream.ReadUInt64(m_SessionToken);
+    }
+
+    // Descriptions that didn't make it are sent again:
+    uint32_t count;
+    if (!m_Stream.ReadCompressedUInt32(count))
+      return false;
+
+    m_KnownGameEvents.clear();
+    for (; 0 < count; --count) {
+      int32_t id;
+      if (!m_Stream.ReadInt32(id))
+        return false;
+      m_KnownGameEvents.insert(id);
+    }
+
+    printf("engine: resumed session, %u game events known.\n",
+           (unsigned int)m_KnownGameEvents.size());
+    return true;
+  }
+
+  bool ReadGameEventSettings(bool delta) {
+    if (!m_Stream.ReadBoolean(m_GameEventsEnabled))
+      return false;
+
+    if (!m_GameEventsEnabled)
+      return true;
+
+    if (delta) {
+      bool changed;
+      if (!m_Stream.ReadBoolean(changed))
+        return false;
+      if (!changed)
+        return true;
+    } else {
+      // The interop forgets the descriptions it has seen.
+      m_KnownGameEvents.clear();
+      m_Allow.clear();
+      m_Deny.clear();
+      m_Enrichments.clear();
+    }
+
+    if (!m_Stream.ReadBoolean(m_TransmitClientTime) ||
+        !m_Stream.ReadBoolean(m_TransmitTick) ||
+        !m_Stream.ReadBoolean(m_TransmitSystemTime))
+      return false;
+
+    if (delta && !ReadStrings(m_Allow, true))
+      return false;
+    if (!ReadStrings(m_Allow, false))
+      return false;
+    if (delta && !ReadStrings(m_Deny, true))
+      return false;
+    if (!ReadStrings(m_Deny, false))
+      return false;
+
+    uint32_t count;
+    if (!m_Stream.ReadCompressedUInt32(count))
+      return false;
+
+    for (; 0 < count; --count) {
+      EnrichmentKey_t key;
+      uint32_t type;
+      if (!m_Stream.ReadStringUTF8(key.first) ||
+          !m_Stream.ReadStringUTF8(key.second) || !m_Stream.ReadUInt32(type))
+        return false;
+      if (0 == type)
+        m_Enrichments.erase(key);
+      else
+        m_Enrichments[key] = type;
+    }
+
+    return true;
+  }
+
+  bool DoBeforeFrameStart() {
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::BeforeFrameStart) ||
+        !m_Stream.WriteCompressedUInt32(m_Options.Commands))
+      return false;
+
+    for (uint32_t i = 0; i < m_Options.Commands; ++i) {
+      if (!m_Stream.WriteCompressedUInt32(2) ||
+          !m_Stream.WriteStringUTF8("afx_simulator") ||
+          !m_Stream.WriteStringUTF8(std::to_string(i)))
+        return false;
+    }
+
+    if (!m_Stream.Flush())
+      return false;
+
+    uint32_t count;
+    if (!m_Stream.ReadCompressedUInt32(count))
+      return false;
+
+    for (; 0 < count; --count) {
+      std::string command;
+      if (!m_Stream.ReadStringUTF8(command))
+        return false;
+    }
+
+    ++m_Stats.Messages;
+    return true;
+  }
+
+  bool IsGameEventAllowed(const GameEventDescription_s& description) const {
+    if (!m_Allow.empty() && m_Allow.end() == m_Allow.find(description.Name))
+      return false;
+    return m_Deny.end() == m_Deny.find(description.Name);
+  }
+
+  bool DoGameEvents(uint32_t count) {
+    if (!m_GameEventsEnabled)
+      return true;
+
+    for (; 0 < count; --count) {
+      const GameEventDescription_s* description = nullptr;
+      for (size_t i = 0; i < g_GameEventCount; ++i) {
+        const GameEventDescription_s& candidate =
+            g_GameEvents[m_NextGameEvent++ % g_GameEventCount];
+        if (IsGameEventAllowed(candidate)) {
+          description = &candidate;
+          break;
+        }
+      }
+
+      if (nullptr == description)
+        return true;
+
+      if (!WriteGameEvent(*description))
+        return false;
+
+      ++m_Stats.Messages;
+      ++m_Stats.Events;
+    }
+
+    // Game events are fire and forget, so this is where the interop could
+    // fall behind.
+    return m_Stream.Flush();
+  }
+
+  bool WriteGameEvent(const GameEventDescription_s& description) {
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::GameEvent))
+      return false;
+
+    if (m_KnownGameEvents.insert(description.Id).second) {
+      if (!m_Stream.WriteInt32(0) || !m_Stream.WriteInt32(description.Id) ||
+          !m_Stream.WriteStringUTF8(description.Name))
+        return false;
+      for (const GameEventKey_s& key : description.Keys) {
+        if (!m_Stream.WriteBoolean(true) || !m_Stream.WriteStringUTF8(key.Name) ||
+            !m_Stream.WriteInt32((int32_t)key.Type))
+          return false;
+      }
+      if (!m_Stream.WriteBoolean(false))
+        return false;
+    } else if (!m_Stream.WriteInt32(description.Id))
+      return false;
+
+    if (m_TransmitClientTime && !m_Stream.WriteSingle(m_Random.NextFloat(100)))
+      return false;
+    if (m_TransmitTick && !m_Stream.WriteInt32((int32_t)m_Stats.Frames))
+      return false;
+    if (m_TransmitSystemTime &&
+        !m_Stream.WriteUInt64(
+            (uint64_t)std::chrono::system_clock::now().time_since_epoch().count()))
+      return false;
+
+    for (const GameEventKey_s& key : description.Keys) {
+      bool ok = true;
+      switch (key.Type) {
+        case GameEventFieldType::CString:
+          ok = m_Stream.WriteStringUTF8(
+              g_Weapons[m_Random.Next() %
+                        (sizeof(g_Weapons) / sizeof(g_Weapons[0]))]);
+          break;
+        case GameEventFieldType::Float:
+          ok = m_Stream.WriteSingle(m_Random.NextFloat(4096));
+          break;
+        case GameEventFieldType::Long:
+          ok = m_Stream.WriteInt32((int32_t)(m_Random.Next() % 1000));
+          break;
+        case GameEventFieldType::Short: {
+          int16_t value = (int16_t)(m_Random.Next() % 64);
+          ok = m_Stream.WriteBytes(&value, 0, sizeof(value));
+        } break;
+        case GameEventFieldType::Byte:
+          ok = m_Stream.WriteByte((uint8_t)m_Random.Next());
+          break;
+        case GameEventFieldType::Bool:
+          ok = m_Stream.WriteBoolean(0 != (m_Random.Next() & 1));
+          break;
+        case GameEventFieldType::Uint64:
+          ok = m_Stream.WriteUInt64(76561197960265728ull + m_Random.Next());
+          break;
+        case GameEventFieldType::Local:
+          break;
+      }
+      if (!ok)
+        return false;
+
+      auto itEnrichment =
+          m_Enrichments.find(EnrichmentKey_t(description.Name, key.Name));
+      if (itEnrichment == m_Enrichments.end())
+        continue;
+
+      uint32_t type = itEnrichment->second;
+      Vector_s vector;
+      QAngle_s angle;
+      if ((type & (1 << 0)) &&
+          !m_Stream.WriteUInt64(76561197960265728ull + m_Random.Next()))
+        return false;
+      if ((type & (1 << 1)) && !WriteVector(m_Stream, vector))
+        return false;
+      if ((type & (1 << 2)) && !WriteQAngle(m_Stream, angle))
+        return false;
+      if ((type & (1 << 3)) && !WriteVector(m_Stream, vector))
+        return false;
+      if ((type & (1 << 4)) && !WriteQAngle(m_Stream, angle))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool DoCalcs() {
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::AfterFrameRenderStart) ||
+        !m_Stream.Flush())
+      return false;
+
+    for (size_t type = 0; type < CalcType_Count; ++type) {
+      uint32_t count;
+      if (!m_Stream.ReadCompressedUInt32(count))
+        return false;
+
+      m_CalcNames[type].resize(count);
+      for (uint32_t i = 0; i < count; ++i) {
+        if (!m_Stream.ReadStringUTF8(m_CalcNames[type][i]))
+          return false;
+      }
+    }
+
+    Vector_s vector;
+    QAngle_s angle;
+
+    for (size_t type = 0; type < CalcType_Count; ++type) {
+      for (size_t i = 0; i < m_CalcNames[type].size(); ++i) {
+        bool hasResult = m_Random.Next() % 100 >= m_Options.CalcMissPercent;
+        if (!m_Stream.WriteBoolean(hasResult))
+          return false;
+
+        ++m_Stats.Calcs;
+        if (!hasResult)
+          continue;
+
+        bool ok = true;
+        switch (type) {
+          case CalcType_Handle:
+          case CalcType_Int:
+            ok = m_Stream.WriteInt32((int32_t)(m_Random.Next() % 2048));
+            break;
+          case CalcType_VecAng:
+            ok = WriteVector(m_Stream, vector) && WriteQAngle(m_Stream, angle);
+            break;
+          case CalcType_Cam:
+            ok = WriteVector(m_Stream, vector) &&
+                 WriteQAngle(m_Stream, angle) && m_Stream.WriteSingle(90);
+            break;
+          case CalcType_Fov:
+            ok = m_Stream.WriteSingle(90);
+            break;
+          case CalcType_Bool:
+            ok = m_Stream.WriteBoolean(0 != (m_Random.Next() & 1));
+            break;
+        }
+        if (!ok)
+          return false;
+      }
+    }
+
+    ++m_Stats.Messages;
+    return m_Stream.Flush();
+  }
+
+  bool DoViewOverride() {
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::OnViewOverride))
+      return false;
+    for (size_t i = 0; i < 7; ++i) {
+      if (!m_Stream.WriteSingle(6 == i ? 90.0f : 0.0f))
+        return false;
+    }
+    if (!m_Stream.Flush())
+      return false;
+
+    bool overridden;
+    if (!m_Stream.ReadBoolean(overridden))
+      return false;
+
+    for (size_t i = 0; overridden && i < 7; ++i) {
+      float value;
+      if (!m_Stream.ReadSingle(value))
+        return false;
+    }
+
+    ++m_Stats.Messages;
+    return true;
+  }
+
+  bool DoRenderView(uint32_t frame) {
+    RenderInfo_s renderInfo;
+    renderInfo.FrameCount = (int)frame;
+    renderInfo.FrameTime =
+        0 < m_Options.Fps ? 1.0f / m_Options.Fps : 1.0f / 300.0f;
+    renderInfo.AbsoluteFrameTime = frame * renderInfo.FrameTime;
+    renderInfo.CurTime = renderInfo.AbsoluteFrameTime;
+    renderInfo.View = MakeView();
+
+    if (!m_Stream.WriteUInt32((uint32_t)EngineMessage::OnRenderView) ||
+        !WriteRenderInfo(m_Stream, renderInfo) || !m_Stream.Flush())
+      return false;
+    ++m_Stats.Messages;
+
+    // Which of the passes the interop wants, in EngineMessage order:
+    static const EngineMessage passes[7] = {
+        EngineMessage::BeforeTranslucentShadow,
+        EngineMessage::AfterTranslucentShadow,
+        EngineMessage::BeforeTranslucent,
+        EngineMessage::AfterTranslucent,
+        EngineMessage::BeforeHud,
+        EngineMessage::AfterHud,
+        EngineMessage::OnRenderViewEnd};
+    bool wanted[7];
+    for (size_t i = 0; i < 7; ++i) {
+      if (!m_Stream.ReadBoolean(wanted[i]))
+        return false;
+    }
+
+    for (size_t i = 0; i < 7; ++i) {
+      // The interop finishes its frame on OnRenderViewEnd, so that one is
+      // always sent:
+      if (6 != i && (!wanted[i] || m_Options.Passes <= i))
+        continue;
+
+      if (!m_Stream.WriteUInt32((uint32_t)passes[i]))
+        return false;
+      if (i < 4 && !WriteView(m_Stream, renderInfo.View))
+        return false;
+      ++m_Stats.Messages;
+    }
+
+    return true;
+  }
+};
+
+// HLAE's drawing connection, answers all commands without drawing anything.
+class CDrawingSimulator : public CSimulator {
+ public:
+  CDrawingSimulator(const Options_s& options, Stats_s& stats)
+      : CSimulator("drawing", options, stats) {}
+
+ protected:
+  virtual bool OnConnected() override {
+    if (m_Options.Legacy)
+      return true;
+
+    m_Step = "Hello";
+
+    const uint32_t clientVersion[4] = {7, 1, 0, 0};
+    if (!m_Stream.WriteUInt32((uint32_t)DrawingMessage::Hello))
+      return false;
+    for (size_t i = 0; i < 4; ++i) {
+      if (!m_Stream.WriteUInt32(clientVersion[i]))
+        return false;
+    }
+    if (!m_Stream.WriteUInt32(GetWantedCapabilities()) || !m_Stream.Flush())
+      return false;
+
+    uint32_t serverVersion[4];
+    uint32_t capabilities;
+    for (size_t i = 0; i < 4; ++i) {
+      if (!m_Stream.ReadUInt32(serverVersion[i]))
+        return false;
+    }
+    if (!m_Stream.ReadUInt32(capabilities))
+      return false;
+
+    printf("drawing: interop %u.%u.%u.%u, capabilities 0x%x.\n",
+           serverVersion[0], serverVersion[1], serverVersion[2],
+           serverVersion[3], capabilities);
+    return true;
+  }
+
+  virtual bool DoFrame(uint32_t frame) override {
+    static const DrawingMessage passes[7] = {
+        DrawingMessage::BeforeTranslucentShadow,
+        DrawingMessage::AfterTranslucentShadow,
+        DrawingMessage::BeforeTranslucent,
+        DrawingMessage::AfterTranslucent,
+        DrawingMessage::BeforeHud,
+        DrawingMessage::AfterHud,
+        DrawingMessage::OnRenderViewEnd};
+
+    for (uint32_t pass = 0; pass < 7 && pass < m_Options.Passes; ++pass) {
+      m_Step = "pass";
+      if (!DoPass(passes[pass], frame, pass))
+        return false;
+    }
+
+    return true;
+  }
+
+ private:
+  CSharedMemory m_Bulk;
+  std::vector<unsigned char> m_Scratch;
+  uint64_t m_CommandCount = 0;
+
+  bool DoPass(DrawingMessage message, uint32_t frame, uint32_t pass) {
+    for (uint32_t retries = 0; retries <= g_MaxRetries; ++retries) {
+      if (0 < retries)
+        ++m_Stats.Retries;
+
+      if (!m_Stream.WriteUInt32((uint32_t)message) ||
+          !m_Stream.WriteBoolean(false) ||
+          !m_Stream.WriteInt32((int32_t)frame) ||
+          !m_Stream.WriteUInt32(pass) || !m_Stream.Flush())
+        return false;
+
+      while (true) {
+        uint32_t reply;
+        m_Step = "reply";
+        if (!m_Stream.ReadUInt32(reply))
+          return false;
+
+        if ((uint32_t)DrawingReply::Skip == reply ||
+            (uint32_t)DrawingReply::Finished == reply)
+          return true;
+        if ((uint32_t)DrawingReply::Retry == reply)
+          break;
+
+        m_Step = "command";
+        if (!DoCommand((DrawingReply)reply) || !m_Stream.Flush())
+          return false;
+        ++m_Stats.Messages;
+      }
+    }
+
+    return true;
+  }
+
+  bool Skip(uint32_t length) {
+    if (m_Scratch.size() < length)
+      m_Scratch.resize(length);
+    return 0 == length || m_Stream.ReadBytes(m_Scratch.data(), 0, length);
+  }
+
+  // Reads what the interop wrote with WriteBulkBytes / WriteBulkRows.
+  bool ReadBulk(uint64_t length) {
+    if (UINT32_MAX < length)
+      return false;
+
+    if (m_Bulk.IsOpen()) {
+      bool inRing;
+      if (!m_Stream.ReadBoolean(inRing))
+        return false;
+
+      if (inRing) {
+        uint32_t offset;
+        if (!m_Stream.ReadUInt32(offset) || m_Bulk.GetSize() < offset ||
+            m_Bulk.GetSize() - offset < length)
+          return false;
+
+        // Stands in for the copy into the D3D resource:
+        if (m_Scratch.size() < length)
+          m_Scratch.resize((size_t)length);
+        memcpy(m_Scratch.data(), m_Bulk.GetData() + offset, (size_t)length);
+
+        m_Stats.BulkBytes += length;
+        return true;
+      }
+    }
+
+    m_Stats.InlineBytes += length;
+    return Skip((uint32_t)length);
+  }
+
+  /**
+   * Answers with the next synthetic HRESULT.
+   * @param outSucceeded optional, receives SUCCEEDED(hr).
+   */
+  bool WriteHr(bool* outSucceeded = nullptr) {
+    ++m_CommandCount;
+    bool succeeded =
+        0 == m_Options.FailEvery || 0 != m_CommandCount % m_Options.FailEvery;
+
+    if (outSucceeded)
+      *outSucceeded = succeeded;
+
+    if (succeeded)
+      return m_Stream.WriteInt32(0);
+
+    ++m_Stats.Failed;
+    return m_Stream.WriteInt32(g_E_FAIL) && m_Stream.WriteUInt32(g_LastError);
+  }
+
+  // Reply of the Create commands that can share a handle.
+  bool WriteCreateResult(bool hasHandle) {
+    bool succeeded;
+    if (!WriteHr(&succeeded))
+      return false;
+    return !(succeeded && hasHandle) ||
+           m_Stream.WriteUInt32(0x1000 + (uint32_t)m_CommandCount);
+  }
+
+  bool ReadHandleArgument(bool& outHasHandle) {
+    return m_Stream.ReadBoolean(outHasHandle) && (!outHasHandle || Skip(4));
+  }
+
+  bool ReadShaderConstants(uint32_t size) {
+    uint32_t count;
+    return Skip(4) && m_Stream.ReadUInt32(count) &&
+           Skip(count * size) && WriteHr();
+  }
+
+  bool DoSetBulkChannel() {
+    std::string name;
+    uint32_t size;
+    if (!m_Stream.ReadStringUTF8(name) || !m_Stream.ReadUInt32(size))
+      return false;
+
+    m_Bulk.Close();
+
+    bool accepted = name.empty();
+    if (!accepted && m_Options.Bulk)
+      accepted = m_Bulk.Open(name.c_str(), size);
+
+    return m_Stream.WriteBoolean(accepted);
+  }
+
+  bool DoCommand(DrawingReply command) {
+    bool hasHandle;
+    bool has;
+    uint32_t size;
+
+    switch (command) {
+      case DrawingReply::D3d9CreateVertexDeclaration:
+        // UInt64 index, UInt32 size, bulk
+        return Skip(8) && m_Stream.ReadUInt32(size) && ReadBulk(size) &&
+               WriteHr();
+
+      case DrawingReply::D3d9CreateIndexBuffer:
+      case DrawingReply::D3d9CreateVertexBuffer:
+        // UInt32 index, length, usage, format / fvf, pool, handle
+        return Skip(5 * 4) && ReadHandleArgument(hasHandle) &&
+               WriteCreateResult(hasHandle);
+
+      case DrawingReply::D3d9CreateTexture:
+        // UInt64 index, UInt32 width, height, levels, usage, format, pool,
+        // handle
+        return Skip(8 + 6 * 4) && ReadHandleArgument(hasHandle) &&
+               WriteCreateResult(hasHandle);
+
+      case DrawingReply::UpdateD3d9IndexBuffer:
+      case DrawingReply::UpdateD3d9VertexBuffer:
+        // UInt64 index, UInt32 offset, UInt32 size, bulk
+        return Skip(8 + 4) && m_Stream.ReadUInt32(size) && ReadBulk(size) &&
+               WriteHr();
+
+      case DrawingReply::UpdateD3d9Texture: {
+        // UInt64 index, UInt32 level, rect, UInt32 rows, UInt32 bytes per
+        // row, bulk rows
+        uint32_t numRows;
+        return Skip(8 + 4) && m_Stream.ReadBoolean(has) &&
+               (!has || Skip(4 * 4)) && m_Stream.ReadUInt32(numRows) &&
+               m_Stream.ReadUInt32(size) &&
+               ReadBulk((uint64_t)numRows * size) && WriteHr();
+      }
+
+      case DrawingReply::D3d9CreateVertexShader:
+      case DrawingReply::D3d9CreatePixelShader:
+        // UInt64 index, UInt32 size, bytes
+        return Skip(8) && m_Stream.ReadUInt32(size) && Skip(size) && WriteHr();
+
+      case DrawingReply::ReleaseD3d9VertexDeclaration:
+      case DrawingReply::ReleaseD3d9IndexBuffer:
+      case DrawingReply::ReleaseD3d9VertexBuffer:
+      case DrawingReply::ReleaseD3d9Texture:
+      case DrawingReply::ReleaseD3d9VertexShader:
+      case DrawingReply::ReleaseD3d9PixelShader:
+      case DrawingReply::ReleaseD3d9Surface:
+        // UInt64 index, no reply
+        return Skip(8);
+
+      case DrawingReply::D3d9SetViewport:
+        // Boolean, UInt32 x, y, width, height, Single minZ, maxZ
+        return m_Stream.ReadBoolean(has) && (!has || Skip(6 * 4)) && WriteHr();
+
+      case DrawingReply::D3d9SetRenderState:
+      case DrawingReply::D3d9SetStreamSourceFreq:
+        return Skip(2 * 4) && WriteHr();
+
+      case DrawingReply::D3d9SetSamplerState:
+      case DrawingReply::D3d9SetTextureStageState:
+      case DrawingReply::D3d9DrawPrimitive:
+        return Skip(3 * 4) && WriteHr();
+
+      case DrawingReply::D3d9SetTexture:
+        // UInt32 sampler, UInt64 index
+        return Skip(4 + 8) && WriteHr();
+
+      case DrawingReply::D3d9SetTransform:
+        // UInt32 state, Boolean, matrix
+        return Skip(4) && m_Stream.ReadBoolean(has) && (!has || Skip(16 * 4)) &&
+               WriteHr();
+
+      case DrawingReply::D3d9SetIndices:
+      case DrawingReply::D3d9SetVertexDeclaration:
+      case DrawingReply::D3d9SetVertexShader:
+      case DrawingReply::D3d9SetPixelShader:
+        return Skip(8) && WriteHr();
+
+      case DrawingReply::D3d9SetStreamSource:
+        // UInt32 stream, UInt64 index, UInt32 offset, UInt32 stride
+        return Skip(4 + 8 + 4 + 4) && WriteHr();
+
+      case DrawingReply::D3d9SetVertexShaderConstantF:
+      case DrawingReply::D3d9SetVertexShaderConstantI:
+      case DrawingReply::D3d9SetPixelShaderConstantF:
+      case DrawingReply::D3d9SetPixelShaderConstantI:
+        return ReadShaderConstants(4);
+
+      case DrawingReply::D3d9SetVertexShaderConstantB:
+      case DrawingReply::D3d9SetPixelShaderConstantB:
+        return ReadShaderConstants(1);
+
+      case DrawingReply::D3d9DrawIndexedPrimitive:
+        return Skip(6 * 4) && WriteHr();
+
+      case DrawingReply::WaitForGpu:
+        return m_Stream.WriteBoolean(true);
+
+      case DrawingReply::BeginCleanState:
+      case DrawingReply::EndCleanState:
+        return true;
+
+      case DrawingReply::D3d9UpdateTexture:
+        // UInt64 source, UInt64 destination
+        return Skip(2 * 8) && WriteHr();
+
+      case DrawingReply::DrawPrimitiveUP:
+        // UInt32 type, count, stride, data
+        return Skip(3 * 4) && m_Stream.ReadBoolean(has) &&
+               (!has || (m_Stream.ReadUInt32(size) && ReadBulk(size))) &&
+               WriteHr();
+
+      case DrawingReply::GetRenderTarget:
+        // Succeeds without a target.
+        return Skip(8) && m_Stream.WriteBoolean(true) &&
+               m_Stream.WriteBoolean(false);
+
+      case DrawingReply::SetRenderTarget:
+        return Skip(8) && m_Stream.WriteBoolean(true);
+
+      case DrawingReply::D3d9TextureGetSurfaceLevel:
+        // UInt64 texture, UInt32 level, UInt64 surface
+        return Skip(8 + 4 + 8) && WriteHr();
+
+      case DrawingReply::D3d9StretchRect:
+        // UInt64 source, rect, UInt64 destination, rect, Int32 filter
+        return Skip(8) && m_Stream.ReadBoolean(has) && (!has || Skip(4 * 4)) &&
+               Skip(8) && m_Stream.ReadBoolean(has) && (!has || Skip(4 * 4)) &&
+               Skip(4) && WriteHr();
+
+      case DrawingReply::SetBulkChannel:
+        return DoSetBulkChannel();
+
+      default:
+        break;
+    }
+
+    return false;
+  }
+};
+
+// Reporting //////////////////////////////////////////////////////////////
+
+double PerSecond(uint64_t count, std::chrono::steady_clock::duration elapsed) {
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  return 0 < seconds ? count / seconds : 0;
+}
+
+void PrintSummary(const char* side, Stats_s& stats) {
+  std::vector<uint32_t>& frameUs = stats.FrameUs;
+  std::sort(frameUs.begin(), frameUs.end());
+
+  auto percentile = [&frameUs](double p) -> uint32_t {
+    if (frameUs.empty())
+      return 0;
+    return frameUs[(size_t)(p * (frameUs.size() - 1))];
+  };
+
+  printf(
+      "%-8s %8llu frames %9.1f fps   frame us p50 %6u p99 %6u max %6u\n",
+      side, (unsigned long long)stats.Frames.load(),
+      PerSecond(stats.Frames, stats.Elapsed), percentile(0.5),
+      percentile(0.99), frameUs.empty() ? 0 : frameUs.back());
+  printf("%-8s %8llu %-8s %9.1f /s", "", (unsigned long long)stats.Messages.load(),
+         0 == strcmp(side, "engine") ? "messages" : "commands",
+         PerSecond(stats.Messages, stats.Elapsed));
+  if (0 == strcmp(side, "engine"))
+    printf("   events %llu (%.1f /s), calcs %llu, reconnects %llu",
+           (unsigned long long)stats.Events.load(),
+           PerSecond(stats.Events, stats.Elapsed),
+           (unsigned long long)stats.Calcs.load(),
+           (unsigned long long)stats.Reconnects.load());
+  else
+    printf("   failed %llu, retries %llu, reconnects %llu, bulk %llu B, "
+           "inline %llu B",
+           (unsigned long long)stats.Failed.load(),
+           (unsigned long long)stats.Retries.load(),
+           (unsigned long long)stats.Reconnects.load(),
+           (unsigned long long)stats.BulkBytes.load(),
+           (unsigned long long)stats.InlineBytes.load());
+  printf("\n");
+}
+
+bool ParseUInt(const char* value, uint32_t& outValue) {
+  char* end;
+  unsigned long result = strtoul(value, &end, 10);
+  if (end == value || '\0' != *end)
+    return false;
+  outValue = (uint32_t)result;
+  return true;
+}
+
+bool ParseOptions(int argc, char* argv[], Options_s& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool ok = true;
+
+    if (0 == strcmp(arg, "--no-bulk")) {
+      options.Bulk = false;
+      continue;
+    }
+    if (0 == strcmp(arg, "--no-resume")) {
+      options.Resume = false;
+      continue;
+    }
+    if (0 == strcmp(arg, "--legacy")) {
+      options.Legacy = true;
+      continue;
+    }
+
+    if (nullptr == value)
+      return false;
+    ++i;
+
+    if (0 == strcmp(arg, "--engine"))
+      options.EngineName = value;
+    else if (0 == strcmp(arg, "--drawing"))
+      options.DrawingName = value;
+    else if (0 == strcmp(arg, "--frames"))
+      ok = ParseUInt(value, options.Frames);
+    else if (0 == strcmp(arg, "--fps"))
+      ok = ParseUInt(value, options.Fps);
+    else if (0 == strcmp(arg, "--passes"))
+      ok = ParseUInt(value, options.Passes);
+    else if (0 == strcmp(arg, "--commands"))
+      ok = ParseUInt(value, options.Commands);
+    else if (0 == strcmp(arg, "--events"))
+      ok = ParseUInt(value, options.Events);
+    else if (0 == strcmp(arg, "--storm")) {
+      std::string every(value);
+      size_t colon = every.find(':');
+      ok = std::string::npos != colon &&
+           ParseUInt(every.substr(0, colon).c_str(), options.StormEvery) &&
+           ParseUInt(every.substr(colon + 1).c_str(), options.StormEvents);
+    } else if (0 == strcmp(arg, "--calc-miss"))
+      ok = ParseUInt(value, options.CalcMissPercent);
+    else if (0 == strcmp(arg, "--fail-every"))
+      ok = ParseUInt(value, options.FailEvery);
+    else if (0 == strcmp(arg, "--reconnect-every"))
+      ok = ParseUInt(value, options.ReconnectEvery);
+    else if (0 == strcmp(arg, "--report"))
+      ok = ParseUInt(value, options.ReportSeconds);
+    else
+      return false;
+
+    if (!ok)
+      return false;
+  }
+
+  return !options.EngineName.empty() || !options.DrawingName.empty();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options_s options;
+  if (!ParseOptions(argc, argv, options)) {
+    fprintf(stderr,
+            "Usage: %s [--engine <name>] [--drawing <name>] [--frames <n>] "
+            "[--fps <n>] [--passes <n>] [--commands <n>] [--events <n>] "
+            "[--storm <every>:<n>] [--calc-miss <percent>] "
+            "[--fail-every <n>] [--reconnect-every <n>] [--no-bulk] "
+            "[--no-resume] [--legacy] "
+            "[--report <seconds>]\n",
+            argv[0]);
+    return 2;
+  }
+
+  Stats_s engineStats;
+  Stats_s drawingStats;
+  std::atomic<int> running{0};
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> threads;
+
+  if (!options.EngineName.empty()) {
+    ++running;
+    threads.emplace_back([&]() {
+      CEngineSimulator simulator(options, engineStats);
+      if (!simulator.Run(options.EngineName))
+        failed = true;
+      --running;
+    });
+  }
+
+  if (!options.DrawingName.empty()) {
+    ++running;
+    threads.emplace_back([&]() {
+      CDrawingSimulator simulator(options, drawingStats);
+      if (!simulator.Run(options.DrawingName))
+        failed = true;
+      --running;
+    });
+  }
+
+  uint64_t lastEngineFrames = 0, lastEvents = 0;
+  uint64_t lastDrawingFrames = 0, lastCommands = 0;
+  auto lastReport = std::chrono::steady_clock::now();
+
+  while (0 < running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto now = std::chrono::steady_clock::now();
+    if (0 == options.ReportSeconds ||
+        now - lastReport < std::chrono::seconds(options.ReportSeconds))
+      continue;
+
+    auto elapsed = now - lastReport;
+    lastReport = now;
+
+    uint64_t engineFrames = engineStats.Frames;
+    uint64_t events = engineStats.Events;
+    uint64_t drawingFrames = drawingStats.Frames;
+    uint64_t commands = drawingStats.Messages;
+
+    printf(
+        "engine %7.1f fps %9.1f events/s | drawing %7.1f fps %9.1f "
+        "commands/s\n",
+        PerSecond(engineFrames - lastEngineFrames, elapsed),
+        PerSecond(events - lastEvents, elapsed),
+        PerSecond(drawingFrames - lastDrawingFrames, elapsed),
+        PerSecond(commands - lastCommands, elapsed));
+
+    lastEngineFrames = engineFrames;
+    lastEvents = events;
+    lastDrawingFrames = drawingFrames;
+    lastCommands = commands;
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (!options.EngineName.empty())
+    PrintSummary("engine", engineStats);
+  if (!options.DrawingName.empty())
+    PrintSummary("drawing", drawingStats);
+
+  return failed ? 1 : 0;
+}
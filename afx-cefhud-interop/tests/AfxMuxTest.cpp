@@ -0,0 +1,227 @@
+// Channels and flow control of CMuxConnection over a socketpair.
+
+#include "AfxTest.h"
+
+#include "AfxMux.h"
+#include "AfxTransport.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+namespace {
+
+void SleepMs(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Two connections talking to each other, each with its reading thread.
+class CMuxPair {
+ public:
+  CMuxPair() {}
+
+  ~CMuxPair() { Stop(); }
+
+  bool Start() {
+    if (!CUnixSocketTransport::CreatePair(m_Initiating, m_Accepting))
+      return false;
+
+    Initiator = std::make_shared<CMuxConnection>(&m_Initiating, true);
+    Acceptor = std::make_shared<CMuxConnection>(&m_Accepting, false);
+
+    m_InitiatorThread = std::thread([this]() { Initiator->Run(); });
+    m_AcceptorThread = std::thread([this]() { Acceptor->Run(); });
+    return true;
+  }
+
+  void Stop() {
+    m_Initiating.Cancel();
+    m_Accepting.Cancel();
+    if (m_InitiatorThread.joinable())
+      m_InitiatorThread.join();
+    if (m_AcceptorThread.joinable())
+      m_AcceptorThread.join();
+  }
+
+  std::shared_ptr<CMuxConnection> Initiator;
+  std::shared_ptr<CMuxConnection> Acceptor;
+
+ private:
+  CUnixSocketTransport m_Initiating;
+  CUnixSocketTransport m_Accepting;
+  std::thread m_InitiatorThread;
+  std::thread m_AcceptorThread;
+};
+
+void WriteRawFrame(CTransport& transport,
+                   uint32_t id,
+                   MuxFrame kind,
+                   const std::vector<unsigned char>& payload) {
+  unsigned char header[9];
+  uint32_t length = (uint32_t)payload.size();
+  memcpy(&header[0], &id, sizeof(id));
+  header[4] = (unsigned char)kind;
+  memcpy(&header[5], &length, sizeof(length));
+  transport.WriteAll(header, sizeof(header));
+  if (0 < length)
+    transport.WriteAll(payload.data(), length);
+}
+
+}  // namespace
+
+AFX_TEST(MuxChannelRoundTrip) {
+  CMuxPair pair;
+  AFX_REQUIRE(pair.Start());
+
+  auto opened = pair.Initiator->OpenChannel();
+  AFX_REQUIRE(nullptr != opened);
+  auto accepted = pair.Acceptor->AcceptChannel();
+  AFX_REQUIRE(nullptr != accepted);
+  AFX_CHECK(opened->GetId() == accepted->GetId());
+  AFX_CHECK(1 == (opened->GetId() & 1));
+
+  // More than a frame, so it gets split:
+  std::vector<unsigned char> sent(3 * g_MuxMaxFrameSize + 17);
+  for (size_t i = 0; i < sent.size(); ++i)
+    sent[i] = (unsigned char)(i * 7);
+
+  std::thread writer([&opened, &sent]() {
+    opened->WriteAll(sent.data(), (uint32_t)sent.size());
+  });
+
+  std::vector<unsigned char> received(sent.size());
+  AFX_CHECK(accepted->ReadAll(received.data(), (uint32_t)received.size()));
+  writer.join();
+  AFX_CHECK(sent == received);
+
+  // And back the other way:
+  const char reply[] = "reply";
+  AFX_CHECK(accepted->WriteAll(reply, sizeof(reply)));
+  char replyReceived[sizeof(reply)];
+  AFX_CHECK(opened->ReadAll(replyReceived, sizeof(replyReceived)));
+  AFX_CHECK(0 == memcmp(reply, replyReceived, sizeof(reply)));
+}
+
+AFX_TEST(MuxFullChannelDoesNotStallOthers) {
+  CMuxPair pair;
+  AFX_REQUIRE(pair.Start());
+
+  auto stuck = pair.Initiator->OpenChannel();
+  AFX_REQUIRE(nullptr != stuck);
+  auto stuckPeer = pair.Acceptor->AcceptChannel();
+  AFX_REQUIRE(nullptr != stuckPeer);
+
+  // Nobody reads, so this fills the window:
+  std::vector<unsigned char> window(g_MuxWindowSize);
+  AFX_REQUIRE(stuck->WriteAll(window.data(), (uint32_t)window.size()));
+
+  std::atomic<bool> written(false);
+  std::thread blocked([&stuck, &written]() {
+    unsigned char byte = 1;
+    stuck->WriteAll(&byte, 1);
+    written = true;
+  });
+
+  auto other = pair.Initiator->OpenChannel();
+  AFX_REQUIRE(nullptr != other);
+  auto otherPeer = pair.Acceptor->AcceptChannel();
+  AFX_REQUIRE(nullptr != otherPeer);
+
+  unsigned char byte = 2;
+  AFX_CHECK(other->WriteAll(&byte, 1));
+  AFX_CHECK(otherPeer->ReadAll(&byte, 1));
+  AFX_CHECK(2 == byte);
+
+  SleepMs(50);
+  AFX_CHECK(!written);
+
+  // Reading grants credit again:
+  std::vector<unsigned char> received(g_MuxWindowSize + 1);
+  AFX_CHECK(stuckPeer->ReadAll(received.data(), (uint32_t)received.size()));
+  blocked.join();
+  AFX_CHECK(written);
+  AFX_CHECK(1 == received.back());
+}
+
+AFX_TEST(MuxCloseKeepsSentBytesReadable) {
+  CMuxPair pair;
+  AFX_REQUIRE(pair.Start());
+
+  auto opened = pair.Initiator->OpenChannel();
+  AFX_REQUIRE(nullptr != opened);
+  auto accepted = pair.Acceptor->AcceptChannel();
+  AFX_REQUIRE(nullptr != accepted);
+
+  const char last[] = "last";
+  AFX_CHECK(opened->WriteAll(last, sizeof(last)));
+  opened->Close();
+
+  char received[sizeof(last)];
+  AFX_CHECK(accepted->ReadAll(received, sizeof(received)));
+  AFX_CHECK(0 == memcmp(last, received, sizeof(last)));
+
+  uint32_t read = 0;
+  AFX_CHECK(!accepted->ReadSome(received, sizeof(received), read));
+  AFX_CHECK(!accepted->WriteAll(last, sizeof(last)));
+}
+
+AFX_TEST(MuxRejectsPeerExceedingWindow) {
+  CUnixSocketTransport peer;
+  CUnixSocketTransport accepting;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(peer, accepting));
+
+  auto connection = std::make_shared<CMuxConnection>(&accepting, false);
+
+  // Ignores the credit the connection grants, the reads are on our side:
+  std::thread writer([&peer]() {
+    WriteRawFrame(peer, 1, MuxFrame::Open, std::vector<unsigned char>());
+    std::vector<unsigned char> payload(g_MuxMaxFrameSize);
+    for (uint32_t sent = 0; sent <= g_MuxWindowSize; sent += g_MuxMaxFrameSize)
+      WriteRawFrame(peer, 1, MuxFrame::Data, payload);
+  });
+
+  AFX_CHECK(!connection->Run());
+  AFX_CHECK(connection->IsShutdown());
+
+  writer.join();
+}
+
+AFX_TEST(MuxRejectsPeerUsingOwnIds) {
+  CUnixSocketTransport peer;
+  CUnixSocketTransport accepting;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(peer, accepting));
+
+  auto connection = std::make_shared<CMuxConnection>(&accepting, false);
+
+  // Even ids are the accepting side's:
+  WriteRawFrame(peer, 2, MuxFrame::Open, std::vector<unsigned char>());
+
+  AFX_CHECK(!connection->Run());
+}
+
+AFX_TEST(MuxTransportEndShutsDown) {
+  CMuxPair pair;
+  AFX_REQUIRE(pair.Start());
+
+  auto opened = pair.Initiator->OpenChannel();
+  AFX_REQUIRE(nullptr != opened);
+  auto accepted = pair.Acceptor->AcceptChannel();
+  AFX_REQUIRE(nullptr != accepted);
+
+  pair.Stop();
+
+  AFX_CHECK(pair.Acceptor->IsShutdown());
+  AFX_CHECK(nullptr == pair.Acceptor->AcceptChannel());
+  AFX_CHECK(nullptr == pair.Initiator->OpenChannel());
+
+  unsigned char byte;
+  uint32_t read = 0;
+  AFX_CHECK(!accepted->ReadSome(&byte, 1, read));
+  AFX_CHECK(!opened->WriteAll(&byte, 1));
+}
@@ -0,0 +1,88 @@
+// Threads of the CTaskPool and CPooledThread.
+
+#include "AfxTest.h"
+
+#include "AfxTaskPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+AFX_TEST(TaskPoolRunsTasks) {
+  const int count = 1000;
+  std::atomic<int> ran(0);
+  std::promise<void> done;
+  std::future<void> finished = done.get_future();
+
+  for (int i = 0; i < count; ++i) {
+    CTaskPool::Get().Submit([&ran, &done]() {
+      if (count == ++ran)
+        done.set_value();
+    });
+  }
+
+  AFX_CHECK(std::future_status::ready ==
+            finished.wait_for(std::chrono::seconds(10)));
+}
+
+AFX_TEST(TaskPoolWaitsWhenSaturated) {
+  std::promise<void> open;
+  std::shared_future<void> opened = open.get_future().share();
+  std::atomic<size_t> running(0);
+  std::atomic<size_t> maxRunning(0);
+  std::atomic<size_t> blocked(0);
+
+  // Twice what the pool may start, all of them block:
+  const size_t count = 2 * g_TaskPoolMaxThreads;
+  std::vector<std::promise<void>> done(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    CTaskPool::Get().Submit([&, i]() {
+      size_t now = ++running;
+      size_t max = maxRunning.load();
+      while (max < now && !maxRunning.compare_exchange_weak(max, now)) {
+      }
+
+      ++blocked;
+      opened.wait();
+      --running;
+      done[i].set_value();
+    });
+  }
+
+  // The ones that got a thread are blocked, the others wait:
+  auto start = std::chrono::steady_clock::now();
+  while (blocked.load() < g_TaskPoolMaxThreads &&
+         std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  AFX_CHECK(g_TaskPoolMaxThreads == blocked.load());
+
+  open.set_value();
+
+  for (auto& task : done) {
+    AFX_CHECK(std::future_status::ready ==
+              task.get_future().wait_for(std::chrono::seconds(10)));
+  }
+  AFX_CHECK(maxRunning.load() <= g_TaskPoolMaxThreads);
+}
+
+AFX_TEST(PooledThreadJoins) {
+  std::atomic<int> sum(0);
+
+  CPooledThread thread(
+      [&sum](int a, int b) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        sum = a + b;
+      },
+      1, 2);
+  AFX_CHECK(thread.joinable());
+
+  thread.join();
+  AFX_CHECK(!thread.joinable());
+  AFX_CHECK(3 == sum.load());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Minimal test registry for the portable interop sources, so the tests have
+// no dependencies beyond the standard library.
+
+#include <stdio.h>
+
+namespace advancedfx {
+namespace interop {
+namespace test {
+
+typedef void (*TestFn_t)(void);
+
+struct TestCase_s {
+  const char* Name;
+  TestFn_t Fn;
+  TestCase_s* Next;
+};
+
+/**
+ * Adds test to the cases main() runs, use AFX_TEST instead.
+ */
+bool RegisterTest(TestCase_s* test);
+
+/**
+ * Marks the running test as failed.
+ */
+void Fail(const char* file, int line, const char* expression);
+
+}  // namespace test
+}  // namespace interop
+}  // namespace advancedfx
+
+#define AFX_TEST(name)                                                  \
+  static void name(void);                                               \
+  static ::advancedfx::interop::test::TestCase_s g_Test_##name = {      \
+      #name, &name, nullptr};                                           \
+  static bool g_TestRegistered_##name =                                 \
+      ::advancedfx::interop::test::RegisterTest(&g_Test_##name);        \
+  static void name(void)
+
+// Fails the running test if expression is false and continues.
+#define AFX_CHECK(expression)                                               \
+  do {                                                                      \
+    if (!(expression))                                                      \
+      ::advancedfx::interop::test::Fail(__FILE__, __LINE__, #expression);   \
+  } while (false)
+
+// Fails the running test and returns from it if expression is false.
+#define AFX_REQUIRE(expression)                                             \
+  do {                                                                      \
+    if (!(expression)) {                                                    \
+      ::advancedfx::interop::test::Fail(__FILE__, __LINE__, #expression);   \
+      return;                                                               \
+    }                                                                       \
+  } while (false)
@@ -0,0 +1,66 @@
+// Runs the interop tests.
+//
+// Usage: afx-cefhud-interop-tests [name]
+//
+// Runs the test called name, or all of them. The exit code is the number of
+// tests that failed.
+
+#include "AfxTest.h"
+
+#include <string.h>
+
+namespace advancedfx {
+namespace interop {
+namespace test {
+
+namespace {
+
+TestCase_s* g_Tests = nullptr;
+TestCase_s** g_TestsTail = &g_Tests;
+bool g_Failed = false;
+
+}  // namespace
+
+bool RegisterTest(TestCase_s* test) {
+  // In the order of registration, so the output follows the sources:
+  *g_TestsTail = test;
+  g_TestsTail = &test->Next;
+  return true;
+}
+
+void Fail(const char* file, int line, const char* expression) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+  g_Failed = true;
+}
+
+}  // namespace test
+}  // namespace interop
+}  // namespace advancedfx
+
+using namespace advancedfx::interop::test;
+
+int main(int argc, char* argv[]) {
+  const char* name = 1 < argc ? argv[1] : nullptr;
+  int ran = 0;
+  int failed = 0;
+
+  for (TestCase_s* test = g_Tests; nullptr != test; test = test->Next) {
+    if (nullptr != name && 0 != strcmp(name, test->Name))
+      continue;
+
+    g_Failed = false;
+    test->Fn();
+    ++ran;
+
+    printf("%s %s\n", g_Failed ? "FAIL" : "ok  ", test->Name);
+    if (g_Failed)
+      ++failed;
+  }
+
+  if (0 == ran) {
+    fprintf(stderr, "No test called %s.\n", nullptr != name ? name : "");
+    return 1;
+  }
+
+  return failed;
+}
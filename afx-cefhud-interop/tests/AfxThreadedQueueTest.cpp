@@ -0,0 +1,223 @@
+// Order, lanes, cancellation and closure storage of CThreadedQueue.
+
+#include "AfxTest.h"
+
+#include "AfxThreadedQueue.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+namespace {
+
+// Collects what the tasks did, in the order they ran.
+class CRecorder {
+ public:
+  void Add(int value) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Values.push_back(value);
+  }
+
+  std::vector<int> Get() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    return m_Values;
+  }
+
+ private:
+  std::mutex m_Mutex;
+  std::vector<int> m_Values;
+};
+
+// Holds up the queue until Open(), so tasks can be queued behind it.
+class CGate {
+ public:
+  CGate() : m_Opened(m_Open.get_future().share()) {}
+
+  /**
+   * Returns once the queue is held up.
+   */
+  void Block(CThreadedQueue& queue) {
+    std::promise<void> blocked;
+    std::future<void> running = blocked.get_future();
+    std::shared_future<void> opened = m_Opened;
+    queue.Queue([&blocked, opened]() {
+      blocked.set_value();
+      opened.wait();
+    });
+    running.wait();
+  }
+
+  void Open() { m_Open.set_value(); }
+
+ private:
+  std::promise<void> m_Open;
+  std::shared_future<void> m_Opened;
+};
+
+/**
+ * @returns once the tasks queued so far ran, deferred ones included.
+ */
+void Drain(CThreadedQueue& queue) {
+  std::promise<void> done;
+  std::future<void> drained = done.get_future();
+  queue.QueueBarrier([&done]() { done.set_value(); });
+  drained.wait();
+}
+
+}  // namespace
+
+AFX_TEST(QueueRunsTasksInOrder) {
+  CThreadedQueue queue;
+  CRecorder recorder;
+
+  for (int i = 0; i < 1000; ++i)
+    queue.Queue([&recorder, i]() { recorder.Add(i); });
+  Drain(queue);
+
+  std::vector<int> values = recorder.Get();
+  AFX_REQUIRE(1000 == values.size());
+  for (int i = 0; i < 1000; ++i)
+    AFX_CHECK(i == values[i]);
+
+  // The last one might still be running:
+  AFX_CHECK(1001 == queue.GetQueued());
+  AFX_CHECK(1001 == queue.GetWaitStats().GetCount());
+  AFX_CHECK(1000 <= queue.GetRunStats().GetCount());
+}
+
+AFX_TEST(QueueRunsTasksFromManyThreads) {
+  CThreadedQueue queue;
+  CRecorder recorder;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < 4; ++p) {
+    producers.emplace_back([&queue, &recorder, p]() {
+      for (int i = 0; i < 1000; ++i)
+        queue.Queue([&recorder, p, i]() { recorder.Add(p * 1000 + i); });
+    });
+  }
+  for (auto& producer : producers)
+    producer.join();
+  Drain(queue);
+
+  // All ran, each producer's in order:
+  std::vector<int> values = recorder.Get();
+  AFX_REQUIRE(4000 == values.size());
+  int next[4] = {0, 1000, 2000, 3000};
+  for (int value : values) {
+    int p = value / 1000;
+    AFX_CHECK(next[p] == value);
+    next[p] = value + 1;
+  }
+}
+
+AFX_TEST(QueueDeferredWaitsForRegular) {
+  CThreadedQueue queue;
+  CRecorder recorder;
+  CGate gate;
+
+  gate.Block(queue);
+  queue.QueueDeferred([&recorder]() { recorder.Add(1); });
+  queue.Queue([&recorder]() { recorder.Add(2); });
+  queue.Queue([&recorder]() { recorder.Add(3); });
+  queue.QueueBarrier([&recorder]() { recorder.Add(4); });
+  queue.Queue([&recorder]() { recorder.Add(5); });
+  gate.Open();
+  Drain(queue);
+
+  // The barrier waits for the deferred task queued before it:
+  AFX_CHECK((std::vector<int>{2, 3, 1, 4, 5}) == recorder.Get());
+}
+
+AFX_TEST(QueueDeferredRunsAfterLimit) {
+  CThreadedQueue queue;
+  CRecorder recorder;
+  CGate gate;
+
+  gate.Block(queue);
+  queue.QueueDeferred([&recorder]() { recorder.Add(-1); });
+  for (int i = 0; i < 2 * g_TaskDeferLimit; ++i)
+    queue.Queue([&recorder, i]() { recorder.Add(i); });
+  gate.Open();
+  Drain(queue);
+
+  std::vector<int> values = recorder.Get();
+  AFX_REQUIRE(2 * g_TaskDeferLimit + 1 == (int)values.size());
+  AFX_CHECK(-1 == values[g_TaskDeferLimit]);
+}
+
+AFX_TEST(QueueCancelMarksQueuedTasks) {
+  CThreadedQueue queue;
+  CRecorder recorder;
+  CGate gate;
+
+  gate.Block(queue);
+  queue.Queue([&]() { recorder.Add(queue.IsCancelled() ? 1 : 0); });
+  queue.QueueDeferred([&]() { recorder.Add(queue.IsCancelled() ? 1 : 0); });
+  queue.Cancel();
+  queue.Queue([&]() { recorder.Add(queue.IsCancelled() ? 1 : 0); });
+  gate.Open();
+  Drain(queue);
+
+  // Cancelled tasks still run:
+  AFX_CHECK((std::vector<int>{1, 0, 1}) == recorder.Get());
+}
+
+AFX_TEST(QueueAbortDropsQueuedTasks) {
+  auto alive = std::make_shared<int>(0);
+  bool ran = false;
+  std::thread opener;
+
+  {
+    CThreadedQueue queue;
+    CGate gate;
+
+    gate.Block(queue);
+    queue.Queue([alive, &ran]() { ran = true; });
+
+    opener = std::thread([&gate]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      gate.Open();
+    });
+
+    // Waits for the running task:
+    queue.Abort();
+    opener.join();
+
+    queue.Queue([alive, &ran]() { ran = true; });
+    AFX_CHECK(3 == alive.use_count());
+  }
+
+  AFX_CHECK(!ran);
+  AFX_CHECK(1 == alive.use_count());
+}
+
+AFX_TEST(QueueRunsBigClosures) {
+  auto alive = std::make_shared<int>(0);
+  int sum = 0;
+
+  {
+    CThreadedQueue queue;
+
+    unsigned char bytes[4 * g_TaskInlineSize];
+    for (size_t i = 0; i < sizeof(bytes); ++i)
+      bytes[i] = (unsigned char)i;
+
+    queue.Queue([alive, bytes, &sum]() {
+      for (size_t i = 0; i < sizeof(bytes); ++i)
+        sum += bytes[i];
+    });
+    Drain(queue);
+  }
+
+  int expected = 0;
+  for (size_t i = 0; i < 4 * g_TaskInlineSize; ++i)
+    expected += (unsigned char)i;
+  AFX_CHECK(expected == sum);
+  AFX_CHECK(1 == alive.use_count());
+}
@@ -0,0 +1,118 @@
+// Deadlines and cancellation of the endpoint transports.
+
+#include "AfxTest.h"
+
+#include "AfxTransport.h"
+
+#include <errno.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock_t;
+
+long long ElapsedMs(Clock_t::time_point start) {
+  return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+             Clock_t::now() - start)
+      .count();
+}
+
+void SleepMs(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+}  // namespace
+
+AFX_TEST(TransportReadTimesOut) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+  a.SetTimeouts(100, AFX_INFINITE_TIMEOUT);
+
+  auto start = Clock_t::now();
+  unsigned char byte;
+  uint32_t read = 0;
+  AFX_CHECK(!a.ReadSome(&byte, 1, read));
+  AFX_CHECK(a.GetTimedOut());
+  AFX_CHECK(ETIMEDOUT == a.GetErrorCode());
+  AFX_CHECK(90 <= ElapsedMs(start));
+}
+
+AFX_TEST(TransportReadDeadlineIsPerOperation) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+  a.SetTimeouts(300, AFX_INFINITE_TIMEOUT);
+
+  // Every part arrives well within the timeout, the whole doesn't:
+  std::thread peer([&b]() {
+    for (int i = 0; i < 10; ++i) {
+      SleepMs(100);
+      unsigned char byte = 0;
+      uint32_t written;
+      b.WriteSome(&byte, 1, written);
+    }
+  });
+
+  auto start = Clock_t::now();
+  unsigned char bytes[10];
+  AFX_CHECK(!a.ReadAll(bytes, sizeof(bytes)));
+  AFX_CHECK(a.GetTimedOut());
+  AFX_CHECK(ElapsedMs(start) < 900);
+
+  peer.join();
+
+  // A read outside of the operation gets its own full timeout:
+  uint32_t read = 0;
+  AFX_CHECK(a.ReadSome(bytes, sizeof(bytes), read));
+  AFX_CHECK(0 < read);
+}
+
+AFX_TEST(TransportWriteTimesOut) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+  a.SetTimeouts(AFX_INFINITE_TIMEOUT, 100);
+
+  // b never reads, so the socket buffers fill up:
+  std::vector<unsigned char> bytes(16 * 1024 * 1024);
+  AFX_CHECK(!a.WriteAll(bytes.data(), (uint32_t)bytes.size()));
+  AFX_CHECK(a.GetTimedOut());
+}
+
+AFX_TEST(TransportCancelEndsPendingRead) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+
+  std::thread canceller([&a]() {
+    SleepMs(50);
+    a.Cancel();
+  });
+
+  unsigned char byte;
+  uint32_t read = 0;
+  AFX_CHECK(!a.ReadSome(&byte, 1, read));
+  AFX_CHECK(!a.GetTimedOut());
+
+  canceller.join();
+
+  // Further calls fail as well:
+  uint32_t written = 0;
+  AFX_CHECK(!a.WriteSome(&byte, 1, written));
+  AFX_CHECK(ECANCELED == a.GetErrorCode());
+}
+
+AFX_TEST(TransportOpenWhenReadyTimesOut) {
+  CUnixSocketTransport client;
+
+  auto start = Clock_t::now();
+  AFX_CHECK(!client.OpenWhenReady("afx-cefhud-interop-test-nobody", 100));
+  AFX_CHECK(client.GetTimedOut());
+  AFX_CHECK(90 <= ElapsedMs(start));
+}
@@ -0,0 +1,223 @@
+// CTransportStream batching, checked against a socketpair.
+
+#include "AfxTest.h"
+
+#include "AfxTransport.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+using namespace advancedfx::interop;
+
+namespace {
+
+// Counts the calls going to the wrapped transport.
+class CCountingTransport : public CTransport {
+ public:
+  explicit CCountingTransport(CTransport* transport) : m_Transport(transport) {}
+
+  virtual bool ReadSome(void* bytes,
+                        uint32_t length,
+                        uint32_t& outRead) override {
+    return m_Transport->ReadSome(bytes, length, outRead);
+  }
+
+  virtual bool WriteSome(const void* bytes,
+                         uint32_t length,
+                         uint32_t& outWritten) override {
+    ++WriteSomeCalls;
+    return m_Transport->WriteSome(bytes, length, outWritten);
+  }
+
+  virtual bool FlushTransport() override {
+    return m_Transport->FlushTransport();
+  }
+
+  int WriteSomeCalls = 0;
+
+ private:
+  CTransport* m_Transport;
+};
+
+// Writes each primitive to the transport right away, like the pipe classes
+// did before writes were buffered.
+class CUnbufferedWriter {
+ public:
+  explicit CUnbufferedWriter(CTransport* transport) : m_Transport(transport) {}
+
+  bool WriteBytes(const void* bytes, uint32_t length) {
+    return m_Transport->WriteAll(bytes, length);
+  }
+
+  bool WriteBoolean(bool value) {
+    uint8_t tmp = value ? 1 : 0;
+    return WriteBytes(&tmp, sizeof(tmp));
+  }
+
+  bool WriteByte(uint8_t value) { return WriteBytes(&value, sizeof(value)); }
+
+  bool WriteUInt32(uint32_t value) { return WriteBytes(&value, sizeof(value)); }
+
+  bool WriteCompressedUInt32(uint32_t value) {
+    if (value <= 255 - 1)
+      return WriteByte((uint8_t)value);
+    return WriteByte(255) && WriteUInt32(value);
+  }
+
+  bool WriteInt32(int32_t value) { return WriteBytes(&value, sizeof(value)); }
+
+  bool WriteCompressedInt32(int32_t value) {
+    if (-128 <= value && value <= 127 - 1) {
+      signed char tmp = (signed char)value;
+      return WriteBytes(&tmp, sizeof(tmp));
+    }
+    signed char tmp = 127;
+    return WriteBytes(&tmp, sizeof(tmp)) && WriteInt32(value);
+  }
+
+  bool WriteUInt64(uint64_t value) { return WriteBytes(&value, sizeof(value)); }
+
+  bool WriteSingle(float value) { return WriteBytes(&value, sizeof(value)); }
+
+  bool WriteStringUTF8(const std::string& value) {
+    return WriteCompressedUInt32((uint32_t)value.length()) &&
+           WriteBytes(value.c_str(), (uint32_t)value.length());
+  }
+
+ private:
+  CTransport* m_Transport;
+};
+
+const std::string g_LongString(300, 'x');
+
+// A frame with each primitive, including both encodings of the compressed
+// ones.
+template <class Writer>
+bool WriteMixedFrame(Writer& writer) {
+  return writer.WriteBoolean(true) && writer.WriteByte(0xab) &&
+         writer.WriteUInt32(0xdeadbeef) && writer.WriteCompressedUInt32(7) &&
+         writer.WriteCompressedUInt32(100000) && writer.WriteInt32(-5) &&
+         writer.WriteCompressedInt32(-3) &&
+         writer.WriteCompressedInt32(-100000) &&
+         writer.WriteUInt64(0x0123456789abcdefull) &&
+         writer.WriteSingle(1.5f) && writer.WriteStringUTF8("afx") &&
+         writer.WriteStringUTF8(g_LongString);
+}
+
+bool ReadRaw(CTransport& transport, std::vector<unsigned char>& outBytes,
+             size_t length) {
+  outBytes.resize(length);
+  return transport.ReadAll(outBytes.data(), (uint32_t)length);
+}
+
+}  // namespace
+
+AFX_TEST(TransportStreamWritesFrameOnce) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+
+  CCountingTransport counting(&a);
+  CTransportStream stream(&counting);
+
+  AFX_REQUIRE(WriteMixedFrame(stream));
+  AFX_CHECK(0 == counting.WriteSomeCalls);
+
+  AFX_REQUIRE(stream.Flush());
+  AFX_CHECK(1 == counting.WriteSomeCalls);
+  AFX_CHECK(0 < stream.GetBytesWritten());
+
+  // Nothing left to write:
+  AFX_REQUIRE(stream.Flush());
+  AFX_CHECK(1 == counting.WriteSomeCalls);
+}
+
+AFX_TEST(TransportStreamMatchesUnbufferedWireFormat) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+
+  CUnbufferedWriter unbuffered(&a);
+  AFX_REQUIRE(WriteMixedFrame(unbuffered));
+
+  CTransportStream stream(&a);
+  AFX_REQUIRE(WriteMixedFrame(stream));
+  AFX_REQUIRE(stream.Flush());
+
+  size_t frameSize = (size_t)stream.GetBytesWritten();
+
+  std::vector<unsigned char> expected;
+  std::vector<unsigned char> actual;
+  AFX_REQUIRE(ReadRaw(b, expected, frameSize));
+  AFX_REQUIRE(ReadRaw(b, actual, frameSize));
+  AFX_CHECK(expected == actual);
+
+  // And it decodes to what was written:
+  AFX_REQUIRE(WriteMixedFrame(stream));
+  AFX_REQUIRE(stream.Flush());
+
+  CTransportStream reader(&b);
+  bool boolValue = false;
+  uint8_t byteValue = 0;
+  uint32_t uint32Value = 0;
+  uint32_t compressedSmall = 0;
+  uint32_t compressedBig = 0;
+  int32_t int32Value = 0;
+  int32_t compressedNegative = 0;
+  int32_t compressedNegativeBig = 0;
+  uint64_t uint64Value = 0;
+  float singleValue = 0;
+  std::string shortString;
+  std::string longString;
+
+  AFX_REQUIRE(reader.ReadBoolean(boolValue));
+  AFX_REQUIRE(reader.ReadByte(byteValue));
+  AFX_REQUIRE(reader.ReadUInt32(uint32Value));
+  AFX_REQUIRE(reader.ReadCompressedUInt32(compressedSmall));
+  AFX_REQUIRE(reader.ReadCompressedUInt32(compressedBig));
+  AFX_REQUIRE(reader.ReadInt32(int32Value));
+  AFX_REQUIRE(reader.ReadCompressedInt32(compressedNegative));
+  AFX_REQUIRE(reader.ReadCompressedInt32(compressedNegativeBig));
+  AFX_REQUIRE(reader.ReadUInt64(uint64Value));
+  AFX_REQUIRE(reader.ReadSingle(singleValue));
+  AFX_REQUIRE(reader.ReadStringUTF8(shortString));
+  AFX_REQUIRE(reader.ReadStringUTF8(longString));
+
+  AFX_CHECK(boolValue);
+  AFX_CHECK(0xab == byteValue);
+  AFX_CHECK(0xdeadbeef == uint32Value);
+  AFX_CHECK(7 == compressedSmall);
+  AFX_CHECK(100000 == compressedBig);
+  AFX_CHECK(-5 == int32Value);
+  AFX_CHECK(-3 == compressedNegative);
+  AFX_CHECK(-100000 == compressedNegativeBig);
+  AFX_CHECK(0x0123456789abcdefull == uint64Value);
+  AFX_CHECK(1.5f == singleValue);
+  AFX_CHECK("afx" == shortString);
+  AFX_CHECK(g_LongString == longString);
+}
+
+AFX_TEST(TransportStreamSendsPendingBeforeRead) {
+  CUnixSocketTransport a;
+  CUnixSocketTransport b;
+  AFX_REQUIRE(CUnixSocketTransport::CreatePair(a, b));
+
+  CTransportStream client(&a);
+  CTransportStream server(&b);
+
+  // The peer answers only once it has the whole request, so the read must
+  // send it even without a Flush():
+  AFX_REQUIRE(client.WriteUInt32(42));
+  AFX_REQUIRE(server.WriteUInt32(43));
+  AFX_REQUIRE(server.Flush());
+
+  uint32_t answer = 0;
+  AFX_REQUIRE(client.ReadUInt32(answer));
+  AFX_CHECK(43 == answer);
+
+  uint32_t request = 0;
+  AFX_REQUIRE(server.ReadUInt32(request));
+  AFX_CHECK(42 == request);
+}